@@ -11,6 +11,7 @@
 #include "Bitcoin.h"
 #include <Hash.h>
 #include <Conversion.h>
+#include <utility/trezor/aes_ctr.h>
 #include <WiFi.h>
 #include "esp_adc_cal.h"
 #include "SPIFFS.h"
@@ -24,6 +25,10 @@ String baseURL = "https://legend.lnbits.com/lnurlpos/api/v1/lnurl/UZsLkBSzdDqEFg
 String key = "UzhUjUGFvEtJRaVSpxxNCa";
 String currency = "USD";
 
+// Payload encryption: 1 = XOR (max 51 bytes, supported by every LNbits version),
+// 2 = AES-256-CTR (room for extra data, server needs the variant 2 decoder)
+#define PAYLOAD_VARIANT 1
+
 //////////////KEYPAD///////////////////
 bool isLilyGoKeyboard = false;
 
@@ -556,14 +561,17 @@ void loadConfig() {
 
 void makeLNURL()
 {
-  randomPin = random(1000, 9999);
+  // ChaCha20 DRBG seeded from the hardware RNG (see uBitcoin rand.h)
+  randomPin = 1000 + random_uniform(9000);
   byte nonce[8];
-  for (int i = 0; i < 8; i++)
-  {
-    nonce[i] = random(256);
-  }
+  random_buffer(nonce, sizeof(nonce));
+#if PAYLOAD_VARIANT == 2
+  byte payload[128];
+  size_t payload_len = aes_encrypt(payload, sizeof(payload), (uint8_t *)key.c_str(), key.length(), nonce, sizeof(nonce), randomPin, inputs.toInt(), currencyByte(), NULL, 0);
+#else
   byte payload[51]; // 51 bytes is max one can get with xor-encryption
   size_t payload_len = xor_encrypt(payload, sizeof(payload), (uint8_t *)key.c_str(), key.length(), nonce, sizeof(nonce), randomPin, inputs.toInt());
+#endif
   preparedURL = baseURL + "?p=";
   preparedURL += toBase64(payload, payload_len, BASE64_URLSAFE | BASE64_NOPADDING);
   Serial.println(preparedURL);
@@ -633,3 +641,77 @@ int xor_encrypt(uint8_t *output, size_t outlen, uint8_t *key, size_t keylen, uin
   // return number of bytes written to the output
   return cur;
 }
+
+/*
+ * Currency byte of the payload: '$' for USD cents, 's' for satoshi, 'E' for euro cents.
+ */
+uint8_t currencyByte()
+{
+  if (currency == "sat")
+  {
+    return 's';
+  }
+  if (currency == "EUR")
+  {
+    return 'E';
+  }
+  return '$';
+}
+
+/*
+ * Fills output with nonce, AES-256-CTR encrypted payload, and HMAC.
+ * Same framing as xor_encrypt() with variant byte 2, but the payload is not limited by the key size:
+ * <2><len|nonce><len|payload:{pin}{amount}{currency byte}{extra}><hmac>
+ * extra is passed to the server as is (order id, tip, ...), up to 255 bytes of payload in total.
+ * AES key is HMAC(key, "AES key:" + nonce), it is unique per nonce so the counter starts at zero.
+ * Returns number of bytes written to the output, 0 if error occured.
+ */
+int aes_encrypt(uint8_t *output, size_t outlen, uint8_t *key, size_t keylen, uint8_t *nonce, size_t nonce_len, uint64_t pin, uint64_t amount_in_cents, uint8_t currency_byte, const uint8_t *extra, size_t extra_len)
+{
+  size_t payload_len = lenVarInt(pin) + lenVarInt(amount_in_cents) + 1 + extra_len;
+  if (payload_len > 255 || outlen < 2 + nonce_len + 1 + payload_len + 8)
+  {
+    return 0;
+  }
+  int cur = 0;
+  output[cur] = 2; // variant: AES-CTR encryption
+  cur++;
+  // nonce_len | nonce
+  output[cur] = nonce_len;
+  cur++;
+  memcpy(output + cur, nonce, nonce_len);
+  cur += nonce_len;
+  // payload, unencrypted first - <pin><amount><currency byte><extra>
+  output[cur] = (uint8_t)payload_len;
+  cur++;
+  uint8_t *payload = output + cur;
+  cur += writeVarInt(pin, output + cur, outlen - cur);
+  cur += writeVarInt(amount_in_cents, output + cur, outlen - cur);
+  output[cur] = currency_byte;
+  cur++;
+  if (extra_len > 0)
+  {
+    memcpy(output + cur, extra, extra_len);
+    cur += extra_len;
+  }
+  // encrypt it with a key derived from the nonce
+  uint8_t hmacresult[32];
+  SHA256 h;
+  h.beginHMAC(key, keylen);
+  h.write((uint8_t *)"AES key:", 8);
+  h.write(nonce, nonce_len);
+  h.endHMAC(hmacresult);
+  AES_CTX ctx;
+  uint8_t iv[AES_BLOCK_SIZE] = {0};
+  aes_init(&ctx, hmacresult, sizeof(hmacresult));
+  aes_ctr_xor(&ctx, iv, payload, payload_len);
+  aes_clear(&ctx);
+  // add hmac to authenticate
+  h.beginHMAC(key, keylen);
+  h.write((uint8_t *)"Data:", 5);
+  h.write(output, cur);
+  h.endHMAC(hmacresult);
+  memcpy(output + cur, hmacresult, 8);
+  cur += 8;
+  return cur;
+}
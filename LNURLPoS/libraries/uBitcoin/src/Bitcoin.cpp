@@ -6,6 +6,7 @@
 #include <string.h>
 #include "utility/trezor/sha2.h"
 #include "utility/trezor/rfc6979.h"
+#include "utility/trezor/bip340.h"
 #include "utility/trezor/ecdsa.h"
 #include "utility/trezor/secp256k1.h"
 #include "utility/segwit_addr.h"
@@ -144,6 +145,30 @@ size_t mnemonicToEntropy(char * mnemonic, uint8_t * output, size_t outputLen){
 }
 #endif
 
+int mnemonicWordIndex(const char * word, size_t len){
+    return mnemonic_word_index(word, len);
+}
+size_t mnemonicComplete(const char * prefix, size_t len, uint16_t * first){
+    int k = 0;
+    int n = mnemonic_complete(prefix, len, &k);
+    if(first != NULL && n > 0){
+        *first = k;
+    }
+    return n;
+}
+const char * mnemonicWord(uint16_t index){
+    if(index >= 2048){
+        return NULL;
+    }
+    return mnemonic_wordlist()[index];
+}
+bool checkMnemonic(const uint16_t * words, size_t count){
+    if(count > 24){
+        return false;
+    }
+    return mnemonic_check_indexes(words, count);
+}
+
 const char * generateMnemonic(const uint8_t * entropy_data, size_t dataLen){
     return generateMnemonic(24, entropy_data, dataLen);
 }
@@ -444,6 +469,30 @@ String PublicKey::nestedSegwitAddress(const Network * network) const{
     return String(addr);
 }
 #endif
+int PublicKey::taprootAddress(char address[], size_t len, const Network * network) const{
+    memzero(address, len);
+    PublicKey output = taprootTweak(*this);
+    if(!output.isValid()){
+        return 0;
+    }
+    uint8_t prog[32];
+    output.xonly(prog);
+    char addr[76] = { 0 };
+    segwit_addr_encode(addr, network->bech32, 1, prog, sizeof(prog));
+    size_t l = strlen(addr);
+    if(l >= len){
+        return 0;
+    }
+    memcpy(address, addr, l);
+    return l;
+}
+#if USE_ARDUINO_STRING || USE_STD_STRING
+String PublicKey::taprootAddress(const Network * network) const{
+    char addr[76] = { 0 };
+    taprootAddress(addr, sizeof(addr), network);
+    return String(addr);
+}
+#endif
 Script PublicKey::script(ScriptType type) const{
     return Script(*this, type);
 }
@@ -454,6 +503,115 @@ bool PublicKey::verify(const Signature sig, const uint8_t hash[32]) const{
     serialize(pub, 65);
     return (ecdsa_verify_digest(&secp256k1, pub, signature, hash)==0);
 }
+bool PublicKey::fromXonly(const uint8_t arr[32]){
+    uint8_t sec[33];
+    sec[0] = 0x02;
+    memcpy(sec+1, arr, 32);
+    curve_point p;
+    if(!ecdsa_read_pubkey(&secp256k1, sec, &p)){
+        return false;
+    }
+    fromCurvePoint(&p);
+    compressed = true;
+    return true;
+}
+bool PublicKey::schnorrVerify(const SchnorrSignature sig, const uint8_t hash[32]) const{
+    uint8_t signature[64];
+    sig.bin(signature, 64);
+    return (bip340_verify(&secp256k1, point, hash, signature)==0);
+}
+
+// ---------------------------------------------------------------- SchnorrSignature class
+
+SchnorrSignature::SchnorrSignature(const char * hex):SchnorrSignature(){
+    ParseByteStream s(hex);
+    SchnorrSignature::from_stream(&s);
+}
+size_t SchnorrSignature::from_stream(ParseStream *s){
+    if(status == PARSING_FAILED){
+        return 0;
+    }
+    if(status == PARSING_DONE){
+        bytes_parsed = 0;
+    }
+    status = PARSING_INCOMPLETE;
+    size_t bytes_read = 0;
+    while(s->available() > 0 && bytes_parsed+bytes_read < 64){
+        sig[bytes_parsed+bytes_read] = s->read();
+        bytes_read++;
+    }
+    if(bytes_parsed+bytes_read == 64){
+        status = PARSING_DONE;
+    }
+    bytes_parsed += bytes_read;
+    return bytes_read;
+}
+size_t SchnorrSignature::to_stream(SerializeStream *s, size_t offset) const{
+    size_t bytes_written = 0;
+    while(s->available() && offset+bytes_written < 64){
+        s->write(sig[offset+bytes_written]);
+        bytes_written++;
+    }
+    return bytes_written;
+}
+
+bool schnorrVerifyBatch(const PublicKey * pubkeys, const uint8_t * hashes, const SchnorrSignature * sigs, size_t n){
+    // bip340_verify_batch takes concatenated keys and signatures,
+    // so they are copied group by group
+    uint8_t pubs[SCHNORR_BATCH_SIZE*32];
+    uint8_t sigArr[SCHNORR_BATCH_SIZE*64];
+    for(size_t i=0; i<n; i+=SCHNORR_BATCH_SIZE){
+        size_t m = n-i;
+        if(m > SCHNORR_BATCH_SIZE){
+            m = SCHNORR_BATCH_SIZE;
+        }
+        for(size_t j=0; j<m; j++){
+            pubkeys[i+j].xonly(pubs+32*j);
+            sigs[i+j].bin(sigArr+64*j, 64);
+        }
+        if(bip340_verify_batch(&secp256k1, m, pubs, hashes+32*i, sigArr) != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+PublicKey taprootTweak(const PublicKey internalKey, const uint8_t * merkleRoot){
+    PublicKey output;
+    taprootTweak(&internalKey, 1, merkleRoot, &output);
+    return output;
+}
+
+size_t taprootTweak(const PublicKey * internalKeys, size_t n, const uint8_t * merkleRoots, PublicKey * outputKeys){
+    curve_point pubs[DERIVE_BATCH_SIZE];
+    curve_point res[DERIVE_BATCH_SIZE];
+    uint8_t valid[DERIVE_BATCH_SIZE];
+    size_t written = 0;
+    for(size_t i=0; i<n; i+=DERIVE_BATCH_SIZE){
+        size_t m = n-i;
+        if(m > DERIVE_BATCH_SIZE){
+            m = DERIVE_BATCH_SIZE;
+        }
+        for(size_t j=0; j<m; j++){
+            valid[j] = internalKeys[i+j].isValid();
+            if(valid[j]){
+                internalKeys[i+j].toCurvePoint(&pubs[j]);
+            }else{ // any valid point, result is dropped
+                pubs[j] = secp256k1.G;
+            }
+        }
+        bip340_tweak_points(&secp256k1, m, pubs, (merkleRoots != NULL) ? merkleRoots+32*i : NULL, res);
+        for(size_t j=0; j<m; j++){
+            if(valid[j] && !point_is_infinity(&res[j])){
+                outputKeys[i+j] = PublicKey(ECPoint(&res[j]));
+                written++;
+            }else{
+                outputKeys[i+j] = PublicKey();
+            }
+        }
+    }
+    return written;
+}
 
 // ---------------------------------------------------------------- PrivateKey class
 
@@ -470,6 +628,9 @@ size_t PrivateKey::from_stream(ParseStream *s){
         num[bytes_parsed+bytes_read] = s->read();
         bytes_read++;
     }
+    if(bytes_read > 0){
+        invalidate();
+    }
     if(bytes_parsed+bytes_read == 32){
         status = PARSING_DONE;
         uint8_t zero[32] = { 0 };
@@ -479,8 +640,8 @@ size_t PrivateKey::from_stream(ParseStream *s){
         bignum256 n;
         bn_read_be(num, &n);
         bn_mod(&n, &secp256k1.order);
-        bn_write_be(&n, num);
-        pubKey = *this * GeneratorPoint;
+        setLimbs(&n);
+        memzero(&n, sizeof(n));
     }
     bytes_parsed += bytes_read;
     return bytes_read;
@@ -493,8 +654,8 @@ PrivateKey::PrivateKey(void){
 PrivateKey::PrivateKey(const uint8_t * secret_arr, bool use_compressed, const Network * net){
     reset();
     memcpy(num, secret_arr, 32);
+    invalidate();
     network = net;
-    pubKey = *this * GeneratorPoint;
     pubKey.compressed = use_compressed;
 }
 /*PrivateKey &PrivateKey::operator=(const PrivateKey &other){
@@ -539,6 +700,7 @@ int PrivateKey::fromWIF(const char * wifArr, size_t wifSize){
     size_t l = fromBase58Check(wifArr, wifSize, arr, sizeof(arr));
     if( (l < 33) || (l > 34) ){
         memzero(num, 32);
+        invalidate();
         return 0;
     }
     bool compressed;
@@ -564,7 +726,7 @@ int PrivateKey::fromWIF(const char * wifArr, size_t wifSize){
     memcpy(num, arr+1, 32);
     memzero(arr, 40); // clear memory
 
-    pubKey = *this * GeneratorPoint;
+    invalidate();
     pubKey.compressed = compressed;
     return 1;
 }
@@ -572,34 +734,49 @@ int PrivateKey::fromWIF(const char * wifArr){
     return fromWIF(wifArr, strlen(wifArr));
 }
 
-PublicKey PrivateKey::publicKey() const{
+const PublicKey & PrivateKey::cachedPublicKey() const{
+    if(!pubKeyValid){
+        bool compressed = pubKey.compressed;
+        pubKey = *this * GeneratorPoint;
+        pubKey.compressed = compressed;
+        pubKeyValid = true;
+    }
     return pubKey;
 }
+PublicKey PrivateKey::publicKey() const{
+    return cachedPublicKey();
+}
 
 int PrivateKey::address(char * address, size_t len) const{
-    return pubKey.address(address, len, network);
+    return cachedPublicKey().address(address, len, network);
 }
 int PrivateKey::legacyAddress(char * address, size_t len) const{
-    return pubKey.legacyAddress(address, len, network);
+    return cachedPublicKey().legacyAddress(address, len, network);
 }
 int PrivateKey::segwitAddress(char * address, size_t len) const{
-    return pubKey.segwitAddress(address, len, network);
+    return cachedPublicKey().segwitAddress(address, len, network);
 }
 int PrivateKey::nestedSegwitAddress(char * address, size_t len) const{
-    return pubKey.nestedSegwitAddress(address, len, network);
+    return cachedPublicKey().nestedSegwitAddress(address, len, network);
+}
+int PrivateKey::taprootAddress(char * address, size_t len) const{
+    return cachedPublicKey().taprootAddress(address, len, network);
 }
 #if USE_ARDUINO_STRING || USE_STD_STRING
 String PrivateKey::address() const{
-    return pubKey.address(network);
+    return cachedPublicKey().address(network);
 }
 String PrivateKey::legacyAddress() const{
-    return pubKey.legacyAddress(network);
+    return cachedPublicKey().legacyAddress(network);
 }
 String PrivateKey::segwitAddress() const{
-    return pubKey.segwitAddress(network);
+    return cachedPublicKey().segwitAddress(network);
 }
 String PrivateKey::nestedSegwitAddress() const{
-    return pubKey.nestedSegwitAddress(network);
+    return cachedPublicKey().nestedSegwitAddress(network);
+}
+String PrivateKey::taprootAddress() const{
+    return cachedPublicKey().taprootAddress(network);
 }
 #endif
 
@@ -615,6 +792,11 @@ Signature PrivateKey::sign(const uint8_t hash[32]) const{
     sig.index = i;
     return sig;
 }
+SchnorrSignature PrivateKey::schnorrSign(const uint8_t hash[32], const uint8_t aux[32]) const{
+    uint8_t signature[64] = {0};
+    bip340_sign(&secp256k1, num, hash, aux, signature);
+    return SchnorrSignature(signature);
+}
 #if USE_ARDUINO_STRING || USE_STD_STRING
 PrivateKey::PrivateKey(const String wifString){
     fromWIF(wifString.c_str());
@@ -93,7 +93,9 @@ enum ScriptType{
     P2WSH,
     P2SH_P2WPKH,
     P2SH_P2WSH,
-    MULTISIG
+    MULTISIG,
+    /**  \brief taproot (witness v1), key path spend only as in bip86 */
+    P2TR
 };
 
 /** \brief SigHash types */
@@ -103,8 +105,121 @@ enum SigHashType{
     SIGHASH_SINGLE = 3
 };
 
+// maximum depth of DerivationPath
+#ifndef DERIVATION_PATH_MAXDEPTH
+#define DERIVATION_PATH_MAXDEPTH 10
+#endif
+
+// DerivationPath is parsed at compile time where the compiler allows loops in constexpr
+#if __cplusplus >= 201402L
+#define DERIVATION_CONSTEXPR constexpr
+#else
+#define DERIVATION_CONSTEXPR
+#endif
+
+/**
+ *  \brief BIP32 derivation path with inline storage, no heap allocations.
+ *         Parses strings like "m/84h/0h/0h/1/23/", hardened indexes are marked
+ *         with `h`, `H` or `'`. Invalid or too deep paths make `valid` false.
+ *         With C++14 literals are parsed at compile time:
+ *         `constexpr DerivationPath bip84("m/84h/0h/0h");`
+ */
+class DerivationPath{
+    static DERIVATION_CONSTEXPR size_t strLength(const char * s){
+        size_t len = 0;
+        while(s[len] != 0){
+            len++;
+        }
+        return len;
+    }
+    DERIVATION_CONSTEXPR void parse(const char * path, size_t len){
+        size_t i = 0;
+        uint32_t cur = 0;
+        bool digits = false, hardened = false;
+        if(len > 0 && path[0] == 'm'){ // "m" or "m/..."
+            if(len > 1 && path[1] != '/'){
+                valid = false;
+                return;
+            }
+            i = (len > 1) ? 2 : 1;
+        }
+        // the end of the string works as the last separator
+        for(; i <= len; i++){
+            char c = (i < len) ? path[i] : '/';
+            if(c == '/'){
+                if(!digits){ // empty element, allowed only at the end
+                    if(i < len){
+                        valid = false;
+                        return;
+                    }
+                    break;
+                }
+                if(depth >= DERIVATION_PATH_MAXDEPTH){
+                    valid = false;
+                    return;
+                }
+                index[depth++] = hardened ? cur + HARDENED_INDEX : cur;
+                cur = 0;
+                digits = false;
+                hardened = false;
+            }else if(c >= '0' && c <= '9' && !hardened){
+                uint32_t d = (uint32_t)(c - '0');
+                // checked before multiplying, uint32_t would wrap around
+                if(cur > (HARDENED_INDEX - 1 - d) / 10){
+                    valid = false;
+                    return;
+                }
+                cur = cur * 10 + d;
+                digits = true;
+            }else if((c == 'h' || c == 'H' || c == '\'') && digits && !hardened){
+                hardened = true;
+            }else{
+                valid = false;
+                return;
+            }
+        }
+    }
+public:
+    /** \brief indexes, first `depth` of them are used */
+    uint32_t index[DERIVATION_PATH_MAXDEPTH];
+    uint8_t depth;
+    bool valid;
+
+    /** \brief empty path, derivation returns the key itself */
+    DERIVATION_CONSTEXPR DerivationPath():index(), depth(0), valid(true){};
+    DERIVATION_CONSTEXPR DerivationPath(const char * path):index(), depth(0), valid(true){ parse(path, strLength(path)); };
+    DERIVATION_CONSTEXPR DerivationPath(const char * path, size_t len):index(), depth(0), valid(true){ parse(path, len); };
+    DerivationPath(const uint32_t * arr, size_t len):index(), depth(0), valid(len <= DERIVATION_PATH_MAXDEPTH){
+        if(valid){
+            memcpy(index, arr, len * sizeof(uint32_t));
+            depth = len;
+        }
+    };
+    /** \brief true if any of the indexes is hardened */
+    DERIVATION_CONSTEXPR bool hardened() const{
+        for(uint8_t i=0; i<depth; i++){
+            if(index[i] >= HARDENED_INDEX){
+                return true;
+            }
+        }
+        return false;
+    };
+    /** \brief path extended by one more index, invalid if it doesn't fit */
+    DerivationPath child(uint32_t childIndex) const{
+        DerivationPath p = *this;
+        if(p.depth >= DERIVATION_PATH_MAXDEPTH){
+            p.valid = false;
+        }else{
+            p.index[p.depth++] = childIndex;
+        }
+        return p;
+    };
+    explicit operator bool() const{ return valid; };
+};
+
 /* forward declarations */
 class Signature;
+class SchnorrSignature;
 class PublicKey;
 class PrivateKey;
 class HDPublicKey;
@@ -129,6 +244,20 @@ const char * generateMnemonic(const char * entropy_string);
 bool checkMnemonic(const char * mnemonic);
 #endif
 
+/** \brief Returns index of the word in BIP39 wordlist or -1 if there is no such word */
+int mnemonicWordIndex(const char * word, size_t len);
+/** \brief Returns the number of BIP39 words starting with `prefix` (for autocompletion),
+ *         index of the first one is written to `first`. Matching words are consecutive.
+ */
+size_t mnemonicComplete(const char * prefix, size_t len, uint16_t * first = NULL);
+/** \brief Returns BIP39 word by its index (0-2047) or NULL */
+const char * mnemonicWord(uint16_t index);
+/** \brief Checks the checksum of a mnemonic given as word indexes (12, 18 or 24 of them) */
+bool checkMnemonic(const uint16_t * words, size_t count);
+
+/** \brief Wipes intermediate keys cached by HDPrivateKey and HDPublicKey::derive */
+void clearDerivationCache();
+
 const char * mnemonicFromEntropy(const uint8_t * entropy_data, size_t dataLen);
 size_t mnemonicToEntropy(const char * mnemonic, size_t mnemonic_len, uint8_t * output, size_t outputLen);
 #if USE_ARDUINO_STRING
@@ -168,6 +297,11 @@ public:
      *  \brief Fills `addr` with nested segwit address (P2SH-P2WPKH, `3...` for mainnet)
      */
     int nestedSegwitAddress(char * addr, size_t len, const Network * network = &DEFAULT_NETWORK) const;
+    /**
+     *  \brief Fills `addr` with taproot address (P2TR, `bc1p...` for mainnet),
+     *          the key is used as internal key without script path (bip86)
+     */
+    int taprootAddress(char * addr, size_t len, const Network * network = &DEFAULT_NETWORK) const;
     /**
      *  \brief Alias for `legacyAddress`
      */
@@ -176,33 +310,50 @@ public:
     String legacyAddress(const Network * network = &DEFAULT_NETWORK) const;
     String segwitAddress(const Network * network = &DEFAULT_NETWORK) const;
     String nestedSegwitAddress(const Network * network = &DEFAULT_NETWORK) const;
+    String taprootAddress(const Network * network = &DEFAULT_NETWORK) const;
     String address(const Network * network = &DEFAULT_NETWORK) const{ return legacyAddress(network); };
 #endif
 #if USE_STD_STRING
     std::string legacyAddress(const Network * network = &DEFAULT_NETWORK) const;
     std::string segwitAddress(const Network * network = &DEFAULT_NETWORK) const;
     std::string nestedSegwitAddress(const Network * network = &DEFAULT_NETWORK) const;
+    std::string taprootAddress(const Network * network = &DEFAULT_NETWORK) const;
     std::string address(const Network * network = &DEFAULT_NETWORK) const{ return legacyAddress(network); };
 #endif
     /**
      *  \brief verifies the ECDSA signature of the hash of the message
      */
     bool verify(const Signature sig, const uint8_t hash[32]) const;
+    /** \brief Writes 32-byte x-only public key (BIP340), parity of y is dropped */
+    void xonly(uint8_t arr[32]) const{ memcpy(arr, point, 32); };
+    /** \brief Loads the point with even y from 32-byte x-only key, returns false if there is none */
+    bool fromXonly(const uint8_t arr[32]);
+    /** \brief verifies BIP340 Schnorr signature of the hash against x-only version of the key */
+    bool schnorrVerify(const SchnorrSignature sig, const uint8_t hash[32]) const;
     /**
-     *  \brief Returns a Script with the type: `P2PKH`, `P2WPKH` or `P2SH_P2WPKH`
+     *  \brief Returns a Script with the type: `P2PKH`, `P2WPKH`, `P2SH_P2WPKH` or `P2TR`
      */
     Script script(ScriptType type = P2PKH) const;
 };
 
 /**
  *  PrivateKey class.
- *  Corresponding public key (point on curve) will be calculated in the constructor.
- *      as point calculation is pretty slow, class initialization can take some time.
+ *  Corresponding public key (point on curve) is calculated on first use and cached,
+ *      copies of the key keep the cached point.
+ *  The cache is filled by const methods, so a key that is shared between threads
+ *      needs its public key computed first (call publicKey() once before sharing it),
+ *      or every thread should work on its own copy.
  */
 class PrivateKey : public ECScalar{
 protected:
-    /** \brief corresponding point on curve ( secret * G ) */
-    PublicKey pubKey;
+    /** \brief corresponding point on curve ( secret * G ), valid only if pubKeyValid is set.
+     *         pubKey.compressed is always valid. */
+    mutable PublicKey pubKey;
+    mutable bool pubKeyValid = false;
+    /** \brief Computes pubKey if the secret has changed since the last call.
+     *         Writes the cache, not safe to call on a shared key from several threads */
+    const PublicKey & cachedPublicKey() const;
+    virtual void invalidate(){ ECScalar::invalidate(); pubKeyValid = false; };
     virtual size_t to_str(char * buf, size_t len) const{ return wif( buf, len); };
     virtual size_t from_str(const char * buf, size_t len){ return fromWIF(buf, len); };
     virtual size_t from_stream(ParseStream *s);
@@ -220,7 +371,6 @@ public:
     /** \brief Length of the key in WIF format (52). In reality not always 52... */
     virtual size_t stringLength() const{ return 52; };
     virtual size_t length() const{ return 32; };
-    void setSecret(const uint8_t secret_arr[32]){ memcpy(num, secret_arr, 32); pubKey = *this * GeneratorPoint; };
 
     /** \brief Pointer to the network to use. Mainnet or Testnet */
     const Network * network;
@@ -240,6 +390,8 @@ public:
     PublicKey publicKey() const;
     /** \brief Signs the hash and returns the Signature */
     Signature sign(const uint8_t hash[32]) const; // pass 32-byte hash of the message here
+    /** \brief Signs the hash with BIP340 Schnorr, aux is optional 32-byte auxiliary randomness */
+    SchnorrSignature schnorrSign(const uint8_t hash[32], const uint8_t aux[32] = NULL) const;
 
     /** \brief Alias for .publicKey().address(network) */
     int address(char * address, size_t len) const;
@@ -249,17 +401,21 @@ public:
     int segwitAddress(char * address, size_t len) const;
     /** \brief Alias for .publicKey().nestedSegwitAddress(network) */
     int nestedSegwitAddress(char * address, size_t len) const;
+    /** \brief Alias for .publicKey().taprootAddress(network) */
+    int taprootAddress(char * address, size_t len) const;
 #if USE_ARDUINO_STRING
     String address() const;
     String legacyAddress() const;
     String segwitAddress() const;
     String nestedSegwitAddress() const;
+    String taprootAddress() const;
 #endif
 #if USE_STD_STRING
     std::string address() const;
     std::string legacyAddress() const;
     std::string segwitAddress() const;
     std::string nestedSegwitAddress() const;
+    std::string taprootAddress() const;
 #endif
 //    PrivateKey &operator=(const PrivateKey &other);                   // assignment
 };
@@ -349,14 +505,16 @@ public:
     HDPrivateKey child(uint32_t index, bool hardened = false) const;
     HDPrivateKey hardenedChild(uint32_t index) const;
     /** \brief derives a child according to derivation path. Use 0x80000000 + index for hardened index. */
-    HDPrivateKey derive(uint32_t * index, size_t len) const;
+    HDPrivateKey derive(const uint32_t * index, size_t len) const;
     /** \brief derives a child according to derivation path. For example "m/84h/1h/0h/1/23/" for the 23rd change address for testnet with P2WPKH type (bip84). */
     HDPrivateKey derive(const char * path) const;
+    /** \brief derives a child according to parsed derivation path, returns invalid key if the path is invalid. */
+    HDPrivateKey derive(const DerivationPath & path) const;
 #if USE_ARDUINO_STRING
     HDPrivateKey derive(String path) const{ return derive(path.c_str()); };
 #endif
     // just to make sure it is compressed
-    PublicKey publicKey() const{ PublicKey p = pubKey; p.compressed = true; return p; };
+    PublicKey publicKey() const{ PublicKey p = cachedPublicKey(); p.compressed = true; return p; };
 //    HDPrivateKey &operator=(const HDPrivateKey &other);                   // assignment
 };
 
@@ -429,12 +587,22 @@ public:
      */
     HDPublicKey child(uint32_t index) const;
     /** \brief derives a child according to derivation path. */
-    HDPublicKey derive(uint32_t * index, size_t len) const;
+    HDPublicKey derive(const uint32_t * index, size_t len) const;
     /** \brief derives a child according to derivation path. For example "m/1/23/" for the 23rd change address. */
     HDPublicKey derive(const char * path) const;
+    /** \brief derives a child according to parsed derivation path, returns empty key if the path is invalid or hardened. */
+    HDPublicKey derive(const DerivationPath & path) const;
 #if USE_ARDUINO_STRING
     HDPublicKey derive(String path) const{ return derive(path.c_str()); };
 #endif
+    /** \brief derives `count` consecutive children `branch/start`, `branch/start+1`, ...
+     *         and writes their scriptPubKeys to `out` (script type is taken from the key).
+     *         Much faster than derive() in a loop, use it for gap limit checks and rescans.
+     *         Returns the number of valid children, invalid ones get an empty script.
+     */
+    size_t deriveRange(uint32_t branch, uint32_t start, size_t count, Script * out) const;
+    /** \brief same as above, but writes addresses to `out`, `len` bytes per address */
+    size_t deriveRange(uint32_t branch, uint32_t start, size_t count, char * out, size_t len) const;
 //    HDPublicKey &operator=(const HDPublicKey &other);                   // assignment
 };
 
@@ -477,6 +645,50 @@ public:
     bool operator!=(const Signature& other) const{ return !operator==(other); };
 };
 
+/**
+ *  \brief BIP340 Schnorr signature, 64 bytes: <R.x><s>.
+ *         Reference: https://github.com/bitcoin/bips/blob/master/bip-0340.mediawiki
+ */
+class SchnorrSignature : public Streamable{
+protected:
+    uint8_t sig[64];
+    virtual size_t from_stream(ParseStream *s);
+    virtual size_t to_stream(SerializeStream *s, size_t offset = 0) const;
+public:
+    SchnorrSignature(){ memset(sig, 0, 64); };
+    SchnorrSignature(const uint8_t arr[64]){ memcpy(sig, arr, 64); };
+    explicit SchnorrSignature(const char * hex);
+    virtual size_t length() const{ return 64; };
+
+    /** \brief populates array with <r[32]><s[32]> */
+    void bin(uint8_t * arr, size_t len) const{ memcpy(arr, sig, len < 64 ? len : 64); };
+
+    bool isValid() const{ uint8_t arr[64] = { 0 }; return memcmp(sig, arr, 64) != 0; };
+    explicit operator bool() const{ return isValid(); };
+
+    bool operator==(const SchnorrSignature& other) const{ return memcmp(sig, other.sig, 64) == 0; };
+    bool operator!=(const SchnorrSignature& other) const{ return !operator==(other); };
+};
+
+/**
+ *  \brief Verifies n Schnorr signatures of n hashes (32 bytes each) at once.
+ *          Returns true only if all signatures are valid, it doesn't tell which one is not.
+ */
+bool schnorrVerifyBatch(const PublicKey * pubkeys, const uint8_t * hashes, const SchnorrSignature * sigs, size_t n);
+
+/**
+ *  \brief Taproot output key Q = P + hash_TapTweak(P.x || merkleRoot) * G (bip341),
+ *          P is the internal key with even y. merkleRoot is 32 bytes or NULL
+ *          for outputs without script path (bip86). Returns invalid key if tweaking fails.
+ */
+PublicKey taprootTweak(const PublicKey internalKey, const uint8_t * merkleRoot = NULL);
+/**
+ *  \brief Tweaks n internal keys at once, merkleRoots are concatenated 32-byte roots or NULL.
+ *          Keys are tweaked in groups sharing one field inversion, use it for address generation.
+ *          Returns the number of valid output keys, failed ones are invalid.
+ */
+size_t taprootTweak(const PublicKey * internalKeys, size_t n, const uint8_t * merkleRoots, PublicKey * outputKeys);
+
 /**
  *  \brief Script class. Parsing requires the length of the script in the beginning.
  */
@@ -494,16 +706,16 @@ public:
     Script();
     Script(const uint8_t * buffer, size_t len);
     /** \brief creates a script from address */
-    Script(const char * address){ fromAddress(address); };
+    Script(const char * address){ init(); fromAddress(address); };
 #if USE_ARDUINO_STRING
     /** \brief creates a script from address */
-    Script(const String address){ fromAddress(address.c_str()); };
+    Script(const String address){ init(); fromAddress(address.c_str()); };
 #endif
 #if USE_STD_STRING
     /** \brief creates a script from address */
-    Script(const std::string address){ fromAddress(address.c_str()); };
+    Script(const std::string address){ init(); fromAddress(address.c_str()); };
 #endif
-    /** \brief creates one of standart scripts (P2PKH, P2WPKH) */
+    /** \brief creates one of standart scripts (P2PKH, P2WPKH, P2TR with the key as internal key) */
     Script(const PublicKey pubkey, ScriptType type = P2PKH);
     /** \brief creates one of standart scripts (P2SH, P2WSH) */
     Script(const Script &other, ScriptType type);
@@ -699,17 +911,22 @@ public:
 #endif
 
     /** \brief adds another input to the transaction */
-    uint8_t addInput(const TxIn txIn);
+    size_t addInput(const TxIn txIn);
     /** \brief adds another output to the transaction */
-    uint8_t addOutput(const TxOut txOut);
+    size_t addOutput(const TxOut txOut);
 
     /** \brief calculates a hash to sign for certain input */
-    int sigHash(uint8_t h[32], uint8_t inputIndex, const Script scriptPubkey, SigHashType sighash = SIGHASH_ALL) const;
+    int sigHash(uint8_t h[32], size_t inputIndex, const Script scriptPubkey, SigHashType sighash = SIGHASH_ALL) const;
 
     int hashPrevouts(uint8_t h[32]) const;
     int hashSequence(uint8_t h[32]) const;
     int hashOutputs(uint8_t h[32]) const;
-    int sigHashSegwit(uint8_t h[32], uint8_t inputIndex, const Script scriptPubKey, uint64_t amount, SigHashType sighash = SIGHASH_ALL) const;
+    int sigHashSegwit(uint8_t h[32], size_t inputIndex, const Script scriptPubKey, uint64_t amount, SigHashType sighash = SIGHASH_ALL) const;
+    /** \brief same as above, but with hashPrevouts, hashSequence and hashOutputs
+     *         computed in advance (96 bytes). They are the same for all inputs,
+     *         use it to sign many inputs without hashing the whole transaction every time.
+     */
+    int sigHashSegwit(uint8_t h[32], size_t inputIndex, const Script scriptPubKey, uint64_t amount, const uint8_t hashes[96], SigHashType sighash = SIGHASH_ALL) const;
 
 #if 0
     /** \brief sorts inputs and outputs in alphabetical order */
@@ -720,9 +937,9 @@ public:
      *         Don't forget to construct txIns[i].scriptSig correctly if you are using P2SH.
      *         For P2WPKH, P2WSH and P2SH-P2WPKH use signSegwitInput method.
      */
-    Signature signInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, SigHashType sighash = SIGHASH_ALL);
+    Signature signInput(size_t inputIndex, const PrivateKey pk, const Script redeemScript, SigHashType sighash = SIGHASH_ALL);
     /** \brief signs legacy input and returns a signature */
-    Signature signInput(uint8_t inputIndex, const PrivateKey pk){
+    Signature signInput(size_t inputIndex, const PrivateKey pk){
         return signInput(inputIndex, pk, Script(pk.publicKey(), P2PKH));
     };
 
@@ -730,11 +947,11 @@ public:
      *         Don't forget to construct txIns[i].witness correctly if you are using P2WSH or P2SH-P2WSH.
      *         For P2PKH and P2SH use signInput method.
      */
-    Signature signSegwitInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, uint64_t amount, ScriptType type = P2WSH, SigHashType sighash = SIGHASH_ALL);
+    Signature signSegwitInput(size_t inputIndex, const PrivateKey pk, const Script redeemScript, uint64_t amount, ScriptType type = P2WSH, SigHashType sighash = SIGHASH_ALL);
     /** \brief signs segwit input and returns a signature. Uses native segwit (P2WPKH) by default, 
      *         you can also specify the type to be P2SH-P2WPKH to sign nested segwit transaction.
      */
-    Signature signSegwitInput(uint8_t inputIndex, const PrivateKey pk, uint64_t amount, ScriptType type = P2WPKH){
+    Signature signSegwitInput(size_t inputIndex, const PrivateKey pk, uint64_t amount, ScriptType type = P2WPKH){
         return signSegwitInput(inputIndex, pk, Script(pk.publicKey(), P2WPKH), amount, type); // FIXME: are you sure?
     };
 
@@ -103,15 +103,23 @@ ECPoint::ECPoint(const char * arr):ECPoint(){
 	ECPoint::parse(arr, strlen(arr));
 };
 
+void ECPoint::toCurvePoint(curve_point * p) const{
+	bn_read_be(point, &p->x);
+	bn_read_be(point+32, &p->y);
+}
+void ECPoint::fromCurvePoint(const curve_point * p){
+	bn_write_be(&p->x, point);
+	bn_write_be(&p->y, point+32);
+}
+
 // bool verify(const Signature sig, const uint8_t hash[32]) const;
 bool ECPoint::isValid() const{ 
 	if(status != PARSING_DONE){
 		return false;
 	}
     curve_point pub;
-	uint8_t buf[65];
-	sec(buf, 65);
-	return ecdsa_read_pubkey(&secp256k1, buf, &pub);
+	toCurvePoint(&pub);
+	return ecdsa_validate_pubkey(&secp256k1, &pub);
 };
 
 ECPoint ECPoint::operator+(const ECPoint& other) const{
@@ -122,16 +130,10 @@ ECPoint ECPoint::operator+(const ECPoint& other) const{
 		return *this;
 	}
     curve_point p1, p2;
-	uint8_t buf[65];
-	sec(buf, 65);
-	ecdsa_read_pubkey(&secp256k1, buf, &p1);
-	other.sec(buf, 65);
-	ecdsa_read_pubkey(&secp256k1, buf, &p2);
+	toCurvePoint(&p1);
+	other.toCurvePoint(&p2);
     point_add(&secp256k1,&p1,&p2);
-    ECPoint sum;
-	bn_write_be(&p2.x, sum.point);
-	bn_write_be(&p2.y, sum.point+32);
-	return sum;
+	return ECPoint(&p2);
 };
 ECPoint ECPoint::operator-() const{
 	if(*this == InfinityPoint){
@@ -140,7 +142,7 @@ ECPoint ECPoint::operator-() const{
 	ECPoint a = *this;
 	bignum256 y;
 	bn_read_be(point+32, &y);
-	bn_inverse(&y, &secp256k1.prime);
+	bn_subtract(&secp256k1.prime, &y, &y);
 	bn_write_be(&y, a.point+32);
 	return a;
 }
@@ -164,6 +166,9 @@ size_t ECScalar::from_stream(ParseStream *s){
         num[bytes_parsed+bytes_read] = s->read();
         bytes_read++;
     }
+    if(bytes_read > 0){
+        invalidate();
+    }
     if(bytes_parsed+bytes_read == 32){
     	status = PARSING_DONE;
 	    uint8_t zero[32] = { 0 };
@@ -173,7 +178,8 @@ size_t ECScalar::from_stream(ParseStream *s){
 	    bignum256 n;
 	    bn_read_be(num, &n);
 	    bn_mod(&n, &secp256k1.order);
-	    bn_write_be(&n, num);
+	    setLimbs(&n);
+	    memzero(&n, sizeof(n));
     }
     bytes_parsed += bytes_read;
     return bytes_read;
@@ -186,90 +192,63 @@ size_t ECScalar::to_stream(SerializeStream *s, size_t offset) const{
 	}
 	return bytes_written;
 }
+void ECScalar::setLimbs(const bignum256 * a){
+	bn_write_be(a, num);
+	invalidate(); // subclasses drop their caches
+	memcpy(&bn, a, sizeof(bn));
+}
 ECScalar ECScalar::operator+(const ECScalar& other) const{
-    bignum256 a, b;
-	bn_read_be(this->num, &a);
-	bn_read_be(other.num, &b);
-	bn_addmod(&a, &b, &secp256k1.order);
+    bignum256 a = *limbs();
+	bn_addmod(&a, other.limbs(), &secp256k1.order);
     bn_mod(&a, &secp256k1.order);
-	ECScalar sum;
-	bn_write_be(&a, sum.num);
-	return sum;
+	return ECScalar(&a);
 }
 ECScalar ECScalar::operator+(const uint32_t& i) const{
-    bignum256 a;
-	bn_read_be(this->num, &a);
+    bignum256 a = *limbs();
 	bn_addi(&a, i);
     bn_mod(&a, &secp256k1.order);
-	ECScalar sum;
-	bn_write_be(&a, sum.num);
-	return sum;
+	return ECScalar(&a);
 }
 ECScalar ECScalar::operator-() const{
-    bignum256 a, b;
-	bn_read_be(this->num, &a);
-	bn_subtract(&secp256k1.order, &a, &b);
-	ECScalar neg;
-	bn_write_be(&b, neg.num);
-	return neg;
+    bignum256 a;
+	bn_subtract(&secp256k1.order, limbs(), &a);
+	bn_mod(&a, &secp256k1.order); // -0 is 0, not order
+	return ECScalar(&a);
 }
 ECScalar ECScalar::operator-(const uint32_t& i) const{
-    bignum256 a;
-	bn_read_be(this->num, &a);
+    bignum256 a = *limbs();
 	bn_subi(&a, i, &secp256k1.order);
     bn_mod(&a, &secp256k1.order);
-	ECScalar sum;
-	bn_write_be(&a, sum.num);
-	return sum;
+	return ECScalar(&a);
 }
 ECScalar ECScalar::operator-(const ECScalar& other) const{
 	return (*this+(-other));
 }
 ECScalar ECScalar::operator*(const ECScalar& other) const{
-    bignum256 a, b;
-	bn_read_be(this->num, &a);
-	bn_read_be(other.num, &b);
-	bn_multiply(&b, &a, &secp256k1.order);
+    bignum256 a = *limbs();
+	bn_multiply(other.limbs(), &a, &secp256k1.order);
     bn_mod(&a, &secp256k1.order);
-	ECScalar mul;
-	bn_write_be(&a, mul.num);
-	return mul;
+	return ECScalar(&a);
 }
 ECScalar ECScalar::operator/(const ECScalar& other) const{
-    bignum256 a, b;
-	bn_read_be(this->num, &a);
-	bn_read_be(other.num, &b);
+    bignum256 a = *limbs();
+    bignum256 b = *other.limbs();
 	bn_inverse(&b, &secp256k1.order);
 	bn_multiply(&b, &a, &secp256k1.order);
     bn_mod(&a, &secp256k1.order);
-	ECScalar res;
-	bn_write_be(&a, res.num);
-	return res;
+	return ECScalar(&a);
 }
 bool ECScalar::operator<(const ECScalar& other) const{
-	bignum256 a,b;
-	bn_read_be(num, &a);
-	bn_read_be(other.num, &b);
-	return bn_is_less(&a, &b);
+	return bn_is_less(limbs(), other.limbs());
 }
 ECPoint operator*(const ECScalar& scalar, const ECPoint& point){
-	ECPoint r;
-	uint8_t num[32];
-	scalar.getSecret(num);
+	curve_point res;
 	if(point == GeneratorPoint){
-		uint8_t pubkey[65];
-		ecdsa_get_public_key65(&secp256k1, num, pubkey);
-		r.parse(pubkey, 65);
+		scalar_multiply(&secp256k1, scalar.limbs(), &res);
 	}else{
-		bignum256 d;
-		bn_read_be(num, &d);
-		curve_point p, res;
-		bn_read_be(point.point, &p.x);
-		bn_read_be(point.point+32, &p.y);
-		point_multiply(&secp256k1, &d, &p, &res);
-		bn_write_be(&res.x, r.point);
-		bn_write_be(&res.y, r.point+32);
+		curve_point p;
+		point.toCurvePoint(&p);
+		point_multiply(&secp256k1, scalar.limbs(), &p, &res);
 	}
-	r.compressed = point.compressed;
-	return r;
-}
\ No newline at end of file
+	return ECPoint(&res, point.compressed);
+}
@@ -4,6 +4,8 @@
 #include "uBitcoin_conf.h"
 #include "BaseClasses.h"
 #include "utility/trezor/memzero.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/ecdsa.h"
 
 class ECPoint : public Streamable{
 protected:
@@ -21,6 +23,12 @@ public:
     ECPoint(const uint8_t pubkeyArr[64], bool use_compressed);
     ECPoint(const uint8_t * secArr);
     explicit ECPoint(const char * secHex);
+    explicit ECPoint(const curve_point * p, bool use_compressed = true):ECPoint(){ fromCurvePoint(p); compressed = use_compressed; };
+
+    /** \brief Reads x,y bytes to curve_point, without decompression or validation.
+     *         point is public and can change at any time, so it is not cached. */
+    void toCurvePoint(curve_point * p) const;
+    void fromCurvePoint(const curve_point * p);
 
     size_t sec(uint8_t * arr, size_t len) const;
     size_t fromSec(const uint8_t * arr, size_t len);
@@ -69,35 +77,46 @@ protected:
     virtual size_t from_stream(ParseStream *s);
     virtual size_t to_stream(SerializeStream *s, size_t offset = 0) const;
     uint8_t num[32];  // scalar mod secp526k1.order
+    /** \brief num in limbs, kept in sync with num on every change so const
+     *         methods never write it and a shared scalar can be read from threads.
+     *         Results of the operators keep it, so chained arithmetic doesn't parse num again */
+    bignum256 bn;
+    /** \brief Call after changing num directly to update cached values */
+    virtual void invalidate(){ bn_read_be(num, &bn); };
 public:
-    virtual void reset(){ bytes_parsed = 0; status=PARSING_DONE; memzero(num, 32); };
+    virtual void reset(){ bytes_parsed = 0; status=PARSING_DONE; memzero(num, 32); memzero(&bn, sizeof(bn)); invalidate(); };
     virtual size_t length() const{ return 32; };
 
-    ECScalar(){ memzero(num, 32); };
+    ECScalar(){ memzero(num, 32); memzero(&bn, sizeof(bn)); };
     ECScalar(const uint8_t * arr, size_t len):ECScalar(){ parse(arr, len); };
     explicit ECScalar(const char * arr):ECScalar(){ parse(arr, strlen(arr)); };
-    ECScalar(uint32_t i):ECScalar(){ intToBigEndian(i, num, 32); };
-    ~ECScalar(){ memzero(num, 32); };
+    ECScalar(uint32_t i):ECScalar(){ intToBigEndian(i, num+28, 4); invalidate(); };
+    explicit ECScalar(const bignum256 * a):ECScalar(){ setLimbs(a); };
+    ~ECScalar(){ memzero(num, 32); memzero(&bn, sizeof(bn)); };
 
     /** \brief Populates array with the secret key */
-    virtual void setSecret(const uint8_t secret_arr[32]){ memcpy(num, secret_arr, 32); };
+    virtual void setSecret(const uint8_t secret_arr[32]){ memcpy(num, secret_arr, 32); invalidate(); };
     /** \brief Sets the secret key */
     void getSecret(uint8_t buffer[32]) const{ memcpy(buffer, num, 32); };
+    /** \brief Returns the scalar in limbs */
+    const bignum256 * limbs() const{ return &bn; };
+    /** \brief Sets the scalar from a reduced bignum */
+    void setLimbs(const bignum256 * a);
 
     ECScalar operator+(const ECScalar& other) const;
     ECScalar operator+(const uint32_t& i) const;
     ECScalar operator-() const;
     ECScalar operator-(const ECScalar& other) const;
     ECScalar operator-(const uint32_t& i) const;
-    ECScalar operator+=(const ECScalar& other){ *this = *this+other; return *this; };
-    ECScalar operator-=(const ECScalar& other){ *this = *this-other; return *this; };
-    ECScalar operator+=(const uint32_t& i){ *this = *this+i; return *this; };
-    ECScalar operator-=(const uint32_t& i){ *this = *this-i; return *this; };
+    ECScalar operator+=(const ECScalar& other){ setLimbs((*this+other).limbs()); return *this; };
+    ECScalar operator-=(const ECScalar& other){ setLimbs((*this-other).limbs()); return *this; };
+    ECScalar operator+=(const uint32_t& i){ setLimbs((*this+i).limbs()); return *this; };
+    ECScalar operator-=(const uint32_t& i){ setLimbs((*this-i).limbs()); return *this; };
 
     ECScalar operator*(const ECScalar& other) const;
     ECScalar operator/(const ECScalar& other) const;
-    ECScalar operator*=(const ECScalar& other){ *this = *this*other; return *this; };
-    ECScalar operator/=(const ECScalar& other){ *this = *this/other; return *this; };
+    ECScalar operator*=(const ECScalar& other){ setLimbs((*this*other).limbs()); return *this; };
+    ECScalar operator/=(const ECScalar& other){ setLimbs((*this/other).limbs()); return *this; };
     
     virtual bool isValid() const{ uint8_t arr[32] = { 0 }; return (memcmp(num, arr, 32) != 0); };
     explicit operator bool() const { return isValid(); };
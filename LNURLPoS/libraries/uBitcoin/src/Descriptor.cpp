@@ -0,0 +1,498 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Descriptor.h"
+#include "PSBT.h"
+#include "Hash.h"
+#include "Conversion.h"
+#include "OpCodes.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+#include "utility/trezor/hmac.h"
+#include "utility/trezor/bip340.h"
+
+// what is copied to the holes of the template
+#define MATERIAL_KEY        0   // compressed public key, 33 bytes
+#define MATERIAL_HASH       1   // hash160 of the public key, 20 bytes
+#define MATERIAL_TAPROOT    2   // taproot output key, 32 bytes
+
+static const uint8_t materialLen[] = { 33, 20, 32 };
+
+struct Descriptor::Key{
+    uint8_t fingerprint[4];     // of the root key
+    DerivationPath origin;      // from the root to the key
+    DerivationPath path;        // from the key to the parent of `*`
+    bool ranged;
+    uint8_t sec[33];            // the key or the parent of `*`
+    curve_point point;          // parent of `*`
+    HMAC_SHA512_CTX hmac;       // keyed with the chain code of the parent of `*`
+    uint8_t fixed[33];          // material of a key without `*`
+    uint32_t cached[DESCRIPTOR_CACHE_SIZE]; // child index + 1, 0 for empty slots
+    uint8_t cache[DESCRIPTOR_CACHE_SIZE][33];
+
+    bool parse(const char * s, size_t len, bool xonly);
+    bool child(uint32_t index, uint8_t out[33]) const;
+};
+
+// [fingerprint/origin]KEY or [fingerprint/origin]XPUB/path/*
+bool Descriptor::Key::parse(const char * s, size_t len, bool xonly){
+    memset(cached, 0, sizeof(cached));
+    ranged = false;
+    bool hasOrigin = false;
+    if(len > 0 && s[0] == '['){
+        const char * end = (const char *)memchr(s, ']', len);
+        if(end == NULL || end - s < 9 || fromHex(s+1, 8, fingerprint, 4) != 4){
+            return false;
+        }
+        if(end - s > 9){
+            if(s[9] != '/' || end - s == 10){
+                return false;
+            }
+            origin = DerivationPath(s+10, end-s-10);
+            if(!origin.valid){
+                return false;
+            }
+        }
+        hasOrigin = true;
+        len -= end-s+1;
+        s = end+1;
+    }
+    const char * slash = (const char *)memchr(s, '/', len);
+    size_t keyLen = (slash == NULL) ? len : (size_t)(slash - s);
+    if(keyLen == (xonly ? 64 : 66)){ // hex public key, can't have a path
+        if(slash != NULL){
+            return false;
+        }
+        sec[0] = 0x02;
+        if(fromHex(s, keyLen, sec+33-keyLen/2, keyLen/2) != keyLen/2 || (sec[0] != 0x02 && sec[0] != 0x03)){
+            return false;
+        }
+        if(!PublicKey(sec)){
+            return false;
+        }
+        if(!hasOrigin){
+            uint8_t h[20];
+            hash160(sec, 33, h);
+            memcpy(fingerprint, h, 4);
+        }
+        return origin.depth <= DERIVATION_PATH_MAXDEPTH;
+    }
+    char str[120] = "";
+    if(keyLen >= sizeof(str)){
+        return false;
+    }
+    memcpy(str, s, keyLen);
+    HDPublicKey xpub(str);
+    if(!xpub){
+        return false;
+    }
+    s += keyLen;
+    len -= keyLen;
+    if(len >= 2 && s[len-2] == '/' && s[len-1] == '*'){
+        ranged = true;
+        len -= 2;
+    }
+    if(len > 0){
+        if(len == 1 || s[0] != '/'){
+            return false;
+        }
+        path = DerivationPath(s+1, len-1);
+        if(!path.valid || path.hardened()){
+            return false;
+        }
+    }
+    if(origin.depth + path.depth + ranged > DERIVATION_PATH_MAXDEPTH){
+        return false;
+    }
+    if(!hasOrigin){
+        xpub.fingerprint(fingerprint);
+    }
+    HDPublicKey parent = xpub.derive(path);
+    if(!parent){
+        return false;
+    }
+    parent.sec(sec, sizeof(sec));
+    if(ranged){
+        parent.toCurvePoint(&point);
+        ubtc_hmac_sha512_Init(&hmac, parent.chainCode, sizeof(parent.chainCode));
+    }
+    return true;
+}
+
+// compressed public key of the child, the same as HDPublicKey::child()
+// but starting from the keyed HMAC and without the fingerprint of the parent
+bool Descriptor::Key::child(uint32_t index, uint8_t out[33]) const{
+    HMAC_SHA512_CTX ctx = hmac;
+    uint8_t data[37];
+    uint8_t raw[64];
+    memcpy(data, sec, 33);
+    intToBigEndian(index, data+33, 4);
+    ubtc_hmac_sha512_Update(&ctx, data, sizeof(data));
+    ubtc_hmac_sha512_Final(&ctx, raw);
+    bignum256 tweak;
+    bn_read_be(raw, &tweak);
+    if(!bn_is_less(&tweak, &secp256k1.order)){
+        return false;
+    }
+    curve_point p;
+    scalar_multiply(&secp256k1, &tweak, &p);
+    point_add(&secp256k1, &point, &p);
+    if(point_is_infinity(&p)){
+        return false;
+    }
+    out[0] = 0x02 | (p.y.val[0] & 1);
+    bn_write_be(&p.x, out+1);
+    return true;
+}
+
+static bool toMaterial(const uint8_t sec[33], uint8_t material, uint8_t * out){
+    switch(material){
+        case MATERIAL_KEY:
+            memcpy(out, sec, 33);
+            return true;
+        case MATERIAL_HASH:
+            hash160(sec, 33, out);
+            return true;
+        default:
+            return bip340_tweak_public_key(&secp256k1, sec+1, NULL, out, NULL) == 0;
+    }
+}
+
+static bool consume(const char * s, size_t len, size_t * pos, const char * token){
+    size_t l = strlen(token);
+    if(len - *pos < l || memcmp(s + *pos, token, l) != 0){
+        return false;
+    }
+    *pos += l;
+    return true;
+}
+
+// small numbers are OP_1...OP_16, larger ones are pushed as a single byte
+static size_t pushNumber(uint8_t n, uint8_t * out){
+    if(n <= 16){
+        out[0] = OP_1 + n - 1;
+        return 1;
+    }
+    out[0] = 1;
+    out[1] = n;
+    return 2;
+}
+
+Descriptor::Descriptor(){
+    keys = NULL;
+    keysLen = 0;
+    bytes = NULL;
+    holes = NULL;
+    levelsLen = 0;
+    material = MATERIAL_KEY;
+    sorted = false;
+    scratch = 0;
+}
+Descriptor::Descriptor(const char * descriptor):Descriptor(){
+    parse(descriptor);
+}
+Descriptor::~Descriptor(){
+    clear();
+}
+void Descriptor::clear(){
+    delete [] keys;
+    delete [] bytes;
+    delete [] holes;
+    keys = NULL;
+    keysLen = 0;
+    bytes = NULL;
+    holes = NULL;
+    levelsLen = 0;
+    material = MATERIAL_KEY;
+    sorted = false;
+    scratch = 0;
+}
+
+bool Descriptor::parse(const char * descriptor, size_t len){
+    clear();
+    const char * hash = (const char *)memchr(descriptor, '#', len);
+    if(hash != NULL){
+        char checksum[10];
+        size_t l = hash - descriptor;
+        if(len - l != 9 || descriptorChecksum(descriptor, l, checksum, sizeof(checksum)) == 0
+            || memcmp(checksum, hash+1, 8) != 0){
+            return false;
+        }
+        len = l;
+    }
+    // wrappers from outside in
+    size_t pos = 0;
+    bool sh = consume(descriptor, len, &pos, "sh(");
+    bool wsh = consume(descriptor, len, &pos, "wsh(");
+    bool multi = false, pkh = false;
+    uint8_t threshold = 0;
+    if(consume(descriptor, len, &pos, "multi(")){
+        multi = true;
+    }else if(consume(descriptor, len, &pos, "sortedmulti(")){
+        multi = true;
+        sorted = true;
+    }else if(wsh){
+        return false;
+    }else if(consume(descriptor, len, &pos, "wpkh(")){
+        material = MATERIAL_HASH;
+    }else if(!sh && consume(descriptor, len, &pos, "pkh(")){
+        material = MATERIAL_HASH;
+        pkh = true;
+    }else if(!sh && consume(descriptor, len, &pos, "tr(")){
+        material = MATERIAL_TAPROOT;
+    }else{
+        return false;
+    }
+    if(multi){
+        if(!sh && !wsh){ // bare multisig is not supported
+            return false;
+        }
+        while(pos < len && descriptor[pos] >= '0' && descriptor[pos] <= '9' && threshold <= DESCRIPTOR_MAX_KEYS){
+            threshold = threshold * 10 + (descriptor[pos] - '0');
+            pos++;
+        }
+        if(!consume(descriptor, len, &pos, ",")){
+            return false;
+        }
+    }
+    // keys up to the closing brackets of all levels
+    size_t closing = 1 + sh + wsh;
+    if(len < pos + closing){
+        return false;
+    }
+    for(size_t i=len-closing; i<len; i++){
+        if(descriptor[i] != ')'){
+            return false;
+        }
+    }
+    size_t end = len - closing;
+    size_t num = 1;
+    for(size_t i=pos; i<end; i++){
+        num += (descriptor[i] == ',');
+    }
+    if(num > DESCRIPTOR_MAX_KEYS || (!multi && num > 1) || (multi && (threshold < 1 || threshold > num))){
+        return false;
+    }
+    keys = new Key[num];
+    holes = new uint16_t[num];
+    for(size_t i=0; i<num; i++){
+        const char * comma = (const char *)memchr(descriptor + pos, ',', end - pos);
+        size_t l = (comma == NULL) ? end - pos : (size_t)(comma - descriptor - pos);
+        if(!keys[i].parse(descriptor + pos, l, material == MATERIAL_TAPROOT)){
+            clear();
+            return false;
+        }
+        pos += l + 1;
+    }
+    for(size_t i=0; i<num; i++){
+        if(!keys[i].ranged && !toMaterial(keys[i].sec, material, keys[i].fixed)){
+            clear();
+            return false;
+        }
+    }
+    // templates: the innermost script, wsh and sh
+    // <threshold> <33 key>... <num> OP_CHECKMULTISIG, numbers above 16 take 2 bytes
+    size_t innerLen = multi ? (3 + 34*num + (threshold > 16) + (num > 16)) : 25;
+    bytes = new uint8_t[2*innerLen + 34 + 23];
+    uint8_t * t = bytes;
+    size_t l = 0;
+    if(multi){
+        l += pushNumber(threshold, t);
+        for(size_t i=0; i<num; i++){
+            t[l++] = 33;
+            holes[i] = l;
+            l += 33;
+        }
+        l += pushNumber(num, t+l);
+        t[l++] = OP_CHECKMULTISIG;
+    }else if(material == MATERIAL_TAPROOT){
+        t[l++] = OP_1;
+        t[l++] = 32;
+        holes[0] = l;
+        l += 32;
+    }else if(pkh){
+        t[l++] = OP_DUP;
+        t[l++] = OP_HASH160;
+        t[l++] = 20;
+        holes[0] = l;
+        l += 20;
+        t[l++] = OP_EQUALVERIFY;
+        t[l++] = OP_CHECKSIG;
+    }else{ // wpkh
+        t[l++] = OP_0;
+        t[l++] = 20;
+        holes[0] = l;
+        l += 20;
+    }
+    levels[0].start = 0;
+    levels[0].len = l;
+    levels[0].hole = 0;
+    levels[0].hash = 0;
+    levelsLen = 1;
+    if(wsh){
+        Level & lvl = levels[levelsLen++];
+        lvl.start = l;
+        lvl.len = 34;
+        lvl.hole = 2;
+        lvl.hash = 32;
+        bytes[l] = OP_0;
+        bytes[l+1] = 32;
+        l += lvl.len;
+    }
+    if(sh){
+        // redeem script is limited to 520 bytes
+        if(levels[levelsLen-1].len > 520){
+            clear();
+            return false;
+        }
+        Level & lvl = levels[levelsLen++];
+        lvl.start = l;
+        lvl.len = 23;
+        lvl.hole = 2;
+        lvl.hash = 20;
+        bytes[l] = OP_HASH160;
+        bytes[l+1] = 20;
+        bytes[l+22] = OP_EQUAL;
+        l += lvl.len;
+    }
+    scratch = l;
+    keysLen = num;
+    return true;
+}
+
+const uint8_t * Descriptor::derive(uint8_t key, uint32_t index){
+    Key & k = keys[key];
+    if(!k.ranged){
+        return k.fixed;
+    }
+    size_t slot = index % DESCRIPTOR_CACHE_SIZE;
+    if(k.cached[slot] != index + 1){
+        uint8_t sec[33];
+        k.cached[slot] = 0;
+        if(!k.child(index, sec) || !toMaterial(sec, material, k.cache[slot])){
+            return NULL;
+        }
+        k.cached[slot] = index + 1;
+    }
+    return k.cache[slot];
+}
+
+size_t Descriptor::scriptPubkey(uint32_t index, uint8_t * out, size_t len){
+    if(!isValid() || index >= HARDENED_INDEX || len < levels[levelsLen-1].len){
+        return 0;
+    }
+    const uint8_t * m[DESCRIPTOR_MAX_KEYS];
+    for(uint8_t i=0; i<keysLen; i++){
+        m[i] = derive(i, index);
+        if(m[i] == NULL){
+            return 0;
+        }
+    }
+    if(sorted){ // insertion sort, there are at most 20 keys
+        for(uint8_t i=1; i<keysLen; i++){
+            const uint8_t * cur = m[i];
+            uint8_t j = i;
+            for(; j>0 && memcmp(m[j-1], cur, 33) > 0; j--){
+                m[j] = m[j-1];
+            }
+            m[j] = cur;
+        }
+    }
+    uint8_t * dst = (levelsLen == 1) ? out : bytes + scratch;
+    memcpy(dst, bytes + levels[0].start, levels[0].len);
+    for(uint8_t i=0; i<keysLen; i++){
+        memcpy(dst + holes[i], m[i], materialLen[material]);
+    }
+    for(uint8_t i=1; i<levelsLen; i++){
+        uint8_t h[32];
+        if(levels[i].hash == 20){
+            hash160(dst, levels[i-1].len, h);
+        }else{
+            sha256(dst, levels[i-1].len, h);
+        }
+        dst = (i == levelsLen-1) ? out : bytes + scratch;
+        memcpy(dst, bytes + levels[i].start, levels[i].len);
+        memcpy(dst + levels[i].hole, h, levels[i].hash);
+    }
+    return levels[levelsLen-1].len;
+}
+
+Script Descriptor::scriptPubkey(uint32_t index){
+    uint8_t buf[40];
+    size_t l = scriptPubkey(index, buf, sizeof(buf));
+    if(l == 0){
+        return Script();
+    }
+    return Script(buf, l);
+}
+
+bool Descriptor::isRanged() const{
+    for(uint8_t i=0; i<keysLen; i++){
+        if(keys[i].ranged){
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t Descriptor::scriptLength() const{
+    if(!isValid()){
+        return 0;
+    }
+    return levels[levelsLen-1].len;
+}
+
+PublicKey Descriptor::publicKey(size_t key, uint32_t index) const{
+    if(key >= keysLen){
+        return PublicKey();
+    }
+    const Key & k = keys[key];
+    if(!k.ranged){
+        return PublicKey(k.sec);
+    }
+    uint8_t sec[33];
+    if(index >= HARDENED_INDEX || !k.child(index, sec)){
+        return PublicKey();
+    }
+    return PublicKey(sec);
+}
+
+DerivationPath Descriptor::derivation(size_t key, uint32_t index, uint8_t fingerprint[4]) const{
+    DerivationPath res;
+    if(key >= keysLen || (keys[key].ranged && index >= HARDENED_INDEX)){
+        res.valid = false;
+        return res;
+    }
+    const Key & k = keys[key];
+    memcpy(fingerprint, k.fingerprint, 4);
+    for(uint8_t i=0; i<k.origin.depth; i++){
+        res.index[res.depth++] = k.origin.index[i];
+    }
+    for(uint8_t i=0; i<k.path.depth; i++){
+        res.index[res.depth++] = k.path.index[i];
+    }
+    if(k.ranged){
+        res.index[res.depth++] = index;
+    }
+    return res;
+}
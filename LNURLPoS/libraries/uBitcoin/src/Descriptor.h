@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __DESCRIPTOR_H__
+#define __DESCRIPTOR_H__
+
+#include "Bitcoin.h"
+
+#ifndef DESCRIPTOR_MAX_KEYS
+#define DESCRIPTOR_MAX_KEYS 20
+#endif
+
+// number of derived keys remembered per key of a ranged descriptor
+#ifndef DESCRIPTOR_CACHE_SIZE
+#define DESCRIPTOR_CACHE_SIZE 8
+#endif
+
+/**
+ *  \brief Output script descriptor.<br>
+ *         Supports `pkh(KEY)`, `wpkh(KEY)`, `sh(wpkh(KEY))`, `tr(KEY)` (key path only),
+ *         `multi` and `sortedmulti` in `wsh(...)`, `sh(...)` or `sh(wsh(...))`.
+ *         KEY is a hex public key (x-only in `tr`) or an xpub followed by a derivation path,
+ *         optionally ending with a wildcard step (`/` followed by `*`), and prefixed by the key origin `[fingerprint/path]`.
+ *         Checksum after `#` is verified if present.<br>
+ *         Parsing compiles the descriptor to a script template with holes for the keys,
+ *         xpubs are derived to the parent of `*` once. Expanding index `i` derives one child
+ *         per key and copies it to the template, recent children are cached.
+ */
+class Descriptor{
+    struct Key;
+    struct Level{
+        uint16_t start;     // offset of the template in bytes
+        uint16_t len;
+        uint16_t hole;      // offset of the hash of the previous level
+        uint8_t hash;       // 20 for hash160, 32 for sha256 of the previous level
+    };
+    Key * keys;
+    uint8_t keysLen;
+    uint8_t material;       // what goes to the holes: key, its hash160 or taproot output key
+    bool sorted;            // sortedmulti: keys are sorted after derivation
+    uint8_t * bytes;        // templates of all levels followed by a scratch buffer
+    uint16_t * holes;       // offsets of the keys in the first level
+    Level levels[3];        // from the innermost script to the scriptPubkey
+    uint8_t levelsLen;
+    uint16_t scratch;       // offset of the scratch buffer in bytes
+    const uint8_t * derive(uint8_t key, uint32_t index);
+public:
+    Descriptor();
+    explicit Descriptor(const char * descriptor);
+    Descriptor(const Descriptor &other) = delete;
+    Descriptor &operator=(const Descriptor &other) = delete;
+    ~Descriptor();
+    /** \brief parses and compiles the descriptor, returns false if it is invalid or not supported */
+    bool parse(const char * descriptor, size_t len);
+    bool parse(const char * descriptor){ return parse(descriptor, strlen(descriptor)); };
+    void clear();
+    bool isValid() const{ return keysLen > 0; };
+    explicit operator bool() const{ return isValid(); };
+    /** \brief true if any of the keys ends with a wildcard step */
+    bool isRanged() const;
+    size_t keysNumber() const{ return keysLen; };
+    /** \brief length of the scriptPubkey without the length prefix */
+    size_t scriptLength() const;
+    /** \brief writes scriptPubkey for the child `index` to out (without the length prefix).
+     *         Returns number of bytes written, 0 if the child is invalid or out is too small.
+     */
+    size_t scriptPubkey(uint32_t index, uint8_t * out, size_t len);
+    Script scriptPubkey(uint32_t index);
+    /** \brief public key number `key` (in the order of the descriptor) for the child `index` */
+    PublicKey publicKey(size_t key, uint32_t index) const;
+    /** \brief full derivation path of the key from its origin, fills the fingerprint of the root.
+     *         Keys without origin use their own fingerprint.
+     */
+    DerivationPath derivation(size_t key, uint32_t index, uint8_t fingerprint[4]) const;
+};
+
+#endif // __DESCRIPTOR_H__
@@ -4,18 +4,165 @@
 #include "Bitcoin.h"
 #include "Hash.h"
 #include "Conversion.h"
+#include "OpCodes.h"
 #include "utility/trezor/sha2.h"
 #include "utility/segwit_addr.h"
 #include "utility/trezor/bignum.h"
 #include "utility/trezor/ecdsa.h"
+#include "utility/trezor/bip340.h"
 #include "utility/trezor/secp256k1.h"
 #include "utility/trezor/memzero.h"
+#include "utility/trezor/hmac.h"
+
+#if DERIVE_THREADS > 1 && (defined(__unix__) || defined(__APPLE__))
+#define DERIVE_USE_THREADS 1
+#endif
+#if USE_BIP32_CACHE && (defined(__unix__) || defined(__APPLE__))
+#define BIP32_CACHE_USE_LOCK 1
+#endif
+#if DERIVE_USE_THREADS || BIP32_CACHE_USE_LOCK
+#include <pthread.h>
+#endif
+#if USE_BIP32_CACHE
+#include <new>
+#endif
 
 #if USE_STD_STRING
 using std::string;
 #define String string
 #endif
 
+// ---------------------------------------------------------------- derivation cache
+
+#if USE_BIP32_CACHE
+/*
+ *  LRU cache of intermediate keys for derive(): entries are keyed by a hash
+ *  of the key the derivation started from and the path prefix, so deriving
+ *  m/84'/0'/0'/0/i resumes from m/84'/0'/0'/0 after the first call.
+ *  Shared by the whole process, so on unix-like hosts lookups are under
+ *  a mutex (deriveRange, PSBT signing and the tools derive from threads).
+ *  Elsewhere it is not thread-safe, like the rest of the library.
+ */
+template <typename T>
+class DerivationCache{
+    struct Entry{
+        uint8_t root[32];   // hash of the key derivation started from
+        uint32_t path[BIP32_CACHE_MAXDEPTH];
+        uint8_t len;        // length of the path prefix, 0 for empty slots
+        uint32_t used;      // last access, for eviction
+        T key;
+    };
+    Entry entries[BIP32_CACHE_SIZE];
+    uint32_t counter = 0;
+#if BIP32_CACHE_USE_LOCK
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+    void acquire(){
+#if BIP32_CACHE_USE_LOCK
+        pthread_mutex_lock(&lock);
+#endif
+    }
+    void release(){
+#if BIP32_CACHE_USE_LOCK
+        pthread_mutex_unlock(&lock);
+#endif
+    }
+    void wipe(Entry * e){
+        // the destructor zeroes secrets and chain codes
+        e->key.~T();
+        memzero(&e->key, sizeof(T));
+        new (&e->key) T();
+        memzero(e->root, 32);
+        memzero(e->path, sizeof(e->path));
+        e->len = 0;
+        e->used = 0;
+    }
+public:
+    /** \brief finds the key with the longest cached prefix of the path,
+     *         at most maxLen long. Returns the prefix length, 0 if nothing is cached */
+    size_t find(const uint8_t root[32], const uint32_t * path, size_t maxLen, T * key){
+        Entry * best = NULL;
+        if(maxLen > BIP32_CACHE_MAXDEPTH){
+            maxLen = BIP32_CACHE_MAXDEPTH;
+        }
+        acquire();
+        for(size_t i=0; i<BIP32_CACHE_SIZE; i++){
+            Entry * e = &entries[i];
+            if(e->len == 0 || e->len > maxLen || (best != NULL && e->len <= best->len)){
+                continue;
+            }
+            if(memcmp(e->root, root, 32) == 0 && memcmp(e->path, path, e->len*sizeof(uint32_t)) == 0){
+                best = e;
+            }
+        }
+        size_t len = 0;
+        if(best != NULL){
+            best->used = ++counter;
+            *key = best->key;
+            len = best->len;
+        }
+        release();
+        return len;
+    }
+    /** \brief stores the key derived with the path prefix of length len, evicts the least recently used one */
+    void add(const uint8_t root[32], const uint32_t * path, size_t len, const T &key){
+        if(len == 0 || len > BIP32_CACHE_MAXDEPTH){
+            return;
+        }
+        acquire();
+        Entry * e = &entries[0];
+        for(size_t i=1; i<BIP32_CACHE_SIZE && e->len != 0; i++){
+            if(entries[i].len == 0 || entries[i].used < e->used){
+                e = &entries[i];
+            }
+        }
+        wipe(e);
+        memcpy(e->root, root, 32);
+        memcpy(e->path, path, len*sizeof(uint32_t));
+        e->len = len;
+        e->used = ++counter;
+        e->key = key;
+        release();
+    }
+    void clear(){
+        acquire();
+        for(size_t i=0; i<BIP32_CACHE_SIZE; i++){
+            wipe(&entries[i]);
+        }
+        counter = 0;
+        release();
+    }
+};
+
+#if USE_BIP32_PRIVATE_CACHE
+static DerivationCache<HDPrivateKey> privateCache;
+#endif
+static DerivationCache<HDPublicKey> publicCache;
+
+// hash of everything the children of the key depend on
+static void cacheRoot(uint8_t tag, const uint8_t * key, size_t keyLen, const uint8_t chainCode[32],
+                      uint8_t depth, ScriptType type, const Network * network, uint8_t root[32]){
+    SHA256_CTX ctx;
+    sha256_Init(&ctx);
+    sha256_Update(&ctx, &tag, 1);
+    sha256_Update(&ctx, key, keyLen);
+    sha256_Update(&ctx, chainCode, 32);
+    sha256_Update(&ctx, &depth, 1);
+    sha256_Update(&ctx, (const uint8_t *)&type, sizeof(type));
+    sha256_Update(&ctx, (const uint8_t *)&network, sizeof(network));
+    sha256_Final(&ctx, root);
+}
+#endif
+
+void clearDerivationCache(){
+#if USE_BIP32_PRIVATE_CACHE
+    privateCache.clear();
+#endif
+#if USE_BIP32_CACHE
+    publicCache.clear();
+#endif
+}
+
 // ---------------------------------------------------------------- HDPrivateKey class
 
 void HDPrivateKey::init(){
@@ -38,7 +185,9 @@ HDPrivateKey::HDPrivateKey(const uint8_t secret[32],
                            uint32_t child_number,
                            const Network * net,
                            ScriptType key_type):PrivateKey(secret, true, net){
-    init();
+    init(); // resets the secret set by PrivateKey
+    memcpy(num, secret, 32);
+    invalidate();
     type = key_type;
     memcpy(chainCode, chain_code, 32);
     depth = key_depth;
@@ -206,6 +355,9 @@ size_t HDPrivateKey::from_stream(ParseStream *s){
         num[bytes_parsed+bytes_read-46] = s->read();
         bytes_read++;
     }
+    if(bytes_read > 0){
+        invalidate();
+    }
     if(bytes_parsed+bytes_read == 78){
         status = PARSING_DONE;
         uint8_t zero[32] = { 0 };
@@ -215,8 +367,8 @@ size_t HDPrivateKey::from_stream(ParseStream *s){
         bignum256 n;
         bn_read_be(num, &n);
         bn_mod(&n, &secp256k1.order);
-        bn_write_be(&n, num);
-        pubKey = *this * GeneratorPoint;
+        setLimbs(&n);
+        memzero(&n, sizeof(n));
         pubKey.compressed = true;
     }
     bytes_parsed += bytes_read;
@@ -245,7 +397,7 @@ int HDPrivateKey::fromSeed(const uint8_t * seed, size_t seedSize, const Network
     memcpy(num, raw, 32);
     network = net;
     memcpy(chainCode, raw+32, 32);
-    pubKey = *this * GeneratorPoint;
+    invalidate();
     pubKey.compressed = true;
     return 1;
 }
@@ -300,6 +452,8 @@ int HDPrivateKey::address(char * addr, size_t len) const{
             return nestedSegwitAddress(addr, len);
         case P2PKH:
             return legacyAddress(addr, len);
+        case P2TR:
+            return taprootAddress(addr, len);
         default:
             return segwitAddress(addr, len);
     }
@@ -318,6 +472,8 @@ String HDPrivateKey::address() const{
             return nestedSegwitAddress();
         case P2PKH:
             return legacyAddress();
+        case P2TR:
+            return taprootAddress();
         default:
             return segwitAddress();
     }
@@ -405,6 +561,9 @@ HDPrivateKey HDPrivateKey::child(uint32_t index, bool hardened) const{
                 case HARDENED_INDEX+84:
                     child.type = P2WPKH;
                     break;
+                case HARDENED_INDEX+86:
+                    child.type = P2TR;
+                    break;
                 case HARDENED_INDEX+48:
                     child.type = MULTISIG;
                     break;
@@ -450,10 +609,7 @@ HDPrivateKey HDPrivateKey::child(uint32_t index, bool hardened) const{
 
     ECScalar r(raw, 32);
     r += *this;
-    uint8_t secret[32];
-    r.getSecret(secret);
-    child.setSecret(secret);
-    memzero(secret, 32);
+    child.setLimbs(r.limbs());
     return child;
 }
 
@@ -461,59 +617,38 @@ HDPrivateKey HDPrivateKey::hardenedChild(uint32_t index) const{
     return child(index, true);
 }
 
-HDPrivateKey HDPrivateKey::derive(uint32_t * index, size_t len) const{
+HDPrivateKey HDPrivateKey::derive(const uint32_t * index, size_t len) const{
+    cachedPublicKey(); // so the next derivation from this key doesn't compute it again
     HDPrivateKey pk = *this;
+#if USE_BIP32_PRIVATE_CACHE
+    // intermediate keys are cached with their public keys,
+    // the key itself is not: leaves are rarely derived twice
+    uint8_t root[32];
+    cacheRoot(0, num, 32, chainCode, depth, type, network, root);
+    size_t start = (len > 0) ? privateCache.find(root, index, len-1, &pk) : 0;
+    for(size_t i=start; i<len; i++){
+        pk = pk.child(index[i]);
+        if(i+1 < len){
+            pk.cachedPublicKey();
+            privateCache.add(root, index, i+1, pk);
+        }
+    }
+    memzero(root, sizeof(root));
+#else
     for(size_t i=0; i<len; i++){
         pk = pk.child(index[i]);
     }
+#endif
     return pk;
 }
 HDPrivateKey HDPrivateKey::derive(const char * path) const{
-    static const char VALID_CHARS[] = "0123456789/'h";
-    size_t len = strlen(path);
-    const char * cur = path;
-    if(path[0] == 'm'){ // remove leading "m/"
-        cur+=2;
-        len-=2;
-    }
-    if(cur[len-1] == '/'){ // remove trailing "/"
-        len--;
-    }
-    HDPrivateKey pk; // invalid private key to return if something failed
-    size_t derivationLen = 1;
-    // checking if all chars are valid and counting derivation length
-    for(size_t i=0; i<len; i++){
-        const char * pch = strchr(VALID_CHARS, cur[i]);
-        if(pch == NULL){ // wrong character
-            return pk;
-        }
-        if(cur[i] == '/'){
-            derivationLen++;
-        }
-    }
-    uint32_t * derivation = (uint32_t *)calloc(derivationLen, sizeof(uint32_t));
-    if(derivation == NULL){ return pk; }
-    size_t current = 0;
-    for(size_t i=0; i<len; i++){
-        if(cur[i] == '/'){ // next
-            current++;
-            continue;
-        }
-        const char * pch = strchr(VALID_CHARS, cur[i]);
-        uint32_t val = pch-VALID_CHARS;
-        if(derivation[current] >= HARDENED_INDEX){ // can't have anything after hardened
-            free(derivation);
-            return pk;
-        }
-        if(val < 10){
-            derivation[current] = derivation[current]*10 + val;
-        }else{ // h or ' -> hardened
-            derivation[current] += HARDENED_INDEX;
-        }
+    return derive(DerivationPath(path));
+}
+HDPrivateKey HDPrivateKey::derive(const DerivationPath & path) const{
+    if(!path.valid){
+        return HDPrivateKey(); // invalid private key
     }
-    pk = derive(derivation, derivationLen);
-    free(derivation);
-    return pk;
+    return derive(path.index, path.depth);
 }
 // ---------------------------------------------------------------- HDPublicKey class
 
@@ -723,6 +858,8 @@ int HDPublicKey::address(char * addr, size_t len) const{
             return PublicKey::nestedSegwitAddress(addr, len, network);
         case P2PKH:
             return PublicKey::legacyAddress(addr, len, network);
+        case P2TR:
+            return PublicKey::taprootAddress(addr, len, network);
         default:
             return PublicKey::segwitAddress(addr, len, network);
     }
@@ -741,6 +878,8 @@ String HDPublicKey::address() const{
             return PublicKey::nestedSegwitAddress(network);
         case P2PKH:
             return PublicKey::legacyAddress(network);
+        case P2TR:
+            return PublicKey::taprootAddress(network);
         default:
             return PublicKey::segwitAddress(network);
     }
@@ -795,54 +934,230 @@ HDPublicKey HDPublicKey::child(uint32_t index) const{
     child.compressed = true;
     return child;
 }
-HDPublicKey HDPublicKey::derive(uint32_t * index, size_t len) const{
+HDPublicKey HDPublicKey::derive(const uint32_t * index, size_t len) const{
     HDPublicKey pk = *this;
+#if USE_BIP32_CACHE
+    uint8_t root[32];
+    cacheRoot(1, point, 64, chainCode, depth, type, network, root);
+    size_t start = (len > 0) ? publicCache.find(root, index, len-1, &pk) : 0;
+    for(size_t i=start; i<len; i++){
+        pk = pk.child(index[i]);
+        if(i+1 < len){
+            publicCache.add(root, index, i+1, pk);
+        }
+    }
+#else
     for(size_t i=0; i<len; i++){
         pk = pk.child(index[i]);
     }
+#endif
     return pk;
 }
 HDPublicKey HDPublicKey::derive(const char * path) const{
-    static const char VALID_CHARS[] = "0123456789/";
-    size_t len = strlen(path);
-    const char * cur = path;
-    if(path[0] == 'm'){ // remove leading "m/"
-        cur+=2;
-        len-=2;
-    }
-    if(cur[len-1] == '/'){ // remove trailing "/"
-        len--;
-    }
-    HDPublicKey pk; // dummy to return if something failed
-    size_t derivationLen = 1;
-    // checking if all chars are valid and counting derivation length
-    for(size_t i=0; i<len; i++){
-        const char * pch = strchr(VALID_CHARS, cur[i]);
-        if(pch == NULL){ // wrong character
-            return pk;
+    return derive(DerivationPath(path));
+}
+HDPublicKey HDPublicKey::derive(const DerivationPath & path) const{
+    if(!path.valid || path.hardened()){ // can't derive hardened children
+        return HDPublicKey();
+    }
+    return derive(path.index, path.depth);
+}
+
+
+// ---------------------------------------------------------------- range derivation
+
+/*
+ *  Part of HDPublicKey::deriveRange handled by one thread. Children are
+ *  processed in groups of DERIVE_BATCH_SIZE: HMACs start from the keyed
+ *  midstate, parent + IL*G points share one inversion and the keys are
+ *  hashed several at a time. Taproot output keys are tweaked together
+ *  in the same way.
+ */
+typedef struct{
+    const HMAC_SHA512_CTX * hmac;   // keyed with the chain code of the branch
+    const curve_point * parent;     // branch key
+    const uint8_t * sec;            // compressed branch key
+    uint32_t start;
+    size_t count;
+    ScriptType type;
+    const Network * network;
+    Script * scripts;               // output scripts or
+    char * addresses;               // output addresses, len bytes each
+    size_t len;
+    size_t written;
+} DeriveRangeJob;
+
+static void * deriveRangeRun(void * arg){
+    DeriveRangeJob * job = (DeriveRangeJob *)arg;
+    bignum256 tweaks[DERIVE_BATCH_SIZE];
+    curve_point points[DERIVE_BATCH_SIZE];
+    curve_point tweaked[DERIVE_BATCH_SIZE];
+    uint8_t valid[DERIVE_BATCH_SIZE];
+    uint8_t keys[DERIVE_BATCH_SIZE*33];
+    uint8_t redeem[DERIVE_BATCH_SIZE*22];
+    uint8_t hashes[DERIVE_BATCH_SIZE*20];
+    uint8_t data[37];
+    uint8_t raw[64];
+    uint8_t script[34];
+    size_t m;
+    job->written = 0;
+    memcpy(data, job->sec, 33);
+    for(size_t i=0; i<job->count; i+=m){
+        m = job->count - i;
+        if(m > DERIVE_BATCH_SIZE){
+            m = DERIVE_BATCH_SIZE;
         }
-        if(cur[i] == '/'){
-            derivationLen++;
+        for(size_t j=0; j<m; j++){
+            HMAC_SHA512_CTX ctx = *job->hmac;
+            intToBigEndian(job->start+i+j, data+33, 4);
+            ubtc_hmac_sha512_Update(&ctx, data, 37);
+            ubtc_hmac_sha512_Final(&ctx, raw);
+            bn_read_be(raw, &tweaks[j]);
+            // IL >= n is invalid, probability is below 2^-127
+            valid[j] = bn_is_less(&tweaks[j], &secp256k1.order);
+            if(!valid[j]){
+                bn_zero(&tweaks[j]);
+            }
         }
-    }
-    uint32_t * derivation = (uint32_t *)calloc(derivationLen, sizeof(uint32_t));
-    if(derivation == NULL){ return pk; }
-    size_t current = 0;
-    for(size_t i=0; i<len; i++){
-        if(cur[i] == '/'){ // next
-            if(derivation[current] >= HARDENED_INDEX){ // can't be hardened
-                free(derivation);
-                return pk;
+        scalar_multiply_add_batch(&secp256k1, job->parent, m, tweaks, points);
+        for(size_t j=0; j<m; j++){
+            if(point_is_infinity(&points[j])){
+                valid[j] = 0;
+                points[j] = *job->parent;
+            }
+            keys[33*j] = 0x02 | (points[j].y.val[0] & 1);
+            bn_write_be(&points[j].x, keys+33*j+1);
+        }
+        if(job->type == P2TR){
+            bip340_tweak_points(&secp256k1, m, points, NULL, tweaked);
+            for(size_t j=0; j<m; j++){
+                if(point_is_infinity(&tweaked[j])){
+                    valid[j] = 0;
+                }else{
+                    bn_write_be(&tweaked[j].x, keys+33*j+1);
+                }
             }
-            current++;
-            continue;
+        }else{
+            hash160_multi(keys, 33, m, hashes);
+        }
+        if(job->type == P2SH_P2WPKH){
+            for(size_t j=0; j<m; j++){
+                redeem[22*j] = 0x00;
+                redeem[22*j+1] = 20;
+                memcpy(redeem+22*j+2, hashes+20*j, 20);
+            }
+            hash160_multi(redeem, 22, m, hashes);
+        }
+        for(size_t j=0; j<m; j++){
+            size_t l;
+            switch(job->type){
+                case P2PKH:
+                    script[0] = OP_DUP;
+                    script[1] = OP_HASH160;
+                    script[2] = 20;
+                    memcpy(script+3, hashes+20*j, 20);
+                    script[23] = OP_EQUALVERIFY;
+                    script[24] = OP_CHECKSIG;
+                    l = 25;
+                    break;
+                case P2SH_P2WPKH:
+                    script[0] = OP_HASH160;
+                    script[1] = 20;
+                    memcpy(script+2, hashes+20*j, 20);
+                    script[22] = OP_EQUAL;
+                    l = 23;
+                    break;
+                case P2TR:
+                    script[0] = OP_1;
+                    script[1] = 32;
+                    memcpy(script+2, keys+33*j+1, 32);
+                    l = 34;
+                    break;
+                default:
+                    script[0] = 0x00;
+                    script[1] = 20;
+                    memcpy(script+2, hashes+20*j, 20);
+                    l = 22;
+            }
+            if(job->scripts != NULL){
+                job->scripts[i+j] = valid[j] ? Script(script, l) : Script();
+            }else{
+                char * addr = job->addresses + (i+j)*job->len;
+                memset(addr, 0, job->len);
+                if(valid[j]){
+                    Script(script, l).address(addr, job->len, job->network);
+                }
+            }
+            job->written += valid[j];
         }
-        const char * pch = strchr(VALID_CHARS, cur[i]);
-        uint32_t val = pch-VALID_CHARS;
-        derivation[current] = derivation[current]*10 + val;
     }
-    pk = derive(derivation, derivationLen);
-    free(derivation);
-    return pk;
+    return NULL;
+}
+
+static size_t deriveRangeJobs(const HDPublicKey * parent, uint32_t branch, uint32_t start, size_t count,
+                              Script * scripts, char * addresses, size_t len){
+    if(branch >= HARDENED_INDEX || start >= HARDENED_INDEX || count > HARDENED_INDEX - start){
+        return 0;
+    }
+    HDPublicKey pk = parent->child(branch);
+    uint8_t sec[33];
+    pk.sec(sec, sizeof(sec));
+    curve_point p;
+    pk.toCurvePoint(&p);
+    HMAC_SHA512_CTX hmac;
+    ubtc_hmac_sha512_Init(&hmac, pk.chainCode, sizeof(pk.chainCode));
+
+    DeriveRangeJob jobs[DERIVE_THREADS];
+    size_t nthreads = DERIVE_THREADS;
+    size_t groups = (count + DERIVE_BATCH_SIZE - 1) / DERIVE_BATCH_SIZE;
+    size_t offset = 0, written = 0;
+#if DERIVE_USE_THREADS
+    pthread_t threads[DERIVE_THREADS];
+    int started[DERIVE_THREADS] = {0};
+#endif
+    if(nthreads > groups){
+        nthreads = groups > 0 ? groups : 1;
+    }
+    for(size_t i=0; i<nthreads; i++){
+        // whole groups for every thread
+        size_t end = (groups * (i + 1) / nthreads) * DERIVE_BATCH_SIZE;
+        if(end > count){
+            end = count;
+        }
+        jobs[i].hmac = &hmac;
+        jobs[i].parent = &p;
+        jobs[i].sec = sec;
+        jobs[i].start = start + offset;
+        jobs[i].count = end - offset;
+        jobs[i].type = pk.type;
+        jobs[i].network = pk.network;
+        jobs[i].scripts = (scripts != NULL) ? scripts + offset : NULL;
+        jobs[i].addresses = (addresses != NULL) ? addresses + offset*len : NULL;
+        jobs[i].len = len;
+        offset = end;
+    }
+#if DERIVE_USE_THREADS
+    // the caller runs the first job
+    for(size_t i=1; i<nthreads; i++){
+        started[i] = (pthread_create(&threads[i], NULL, deriveRangeRun, &jobs[i]) == 0);
+    }
+#endif
+    for(size_t i=0; i<nthreads; i++){
+#if DERIVE_USE_THREADS
+        if(started[i]){
+            pthread_join(threads[i], NULL);
+        }else
+#endif
+        deriveRangeRun(&jobs[i]);
+        written += jobs[i].written;
+    }
+    memzero(&hmac, sizeof(hmac));
+    return written;
 }
 
+size_t HDPublicKey::deriveRange(uint32_t branch, uint32_t start, size_t count, Script * out) const{
+    return deriveRangeJobs(this, branch, start, count, out, NULL, 0);
+}
+size_t HDPublicKey::deriveRange(uint32_t branch, uint32_t start, size_t count, char * out, size_t len) const{
+    return deriveRangeJobs(this, branch, start, count, NULL, out, len);
+}
@@ -1,6 +1,8 @@
 #include "Hash.h"
 #include "utility/trezor/hmac.h"
 #include "utility/trezor/ripemd160.h"
+#include "utility/trezor/multibuf.h"
+#include "utility/trezor/memzero.h"
 
 #if USE_STD_STRING
 using std::string;
@@ -122,6 +124,12 @@ size_t Hash160::end(uint8_t hash[20]){
     return 20;
 }
 
+int hash160_multi(const uint8_t * data, size_t len, size_t count, uint8_t * hashes){
+    // longer messages fall back to one at a time inside
+    multibuf_hash160(data, len, len, count, hashes);
+    return count*20;
+}
+
 /********************** Double SHA-256 ***********************/
 /******************** sha256( sha256( m ) ) ******************/
 
@@ -190,3 +198,12 @@ int sha512Hmac(const uint8_t * key, size_t keyLen, const uint8_t * data, size_t
     ubtc_hmac_sha512(key, keyLen, data, dataLen, hash);
     return 64;
 }
+int sha512Hmac_multi(const uint8_t * key, size_t keyLen, const uint8_t * data, size_t len, size_t count, uint8_t * hmacs){
+    uint64_t opad[8], ipad[8];
+    ubtc_hmac_sha512_prepare(key, keyLen, opad, ipad);
+    // longer messages fall back to one at a time inside
+    multibuf_hmac_sha512(opad, ipad, data, len, len, count, hmacs);
+    memzero(opad, sizeof(opad));
+    memzero(ipad, sizeof(ipad));
+    return count*64;
+}
@@ -91,6 +91,12 @@ public:
     size_t end(uint8_t hash[20]);
 };
 
+/** \brief hash160 of `count` messages of `len` bytes each stored back to back in `data`.
+ *         Writes count*20 bytes to `hashes`, returns number of bytes written.
+ *         Short messages (pubkeys, scripts up to 55 bytes) are hashed
+ *         several at a time using SIMD lanes where available. */
+int hash160_multi(const uint8_t * data, size_t len, size_t count, uint8_t * hashes);
+
 /********************** Double SHA-256 ***********************/
 /******************** sha256( sha256( m ) ) ******************/
 
@@ -112,6 +118,11 @@ public:
 /************************** SHA-512 **************************/
 
 int sha512Hmac(const uint8_t * key, size_t keyLen, const uint8_t * data, size_t dataLen, uint8_t hash[64]);
+/** \brief HMAC-SHA512 of `count` messages of `len` bytes each stored back to back in `data`,
+ *         all with the same key. Writes count*64 bytes to `hmacs`, returns number of bytes written.
+ *         Short messages (up to 111 bytes, like BIP32 child derivation data)
+ *         are processed several at a time using SIMD lanes where available. */
+int sha512Hmac_multi(const uint8_t * key, size_t keyLen, const uint8_t * data, size_t len, size_t count, uint8_t * hmacs);
 
 int sha512(const uint8_t * data, size_t len, uint8_t hash[64]);
 int sha512(const char * data, size_t len, uint8_t hash[64]);
@@ -1,5 +1,10 @@
 #include "PSBT.h"
+#include "Hash.h"
 #include "Conversion.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+#include "utility/trezor/memzero.h"
 #if USE_STD_STRING
 using std::string;
 #define String string
@@ -198,7 +203,7 @@ size_t PSBT::from_stream(ParseStream *s){
         }
         last_key_pos += key.length()+value.length();
     }
-    uint8_t sections_number = 0;
+    size_t sections_number = 0;
     if(last_key_pos > 5){ // tx is already parsed
         sections_number = 1+tx.inputsNumber+tx.outputsNumber;
     }
@@ -248,7 +253,7 @@ size_t PSBT::from_stream(ParseStream *s){
     return bytes_read;
 }
 
-int PSBT::add(uint8_t section, const Script * k, const Script * v){
+int PSBT::add(size_t section, const Script * k, const Script * v){
     if(section == 0 || section > 1+tx.inputsNumber+tx.outputsNumber){
         return 0;
     }
@@ -262,7 +267,7 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
     int res = 0;
 
     if(section < 1+tx.inputsNumber){ // input section
-        uint8_t input = section-1;
+        size_t input = section-1;
         switch(key_code){
             case 0: { // PSBT_IN_NON_WITNESS_UTXO
                 // we need to verify that tx hashes to prevtx_hash
@@ -402,7 +407,7 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
             }
         }
     }else{ // output section
-        uint8_t output = section-1-tx.inputsNumber;
+        size_t output = section-1-tx.inputsNumber;
         switch(key_code){
             case 0: { // PSBT_OUT_REDEEM_SCRIPT
                 if(k->length() != 2){
@@ -481,11 +486,11 @@ size_t PSBT::to_stream(SerializeStream *s, size_t offset) const{
         bytes_written += s->serialize(&tx, offset+bytes_written-cur);
     }
     cur+=tx.length();
-    uint8_t sections_number = 1 + tx.inputsNumber + tx.outputsNumber;
-    uint8_t section = 0;
+    size_t sections_number = 1 + tx.inputsNumber + tx.outputsNumber;
+    size_t section = 0;
     while(s->available() && section < sections_number){
         if(section > 0 && section < tx.inputsNumber+1){
-            uint8_t input = section-1;
+            size_t input = section-1;
             for(size_t i=0; i<txInsMeta[input].signaturesLen; i++){
                 uint8_t key_arr[67];
                 key_arr[1] = 0x02; // PSBT_IN_PARTIAL_SIG
@@ -516,7 +521,7 @@ size_t PSBT::to_stream(SerializeStream *s, size_t offset) const{
 }
 
 size_t PSBT::length() const{
-    uint8_t sections_number = 1 + tx.inputsNumber + tx.outputsNumber;
+    size_t sections_number = 1 + tx.inputsNumber + tx.outputsNumber;
     size_t len = 7 + lenVarInt(tx.length()) + tx.length() + sections_number;
     for(size_t input=0; input<tx.inputsNumber; input++){
         for(size_t i=0; i<txInsMeta[input].signaturesLen; i++){
@@ -597,83 +602,232 @@ PSBT::~PSBT(){
     }
 }
 
-uint8_t PSBT::sign(const HDPrivateKey root){
+/*
+ *  Signing. Derivations with our fingerprint are sorted by depth and path,
+ *  so inputs sharing the parent key (like m/84'/0'/0'/0) come together.
+ *  Every ancestor is derived once and kept on a stack, children of one
+ *  parent are derived together: HMACs of several children at once, public
+ *  keys as parent + IL*G with one shared inversion and private keys as
+ *  parent + IL without building HDPrivateKey objects.
+ */
+typedef struct{
+    const PSBTDerivation * derivation;
+    size_t input;
+} PSBTSigningJob;
+
+static int compareSigningJobs(const void * a, const void * b){
+    const PSBTSigningJob * ja = (const PSBTSigningJob *)a;
+    const PSBTSigningJob * jb = (const PSBTSigningJob *)b;
+    const PSBTDerivation * da = ja->derivation;
+    const PSBTDerivation * db = jb->derivation;
+    if(da->derivationLen != db->derivationLen){
+        return (da->derivationLen < db->derivationLen) ? -1 : 1;
+    }
+    for(size_t i=0; i<da->derivationLen; i++){
+        if(da->derivation[i] != db->derivation[i]){
+            return (da->derivation[i] < db->derivation[i]) ? -1 : 1;
+        }
+    }
+    // same key - keep the order of the inputs
+    return (ja->input < jb->input) ? -1 : (ja->input > jb->input);
+}
+
+// number of equal leading indexes of two paths
+static size_t commonPrefix(const uint32_t * a, const uint32_t * b, size_t len){
+    size_t i = 0;
+    while(i < len && a[i] == b[i]){
+        i++;
+    }
+    return i;
+}
+
+bool PSBT::signInput(size_t input, const uint8_t secret[32], const PublicKey & pubkey, const uint8_t hashes[96]){
+    const PSBTInputMetadata * meta = &txInsMeta[input];
+    uint8_t h[32];
+    if(meta->witnessScript.length() > 1){ // P2WSH / P2SH_P2WSH
+        tx.sigHashSegwit(h, input, meta->witnessScript, meta->txOut.amount, hashes);
+    }else{
+        if(meta->redeemScript.length() > 1){
+            if(meta->redeemScript.type() == P2WPKH){ // P2SH_P2WPKH
+                tx.sigHashSegwit(h, input, pubkey.script(), meta->txOut.amount, hashes);
+            }else{ // P2SH
+                tx.sigHash(h, input, meta->redeemScript);
+            }
+        }else{ // P2WPKH / P2PKH / DIRECT_SCRIPT
+            if(meta->txOut.scriptPubkey.type() == P2WPKH){
+                tx.sigHashSegwit(h, input, pubkey.script(), meta->txOut.amount, hashes);
+            }else{ // P2PKH / DIRECT_SCRIPT
+                tx.sigHash(h, input, meta->txOut.scriptPubkey);
+            }
+        }
+    }
+    uint8_t rs[64];
+    int res = ecdsa_sign_digest(&secp256k1, secret, h, rs, NULL, NULL);
+    memzero(h, sizeof(h));
+    if(res != 0){
+        return false;
+    }
+    Signature sig(rs, rs+32);
+
+    // adding partial signature to the PSBT
+    uint8_t arr[67];
+    arr[1] = 0x02; // PSBT_IN_PARTIAL_SIG
+    uint8_t len = 1 + pubkey.serialize(arr+2, 65);
+    arr[0] = len;
+    Script k;
+    k.parse(arr, len+1);
+
+    uint8_t varr[100];
+    len = 1+sig.serialize(varr+1, 99);
+    varr[0] = len;
+    varr[len] = SIGHASH_ALL;
+    Script val;
+    val.parse(varr, len+1);
+    return add(input+1, &k, &val) > 0;
+}
+
+size_t PSBT::sign(const HDPrivateKey root){
     uint8_t fingerprint[4];
     root.fingerprint(fingerprint);
-    uint8_t counter = 0;
-    // in most cases only one account key is required, so we can cache it
-    uint32_t * first_derivation = NULL;
-    uint8_t first_derivation_len = 0;
-    HDPrivateKey account;
+    size_t num = 0;
+    size_t maxLen = 0;
     for(size_t i=0; i<tx.inputsNumber; i++){
-        if(txInsMeta[i].derivationsLen > 0){
-            for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
-                if(memcmp(fingerprint, txInsMeta[i].derivations[j].fingerprint, 4) == 0){
-                    // caching account key here
-                    if(first_derivation == NULL){
-                        first_derivation = txInsMeta[i].derivations[j].derivation;
-                        first_derivation_len = 0;
-                        for(size_t k=0; k < txInsMeta[i].derivations[j].derivationLen; k++){
-                            if(txInsMeta[i].derivations[j].derivation[k] >= 0x80000000){
-                                first_derivation_len++;
-                            }else{
-                                break;
-                            }
-                        }
-                        account = root.derive(first_derivation, first_derivation_len);
-                    }
-                    PrivateKey pk;
-                    // checking if cached key is ok
-                    if(memcmp(first_derivation, txInsMeta[i].derivations[j].derivation, first_derivation_len*sizeof(uint32_t))==0){
-                        pk = account.derive(txInsMeta[i].derivations[j].derivation+first_derivation_len, txInsMeta[i].derivations[j].derivationLen - first_derivation_len);
-                    }else{
-                        pk = root.derive(txInsMeta[i].derivations[j].derivation, txInsMeta[i].derivations[j].derivationLen);
-                    }
-                    if(txInsMeta[i].derivations[j].pubkey == pk.publicKey()){
-                        // can sign - let's sign
-                        uint8_t h[32];
-                        if(txInsMeta[i].witnessScript.length() > 1){ // P2WSH / P2SH_P2WSH
-                            tx.sigHashSegwit(h, i, txInsMeta[i].witnessScript, txInsMeta[i].txOut.amount);
-                        }else{
-                            if(txInsMeta[i].redeemScript.length() > 1){
-                                if(txInsMeta[i].redeemScript.type() == P2WPKH){ // P2SH_P2WPKH
-                                    // tx.sigHashSegwit(h, i, txInsMeta[i].redeemScript, txInsMeta[i].txOut.amount);
-                                    tx.sigHashSegwit(h, i, pk.publicKey().script(), txInsMeta[i].txOut.amount);
-                                }else{ // P2SH
-                                    tx.sigHash(h, i, txInsMeta[i].redeemScript);
-                                }
-                            }else{ // P2WPKH / P2PKH / DIRECT_SCRIPT
-                                if(txInsMeta[i].txOut.scriptPubkey.type() == P2WPKH){
-                                    // tx.sigHashSegwit(h, i, txInsMeta[i].txOut.scriptPubkey, txInsMeta[i].txOut.amount);
-                                    tx.sigHashSegwit(h, i, pk.publicKey().script(), txInsMeta[i].txOut.amount);
-                                }else{ // P2PKH / DIRECT_SCRIPT
-                                    tx.sigHash(h, i, txInsMeta[i].txOut.scriptPubkey);
-                                }
-                            }
-                        }
-                        Signature sig = pk.sign(h);
-
-                        // adding partial signature to the PSBT
-                        uint8_t arr[67];
-                        arr[1] = 0x02; // PSBT_IN_PARTIAL_SIG
-                        uint8_t len = 1 + pk.publicKey().serialize(arr+2, 65);
-                        arr[0] = len;
-                        Script k;
-                        k.parse(arr, len+1);
-
-                        uint8_t varr[100];
-                        len = 1+sig.serialize(varr+1, 99);
-                        varr[0] = len;
-                        varr[len] = SIGHASH_ALL;
-                        Script val;
-                        val.parse(varr, len+1);
-                        add(i+1, &k, &val);
-                        counter++; // can sign
-                    }
+        for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
+            if(memcmp(fingerprint, txInsMeta[i].derivations[j].fingerprint, 4) == 0){
+                num++;
+                if(txInsMeta[i].derivations[j].derivationLen > maxLen){
+                    maxLen = txInsMeta[i].derivations[j].derivationLen;
+                }
+            }
+        }
+    }
+    if(num == 0){
+        return 0;
+    }
+    PSBTSigningJob * jobs = new PSBTSigningJob[num];
+    num = 0;
+    for(size_t i=0; i<tx.inputsNumber; i++){
+        for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
+            if(memcmp(fingerprint, txInsMeta[i].derivations[j].fingerprint, 4) == 0){
+                jobs[num].derivation = &txInsMeta[i].derivations[j];
+                jobs[num].input = i;
+                num++;
+            }
+        }
+    }
+    qsort(jobs, num, sizeof(PSBTSigningJob), compareSigningJobs);
+
+    // hashes of all prevouts, sequences and outputs are the same for all segwit inputs
+    uint8_t hashes[96];
+    tx.hashPrevouts(hashes);
+    tx.hashSequence(hashes+32);
+    tx.hashOutputs(hashes+64);
+
+    // ancestors[k] is derived with the first k indexes of path
+    HDPrivateKey * ancestors = new HDPrivateKey[maxLen > 0 ? maxLen : 1];
+    ancestors[0] = root;
+    const uint32_t * path = NULL;
+    size_t depth = 0;
+
+    bignum256 tweaks[DERIVE_BATCH_SIZE];
+    curve_point points[DERIVE_BATCH_SIZE];
+    uint8_t data[DERIVE_BATCH_SIZE*37];
+    uint8_t raw[DERIVE_BATCH_SIZE*64];
+    uint8_t secret[32];
+    uint8_t point[64];
+    bignum256 parentSecret;
+    size_t counter = 0;
+    for(size_t first=0, last=0; first<num; first=last){
+        const PSBTDerivation * d = jobs[first].derivation;
+        if(d->derivationLen == 0){ // root key itself
+            root.getSecret(secret);
+            for(last=first; last<num && jobs[last].derivation->derivationLen == 0; last++){
+                if(jobs[last].derivation->pubkey == root.publicKey()){
+                    counter += signInput(jobs[last].input, secret, jobs[last].derivation->pubkey, hashes);
+                }
+            }
+            continue;
+        }
+        // all children of the same parent
+        size_t parentLen = d->derivationLen - 1;
+        for(last=first+1; last<num; last++){
+            const PSBTDerivation * other = jobs[last].derivation;
+            if(other->derivationLen != d->derivationLen || commonPrefix(d->derivation, other->derivation, parentLen) != parentLen){
+                break;
+            }
+        }
+        // deriving missing ancestors
+        size_t common = (path == NULL) ? 0 : commonPrefix(path, d->derivation, (depth < parentLen) ? depth : parentLen);
+        for(size_t k=common; k<parentLen; k++){
+            ancestors[k+1] = ancestors[k].child(d->derivation[k]);
+        }
+        path = d->derivation;
+        depth = parentLen;
+
+        const HDPrivateKey & parent = ancestors[parentLen];
+        if(!parent.isValid()){
+            continue;
+        }
+        curve_point parentPoint;
+        parent.publicKey().toCurvePoint(&parentPoint);
+        uint8_t sec[33];
+        parent.publicKey().sec(sec, sizeof(sec));
+        parent.getSecret(secret);
+        bn_read_be(secret, &parentSecret);
+        size_t m;
+        for(size_t i=first; i<last; i+=m){
+            m = last - i;
+            if(m > DERIVE_BATCH_SIZE){
+                m = DERIVE_BATCH_SIZE;
+            }
+            for(size_t j=0; j<m; j++){
+                uint32_t index = jobs[i+j].derivation->derivation[parentLen];
+                if(index >= HARDENED_INDEX){
+                    data[37*j] = 0x00;
+                    memcpy(data+37*j+1, secret, 32);
+                }else{
+                    memcpy(data+37*j, sec, 33);
+                }
+                intToBigEndian(index, data+37*j+33, 4);
+            }
+            sha512Hmac_multi(parent.chainCode, 32, data, 37, m, raw);
+            for(size_t j=0; j<m; j++){
+                bn_read_be(raw+64*j, &tweaks[j]);
+                // IL >= n is invalid, probability is below 2^-127
+                if(!bn_is_less(&tweaks[j], &secp256k1.order)){
+                    bn_zero(&tweaks[j]);
+                }
+            }
+            scalar_multiply_add_batch(&secp256k1, &parentPoint, m, tweaks, points);
+            for(size_t j=0; j<m; j++){
+                const PSBTDerivation * child = jobs[i+j].derivation;
+                if(bn_is_zero(&tweaks[j]) || point_is_infinity(&points[j])){
+                    continue;
                 }
+                bn_write_be(&points[j].x, point);
+                bn_write_be(&points[j].y, point+32);
+                if(memcmp(point, child->pubkey.point, 64) != 0){
+                    continue;
+                }
+                // can sign - let's sign
+                bignum256 key = tweaks[j];
+                bn_add(&key, &parentSecret);
+                bn_mod(&key, &secp256k1.order);
+                uint8_t childSecret[32];
+                bn_write_be(&key, childSecret);
+                counter += signInput(jobs[i+j].input, childSecret, child->pubkey, hashes);
+                memzero(&key, sizeof(key));
+                memzero(childSecret, sizeof(childSecret));
             }
         }
+        memzero(tweaks, sizeof(tweaks));
+        memzero(data, sizeof(data));
+        memzero(raw, sizeof(raw));
     }
+    memzero(secret, sizeof(secret));
+    memzero(&parentSecret, sizeof(parentSecret));
+    delete [] ancestors;
+    delete [] jobs;
     return counter;
 }
 
@@ -735,6 +889,21 @@ bool PSBT::isMine(uint8_t outputNumber, const HDPrivateKey xprv) const{
     return mine;
 }
 
+bool PSBT::isMine(uint8_t outputNumber, OwnershipIndex & index) const{
+    if(outputNumber >= tx.outputsNumber){
+        return false;
+    }
+    return index.find(tx.txOuts[outputNumber].scriptPubkey);
+}
+
+bool PSBT::isChange(uint8_t outputNumber, OwnershipIndex & index) const{
+    if(outputNumber >= tx.outputsNumber){
+        return false;
+    }
+    uint8_t branch = 0;
+    return index.find(tx.txOuts[outputNumber].scriptPubkey, NULL, &branch) && (branch == 1);
+}
+
 PSBT& PSBT::operator=(PSBT const &other){
     if (this == &other){ return *this; } // self-assignment
     // free memory
@@ -812,3 +981,384 @@ PSBT& PSBT::operator=(PSBT const &other){
     }
     return *this;
 }
+
+// ---------------------------------------------------------------- ownership index
+
+// extracts script hash, witness program or taproot output key from scriptPubkey,
+// returns its length or 0 for unsupported scripts
+static uint8_t ownershipKey(const Script & script, uint8_t key[32], uint8_t * type){
+    uint8_t arr[40];
+    if(script.length() > sizeof(arr)){
+        return 0;
+    }
+    // serialized with 1-byte length prefix
+    script.serialize(arr, sizeof(arr));
+    *type = script.type();
+    switch(*type){
+        case P2PKH:
+            memcpy(key, arr+4, 20);
+            return 20;
+        case P2SH:
+        case P2WPKH:
+            memcpy(key, arr+3, 20);
+            return 20;
+        case P2WSH:
+        case P2TR:
+            memcpy(key, arr+3, 32);
+            return 32;
+        default:
+            return 0;
+    }
+}
+
+OwnershipIndex::OwnershipIndex(uint32_t gap){
+    entries = NULL;
+    capacity = 0;
+    count = 0;
+    borrowed = false;
+    accounts = NULL;
+    accountsLen = 0;
+    accountsCapacity = 0;
+    window = (gap > 0) ? gap : 1;
+}
+OwnershipIndex::~OwnershipIndex(){
+    clear();
+}
+void OwnershipIndex::clear(){
+    if(entries != NULL && !borrowed){
+        free(entries);
+    }
+    entries = NULL;
+    borrowed = false;
+    if(accounts != NULL){
+        delete [] accounts;
+        accounts = NULL;
+    }
+    capacity = 0;
+    count = 0;
+    accountsLen = 0;
+    accountsCapacity = 0;
+}
+// linear probing, keys are hashes already so their first bytes are the hash
+OwnershipIndex::Entry * OwnershipIndex::slot(const uint8_t * key, uint8_t keyLen, uint8_t type) const{
+    size_t mask = capacity-1;
+    size_t i = ((size_t)key[0] | ((size_t)key[1] << 8) | ((size_t)key[2] << 16) | ((size_t)key[3] << 24)) & mask;
+    while(entries[i].keyLen != 0){
+        if(entries[i].keyLen == keyLen && entries[i].type == type && memcmp(entries[i].key, key, keyLen) == 0){
+            return &entries[i];
+        }
+        i = (i+1) & mask;
+    }
+    return &entries[i];
+}
+// makes room for num more entries keeping the load factor below 1/2,
+// copies the table if it belongs to a snapshot
+bool OwnershipIndex::reserve(size_t num){
+    if(2*(count+num) <= capacity && !borrowed){
+        return true;
+    }
+    size_t newCapacity = (capacity > 0) ? capacity : 64;
+    while(2*(count+num) > newCapacity){
+        newCapacity *= 2;
+    }
+    Entry * old = entries;
+    size_t oldCapacity = capacity;
+    entries = (Entry *)calloc(newCapacity, sizeof(Entry));
+    if(entries == NULL){
+        entries = old;
+        return false;
+    }
+    capacity = newCapacity;
+    for(size_t i=0; i<oldCapacity; i++){
+        if(old[i].keyLen != 0){
+            *slot(old[i].key, old[i].keyLen, old[i].type) = old[i];
+        }
+    }
+    if(!borrowed){
+        free(old);
+    }
+    borrowed = false;
+    return true;
+}
+// derives scripts of the branch up to index end (exclusive)
+bool OwnershipIndex::extend(uint32_t xpub, uint8_t branch, uint32_t end){
+    Account * acc = &accounts[xpub];
+    uint32_t start = acc->derived[branch];
+    if(end <= start){
+        return true;
+    }
+    size_t num = end - start;
+    if(!reserve(num)){
+        return false;
+    }
+    Script * scripts = new Script[num];
+    if(acc->xpub.deriveRange(branch, start, num, scripts) == 0){
+        delete [] scripts;
+        return false;
+    }
+    for(size_t i=0; i<num; i++){
+        Entry e;
+        memset(&e, 0, sizeof(e)); // padding goes to snapshots
+        e.keyLen = ownershipKey(scripts[i], e.key, &e.type);
+        if(e.keyLen == 0){ // invalid child
+            continue;
+        }
+        e.xpub = xpub;
+        e.branch = branch;
+        e.index = start+i;
+        Entry * s = slot(e.key, e.keyLen, e.type);
+        if(s->keyLen == 0){
+            count++;
+        }
+        *s = e;
+    }
+    delete [] scripts;
+    acc->derived[branch] = end;
+    return true;
+}
+int OwnershipIndex::add(const HDPublicKey xpub){
+    if(accountsLen >= 0x7FFFFFFF){
+        return -1;
+    }
+    if(accountsLen == accountsCapacity){
+        uint32_t newCapacity = (accountsCapacity > 0) ? 2*accountsCapacity : 4;
+        Account * arr = new Account[newCapacity];
+        for(uint32_t i=0; i<accountsLen; i++){
+            arr[i] = accounts[i];
+        }
+        if(accounts != NULL){
+            delete [] accounts;
+        }
+        accounts = arr;
+        accountsCapacity = newCapacity;
+    }
+    Account * acc = &accounts[accountsLen];
+    acc->xpub = xpub;
+    memset(acc->derived, 0, sizeof(acc->derived));
+    memset(acc->used, 0, sizeof(acc->used));
+    accountsLen++;
+    for(uint8_t branch=0; branch<2; branch++){
+        if(!extend(accountsLen-1, branch, window)){
+            return -1;
+        }
+    }
+    return accountsLen-1;
+}
+bool OwnershipIndex::find(const Script & scriptPubkey, uint32_t * xpub, uint8_t * branch, uint32_t * index){
+    uint8_t key[32];
+    uint8_t type;
+    uint8_t keyLen = ownershipKey(scriptPubkey, key, &type);
+    if(keyLen == 0 || count == 0){
+        return false;
+    }
+    Entry * e = slot(key, keyLen, type);
+    if(e->keyLen == 0){
+        return false;
+    }
+    // copy, extending can move the table
+    Entry found = *e;
+    if(found.xpub >= accountsLen || found.branch > 1){ // broken snapshot
+        return false;
+    }
+    Account * acc = &accounts[found.xpub];
+    if(found.index >= acc->used[found.branch]){
+        acc->used[found.branch] = found.index + 1;
+    }
+    if(found.index + window >= acc->derived[found.branch]){
+        extend(found.xpub, found.branch, found.index + 1 + window);
+    }
+    if(xpub != NULL){
+        *xpub = found.xpub;
+    }
+    if(branch != NULL){
+        *branch = found.branch;
+    }
+    if(index != NULL){
+        *index = found.index;
+    }
+    return true;
+}
+size_t OwnershipIndex::scan(const Tx & tx, Match * matches, size_t len){
+    size_t num = 0;
+    for(size_t i=0; i<tx.outputsNumber; i++){
+        Match m;
+        if(!find(tx.txOuts[i].scriptPubkey, &m.xpub, &m.branch, &m.index)){
+            continue;
+        }
+        if(matches != NULL && num < len){
+            m.output = i;
+            m.amount = tx.txOuts[i].amount;
+            matches[num] = m;
+        }
+        num++;
+    }
+    return num;
+}
+uint32_t OwnershipIndex::used(uint32_t xpub, uint8_t branch) const{
+    if(xpub >= accountsLen || branch > 1){
+        return 0;
+    }
+    return accounts[xpub].used[branch];
+}
+uint32_t OwnershipIndex::derived(uint32_t xpub, uint8_t branch) const{
+    if(xpub >= accountsLen || branch > 1){
+        return 0;
+    }
+    return accounts[xpub].derived[branch];
+}
+
+// snapshot: header, accounts, hash table aligned to 8 bytes
+struct OwnershipSnapshotHeader{
+    uint8_t magic[4];
+    uint32_t version;
+    uint32_t byteOrder;     // detects snapshots from other platforms
+    uint32_t entrySize;
+    uint32_t window;
+    uint32_t xpubs;
+    uint64_t capacity;
+    uint64_t count;
+};
+static const uint8_t OWNERSHIP_SNAPSHOT_MAGIC[4] = { 'u', 'B', 'O', 'I' };
+#define OWNERSHIP_SNAPSHOT_VERSION 1
+#define OWNERSHIP_SNAPSHOT_BYTE_ORDER 0x01020304
+// xpubs are stored with uncompressed points, parsing a serialized xpub
+// would cost a square root per xpub on every load
+struct OwnershipSnapshotAccount{
+    uint8_t point[64];
+    uint8_t chainCode[32];
+    uint8_t parentFingerprint[4];
+    uint32_t childNumber;
+    uint32_t derived[2];
+    uint32_t used[2];
+    uint8_t depth;
+    uint8_t type;
+    uint8_t network;    // number in networks[], 0xFF for others
+    uint8_t reserved[5];
+};
+#define OWNERSHIP_SNAPSHOT_ACCOUNT sizeof(OwnershipSnapshotAccount)
+
+static size_t ownershipTableOffset(size_t xpubs){
+    size_t offset = sizeof(OwnershipSnapshotHeader) + xpubs * OWNERSHIP_SNAPSHOT_ACCOUNT;
+    return (offset + 7) & ~(size_t)7;
+}
+size_t OwnershipIndex::snapshotLength() const{
+    return ownershipTableOffset(accountsLen) + capacity * sizeof(Entry);
+}
+size_t OwnershipIndex::snapshot(uint8_t * out, size_t len) const{
+    size_t total = snapshotLength();
+    if(len < total){
+        return 0;
+    }
+    memset(out, 0, total);
+    OwnershipSnapshotHeader h;
+    memcpy(h.magic, OWNERSHIP_SNAPSHOT_MAGIC, 4);
+    h.version = OWNERSHIP_SNAPSHOT_VERSION;
+    h.byteOrder = OWNERSHIP_SNAPSHOT_BYTE_ORDER;
+    h.entrySize = sizeof(Entry);
+    h.window = window;
+    h.xpubs = accountsLen;
+    h.capacity = capacity;
+    h.count = count;
+    memcpy(out, &h, sizeof(h));
+    uint8_t * p = out + sizeof(h);
+    for(uint32_t i=0; i<accountsLen; i++){
+        const Account * acc = &accounts[i];
+        OwnershipSnapshotAccount a;
+        memset(&a, 0, sizeof(a));
+        memcpy(a.point, acc->xpub.point, 64);
+        memcpy(a.chainCode, acc->xpub.chainCode, 32);
+        memcpy(a.parentFingerprint, acc->xpub.parentFingerprint, 4);
+        a.childNumber = acc->xpub.childNumber;
+        memcpy(a.derived, acc->derived, sizeof(a.derived));
+        memcpy(a.used, acc->used, sizeof(a.used));
+        a.depth = acc->xpub.depth;
+        a.type = acc->xpub.type;
+        a.network = 0xFF;
+        for(uint8_t j=0; j<networks_len; j++){
+            if(networks[j] == acc->xpub.network){
+                a.network = j;
+            }
+        }
+        memcpy(p, &a, sizeof(a));
+        p += OWNERSHIP_SNAPSHOT_ACCOUNT;
+    }
+    if(capacity > 0){
+        memcpy(out + ownershipTableOffset(accountsLen), entries, capacity * sizeof(Entry));
+    }
+    return total;
+}
+bool OwnershipIndex::load(const uint8_t * snapshot, size_t len){
+    clear();
+    OwnershipSnapshotHeader h;
+    if(len < sizeof(h)){
+        return false;
+    }
+    memcpy(&h, snapshot, sizeof(h));
+    if(memcmp(h.magic, OWNERSHIP_SNAPSHOT_MAGIC, 4) != 0 || h.version != OWNERSHIP_SNAPSHOT_VERSION ||
+       h.byteOrder != OWNERSHIP_SNAPSHOT_BYTE_ORDER || h.entrySize != sizeof(Entry) ||
+       h.window == 0 || h.xpubs >= 0x7FFFFFFF || (h.capacity & (h.capacity-1)) != 0 || 2*h.count > h.capacity){
+        return false;
+    }
+    size_t offset = ownershipTableOffset(h.xpubs);
+    if(h.capacity > (SIZE_MAX - offset) / sizeof(Entry) || len < offset + h.capacity * sizeof(Entry)){
+        return false;
+    }
+    if(h.xpubs > 0){
+        accounts = new Account[h.xpubs];
+        accountsCapacity = h.xpubs;
+    }
+    const uint8_t * p = snapshot + sizeof(h);
+    for(accountsLen=0; accountsLen<h.xpubs; accountsLen++){
+        OwnershipSnapshotAccount a;
+        memcpy(&a, p, sizeof(a));
+        Account * acc = &accounts[accountsLen];
+        acc->xpub = HDPublicKey(a.point, a.chainCode, a.depth, a.parentFingerprint, a.childNumber,
+                                (a.network < networks_len) ? networks[a.network] : &DEFAULT_NETWORK,
+                                (ScriptType)a.type);
+        if(!acc->xpub){ // not on the curve
+            clear();
+            return false;
+        }
+        memcpy(acc->derived, a.derived, sizeof(acc->derived));
+        memcpy(acc->used, a.used, sizeof(acc->used));
+        p += OWNERSHIP_SNAPSHOT_ACCOUNT;
+    }
+    window = h.window;
+    capacity = h.capacity;
+    count = h.count;
+    if(capacity == 0){
+        return true;
+    }
+    const uint8_t * table = snapshot + offset;
+    // the table is used as is, so it has to be consistent with the header:
+    // slot() needs an empty slot to stop, matches index accounts[xpub].used[branch]
+    size_t used = 0;
+    for(size_t i=0; i<capacity; i++){
+        Entry e;
+        memcpy(&e, table + i*sizeof(Entry), sizeof(Entry));
+        if(e.keyLen == 0){
+            continue;
+        }
+        if((e.keyLen != 20 && e.keyLen != 32) || e.xpub >= h.xpubs || e.branch > 1){
+            clear();
+            return false;
+        }
+        used++;
+    }
+    if(used != count || used >= capacity){
+        clear();
+        return false;
+    }
+    if(((uintptr_t)table) % 8 == 0){
+        entries = (Entry *)table;
+        borrowed = true;
+        return true;
+    }
+    entries = (Entry *)malloc(capacity * sizeof(Entry));
+    if(entries == NULL){
+        clear();
+        return false;
+    }
+    memcpy(entries, table, capacity * sizeof(Entry));
+    return true;
+}
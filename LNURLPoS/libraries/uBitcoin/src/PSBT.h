@@ -65,6 +65,94 @@ String descriptorChecksum(String descriptor);
 std::string descriptorChecksum(std::string descriptor);
 #endif
 
+/**
+ *  \brief Set of scriptPubkeys of watched xpubs for quick ownership checks.
+ *         Keeps scripts of the first `window` receive (`xpub/0/i`) and change
+ *         (`xpub/1/i`) addresses of every xpub in an open-addressing hash table,
+ *         lookups don't need any EC operations. When a lookup hits one of the
+ *         last `window` derived addresses the branch is extended so there are
+ *         `window` unused addresses after the hit again (like a gap limit).
+ *         The state can be saved to a snapshot and loaded back without
+ *         deriving anything, the hash table is used in place (for example
+ *         from a memory-mapped file) until the index has to change it.
+ */
+class OwnershipIndex{
+    struct Entry{
+        uint8_t key[32];    // script hash or witness program
+        uint32_t xpub;      // number of the xpub in the index
+        uint32_t index;
+        uint8_t keyLen;     // 20 or 32, 0 for empty slots
+        uint8_t type;       // ScriptType of the scriptPubkey
+        uint8_t branch;     // 0 for receive, 1 for change addresses
+    };
+    struct Account{
+        HDPublicKey xpub;
+        uint32_t derived[2]; // number of derived addresses per branch
+        uint32_t used[2];    // highest used index + 1 per branch
+    };
+    Entry * entries;
+    size_t capacity;        // power of 2
+    size_t count;
+    bool borrowed;          // entries point to a snapshot, not owned
+    Account * accounts;
+    uint32_t accountsLen;
+    uint32_t accountsCapacity;
+    uint32_t window;
+    Entry * slot(const uint8_t * key, uint8_t keyLen, uint8_t type) const;
+    bool reserve(size_t num);
+    bool extend(uint32_t xpub, uint8_t branch, uint32_t end);
+public:
+    /** \brief output of a transaction paying to one of the xpubs */
+    struct Match{
+        uint32_t output;    // output number in the transaction
+        uint32_t xpub;
+        uint8_t branch;
+        uint32_t index;
+        uint64_t amount;
+    };
+    explicit OwnershipIndex(uint32_t gap = 20);
+    OwnershipIndex(const OwnershipIndex &other) = delete;
+    OwnershipIndex &operator=(const OwnershipIndex &other) = delete;
+    ~OwnershipIndex();
+    /** \brief adds xpub to the index and derives its first `window` receive and change scripts.
+     *         Script type and network are taken from the xpub.
+     *         Returns the number of the xpub in the index or -1 on failure.
+     */
+    int add(const HDPublicKey xpub);
+    /** \brief checks if the script belongs to one of the xpubs,
+     *         fills its number, branch (0 or 1) and child index if pointers are not NULL.
+     *         Marks the address as used and extends the branch if the hit
+     *         is close to the last derived address.
+     */
+    bool find(const Script & scriptPubkey, uint32_t * xpub = NULL, uint8_t * branch = NULL, uint32_t * index = NULL);
+    /** \brief checks all outputs of the transaction, fills up to `len` matches.
+     *         Returns the number of outputs paying to the xpubs.
+     */
+    size_t scan(const Tx & tx, Match * matches = NULL, size_t len = 0);
+    /** \brief highest used child index + 1 on the branch of the xpub, 0 if nothing is used */
+    uint32_t used(uint32_t xpub, uint8_t branch) const;
+    /** \brief number of derived addresses on the branch of the xpub */
+    uint32_t derived(uint32_t xpub, uint8_t branch) const;
+    /** \brief number of xpubs in the index */
+    size_t xpubs() const{ return accountsLen; };
+    /** \brief number of scripts in the index */
+    size_t size() const{ return count; };
+    /** \brief removes all xpubs and scripts */
+    void clear();
+    /** \brief size of the snapshot in bytes */
+    size_t snapshotLength() const;
+    /** \brief saves xpubs, their state and the hash table to the buffer.
+     *         Returns the number of bytes written or 0 if the buffer is too small.
+     *         Snapshots use native byte order and are loaded on the same platform.
+     */
+    size_t snapshot(uint8_t * out, size_t len) const;
+    /** \brief replaces the index with the snapshot. If the buffer is aligned to
+     *         8 bytes the hash table is not copied, the buffer should stay valid
+     *         and unchanged until the index is cleared, destroyed or extended.
+     */
+    bool load(const uint8_t * snapshot, size_t len);
+};
+
 /** \brief PSBT class. See [bip174](https://github.com/bitcoin/bips/blob/master/bip-0174.mediawiki) */
 class PSBT : public Streamable{
 protected:
@@ -72,8 +160,12 @@ protected:
     virtual size_t to_stream(SerializeStream *s, size_t offset = 0) const;
     Script key; // key for parsing
     Script value; // value for parsing
-    uint8_t current_section;
+    size_t current_section;
     size_t last_key_pos;
+    /** \brief signs the input with the key and adds partial signature,
+     *         hashes are hashPrevouts, hashSequence and hashOutputs of the transaction.
+     */
+    bool signInput(size_t input, const uint8_t secret[32], const PublicKey & pubkey, const uint8_t hashes[96]);
 public:
     virtual size_t length() const;
     PSBT(){ txInsMeta = NULL; txOutsMeta = NULL; status = PARSING_DONE; current_section = 0; last_key_pos = 0; };
@@ -84,9 +176,9 @@ public:
     PSBTOutputMetadata * txOutsMeta;
 
     /** \brief adds key-value pair to section */
-    int add(uint8_t section, const Script * k, const Script * v);
+    int add(size_t section, const Script * k, const Script * v);
     /** \brief Signes everything it can with keys derived from root HD private key */
-    uint8_t sign(const HDPrivateKey root);
+    size_t sign(const HDPrivateKey root);
     /** \brief parses psbt transaction from base64 encoded string */
 #if USE_ARDUINO_STRING
     size_t parseBase64(String b64);
@@ -101,8 +193,12 @@ public:
     /** \brief Verifies if output is mine */
     bool isMine(uint8_t outputNumber, const HDPublicKey xpub) const;
     bool isMine(uint8_t outputNumber, const HDPrivateKey xprv) const;
+    /** \brief Verifies if output script belongs to one of the xpubs in the index */
+    bool isMine(uint8_t outputNumber, OwnershipIndex & index) const;
+    /** \brief Verifies if output goes to a change address (`xpub/1/i`) of one of the xpubs in the index */
+    bool isChange(uint8_t outputNumber, OwnershipIndex & index) const;
     // TODO: add verify() function that checks all the fields (scripts, pubkeys etc)
-    // TODO: add isChange() function that would verify the output with respect the inputs
+    // TODO: check that change outputs belong to the same xpubs as the inputs
     PSBT &operator=(PSBT const &other);
     bool isValid() const{ return status==PARSING_DONE; };
     explicit operator bool() const{ return isValid(); };
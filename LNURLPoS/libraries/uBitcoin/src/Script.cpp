@@ -45,7 +45,7 @@ void Script::fromAddress(const char * address){
     // segwit
     if(type == P2WPKH){
         int ver = 0;
-        uint8_t prog[32];
+        uint8_t prog[40];
         size_t prog_len = 0;
         int r = segwit_addr_decode(&ver, prog, &prog_len, network->bech32, address);
         if(r != 1){ // decoding failed
@@ -54,7 +54,7 @@ void Script::fromAddress(const char * address){
         scriptLen = prog_len + 2;
         scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return; }
-        scriptArray[0] = ver;
+        scriptArray[0] = (ver == 0) ? 0x00 : OP_1 + ver - 1;
         scriptArray[1] = prog_len; // varint?
         memcpy(scriptArray+2, prog, prog_len);
     }else{ // legacy or nested segwit
@@ -120,6 +120,16 @@ Script::Script(const PublicKey pubkey, ScriptType type):Script(){
         int l = pubkey.sec(sec_arr, sizeof(sec_arr));
         hash160(sec_arr, l, scriptArray+2);
     }
+    if(type == P2TR){
+        PublicKey output = taprootTweak(pubkey);
+        if(!output.isValid()){ return; }
+        scriptLen = 34;
+        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        if(scriptArray == NULL){ scriptLen = 0; return; }
+        scriptArray[0] = OP_1;
+        scriptArray[1] = 32;
+        output.xonly(scriptArray+2);
+    }
 }
 Script::Script(const Script &other, ScriptType type):Script(){
     if(type == P2SH){
@@ -249,6 +259,13 @@ ScriptType Script::type() const{
     ){
         return P2WSH;
     }
+    if(
+        (scriptLen == 34) &&
+        (scriptArray[0] == OP_1) &&
+        (scriptArray[1] == 32)
+    ){
+        return P2TR;
+    }
     return UNKNOWN_TYPE;
 }
 size_t Script::address(char * buffer, size_t len, const Network * network) const{
@@ -279,9 +296,10 @@ size_t Script::address(char * buffer, size_t len, const Network * network) const
         memcpy(buffer, address, l);
         return l;
     }
-    if(type() == P2WPKH || type() == P2WSH){
+    if(type() == P2WPKH || type() == P2WSH || type() == P2TR){
         char address[76] = { 0 };
-        segwit_addr_encode(address, network->bech32, scriptArray[0], scriptArray+2, scriptArray[1]);
+        int ver = (scriptArray[0] == 0x00) ? 0 : scriptArray[0] - OP_1 + 1;
+        segwit_addr_encode(address, network->bech32, ver, scriptArray+2, scriptArray[1]);
         size_t l = strlen(address);
         if(l > len){
             return 0;
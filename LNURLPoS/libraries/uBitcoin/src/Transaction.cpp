@@ -482,7 +482,7 @@ size_t Tx::from_stream(ParseStream *s){
     bytes_parsed+=bytes_read;
     return bytes_read;
 }
-int Tx::sigHash(uint8_t h[32], uint8_t inputIndex, const Script scriptPubkey, SigHashType sighash) const{
+int Tx::sigHash(uint8_t h[32], size_t inputIndex, const Script scriptPubkey, SigHashType sighash) const{
     Script empty;
     DoubleSha s;
     s.begin();
@@ -596,7 +596,7 @@ String Tx::wtxid() const{
 }
 #endif
 
-uint8_t Tx::addInput(const TxIn txIn){
+size_t Tx::addInput(const TxIn txIn){
     TxIn * arr = new TxIn[inputsNumber+1];
     for(unsigned int i=0; i<inputsNumber; i++){
         arr[i] = txIns[i];
@@ -609,7 +609,7 @@ uint8_t Tx::addInput(const TxIn txIn){
     inputsNumber++;
     return inputsNumber;
 }
-uint8_t Tx::addOutput(const TxOut txOut){
+size_t Tx::addOutput(const TxOut txOut){
     TxOut * arr = new TxOut[outputsNumber+1];
     for(unsigned int i=0; i<outputsNumber; i++){
         arr[i] = txOuts[i];
@@ -658,18 +658,22 @@ int Tx::hashOutputs(uint8_t h[32]) const{
     return 32;
 }
 
-int Tx::sigHashSegwit(uint8_t h[32], uint8_t inputIndex, const Script scriptPubKey, uint64_t amount, SigHashType sighash) const{
+int Tx::sigHashSegwit(uint8_t h[32], size_t inputIndex, const Script scriptPubKey, uint64_t amount, SigHashType sighash) const{
+    uint8_t hashes[96];
+    hashPrevouts(hashes);
+    hashSequence(hashes+32);
+    hashOutputs(hashes+64);
+    return sigHashSegwit(h, inputIndex, scriptPubKey, amount, hashes, sighash);
+}
+
+int Tx::sigHashSegwit(uint8_t h[32], size_t inputIndex, const Script scriptPubKey, uint64_t amount, const uint8_t hashes[96], SigHashType sighash) const{
     DoubleSha s;
     s.begin();
     uint8_t arr[8];
     intToLittleEndian(version, arr, 4);
     s.write(arr, 4);
 
-    hashPrevouts(h);
-    s.write(h, 32);
-
-    hashSequence(h);
-    s.write(h, 32);
+    s.write(hashes, 64); // hashPrevouts, hashSequence
 
     s.write(txIns[inputIndex].hash, 32);
     intToLittleEndian(txIns[inputIndex].outputIndex, arr, 4);
@@ -681,8 +685,7 @@ int Tx::sigHashSegwit(uint8_t h[32], uint8_t inputIndex, const Script scriptPubK
     intToLittleEndian(txIns[inputIndex].sequence, arr, 4);
     s.write(arr, 4);
 
-    hashOutputs(h);
-    s.write(h, 32);
+    s.write(hashes+64, 32); // hashOutputs
 
     intToLittleEndian(locktime, arr, 4);
     s.write(arr, 4);
@@ -693,7 +696,7 @@ int Tx::sigHashSegwit(uint8_t h[32], uint8_t inputIndex, const Script scriptPubK
     return 32;
 }
 
-Signature Tx::signInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, SigHashType sighash){
+Signature Tx::signInput(size_t inputIndex, const PrivateKey pk, const Script redeemScript, SigHashType sighash){
     uint8_t h[32];
     sigHash(h, inputIndex, redeemScript, sighash);
 
@@ -712,7 +715,7 @@ Signature Tx::signInput(uint8_t inputIndex, const PrivateKey pk, const Script re
 
     return sig;
 }
-Signature Tx::signSegwitInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, uint64_t amount, ScriptType type, SigHashType sighash){
+Signature Tx::signSegwitInput(size_t inputIndex, const PrivateKey pk, const Script redeemScript, uint64_t amount, ScriptType type, SigHashType sighash){
     uint8_t h[32];
 
     ScriptType redeem_type = redeemScript.type();
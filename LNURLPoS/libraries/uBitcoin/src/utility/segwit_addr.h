@@ -30,7 +30,14 @@ extern "C"
 
 #define MAX_BECH32_SIZE 1000 // for lightning
 
-/** Encode a SegWit address
+/** Supported encodings, bech32m (BIP350) is used for witness versions 1 and above */
+typedef enum {
+    BECH32_ENCODING_NONE,
+    BECH32_ENCODING_BECH32,
+    BECH32_ENCODING_BECH32M
+} bech32_encoding;
+
+/** Encode a SegWit address, bech32 for version 0 and bech32m for others
  *
  *  Out: output:   Pointer to a buffer of size 73 + strlen(hrp) that will be
  *                 updated to contain the null-terminated address.
@@ -49,7 +56,7 @@ int segwit_addr_encode(
     size_t prog_len
 );
 
-/** Decode a SegWit address
+/** Decode a SegWit address, version 0 has to use bech32 and others bech32m
  *
  *  Out: ver:      Pointer to an int that will be updated to contain the witness
  *                 program version (between 0 and 16 inclusive).
@@ -86,6 +93,14 @@ int bech32_encode(
     size_t data_len
 );
 
+/** Encode a Bech32m string, same as bech32_encode but with bech32m checksum */
+int bech32m_encode(
+    char *output,
+    const char *hrp,
+    const uint8_t *data,
+    size_t data_len
+);
+
 /** Decode a Bech32 string
  *
  *  Out: hrp:      Pointer to a buffer of size strlen(input) - 6. Will be
@@ -104,6 +119,18 @@ int bech32_decode(
     const char *input
 );
 
+/** Decode a Bech32 or Bech32m string
+ *
+ *  Arguments are the same as in bech32_decode.
+ *  Returns the encoding of the checksum, BECH32_ENCODING_NONE if decoding failed.
+ */
+bech32_encoding bech32_decode_any(
+    char *hrp,
+    uint8_t *data,
+    size_t *data_len,
+    const char *input
+);
+
 int convert_bits(uint8_t* out, size_t* outlen, int outbits, const uint8_t* in, size_t inlen, int inbits, int pad);
 
 #ifdef __cplusplus
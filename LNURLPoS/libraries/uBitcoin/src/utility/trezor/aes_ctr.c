@@ -0,0 +1,458 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "aes_ctr.h"
+#include "memzero.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <wmmintrin.h>
+#define AES_HAVE_AESNI 1
+#endif
+
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include("aes/esp_aes.h")
+#include "aes/esp_aes.h"
+#define AES_HAVE_ESP32 1
+#elif __has_include("hwcrypto/aes.h")
+#include "hwcrypto/aes.h"
+#define AES_HAVE_ESP32 1
+#endif
+#endif
+
+/*
+ * Portable implementation.
+ *
+ * Two blocks are processed at once in bitsliced form: 32 bytes become
+ * 8 words, word i holds bit i of every byte (block 0 in the low half).
+ * The S-box is computed instead of looked up, x^254 in GF(2^8) followed
+ * by the affine transform, so there are no secret-dependent branches
+ * or memory accesses. ShiftRows and MixColumns are fixed bit
+ * permutations of the words.
+ */
+
+static void bs_pack(const uint8_t in[32], uint32_t p[8]) {
+	int i, j;
+	for (i = 0; i < 8; i++) {
+		p[i] = 0;
+		for (j = 0; j < 32; j++) {
+			p[i] |= (uint32_t)((in[j] >> i) & 1) << j;
+		}
+	}
+}
+
+static void bs_unpack(const uint32_t p[8], uint8_t out[32]) {
+	int i, j;
+	for (j = 0; j < 32; j++) {
+		uint8_t b = 0;
+		for (i = 0; i < 8; i++) {
+			b |= (uint8_t)(((p[i] >> j) & 1) << i);
+		}
+		out[j] = b;
+	}
+}
+
+// r = a * b in GF(2^8) modulo x^8 + x^4 + x^3 + x + 1, r may alias a or b
+static void bs_gf_mul(uint32_t r[8], const uint32_t a[8], const uint32_t b[8]) {
+	uint32_t t[15];
+	int i, j;
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < 8; i++) {
+		for (j = 0; j < 8; j++) {
+			t[i + j] ^= a[i] & b[j];
+		}
+	}
+	// x^k = x^(k-4) + x^(k-5) + x^(k-7) + x^(k-8) for k >= 8
+	for (i = 14; i >= 8; i--) {
+		t[i - 4] ^= t[i];
+		t[i - 5] ^= t[i];
+		t[i - 7] ^= t[i];
+		t[i - 8] ^= t[i];
+	}
+	memcpy(r, t, 8 * sizeof(uint32_t));
+}
+
+// r = a^2, squaring is linear in GF(2^8), r may alias a
+static void bs_gf_sqr(uint32_t r[8], const uint32_t a[8]) {
+	uint32_t t[8];
+	t[0] = a[0] ^ a[4] ^ a[6];
+	t[1] = a[4] ^ a[6] ^ a[7];
+	t[2] = a[1] ^ a[5];
+	t[3] = a[4] ^ a[5] ^ a[6] ^ a[7];
+	t[4] = a[2] ^ a[4] ^ a[7];
+	t[5] = a[5] ^ a[6];
+	t[6] = a[3] ^ a[5];
+	t[7] = a[6] ^ a[7];
+	memcpy(r, t, sizeof(t));
+}
+
+static void bs_sub_bytes(uint32_t p[8]) {
+	uint32_t x2[8], x3[8], x12[8], x14[8], y[8];
+	int i;
+	// x^254 = x^-1 (and 0 for 0)
+	bs_gf_sqr(x2, p);             // x^2
+	bs_gf_mul(x3, x2, p);         // x^3
+	bs_gf_sqr(y, x3);             // x^6
+	bs_gf_sqr(x12, y);            // x^12
+	bs_gf_mul(x14, x12, x2);      // x^14
+	bs_gf_mul(y, x12, x3);        // x^15
+	for (i = 0; i < 4; i++) {
+		bs_gf_sqr(y, y);          // x^30, x^60, x^120, x^240
+	}
+	bs_gf_mul(y, y, x14);         // x^254
+	// affine transform, constant 0x63
+	for (i = 0; i < 8; i++) {
+		p[i] = y[i] ^ y[(i + 4) & 7] ^ y[(i + 5) & 7] ^ y[(i + 6) & 7] ^
+		       y[(i + 7) & 7];
+	}
+	p[0] = ~p[0];
+	p[1] = ~p[1];
+	p[5] = ~p[5];
+	p[6] = ~p[6];
+	memzero(x2, sizeof(x2));
+	memzero(x3, sizeof(x3));
+	memzero(x12, sizeof(x12));
+	memzero(x14, sizeof(x14));
+	memzero(y, sizeof(y));
+}
+
+// byte 4 * column + row of each block sits at bit 4 * column + row
+// of the corresponding 16-bit half, ROTR16 rotates both halves
+#define ROTR16(x, k, lo) ((((x) >> (k)) & (lo)) | (((x) << (16 - (k))) & ~(lo)))
+
+static void bs_shift_rows(uint32_t p[8]) {
+	int i;
+	for (i = 0; i < 8; i++) {
+		uint32_t x = p[i];
+		p[i] = (x & 0x11111111) |
+		       ROTR16(x & 0x22222222, 4, 0x0FFF0FFF) |
+		       ROTR16(x & 0x44444444, 8, 0x00FF00FF) |
+		       ROTR16(x & 0x88888888, 12, 0x000F000F);
+	}
+}
+
+// next row of the same column
+#define ROT_ROW1(x) ((((x) >> 1) & 0x77777777) | (((x) << 3) & 0x88888888))
+#define ROT_ROW2(x) ((((x) >> 2) & 0x33333333) | (((x) << 2) & 0xCCCCCCCC))
+
+static void bs_mix_columns(uint32_t p[8]) {
+	uint32_t t[8], all[8];
+	int i;
+	// b[r] = a[r] ^ (a[0] ^ a[1] ^ a[2] ^ a[3]) ^ xtime(a[r] ^ a[r+1])
+	for (i = 0; i < 8; i++) {
+		t[i] = p[i] ^ ROT_ROW1(p[i]);
+		all[i] = t[i] ^ ROT_ROW2(t[i]);
+	}
+	p[0] ^= all[0] ^ t[7];
+	p[1] ^= all[1] ^ t[0] ^ t[7];
+	p[2] ^= all[2] ^ t[1];
+	p[3] ^= all[3] ^ t[2] ^ t[7];
+	p[4] ^= all[4] ^ t[3] ^ t[7];
+	p[5] ^= all[5] ^ t[4];
+	p[6] ^= all[6] ^ t[5];
+	p[7] ^= all[7] ^ t[6];
+}
+
+static void bs_add_round_key(uint32_t p[8], const uint32_t rk[8]) {
+	int i;
+	for (i = 0; i < 8; i++) {
+		p[i] ^= rk[i];
+	}
+}
+
+// encrypts two blocks in place
+static void aes_encrypt2_portable(const AES_CTX *ctx, uint8_t s[32]) {
+	uint32_t p[8];
+	int r;
+	bs_pack(s, p);
+	bs_add_round_key(p, ctx->bsrk[0]);
+	for (r = 1; r <= ctx->rounds; r++) {
+		bs_sub_bytes(p);
+		bs_shift_rows(p);
+		if (r != ctx->rounds) {
+			bs_mix_columns(p);
+		}
+		bs_add_round_key(p, ctx->bsrk[r]);
+	}
+	bs_unpack(p, s);
+	memzero(p, sizeof(p));
+}
+
+// applies the S-box to the first 4 bytes of w
+static void sub_word(uint8_t w[4]) {
+	uint8_t s[32] = {0};
+	uint32_t p[8];
+	memcpy(s, w, 4);
+	bs_pack(s, p);
+	bs_sub_bytes(p);
+	bs_unpack(p, s);
+	memcpy(w, s, 4);
+	memzero(s, sizeof(s));
+	memzero(p, sizeof(p));
+}
+
+static inline uint8_t xtime(uint8_t x) {
+	return (uint8_t)((x << 1) ^ (0x1b & -(x >> 7)));
+}
+
+static void aes_expand_key(AES_CTX *ctx, const uint8_t *key, size_t keylen) {
+	uint8_t *w = (uint8_t *)ctx->rk;
+	uint8_t t[4];
+	uint8_t s[32];
+	uint8_t rcon = 1;
+	size_t nk = keylen / 4;
+	size_t total = 4 * (ctx->rounds + 1);
+	size_t i;
+	int j;
+
+	memcpy(w, key, keylen);
+	for (i = nk; i < total; i++) {
+		memcpy(t, w + 4 * (i - 1), 4);
+		if (i % nk == 0) {
+			// RotWord, SubWord, Rcon
+			uint8_t b = t[0];
+			t[0] = t[1]; t[1] = t[2]; t[2] = t[3]; t[3] = b;
+			sub_word(t);
+			t[0] ^= rcon;
+			rcon = xtime(rcon);
+		} else if (nk > 6 && i % nk == 4) {
+			sub_word(t);
+		}
+		for (j = 0; j < 4; j++) {
+			w[4 * i + j] = w[4 * (i - nk) + j] ^ t[j];
+		}
+	}
+	// bitsliced round keys for the portable implementation, same key
+	// for both blocks
+	for (i = 0; i <= (size_t)ctx->rounds; i++) {
+		memcpy(s, ctx->rk[i], 16);
+		memcpy(s + 16, ctx->rk[i], 16);
+		bs_pack(s, ctx->bsrk[i]);
+	}
+	memzero(t, sizeof(t));
+	memzero(s, sizeof(s));
+}
+
+/*
+ * AES-NI, compiled with a target attribute and enabled after a CPUID check,
+ * so the library doesn't need to be built with -maes.
+ */
+
+#if AES_HAVE_AESNI
+static int aesni_available(void) {
+#if defined(__AES__)
+	return 1;
+#else
+	return __builtin_cpu_supports("aes");
+#endif
+}
+
+__attribute__((target("aes,sse2")))
+static void aes_encrypt_blocks_aesni(const AES_CTX *ctx, uint8_t *blocks,
+                                     size_t n) {
+	__m128i rk[15];
+	int r;
+	size_t i;
+	for (r = 0; r <= ctx->rounds; r++) {
+		rk[r] = _mm_loadu_si128((const __m128i *)ctx->rk[r]);
+	}
+	// four independent blocks keep the AES unit busy
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i b0 = _mm_loadu_si128((const __m128i *)(blocks + 16 * i));
+		__m128i b1 = _mm_loadu_si128((const __m128i *)(blocks + 16 * i + 16));
+		__m128i b2 = _mm_loadu_si128((const __m128i *)(blocks + 16 * i + 32));
+		__m128i b3 = _mm_loadu_si128((const __m128i *)(blocks + 16 * i + 48));
+		b0 = _mm_xor_si128(b0, rk[0]);
+		b1 = _mm_xor_si128(b1, rk[0]);
+		b2 = _mm_xor_si128(b2, rk[0]);
+		b3 = _mm_xor_si128(b3, rk[0]);
+		for (r = 1; r < ctx->rounds; r++) {
+			b0 = _mm_aesenc_si128(b0, rk[r]);
+			b1 = _mm_aesenc_si128(b1, rk[r]);
+			b2 = _mm_aesenc_si128(b2, rk[r]);
+			b3 = _mm_aesenc_si128(b3, rk[r]);
+		}
+		_mm_storeu_si128((__m128i *)(blocks + 16 * i), _mm_aesenclast_si128(b0, rk[r]));
+		_mm_storeu_si128((__m128i *)(blocks + 16 * i + 16), _mm_aesenclast_si128(b1, rk[r]));
+		_mm_storeu_si128((__m128i *)(blocks + 16 * i + 32), _mm_aesenclast_si128(b2, rk[r]));
+		_mm_storeu_si128((__m128i *)(blocks + 16 * i + 48), _mm_aesenclast_si128(b3, rk[r]));
+	}
+	for (; i < n; i++) {
+		__m128i b = _mm_loadu_si128((const __m128i *)(blocks + 16 * i));
+		b = _mm_xor_si128(b, rk[0]);
+		for (r = 1; r < ctx->rounds; r++) {
+			b = _mm_aesenc_si128(b, rk[r]);
+		}
+		_mm_storeu_si128((__m128i *)(blocks + 16 * i), _mm_aesenclast_si128(b, rk[r]));
+	}
+	memzero(rk, sizeof(rk));
+}
+#endif
+
+/*
+ * ESP32 hardware AES peripheral, locking is done by esp_aes_crypt_ecb()
+ */
+
+#if AES_HAVE_ESP32
+static void aes_encrypt_blocks_esp32(const AES_CTX *ctx, uint8_t *blocks,
+                                     size_t n) {
+	esp_aes_context hw;
+	size_t i;
+	esp_aes_init(&hw);
+	esp_aes_setkey(&hw, ctx->key, 8 * ctx->keylen);
+	for (i = 0; i < n; i++) {
+		esp_aes_crypt_ecb(&hw, ESP_AES_ENCRYPT, blocks + 16 * i, blocks + 16 * i);
+	}
+	esp_aes_free(&hw);
+}
+#endif
+
+/*
+ * Public API
+ */
+
+// encrypts n blocks in place with the selected backend
+static void aes_encrypt_blocks(const AES_CTX *ctx, uint8_t *blocks, size_t n) {
+	size_t i;
+	switch (ctx->backend) {
+#if AES_HAVE_AESNI
+		case AES_BACKEND_AESNI:
+			aes_encrypt_blocks_aesni(ctx, blocks, n);
+			return;
+#endif
+#if AES_HAVE_ESP32
+		case AES_BACKEND_ESP32:
+			aes_encrypt_blocks_esp32(ctx, blocks, n);
+			return;
+#endif
+		default:
+			break;
+	}
+	for (i = 0; i + 2 <= n; i += 2) {
+		aes_encrypt2_portable(ctx, blocks + 16 * i);
+	}
+	if (i < n) {
+		uint8_t s[32] = {0};
+		memcpy(s, blocks + 16 * i, 16);
+		aes_encrypt2_portable(ctx, s);
+		memcpy(blocks + 16 * i, s, 16);
+		memzero(s, sizeof(s));
+	}
+}
+
+int aes_init_backend(AES_CTX *ctx, const uint8_t *key, size_t keylen,
+                     int backend) {
+	if (keylen != 16 && keylen != 32) {
+		return -1;
+	}
+	switch (backend) {
+		case AES_BACKEND_PORTABLE:
+			break;
+#if AES_HAVE_AESNI
+		case AES_BACKEND_AESNI:
+			if (!aesni_available()) {
+				return -1;
+			}
+			break;
+#endif
+#if AES_HAVE_ESP32
+		case AES_BACKEND_ESP32:
+			break;
+#endif
+		default:
+			return -1;
+	}
+	memzero(ctx, sizeof(AES_CTX));
+	ctx->backend = backend;
+	ctx->keylen = (int)keylen;
+	ctx->rounds = (keylen == 16) ? 10 : 14;
+	memcpy(ctx->key, key, keylen);
+	aes_expand_key(ctx, key, keylen);
+	return 0;
+}
+
+int aes_init(AES_CTX *ctx, const uint8_t *key, size_t keylen) {
+#if AES_HAVE_ESP32
+	if (aes_init_backend(ctx, key, keylen, AES_BACKEND_ESP32) == 0) {
+		return 0;
+	}
+#endif
+#if AES_HAVE_AESNI
+	if (aes_init_backend(ctx, key, keylen, AES_BACKEND_AESNI) == 0) {
+		return 0;
+	}
+#endif
+	return aes_init_backend(ctx, key, keylen, AES_BACKEND_PORTABLE);
+}
+
+const char *aes_backend_name(int backend) {
+	switch (backend) {
+		case AES_BACKEND_AESNI:
+			return "aes-ni";
+		case AES_BACKEND_ESP32:
+			return "esp32";
+		default:
+			return "portable";
+	}
+}
+
+void aes_encrypt_block(const AES_CTX *ctx, const uint8_t in[AES_BLOCK_SIZE],
+                       uint8_t out[AES_BLOCK_SIZE]) {
+	memmove(out, in, AES_BLOCK_SIZE);
+	aes_encrypt_blocks(ctx, out, 1);
+}
+
+void aes_ctr_xor(const AES_CTX *ctx, const uint8_t iv[AES_BLOCK_SIZE],
+                 uint8_t *data, size_t len) {
+	// keystream is produced 8 blocks at a time
+	uint8_t ks[8 * AES_BLOCK_SIZE];
+	uint8_t ctr[AES_BLOCK_SIZE];
+	size_t i, n, blocks;
+	int j;
+	memcpy(ctr, iv, AES_BLOCK_SIZE);
+	while (len > 0) {
+		n = len < sizeof(ks) ? len : sizeof(ks);
+		blocks = (n + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+		for (i = 0; i < blocks; i++) {
+			memcpy(ks + AES_BLOCK_SIZE * i, ctr, AES_BLOCK_SIZE);
+			// increment the 128-bit big endian counter
+			for (j = AES_BLOCK_SIZE - 1; j >= 0; j--) {
+				if (++ctr[j] != 0) {
+					break;
+				}
+			}
+		}
+		aes_encrypt_blocks(ctx, ks, blocks);
+		for (i = 0; i < n; i++) {
+			data[i] ^= ks[i];
+		}
+		data += n;
+		len -= n;
+	}
+	memzero(ks, sizeof(ks));
+}
+
+void aes_clear(AES_CTX *ctx) {
+	memzero(ctx, sizeof(AES_CTX));
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __AES_CTR_H__
+#define __AES_CTR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define AES_BLOCK_SIZE 16
+
+// AES implementations, aes_init() picks the fastest one available
+#define AES_BACKEND_PORTABLE 0  // constant-time bitsliced S-box, no tables
+#define AES_BACKEND_AESNI    1  // x86 AES-NI instructions
+#define AES_BACKEND_ESP32    2  // ESP32 hardware AES peripheral
+
+typedef struct _AES_CTX {
+	uint8_t rk[15][AES_BLOCK_SIZE];  // expanded round keys
+	uint32_t bsrk[15][8];            // bitsliced round keys (portable)
+	uint8_t key[32];                 // raw key for the hardware peripheral
+	int keylen;
+	int rounds;
+	int backend;
+} AES_CTX;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// keylen is 16 or 32 bytes (AES-128 or AES-256), returns 0 on success
+int aes_init(AES_CTX *ctx, const uint8_t *key, size_t keylen);
+// same as aes_init() with a specific backend,
+// returns -1 if it is not available on this platform
+int aes_init_backend(AES_CTX *ctx, const uint8_t *key, size_t keylen,
+                     int backend);
+// name of the backend ("portable", "aes-ni" or "esp32")
+const char *aes_backend_name(int backend);
+
+void aes_encrypt_block(const AES_CTX *ctx, const uint8_t in[AES_BLOCK_SIZE],
+                       uint8_t out[AES_BLOCK_SIZE]);
+// CTR mode (NIST SP 800-38A), xors len bytes of keystream into data.
+// iv is the initial 128-bit big endian counter block.
+void aes_ctr_xor(const AES_CTX *ctx, const uint8_t iv[AES_BLOCK_SIZE],
+                 uint8_t *data, size_t len);
+
+void aes_clear(AES_CTX *ctx);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif
@@ -481,12 +481,273 @@ void bn_multiply_reduce(bignum256 *x, uint32_t res[18], const bignum256 *prime)
 	}
 }
 
+#if USE_BN_64
+
+/* 64-bit backend for hosts with a 64x64->128 bit multiplier.
+ *
+ * Primes of the form 2^256 - c with c < 2^130, like the secp256k1
+ * field prime and group order, are handled in four 64-bit limbs:
+ * a number hi * 2^256 + lo is reduced as lo + hi * c.  Other primes
+ * keep using the 30-bit code.  bignum256 stays the interface type,
+ * numbers are only converted on entry and exit.
+ */
+
+typedef unsigned __int128 bn_uint128;
+
+typedef struct {
+	uint64_t c[3]; // 2^256 - prime
+	int clen;      // number of non-zero limbs in c
+} bn64_prime;
+
+#define BN64_MASK30 0x3FFFFFFFull
+
+// reads a normalized bignum256 (up to 270 bits) into five 64-bit limbs
+static inline void bn64_read(const bignum256 *a, uint64_t r[5])
+{
+	const uint32_t *v = a->val;
+	r[0] = v[0] | ((uint64_t)v[1] << 30) | ((uint64_t)v[2] << 60);
+	r[1] = (v[2] >> 4) | ((uint64_t)v[3] << 26) | ((uint64_t)v[4] << 56);
+	r[2] = (v[4] >> 8) | ((uint64_t)v[5] << 22) | ((uint64_t)v[6] << 52);
+	r[3] = (v[6] >> 12) | ((uint64_t)v[7] << 18) | ((uint64_t)v[8] << 48);
+	r[4] = v[8] >> 16;
+}
+
+// writes a 256 bit number as a normalized bignum256
+static inline void bn64_write(const uint64_t r[4], bignum256 *a)
+{
+	uint32_t *v = a->val;
+	v[0] = r[0] & BN64_MASK30;
+	v[1] = (r[0] >> 30) & BN64_MASK30;
+	v[2] = ((r[0] >> 60) | (r[1] << 4)) & BN64_MASK30;
+	v[3] = (r[1] >> 26) & BN64_MASK30;
+	v[4] = ((r[1] >> 56) | (r[2] << 8)) & BN64_MASK30;
+	v[5] = (r[2] >> 22) & BN64_MASK30;
+	v[6] = ((r[2] >> 52) | (r[3] << 12)) & BN64_MASK30;
+	v[7] = (r[3] >> 18) & BN64_MASK30;
+	v[8] = r[3] >> 48;
+}
+
+// returns 1 if prime is 2^256 - c with c < 2^130 and fills pm.
+// Two folds of bn64_reduce leave at most 2^256 + 2^261 then, with
+// a larger c the second fold overflows into a fifth limb
+static inline int bn64_prime_init(const bignum256 *prime, bn64_prime *pm)
+{
+	uint64_t p[5];
+	if (prime->val[8] != 0xFFFF || prime->val[7] != 0x3FFFFFFF ||
+	    prime->val[6] != 0x3FFFFFFF || (prime->val[5] >> 10) != 0xFFFFF) {
+		return 0;
+	}
+	bn64_read(prime, p);
+	// c = 2^256 - prime, prime is odd so there is no carry out of limb 0
+	pm->c[0] = -p[0];
+	pm->c[1] = ~p[1];
+	pm->c[2] = ~p[2];
+	if (pm->c[2] != 0 || (pm->c[1] >> 2) != 0) {
+		return 0;
+	}
+	pm->clen = pm->c[1] ? 2 : 1;
+	return 1;
+}
+
+// r = r + top * c, top * c must be below 2^256,
+// returns the carry out of the 256 bits (0 or 1)
+static inline uint64_t bn64_addmul_top(uint64_t r[4], uint64_t top, const bn64_prime *pm)
+{
+	bn_uint128 t = 0;
+	int j;
+	for (j = 0; j < 4; j++) {
+		if (j < pm->clen) {
+			t += (bn_uint128)top * pm->c[j];
+		}
+		t += r[j];
+		r[j] = (uint64_t)t;
+		t >>= 64;
+	}
+	return (uint64_t)t;
+}
+
+// r = r + carry * c, carry is 0 or 1 and r < c if carry is 1,
+// so nothing overflows. Constant time.
+static inline void bn64_add_carry(uint64_t r[4], uint64_t carry, const bn64_prime *pm)
+{
+	uint64_t mask = -carry;
+	bn_uint128 t = 0;
+	int j;
+	for (j = 0; j < 4; j++) {
+		t += r[j];
+		if (j < 3) {
+			t += pm->c[j] & mask;
+		}
+		r[j] = (uint64_t)t;
+		t >>= 64;
+	}
+}
+
+// a += m * c, a has 8 limbs and the result must fit
+static void bn64_muladd(uint64_t a[8], const uint64_t *m, int mlen, const bn64_prime *pm)
+{
+	int i, j;
+	for (i = 0; i < mlen; i++) {
+		bn_uint128 acc = 0;
+		for (j = 0; j < pm->clen; j++) {
+			acc += (bn_uint128)m[i] * pm->c[j] + a[i + j];
+			a[i + j] = (uint64_t)acc;
+			acc >>= 64;
+		}
+		for (j = i + pm->clen; j < 8; j++) {
+			acc += a[j];
+			a[j] = (uint64_t)acc;
+			acc >>= 64;
+		}
+	}
+}
+
+// reduces a 512 bit number t below 2^256 (partly reduced) into r
+static void bn64_reduce(const uint64_t t[8], uint64_t r[4], const bn64_prime *pm)
+{
+	uint64_t top;
+	if (pm->clen == 1) {
+		// secp256k1 field prime: c is a single limb
+		const uint64_t c = pm->c[0];
+		bn_uint128 acc = 0;
+		int j;
+		for (j = 0; j < 4; j++) {
+			acc += (bn_uint128)t[4 + j] * c + t[j];
+			r[j] = (uint64_t)acc;
+			acc >>= 64;
+		}
+		top = (uint64_t)acc; // < c + 1
+	} else {
+		uint64_t a[8] = {0};
+		uint64_t hi[3];
+		memcpy(a, t, 4 * sizeof(uint64_t));
+		// t < 2^512  ->  a < 2^256 * (c + 1), high part is below 2^131
+		bn64_muladd(a, t + 4, 4, pm);
+		memcpy(hi, a + 4, sizeof(hi));
+		memset(a + 4, 0, 4 * sizeof(uint64_t));
+		//            ->  a < 2^256 + 2^131 * c < 2^256 + 2^261, top fits a[4]
+		bn64_muladd(a, hi, 3, pm);
+		memcpy(r, a, 4 * sizeof(uint64_t));
+		top = a[4];
+		memzero(a, sizeof(a));
+		memzero(hi, sizeof(hi));
+	}
+	// top * c is small now, the carry can only happen once
+	bn64_add_carry(r, bn64_addmul_top(r, top, pm), pm);
+}
+// converts a normalized bignum256 into 4 limbs below 2^256
+static inline void bn64_load(const bignum256 *x, uint64_t r[4], const bn64_prime *pm)
+{
+	uint64_t a[5];
+	bn64_read(x, a);
+	memcpy(r, a, 4 * sizeof(uint64_t));
+	// x < 2^270, the top limb is below 2^14
+	bn64_add_carry(r, bn64_addmul_top(r, a[4], pm), pm);
+	memzero(a, sizeof(a));
+}
+
+// r = a * b, partly reduced, r may alias a or b
+static void bn64_mulmod(const uint64_t a[4], const uint64_t b[4], uint64_t r[4], const bn64_prime *pm)
+{
+	uint64_t t[8];
+	int i, j;
+	for (i = 0; i < 4; i++) {
+		bn_uint128 carry = 0;
+		for (j = 0; j < 4; j++) {
+			carry += (bn_uint128)a[i] * b[j] + (i == 0 ? 0 : t[i + j]);
+			t[i + j] = (uint64_t)carry;
+			carry >>= 64;
+		}
+		t[i + 4] = (uint64_t)carry;
+	}
+	bn64_reduce(t, r, pm);
+	memzero(t, sizeof(t));
+}
+
+// r = a^2, partly reduced, r may alias a
+static void bn64_sqrmod(const uint64_t a[4], uint64_t r[4], const bn64_prime *pm)
+{
+	uint64_t t[8] = {0};
+	bn_uint128 carry;
+	uint64_t top;
+	int i, j;
+	// cross products a[i] * a[j], i < j
+	for (i = 0; i < 3; i++) {
+		carry = 0;
+		for (j = i + 1; j < 4; j++) {
+			carry += (bn_uint128)a[i] * a[j] + t[i + j];
+			t[i + j] = (uint64_t)carry;
+			carry >>= 64;
+		}
+		t[i + 4] = (uint64_t)carry;
+	}
+	// double them and add the squares
+	carry = 0;
+	for (i = 0; i < 4; i++) {
+		bn_uint128 sq = (bn_uint128)a[i] * a[i];
+		carry += (bn_uint128)(t[2 * i] << 1) + (uint64_t)sq;
+		top = t[2 * i] >> 63;
+		t[2 * i] = (uint64_t)carry;
+		carry >>= 64;
+		carry += (bn_uint128)(t[2 * i + 1] << 1) + (uint64_t)(sq >> 64) + top;
+		top = t[2 * i + 1] >> 63;
+		t[2 * i + 1] = (uint64_t)carry;
+		carry >>= 64;
+		carry += top;
+	}
+	bn64_reduce(t, r, pm);
+	memzero(t, sizeof(t));
+}
+
+// x = x^e mod prime with a fixed 4-bit window, e is public
+static void bn64_pow(bignum256 *x, const uint64_t e[4], const bignum256 *prime, const bn64_prime *pm)
+{
+	uint64_t table[16][4];
+	uint64_t r[4];
+	int i, j;
+	memset(table[0], 0, sizeof(table[0]));
+	table[0][0] = 1;
+	bn64_load(x, table[1], pm);
+	for (i = 2; i < 16; i++) {
+		bn64_mulmod(table[i - 1], table[1], table[i], pm);
+	}
+	memcpy(r, table[0], sizeof(r));
+	for (i = 63; i >= 0; i--) {
+		int w = (e[i / 16] >> (4 * (i % 16))) & 0xF;
+		for (j = 0; j < 4; j++) {
+			bn64_sqrmod(r, r, pm);
+		}
+		if (w != 0) {
+			bn64_mulmod(r, table[w], r, pm);
+		}
+	}
+	bn64_write(r, x);
+	bn_mod(x, prime);
+	memzero(table, sizeof(table));
+	memzero(r, sizeof(r));
+}
+
+#endif
+
 // Compute x := k * x  (mod prime)
 // both inputs must be smaller than 180 * prime.
 // result is partly reduced (0 <= x < 2 * prime)
 // This only works for primes between 2^256-2^224 and 2^256.
 void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime)
 {
+#if USE_BN_64
+	bn64_prime pm;
+	if (bn64_prime_init(prime, &pm)) {
+		uint64_t a[4], b[4];
+		bn64_load(k, a, &pm);
+		bn64_load(x, b, &pm);
+		bn64_mulmod(a, b, a, &pm);
+		bn64_write(a, x);
+		memzero(a, sizeof(a));
+		memzero(b, sizeof(b));
+		return;
+	}
+#endif
 	uint32_t res[18] = {0};
 	bn_multiply_long(k, x, res);
 	bn_multiply_reduce(x, res, prime); 
@@ -525,6 +786,19 @@ void bn_sqrt(bignum256 *x, const bignum256 *prime)
 	// this method compute x^1/2 = x^(prime+1)/4
 	uint32_t i, j, limb;
 	bignum256 res, p;
+#if USE_BN_64
+	bn64_prime pm;
+	if (bn64_prime_init(prime, &pm)) {
+		uint64_t e[5];
+		memcpy(&p, prime, sizeof(bignum256));
+		bn_addi(&p, 1);
+		bn_rshift(&p);
+		bn_rshift(&p);
+		bn64_read(&p, e);
+		bn64_pow(x, e, prime, &pm);
+		return;
+	}
+#endif
 	bn_one(&res);
 	// compute p = (prime+1)/4
 	memcpy(&p, prime, sizeof(bignum256));
@@ -556,7 +830,267 @@ void bn_sqrt(bignum256 *x, const bignum256 *prime)
 	memzero(&p, sizeof(p));
 }
 
-#if ! USE_INVERSE_FAST
+/* Constant time inversion with Bernstein-Yang divsteps ("safegcd"),
+ * https://gcd.cr.yp.to/safegcd-20190413.pdf, following the libsecp256k1
+ * modinv32/modinv64 implementation.
+ *
+ * f = prime and g = x are kept in signed limbs of BN_DIVSTEP_BITS bits:
+ * 62 with 128-bit integers, 30 otherwise.  Each batch of divsteps only
+ * looks at the low limbs of f and g and yields a 2x2 matrix that is then
+ * applied to f, g and to d, e (the coefficients of x^-1 mod prime).
+ * 744 divsteps (12 batches of 62 or 25 of 30) are enough for 256-bit
+ * inputs, so the loop count and memory accesses do not depend on x.
+ */
+#if USE_BN_64
+
+#define BN_DIVSTEP_BITS 62
+#define BN_DIVSTEP_LIMBS 5
+#define BN_DIVSTEP_BATCHES 12
+
+typedef int64_t bn_divstep_limb;
+typedef uint64_t bn_divstep_ulimb;
+typedef __int128 bn_divstep_wide;
+
+// signed 62-bit limbs of a normalized bignum256
+static void bn_to_divstep(const bignum256 *a, bn_divstep_limb r[5])
+{
+	const uint64_t M62 = UINT64_MAX >> 2;
+	r[0] = (a->val[0] | (uint64_t)a->val[1] << 30 | (uint64_t)a->val[2] << 60) & M62;
+	r[1] = (a->val[2] >> 2 | (uint64_t)a->val[3] << 28 | (uint64_t)a->val[4] << 58) & M62;
+	r[2] = (a->val[4] >> 4 | (uint64_t)a->val[5] << 26 | (uint64_t)a->val[6] << 56) & M62;
+	r[3] = (a->val[6] >> 6 | (uint64_t)a->val[7] << 24 | (uint64_t)a->val[8] << 54) & M62;
+	r[4] = a->val[8] >> 8;
+}
+
+// r must be in [0, 2^256) with limbs in [0, 2^62)
+static void bn_from_divstep(const bn_divstep_limb r[5], bignum256 *a)
+{
+	const uint64_t M30 = 0x3FFFFFFF;
+	uint64_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+	a->val[0] = r0 & M30;
+	a->val[1] = (r0 >> 30) & M30;
+	a->val[2] = ((r0 >> 60) | (r1 << 2)) & M30;
+	a->val[3] = (r1 >> 28) & M30;
+	a->val[4] = ((r1 >> 58) | (r2 << 4)) & M30;
+	a->val[5] = (r2 >> 26) & M30;
+	a->val[6] = ((r2 >> 56) | (r3 << 6)) & M30;
+	a->val[7] = (r3 >> 24) & M30;
+	a->val[8] = (r3 >> 54) | (r4 << 8);
+}
+
+#else
+
+#define BN_DIVSTEP_BITS 30
+#define BN_DIVSTEP_LIMBS 9
+#define BN_DIVSTEP_BATCHES 25
+
+typedef int32_t bn_divstep_limb;
+typedef uint32_t bn_divstep_ulimb;
+typedef int64_t bn_divstep_wide;
+
+// bignum256 already uses 30-bit limbs
+static void bn_to_divstep(const bignum256 *a, bn_divstep_limb r[9])
+{
+	int i;
+	for (i = 0; i < 9; i++) {
+		r[i] = a->val[i];
+	}
+}
+
+static void bn_from_divstep(const bn_divstep_limb r[9], bignum256 *a)
+{
+	int i;
+	for (i = 0; i < 9; i++) {
+		a->val[i] = r[i];
+	}
+}
+
+#endif
+
+#define BN_DIVSTEP_MASK ((bn_divstep_limb)(((bn_divstep_ulimb)-1) >> (8 * sizeof(bn_divstep_limb) - BN_DIVSTEP_BITS)))
+
+// transition matrix of a batch of divsteps, scaled by 2^BN_DIVSTEP_BITS
+typedef struct {
+	bn_divstep_limb u, v, q, r;
+} bn_divstep_matrix;
+
+// BN_DIVSTEP_BITS divsteps on the low bits of f and g, eta = -delta.
+// Branch-free: f is odd, g is made even in every step by adding or
+// subtracting f and swapping them if delta > 0.
+static bn_divstep_limb bn_divsteps(bn_divstep_limb eta, bn_divstep_ulimb f0, bn_divstep_ulimb g0, bn_divstep_matrix *t)
+{
+	// u, v, q, r are signed, kept unsigned so that shifts are defined
+	bn_divstep_ulimb u = 1, v = 0, q = 0, r = 1;
+	bn_divstep_ulimb c1, c2, f = f0, g = g0, x, y, z;
+	int i;
+
+	for (i = 0; i < BN_DIVSTEP_BITS; i++) {
+		// masks for eta < 0 and g odd
+		c1 = (bn_divstep_ulimb)(eta >> (8 * sizeof(eta) - 1));
+		c2 = -(g & 1);
+		// x, y, z = f, u, v negated if eta < 0
+		x = (f ^ c1) - c1;
+		y = (u ^ c1) - c1;
+		z = (v ^ c1) - c1;
+		// g, q, r += x, y, z if g is odd
+		g += x & c2;
+		q += y & c2;
+		r += z & c2;
+		// swap if eta < 0 and g was odd: eta = -eta - 1, f = old g
+		c1 &= c2;
+		eta = (eta ^ (bn_divstep_limb)c1) - ((bn_divstep_limb)c1 + 1);
+		f += g & c1;
+		u += q & c1;
+		v += r & c1;
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+	t->u = (bn_divstep_limb)u;
+	t->v = (bn_divstep_limb)v;
+	t->q = (bn_divstep_limb)q;
+	t->r = (bn_divstep_limb)r;
+	return eta;
+}
+
+// [f, g] = t * [f, g] / 2^BN_DIVSTEP_BITS, exact
+static void bn_divstep_update_fg(bn_divstep_limb *f, bn_divstep_limb *g, const bn_divstep_matrix *t)
+{
+	bn_divstep_wide cf, cg;
+	int i;
+
+	cf = (bn_divstep_wide)t->u * f[0] + (bn_divstep_wide)t->v * g[0];
+	cg = (bn_divstep_wide)t->q * f[0] + (bn_divstep_wide)t->r * g[0];
+	cf >>= BN_DIVSTEP_BITS;
+	cg >>= BN_DIVSTEP_BITS;
+	for (i = 1; i < BN_DIVSTEP_LIMBS; i++) {
+		cf += (bn_divstep_wide)t->u * f[i] + (bn_divstep_wide)t->v * g[i];
+		cg += (bn_divstep_wide)t->q * f[i] + (bn_divstep_wide)t->r * g[i];
+		f[i - 1] = (bn_divstep_limb)cf & BN_DIVSTEP_MASK;
+		g[i - 1] = (bn_divstep_limb)cg & BN_DIVSTEP_MASK;
+		cf >>= BN_DIVSTEP_BITS;
+		cg >>= BN_DIVSTEP_BITS;
+	}
+	f[i - 1] = (bn_divstep_limb)cf;
+	g[i - 1] = (bn_divstep_limb)cg;
+}
+
+// [d, e] = (t * [d, e] + m * [md, me]) / 2^BN_DIVSTEP_BITS with md, me
+// chosen to make the division exact and to keep d, e in (-2m, m).
+// m_inv is m^-1 mod 2^BN_DIVSTEP_BITS.
+static void bn_divstep_update_de(bn_divstep_limb *d, bn_divstep_limb *e, const bn_divstep_matrix *t, const bn_divstep_limb *m, bn_divstep_ulimb m_inv)
+{
+	bn_divstep_limb sd, se, md, me;
+	bn_divstep_wide cd, ce;
+	int i;
+
+	// md, me = u, q if d < 0, plus v, r if e < 0
+	sd = d[BN_DIVSTEP_LIMBS - 1] >> (BN_DIVSTEP_BITS + 1);
+	se = e[BN_DIVSTEP_LIMBS - 1] >> (BN_DIVSTEP_BITS + 1);
+	md = (t->u & sd) + (t->v & se);
+	me = (t->q & sd) + (t->r & se);
+	cd = (bn_divstep_wide)t->u * d[0] + (bn_divstep_wide)t->v * e[0];
+	ce = (bn_divstep_wide)t->q * d[0] + (bn_divstep_wide)t->r * e[0];
+	// make the low bits of cd + m * md and ce + m * me zero
+	md -= (m_inv * (bn_divstep_ulimb)cd + md) & BN_DIVSTEP_MASK;
+	me -= (m_inv * (bn_divstep_ulimb)ce + me) & BN_DIVSTEP_MASK;
+	cd += (bn_divstep_wide)m[0] * md;
+	ce += (bn_divstep_wide)m[0] * me;
+	cd >>= BN_DIVSTEP_BITS;
+	ce >>= BN_DIVSTEP_BITS;
+	for (i = 1; i < BN_DIVSTEP_LIMBS; i++) {
+		cd += (bn_divstep_wide)t->u * d[i] + (bn_divstep_wide)t->v * e[i];
+		ce += (bn_divstep_wide)t->q * d[i] + (bn_divstep_wide)t->r * e[i];
+		cd += (bn_divstep_wide)m[i] * md;
+		ce += (bn_divstep_wide)m[i] * me;
+		d[i - 1] = (bn_divstep_limb)cd & BN_DIVSTEP_MASK;
+		e[i - 1] = (bn_divstep_limb)ce & BN_DIVSTEP_MASK;
+		cd >>= BN_DIVSTEP_BITS;
+		ce >>= BN_DIVSTEP_BITS;
+	}
+	d[i - 1] = (bn_divstep_limb)cd;
+	e[i - 1] = (bn_divstep_limb)ce;
+}
+
+// propagates carries so that all but the top limb are in [0, 2^BN_DIVSTEP_BITS)
+static void bn_divstep_carry(bn_divstep_limb *r)
+{
+	int i;
+	for (i = 0; i < BN_DIVSTEP_LIMBS - 1; i++) {
+		r[i + 1] += r[i] >> BN_DIVSTEP_BITS;
+		r[i] &= BN_DIVSTEP_MASK;
+	}
+}
+
+// r in (-2m, m) to [0, m), negated if sign < 0
+static void bn_divstep_normalize(bn_divstep_limb *r, bn_divstep_limb sign, const bn_divstep_limb *m)
+{
+	bn_divstep_limb cond;
+	int i;
+
+	cond = r[BN_DIVSTEP_LIMBS - 1] >> (BN_DIVSTEP_BITS + 1);
+	for (i = 0; i < BN_DIVSTEP_LIMBS; i++) {
+		r[i] += m[i] & cond;
+	}
+	cond = sign >> (BN_DIVSTEP_BITS + 1);
+	for (i = 0; i < BN_DIVSTEP_LIMBS; i++) {
+		r[i] = (r[i] ^ cond) - cond;
+	}
+	bn_divstep_carry(r);
+	cond = r[BN_DIVSTEP_LIMBS - 1] >> (BN_DIVSTEP_BITS + 1);
+	for (i = 0; i < BN_DIVSTEP_LIMBS; i++) {
+		r[i] += m[i] & cond;
+	}
+	bn_divstep_carry(r);
+}
+
+// x = x^-1 mod prime in constant time, 0 if x is 0 mod prime.
+// prime must be odd, the result is fully reduced.
+void bn_inverse_safegcd(bignum256 *x, const bignum256 *prime)
+{
+	bn_divstep_limb m[BN_DIVSTEP_LIMBS], f[BN_DIVSTEP_LIMBS], g[BN_DIVSTEP_LIMBS];
+	bn_divstep_limb d[BN_DIVSTEP_LIMBS] = {0}, e[BN_DIVSTEP_LIMBS] = {1};
+	bn_divstep_limb eta = -1; // delta = 1
+	bn_divstep_ulimb m_inv;
+	bn_divstep_matrix t;
+	int i;
+
+	bn_fast_mod(x, prime);
+	bn_mod(x, prime);
+	bn_to_divstep(prime, m);
+	bn_to_divstep(x, g);
+	memcpy(f, m, sizeof(f));
+	// m^-1 mod 2^(8 * sizeof(limb)) by Newton iteration, each step doubles the correct bits
+	m_inv = m[0];
+	for (i = 0; i < 5; i++) {
+		m_inv *= 2 - m[0] * m_inv;
+	}
+	m_inv &= BN_DIVSTEP_MASK;
+
+	for (i = 0; i < BN_DIVSTEP_BATCHES; i++) {
+		eta = bn_divsteps(eta, f[0], g[0], &t);
+		bn_divstep_update_de(d, e, &t, m, m_inv);
+		bn_divstep_update_fg(f, g, &t);
+	}
+	// now g = 0, f = +-1 and d = +-x^-1
+	bn_divstep_normalize(d, f[BN_DIVSTEP_LIMBS - 1], m);
+	bn_from_divstep(d, x);
+
+	memzero(f, sizeof(f));
+	memzero(g, sizeof(g));
+	memzero(d, sizeof(d));
+	memzero(e, sizeof(e));
+	memzero(&t, sizeof(t));
+}
+
+#if USE_INVERSE_SAFEGCD
+
+void bn_inverse(bignum256 *x, const bignum256 *prime)
+{
+	bn_inverse_safegcd(x, prime);
+}
+
+#elif ! USE_INVERSE_FAST
 
 // in field G_prime, small but slow
 void bn_inverse(bignum256 *x, const bignum256 *prime)
@@ -564,6 +1098,16 @@ void bn_inverse(bignum256 *x, const bignum256 *prime)
 	// this method compute x^-1 = x^(prime-2)
 	uint32_t i, j, limb;
 	bignum256 res;
+#if USE_BN_64
+	bn64_prime pm;
+	if (bn64_prime_init(prime, &pm)) {
+		uint64_t e[5];
+		bn64_read(prime, e);
+		e[0] -= 2; // prime is odd and larger than 2
+		bn64_pow(x, e, prime, &pm);
+		return;
+	}
+#endif
 	bn_one(&res);
 	for (i = 0; i < 9; i++) {
 		// invariants:
@@ -867,6 +1411,38 @@ void bn_inverse(bignum256 *x, const bignum256 *prime)
 }
 #endif
 
+// inverts n numbers with a single bn_inverse (Montgomery's trick),
+// tmp is scratch space for n numbers. None of x[i] can be zero.
+void bn_inverse_batch(bignum256 *x, bignum256 *tmp, size_t n, const bignum256 *prime)
+{
+	size_t i;
+	bignum256 inv, xinv;
+	if (n == 0) {
+		return;
+	}
+	// tmp[i] = x[0] * ... * x[i]
+	tmp[0] = x[0];
+	for (i = 1; i < n; i++) {
+		tmp[i] = x[i];
+		bn_multiply(&tmp[i - 1], &tmp[i], prime);
+	}
+	inv = tmp[n - 1];
+	bn_inverse(&inv, prime);
+	for (i = n; i-- > 0;) {
+		// inv = 1 / (x[0] * ... * x[i])
+		xinv = inv;
+		if (i > 0) {
+			bn_multiply(&tmp[i - 1], &xinv, prime);
+			bn_multiply(&x[i], &inv, prime);
+		}
+		x[i] = xinv;
+		bn_mod(&x[i], prime);
+	}
+	memzero(&inv, sizeof(inv));
+	memzero(&xinv, sizeof(xinv));
+	memzero(tmp, n * sizeof(bignum256));
+}
+
 void bn_normalize(bignum256 *a) {
 	bn_addi(a, 0);
 }
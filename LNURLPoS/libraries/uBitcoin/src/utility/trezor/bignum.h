@@ -128,6 +128,8 @@ void bn_mult_k(bignum256 *x, uint8_t k, const bignum256 *prime);
 
 void bn_mod(bignum256 *x, const bignum256 *prime);
 
+void bn_multiply_long(const bignum256 *k, const bignum256 *x, uint32_t res[18]);
+
 void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime);
 
 void bn_fast_mod(bignum256 *x, const bignum256 *prime);
@@ -136,6 +138,10 @@ void bn_sqrt(bignum256 *x, const bignum256 *prime);
 
 void bn_inverse(bignum256 *x, const bignum256 *prime);
 
+void bn_inverse_safegcd(bignum256 *x, const bignum256 *prime);
+
+void bn_inverse_batch(bignum256 *x, bignum256 *tmp, size_t n, const bignum256 *prime);
+
 void bn_normalize(bignum256 *a);
 
 void bn_add(bignum256 *a, const bignum256 *b);
@@ -0,0 +1,329 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "bip340.h"
+#include "options.h"
+#include "sha2.h"
+#include "memzero.h"
+
+// starts SHA256(SHA256(tag) || SHA256(tag) || ...)
+static void tagged_hash_init(SHA256_CTX *ctx, const char *tag)
+{
+	uint8_t h[SHA256_DIGEST_LENGTH];
+	sha256_Raw((const uint8_t *)tag, strlen(tag), h);
+	sha256_Init(ctx);
+	sha256_Update(ctx, h, sizeof(h));
+	sha256_Update(ctx, h, sizeof(h));
+}
+
+// e = hash_challenge(r || P.x || msg) mod n
+static void bip340_challenge(const ecdsa_curve *curve, const uint8_t *r, const uint8_t *pub_x, const uint8_t *msg, bignum256 *e)
+{
+	SHA256_CTX ctx;
+	uint8_t h[SHA256_DIGEST_LENGTH];
+	tagged_hash_init(&ctx, "BIP0340/challenge");
+	sha256_Update(&ctx, r, 32);
+	sha256_Update(&ctx, pub_x, 32);
+	sha256_Update(&ctx, msg, 32);
+	sha256_Final(&ctx, h);
+	bn_read_be(h, e);
+	bn_mod(e, &curve->order);
+}
+
+// point with even y and x coordinate x, returns 0 if there is none
+static int lift_x(const ecdsa_curve *curve, const uint8_t *x, curve_point *p)
+{
+	uint8_t sec[33];
+	sec[0] = 0x02;
+	memcpy(sec + 1, x, 32);
+	return ecdsa_read_pubkey(curve, sec, p);
+}
+
+// a = n - a if cond is set, without branching on cond. a must be in [1, n-1]
+static void scalar_cnegate(const ecdsa_curve *curve, int cond, bignum256 *a)
+{
+	bignum256 neg;
+	bn_subtract(&curve->order, a, &neg);
+	bn_cmov(a, cond, &neg, a);
+	memzero(&neg, sizeof(neg));
+}
+
+int bip340_get_public_key(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_x)
+{
+	curve_point P;
+	bignum256 d;
+	bn_read_be(priv_key, &d);
+	if (bn_is_zero(&d) || !bn_is_less(&d, &curve->order)) {
+		memzero(&d, sizeof(d));
+		return 1;
+	}
+	scalar_multiply(curve, &d, &P);
+	bn_write_be(&P.x, pub_x);
+	memzero(&P, sizeof(P));
+	memzero(&d, sizeof(d));
+	return 0;
+}
+
+int bip340_sign(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *msg, const uint8_t *aux, uint8_t *sig)
+{
+	static const uint8_t zero[32] = {0};
+	SHA256_CTX ctx;
+	curve_point P, R;
+	bignum256 d, k, e;
+	uint8_t t[32], px[32];
+	int i;
+
+	bn_read_be(priv_key, &d);
+	if (bn_is_zero(&d) || !bn_is_less(&d, &curve->order)) {
+		memzero(&d, sizeof(d));
+		return 1;
+	}
+	scalar_multiply(curve, &d, &P);
+	scalar_cnegate(curve, bn_is_odd(&P.y), &d);
+	bn_write_be(&P.x, px);
+
+	// t = d xor hash_aux(aux)
+	tagged_hash_init(&ctx, "BIP0340/aux");
+	sha256_Update(&ctx, aux ? aux : zero, 32);
+	sha256_Final(&ctx, t);
+	bn_write_be(&d, sig);
+	for (i = 0; i < 32; i++) {
+		t[i] ^= sig[i];
+	}
+
+	// k = hash_nonce(t || P.x || msg) mod n
+	tagged_hash_init(&ctx, "BIP0340/nonce");
+	sha256_Update(&ctx, t, 32);
+	sha256_Update(&ctx, px, 32);
+	sha256_Update(&ctx, msg, 32);
+	sha256_Final(&ctx, t);
+	bn_read_be(t, &k);
+	bn_mod(&k, &curve->order);
+	if (bn_is_zero(&k)) {
+		// happens with negligible probability
+		memzero(&d, sizeof(d));
+		memzero(t, sizeof(t));
+		memzero(sig, 64);
+		return 1;
+	}
+	scalar_multiply(curve, &k, &R);
+	scalar_cnegate(curve, bn_is_odd(&R.y), &k);
+	bn_write_be(&R.x, sig);
+
+	// s = k + e * d mod n
+	bip340_challenge(curve, sig, px, msg, &e);
+	bn_multiply(&d, &e, &curve->order);
+	bn_addmod(&e, &k, &curve->order);
+	bn_mod(&e, &curve->order);
+	bn_write_be(&e, sig + 32);
+
+	memzero(&ctx, sizeof(ctx));
+	memzero(&d, sizeof(d));
+	memzero(&k, sizeof(k));
+	memzero(&e, sizeof(e));
+	memzero(&R, sizeof(R));
+	memzero(t, sizeof(t));
+	return 0;
+}
+
+int bip340_verify(const ecdsa_curve *curve, const uint8_t *pub_x, const uint8_t *msg, const uint8_t *sig)
+{
+	curve_point P, R;
+	bignum256 r, s, e;
+
+	if (!lift_x(curve, pub_x, &P)) {
+		return 1;
+	}
+	bn_read_be(sig, &r);
+	bn_read_be(sig + 32, &s);
+	if (!bn_is_less(&r, &curve->prime) || !bn_is_less(&s, &curve->order)) {
+		return 2;
+	}
+	// R = s * G - e * P
+	bip340_challenge(curve, sig, pub_x, msg, &e);
+	if (!bn_is_zero(&e)) {
+		bn_subtract(&curve->order, &e, &e);
+	}
+	point_multiply_double(curve, &s, &e, &P, &R);
+	if (point_is_infinity(&R) || bn_is_odd(&R.y) || !bn_is_equal(&R.x, &r)) {
+		return 3;
+	}
+	return 0;
+}
+
+// checks sum a_i * (s_i * G - R_i - e_i * P_i) = 0 for random a_i with a_0 = 1,
+// a single multi-scalar multiplication of 2n + 1 points
+static int verify_group(const ecdsa_curve *curve, size_t n, const uint8_t *pub_xs, const uint8_t *msgs, const uint8_t *sigs)
+{
+	curve_point points[2 * SCHNORR_BATCH_SIZE + 1];
+	bignum256 k[2 * SCHNORR_BATCH_SIZE + 1];
+	bignum256 *sum = &k[0];
+	bignum256 a, s;
+	SHA256_CTX ctx;
+	uint8_t seed[SHA256_DIGEST_LENGTH], buf[SHA256_DIGEST_LENGTH + 4];
+	size_t i;
+
+	// randomizers are derived from all inputs of the group,
+	// so they can't be chosen before the signatures are fixed
+	sha256_Init(&ctx);
+	sha256_Update(&ctx, pub_xs, 32 * n);
+	sha256_Update(&ctx, msgs, 32 * n);
+	sha256_Update(&ctx, sigs, 64 * n);
+	sha256_Final(&ctx, seed);
+
+	points[0] = curve->G;
+	bn_zero(sum);
+	for (i = 0; i < n; i++) {
+		curve_point *R = &points[2 * i + 1], *P = &points[2 * i + 2];
+		bignum256 *ka = &k[2 * i + 1], *ke = &k[2 * i + 2];
+		if (!lift_x(curve, pub_xs + 32 * i, P) || !lift_x(curve, sigs + 64 * i, R)) {
+			return 1;
+		}
+		bn_read_be(sigs + 64 * i + 32, &s);
+		if (!bn_is_less(&s, &curve->order)) {
+			return 1;
+		}
+		if (i == 0) {
+			bn_one(&a);
+		} else {
+			memcpy(buf, seed, sizeof(seed));
+			write_le(buf + sizeof(seed), (uint32_t)i);
+			sha256_Raw(buf, sizeof(buf), buf);
+			bn_read_be(buf, &a);
+			bn_mod(&a, &curve->order);
+		}
+		// sum += a_i * s_i
+		bn_multiply(&a, &s, &curve->order);
+		bn_addmod(sum, &s, &curve->order);
+		bn_mod(sum, &curve->order);
+		// -a_i * R_i - a_i * e_i * P_i
+		bip340_challenge(curve, sigs + 64 * i, pub_xs + 32 * i, msgs + 32 * i, ke);
+		bn_multiply(&a, ke, &curve->order);
+		bn_mod(ke, &curve->order);
+		*ka = a;
+		bn_subtract(&curve->prime, &R->y, &R->y);
+		bn_subtract(&curve->prime, &P->y, &P->y);
+	}
+	return !point_multiply_multi(curve, 2 * n + 1, k, points, NULL);
+}
+
+int bip340_verify_batch(const ecdsa_curve *curve, size_t n, const uint8_t *pub_xs, const uint8_t *msgs, const uint8_t *sigs)
+{
+	size_t i, m;
+	for (i = 0; i < n; i += m) {
+		m = n - i;
+		if (m > SCHNORR_BATCH_SIZE) {
+			m = SCHNORR_BATCH_SIZE;
+		}
+		if (m == 1) {
+			if (bip340_verify(curve, pub_xs + 32 * i, msgs + 32 * i, sigs + 64 * i) != 0) {
+				return 1;
+			}
+		} else if (verify_group(curve, m, pub_xs + 32 * i, msgs + 32 * i, sigs + 64 * i) != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// t = hash_TapTweak(P.x || merkle_root), returns 0 if t is out of range
+static int taptweak(const ecdsa_curve *curve, const uint8_t *pub_x, const uint8_t *merkle_root, bignum256 *t)
+{
+	SHA256_CTX ctx;
+	uint8_t h[SHA256_DIGEST_LENGTH];
+	tagged_hash_init(&ctx, "TapTweak");
+	sha256_Update(&ctx, pub_x, 32);
+	if (merkle_root != NULL) {
+		sha256_Update(&ctx, merkle_root, 32);
+	}
+	sha256_Final(&ctx, h);
+	bn_read_be(h, t);
+	return bn_is_less(t, &curve->order);
+}
+
+int bip340_tweak_public_key(const ecdsa_curve *curve, const uint8_t *pub_x, const uint8_t *merkle_root, uint8_t *out_x, int *parity)
+{
+	curve_point P, Q;
+	bignum256 t;
+
+	if (!lift_x(curve, pub_x, &P)) {
+		return 1;
+	}
+	if (!taptweak(curve, pub_x, merkle_root, &t)) {
+		return 2;
+	}
+	scalar_multiply(curve, &t, &Q);
+	point_add(curve, &P, &Q);
+	if (point_is_infinity(&Q)) {
+		return 2;
+	}
+	bn_write_be(&Q.x, out_x);
+	if (parity != NULL) {
+		*parity = bn_is_odd(&Q.y);
+	}
+	return 0;
+}
+
+// Q = P + t * G is computed for groups of DERIVE_BATCH_SIZE keys,
+// conversion to affine coordinates shares one inversion per group.
+size_t bip340_tweak_points(const ecdsa_curve *curve, size_t n, const curve_point *pubs, const uint8_t *merkle_roots, curve_point *res)
+{
+	curve_point P[DERIVE_BATCH_SIZE];
+	bignum256 t[DERIVE_BATCH_SIZE];
+	uint8_t valid[DERIVE_BATCH_SIZE];
+	uint8_t x[32];
+	size_t start, i, m, failed = 0;
+
+	for (start = 0; start < n; start += m) {
+		m = n - start;
+		if (m > DERIVE_BATCH_SIZE) {
+			m = DERIVE_BATCH_SIZE;
+		}
+		for (i = 0; i < m; i++) {
+			// internal key is the point with even y, as in lift_x
+			P[i] = pubs[start + i];
+			if (bn_is_odd(&P[i].y)) {
+				bn_subtract(&curve->prime, &P[i].y, &P[i].y);
+			}
+			bn_write_be(&P[i].x, x);
+			valid[i] = taptweak(curve, x, (merkle_roots != NULL) ? merkle_roots + 32 * (start + i) : NULL, &t[i]);
+			if (!valid[i]) {
+				bn_zero(&t[i]);
+			}
+		}
+		if (m > 1) {
+			scalar_multiply_add_multi(curve, m, P, t, res + start);
+		} else {
+			// one lane of the affine comb pays an inversion per row
+			scalar_multiply(curve, &t[0], &res[start]);
+			point_add(curve, &P[0], &res[start]);
+		}
+		for (i = 0; i < m; i++) {
+			if (!valid[i] || point_is_infinity(&res[start + i])) {
+				point_set_infinity(&res[start + i]);
+				failed++;
+			}
+		}
+	}
+	return failed;
+}
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __BIP340_H__
+#define __BIP340_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ecdsa.h"
+
+// BIP340 Schnorr signatures over 32-byte messages.
+// Public keys are x-only: 32-byte x coordinate of the point with even y.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// fills pub_x with the x-only public key, returns 0 on success, 1 if priv_key is invalid
+int bip340_get_public_key(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_x);
+// signs 32-byte msg, aux is 32 bytes of auxiliary randomness or NULL (all zeroes).
+// Returns 0 on success, 1 if priv_key is invalid
+int bip340_sign(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *msg, const uint8_t *aux, uint8_t *sig);
+// returns 0 if the signature is valid,
+// 1 - invalid public key, 2 - r or s out of range, 3 - signature does not match
+int bip340_verify(const ecdsa_curve *curve, const uint8_t *pub_x, const uint8_t *msg, const uint8_t *sig);
+// verifies n signatures at once, pub_xs, msgs and sigs are concatenated
+// 32, 32 and 64-byte values. Returns 0 if all signatures are valid, 1 otherwise
+int bip340_verify_batch(const ecdsa_curve *curve, size_t n, const uint8_t *pub_xs, const uint8_t *msgs, const uint8_t *sigs);
+// taproot output key Q = P + hash_TapTweak(P.x || merkle_root) * G (BIP341),
+// merkle_root is 32 bytes or NULL for outputs without a script path.
+// Fills out_x with x-only Q and parity (if not NULL) with the parity of its y.
+// Returns 0 on success, 1 if pub_x is invalid, 2 if the tweak is out of range
+int bip340_tweak_public_key(const ecdsa_curve *curve, const uint8_t *pub_x, const uint8_t *merkle_root, uint8_t *out_x, int *parity);
+// tweaks n keys at once: res[i] = P[i] + hash_TapTweak(P[i].x || merkle_roots[i]) * G,
+// P[i] is pubs[i] with even y. merkle_roots are concatenated 32-byte roots or NULL.
+// pubs must be valid points and can not overlap res. Failed keys are set to
+// the point at infinity, returns the number of failed keys
+size_t bip340_tweak_points(const ecdsa_curve *curve, size_t n, const curve_point *pubs, const uint8_t *merkle_roots, curve_point *res);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif
@@ -30,6 +30,8 @@
 #include "sha2.h"
 #include "pbkdf2.h"
 #include "bip39_english.h"
+#include "bip39_hash.h"
+#include "bip39_english.table"
 #include "options.h"
 #include "memzero.h"
 
@@ -99,6 +101,69 @@ void mnemonic_clear(void)
 	memzero(mnemo, sizeof(mnemo));
 }
 
+// the only word that can start with the first 4 letters of the prefix,
+// -1 if the prefix has other characters than a-z
+static int mnemonic_candidate(const char *prefix, size_t len)
+{
+	uint32_t key = bip39_prefix_key(prefix, len);
+	if (key == 0) {
+		return -1;
+	}
+	return bip39_index[bip39_slot(key, bip39_displacement[bip39_bucket(key)])];
+}
+
+// index of the word in the wordlist, -1 if there is no such word
+int mnemonic_word_index(const char *word, size_t len)
+{
+	int k = mnemonic_candidate(word, len);
+	if (k < 0 || len > 8 || strncmp(wordlist[k], word, len) != 0 || wordlist[k][len] != 0) {
+		return -1;
+	}
+	return k;
+}
+
+// number of words starting with the prefix, index of the first one
+// is written to first. The wordlist is sorted, matches are consecutive.
+int mnemonic_complete(const char *prefix, size_t len, int *first)
+{
+	int lo = 0, hi = BIP39_WORDS, mid, k;
+	if (len >= 4) {
+		// at most one word, found by its first 4 letters
+		k = mnemonic_candidate(prefix, len);
+		if (k < 0 || strncmp(wordlist[k], prefix, len) != 0) {
+			return 0;
+		}
+		if (first) {
+			*first = k;
+		}
+		return 1;
+	}
+	// first word not below the prefix
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (strncmp(wordlist[mid], prefix, len) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	k = lo;
+	hi = BIP39_WORDS;
+	// first word above the prefix
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (strncmp(wordlist[mid], prefix, len) <= 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (first) {
+		*first = k;
+	}
+	return lo - k;
+}
+
 int mnemonic_to_entropy(const char *mnemonic, uint8_t *entropy)
 {
 	if (!mnemonic) {
@@ -121,7 +186,8 @@ int mnemonic_to_entropy(const char *mnemonic, uint8_t *entropy)
 	}
 
 	char current_word[10];
-	uint32_t j, k, ki, bi = 0;
+	uint32_t j, ki, bi = 0;
+	int k;
 	uint8_t bits[32 + 1];
 
 	memzero(bits, sizeof(bits));
@@ -139,21 +205,15 @@ int mnemonic_to_entropy(const char *mnemonic, uint8_t *entropy)
 		if (mnemonic[i] != 0) {
 			i++;
 		}
-		k = 0;
-		for (;;) {
-			if (!wordlist[k]) { // word not found
-				return 0;
-			}
-			if (strcmp(current_word, wordlist[k]) == 0) { // word found on index k
-				for (ki = 0; ki < 11; ki++) {
-					if (k & (1 << (10 - ki))) {
-						bits[bi / 8] |= 1 << (7 - (bi % 8));
-					}
-					bi++;
-				}
-				break;
+		k = mnemonic_word_index(current_word, j);
+		if (k < 0) { // word not found
+			return 0;
+		}
+		for (ki = 0; ki < 11; ki++) {
+			if (k & (1 << (10 - ki))) {
+				bits[bi / 8] |= 1 << (7 - (bi % 8));
 			}
-			k++;
+			bi++;
 		}
 	}
 	if (bi != n * 11) {
@@ -163,6 +223,36 @@ int mnemonic_to_entropy(const char *mnemonic, uint8_t *entropy)
 	return n * 11;
 }
 
+// checksum of a mnemonic given as word indexes, without building the string
+int mnemonic_check_indexes(const uint16_t *words, int count)
+{
+	if (count != 12 && count != 18 && count != 24) {
+		return 0;
+	}
+	uint8_t bits[32 + 1];
+	uint32_t acc = 0;
+	int nbits = 0, nbytes = 0;
+	for (int i = 0; i < count; i++) {
+		if (words[i] >= BIP39_WORDS) {
+			return 0;
+		}
+		acc = (acc << 11) | words[i];
+		nbits += 11;
+		while (nbits >= 8) {
+			nbits -= 8;
+			bits[nbytes++] = acc >> nbits;
+		}
+	}
+	int len = count * 4 / 3;
+	// 4, 6 or 8 bits of checksum are left at the end of the last byte
+	uint8_t checksum = (nbits > 0) ? (acc << (8 - nbits)) : bits[len];
+	uint8_t mask = 0xFF << (8 - count / 3);
+	sha256_Raw(bits, len, bits);
+	int res = (bits[0] & mask) == (checksum & mask);
+	memzero(bits, sizeof(bits));
+	return res;
+}
+
 int mnemonic_check(const char *mnemonic)
 {
 	uint8_t bits[32 + 1];
@@ -24,6 +24,7 @@
 #ifndef __BIP39_H__
 #define __BIP39_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define BIP39_PBKDF2_ROUNDS 2048
@@ -39,8 +40,14 @@ void mnemonic_clear(void);
 
 int mnemonic_check(const char *mnemonic);
 
+int mnemonic_check_indexes(const uint16_t *words, int count);
+
 int mnemonic_to_entropy(const char *mnemonic, uint8_t *entropy);
 
+int mnemonic_word_index(const char *word, size_t len);
+
+int mnemonic_complete(const char *prefix, size_t len, int *first);
+
 // passphrase must be at most 256 characters otherwise it would be truncated
 void mnemonic_to_seed(const char *mnemonic, const char *passphrase, uint8_t seed[512 / 8], void (*progress_callback)(uint32_t current, uint32_t total));
 
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __BIP39_HASH_H__
+#define __BIP39_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal perfect hash of the BIP39 wordlist: words are unique in their
+// first 4 letters, the prefix packed to 20 bits picks one of
+// BIP39_HASH_BUCKETS buckets and the bucket's displacement moves it to
+// a slot of its own, bip39_index maps slots back to word indexes.
+// Both tables are in bip39_english.table generated by
+// tests/tools/mkbip39hash.c (`make bip39hash` in tests).
+
+#define BIP39_WORDS 2048
+#define BIP39_HASH_BUCKETS 512
+
+// packs up to 4 first letters, 0 if there is a character other than a-z
+static inline uint32_t bip39_prefix_key(const char *word, size_t len)
+{
+	uint32_t key = 0;
+	size_t i;
+	for (i = 0; i < len && i < 4; i++) {
+		uint32_t c = (uint8_t)word[i] - 'a';
+		if (c >= 26) {
+			return 0;
+		}
+		key = (key << 5) | (c + 1);
+	}
+	return key;
+}
+
+static inline uint32_t bip39_mix(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x85ebca6b;
+	x ^= x >> 13;
+	x *= 0xc2b2ae35;
+	x ^= x >> 16;
+	return x;
+}
+
+static inline uint32_t bip39_bucket(uint32_t key)
+{
+	return bip39_mix(key) % BIP39_HASH_BUCKETS;
+}
+
+static inline uint32_t bip39_slot(uint32_t key, uint32_t displacement)
+{
+	return bip39_mix(key ^ ((displacement + 1) * 0x9e3779b9)) % BIP39_WORDS;
+}
+
+#endif
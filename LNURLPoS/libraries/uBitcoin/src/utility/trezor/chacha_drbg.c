@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "chacha_drbg.h"
+#include "memzero.h"
+#include "sha2.h"
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d) \
+	a += b; d ^= a; d = ROTL32(d, 16); \
+	c += d; b ^= c; b = ROTL32(b, 12); \
+	a += b; d ^= a; d = ROTL32(d, 8);  \
+	c += d; b ^= c; b = ROTL32(b, 7);
+
+#define READ_LE32(p)                                              \
+	(((uint32_t)(p)[3] << 24) | ((uint32_t)(p)[2] << 16) |      \
+	 ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[0]))
+
+void chacha20_block(const uint8_t key[32], const uint8_t nonce[12],
+                    uint32_t counter, uint8_t out[64]) {
+	uint32_t in[16], x[16];
+	int i;
+
+	// "expand 32-byte k"
+	in[0] = 0x61707865;
+	in[1] = 0x3320646e;
+	in[2] = 0x79622d32;
+	in[3] = 0x6b206574;
+	for (i = 0; i < 8; i++) {
+		in[4 + i] = READ_LE32(key + 4 * i);
+	}
+	in[12] = counter;
+	for (i = 0; i < 3; i++) {
+		in[13 + i] = READ_LE32(nonce + 4 * i);
+	}
+
+	memcpy(x, in, sizeof(x));
+	for (i = 0; i < 10; i++) {
+		QUARTERROUND(x[0], x[4], x[8], x[12]);
+		QUARTERROUND(x[1], x[5], x[9], x[13]);
+		QUARTERROUND(x[2], x[6], x[10], x[14]);
+		QUARTERROUND(x[3], x[7], x[11], x[15]);
+		QUARTERROUND(x[0], x[5], x[10], x[15]);
+		QUARTERROUND(x[1], x[6], x[11], x[12]);
+		QUARTERROUND(x[2], x[7], x[8], x[13]);
+		QUARTERROUND(x[3], x[4], x[9], x[14]);
+	}
+	for (i = 0; i < 16; i++) {
+		uint32_t v = x[i] + in[i];
+		out[4 * i] = (uint8_t)v;
+		out[4 * i + 1] = (uint8_t)(v >> 8);
+		out[4 * i + 2] = (uint8_t)(v >> 16);
+		out[4 * i + 3] = (uint8_t)(v >> 24);
+	}
+	memzero(in, sizeof(in));
+	memzero(x, sizeof(x));
+}
+
+void chacha20_xor(const uint8_t key[32], const uint8_t nonce[12],
+                  uint32_t counter, uint8_t *data, size_t len) {
+	uint8_t block[64];
+	size_t i;
+	while (len > 0) {
+		size_t n = len < sizeof(block) ? len : sizeof(block);
+		chacha20_block(key, nonce, counter++, block);
+		for (i = 0; i < n; i++) {
+			data[i] ^= block[i];
+		}
+		data += n;
+		len -= n;
+	}
+	memzero(block, sizeof(block));
+}
+
+static void chacha_drbg_refill(CHACHA_DRBG_CTX *ctx) {
+	static const uint8_t nonce[12] = {0};
+	uint32_t i;
+	// key is replaced on every refill, so the counter can always start at 0
+	for (i = 0; i < CHACHA_DRBG_POOL_SIZE / 64; i++) {
+		chacha20_block(ctx->key, nonce, i, ctx->pool + 64 * i);
+	}
+	memcpy(ctx->key, ctx->pool, sizeof(ctx->key));
+	memzero(ctx->pool, sizeof(ctx->key));
+	ctx->available = CHACHA_DRBG_POOL_SIZE - sizeof(ctx->key);
+	ctx->generated += CHACHA_DRBG_POOL_SIZE;
+}
+
+void chacha_drbg_init(CHACHA_DRBG_CTX *ctx, const uint8_t *entropy,
+                      size_t len) {
+	memzero(ctx, sizeof(CHACHA_DRBG_CTX));
+	chacha_drbg_reseed(ctx, entropy, len);
+}
+
+void chacha_drbg_reseed(CHACHA_DRBG_CTX *ctx, const uint8_t *entropy,
+                        size_t len) {
+	SHA256_CTX sha;
+	// key = sha256(key || entropy)
+	sha256_Init(&sha);
+	sha256_Update(&sha, ctx->key, sizeof(ctx->key));
+	sha256_Update(&sha, entropy, len);
+	sha256_Final(&sha, ctx->key);
+	memzero(&sha, sizeof(sha));
+	// keystream from the previous key is never handed out
+	memzero(ctx->pool, sizeof(ctx->pool));
+	ctx->available = 0;
+	ctx->generated = 0;
+}
+
+void chacha_drbg_generate(CHACHA_DRBG_CTX *ctx, uint8_t *out, size_t len) {
+	while (len > 0) {
+		if (ctx->available == 0) {
+			chacha_drbg_refill(ctx);
+		}
+		size_t n = len < ctx->available ? len : ctx->available;
+		uint8_t *src = ctx->pool + CHACHA_DRBG_POOL_SIZE - ctx->available;
+		memcpy(out, src, n);
+		memzero(src, n);
+		ctx->available -= n;
+		out += n;
+		len -= n;
+	}
+}
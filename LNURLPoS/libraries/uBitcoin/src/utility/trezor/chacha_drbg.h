@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __CHACHA_DRBG_H__
+#define __CHACHA_DRBG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ChaCha20 keystream is produced this many bytes at a time
+#define CHACHA_DRBG_POOL_SIZE 512
+
+// Fast-key-erasure generator: every refill produces CHACHA_DRBG_POOL_SIZE
+// bytes of ChaCha20 keystream, the first 32 bytes replace the key and the
+// rest are handed out. Served bytes are wiped from the pool.
+typedef struct _CHACHA_DRBG_CTX {
+	uint8_t key[32];
+	uint8_t pool[CHACHA_DRBG_POOL_SIZE];
+	size_t available;    // unread bytes at the end of the pool
+	uint64_t generated;  // bytes generated since the last reseed
+} CHACHA_DRBG_CTX;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ChaCha20 block function (RFC 8439)
+void chacha20_block(const uint8_t key[32], const uint8_t nonce[12],
+                    uint32_t counter, uint8_t out[64]);
+// ChaCha20 stream cipher (RFC 8439), xors len bytes of keystream into data
+void chacha20_xor(const uint8_t key[32], const uint8_t nonce[12],
+                  uint32_t counter, uint8_t *data, size_t len);
+
+void chacha_drbg_init(CHACHA_DRBG_CTX *ctx, const uint8_t *entropy,
+                      size_t len);
+// mixes additional entropy into the key and drops the buffered pool
+void chacha_drbg_reseed(CHACHA_DRBG_CTX *ctx, const uint8_t *entropy,
+                        size_t len);
+void chacha_drbg_generate(CHACHA_DRBG_CTX *ctx, uint8_t *out, size_t len);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif
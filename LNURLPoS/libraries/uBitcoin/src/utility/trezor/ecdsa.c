@@ -37,6 +37,11 @@
 #include "rfc6979.h"
 #include "memzero.h"
 
+#if VERIFY_BATCH_THREADS > 1 && (defined(__unix__) || defined(__APPLE__))
+#include <pthread.h>
+#define VERIFY_THREADS 1
+#endif
+
 // Set cp2 = cp1
 void point_copy(const curve_point *cp1, curve_point *cp2)
 {
@@ -187,6 +192,16 @@ void conditional_negate(uint32_t cond, bignum256 *a, const bignum256 *prime)
 	assert(a->val[8] < 0x20000);
 }
 
+// count (at most 30) bits of a starting at bit pos
+static uint32_t bn_bits(const bignum256 *a, int pos, int count)
+{
+	uint32_t bits = a->val[pos / 30] >> (pos % 30);
+	if (pos % 30 + count > 30 && pos / 30 < 8) {
+		bits |= a->val[pos / 30 + 1] << (30 - pos % 30);
+	}
+	return bits & ((1u << count) - 1);
+}
+
 typedef struct jacobian_curve_point {
 	bignum256 x, y, z;
 } jacobian_curve_point;
@@ -387,11 +402,13 @@ void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
 	bn_multiply(&m, &m, prime);
 	bn_mult_k(&m, 3, prime);
 
-	az4 = p->z;
-	bn_multiply(&az4, &az4, prime);
-	bn_multiply(&az4, &az4, prime);
-	bn_mult_k(&az4, -curve->a, prime);
-	bn_subtractmod(&m, &az4, &m, prime);
+	if (curve->a != 0) {
+		az4 = p->z;
+		bn_multiply(&az4, &az4, prime);
+		bn_multiply(&az4, &az4, prime);
+		bn_mult_k(&az4, -curve->a, prime);
+		bn_subtractmod(&m, &az4, &m, prime);
+	}
 	bn_mult_half(&m, prime);
 
 	// msq = m^2
@@ -422,7 +439,12 @@ void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
 	bn_fast_mod(&p->y, prime);
 }
 
-// res = k * p
+static void point_multiply_glv(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res);
+static void point_odd_multiples(const ecdsa_curve *curve, const curve_point *p, curve_point *table, size_t n);
+
+// res = k * p, constant time: for secret scalars (ECDH, tweaks).
+// Public-input paths (verification, recovery, tweaks of public keys)
+// use point_multiply_double or scalar_multiply instead
 void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
 {
 	// this algorithm is loosely based on
@@ -431,14 +453,19 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	//  Side Channel Attacks.
 	assert (bn_is_less(k, &curve->order));
 
+	if (curve->glv) {
+		point_multiply_glv(curve, k, p, res);
+		return;
+	}
+
 	int i, j;
-	static CONFIDENTIAL bignum256 a;
+	CONFIDENTIAL bignum256 a;
 	uint32_t *aptr;
 	uint32_t abits;
 	int ashift;
 	uint32_t is_even = (k->val[0] & 1) - 1;
 	uint32_t bits, sign, nsign;
-	static CONFIDENTIAL jacobian_curve_point jres;
+	CONFIDENTIAL jacobian_curve_point jres;
 	curve_point pmult[8];
 	const bignum256 *prime = &curve->prime;
 
@@ -477,16 +504,9 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	//
 	// We compute |a[i]| * p in advance for all possible
 	// values of |a[i]| * p.  pmult[i] = (2*i+1) * p
-	// We compute p, 3*p, ..., 15*p and store it in the table pmult.
-	// store p^2 temporarily in pmult[7]
-	pmult[7] = *p;
-	point_double(curve, &pmult[7]);
-	// compute 3*p, etc by repeatedly adding p^2.
-	pmult[0] = *p;
-	for (i = 1; i < 8; i++) {
-		pmult[i] = pmult[7];
-		point_add(curve, &pmult[i-1], &pmult[i]);
-	}
+	// We compute p, 3*p, ..., 15*p and store it in the table pmult,
+	// in jacobian coordinates with one shared inversion at the end.
+	point_odd_multiples(curve, p, pmult, 8);
 
 	// now compute  res = sum_{i=0..63} a[i] * 16^i * p step by step,
 	// starting with i = 63.
@@ -546,18 +566,12 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 
 #if USE_PRECOMPUTED_CP
 
-// res = k * G
-// k must be a normalized number with 0 <= k < curve->order
-void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+// a = k + 2^(w*m) (mod curve->order), odd, see scalar_multiply_jacobian.
+// Returns 0 if k is zero.
+static uint32_t scalar_comb_recode(const ecdsa_curve *curve, const bignum256 *k, bignum256 *a)
 {
-	assert (bn_is_less(k, &curve->order));
-
-	int i, j;
-	static CONFIDENTIAL bignum256 a;
+	int j;
 	uint32_t is_even = (k->val[0] & 1) - 1;
-	uint32_t lowbits;
-	static CONFIDENTIAL jacobian_curve_point jres;
-	const bignum256 *prime = &curve->prime;
 
 	// is_even = 0xffffffff if k is even, 0 otherwise.
 
@@ -568,67 +582,101 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 	for (j = 0; j < 8; j++) {
 		is_non_zero |= k->val[j];
 		tmp += 0x3fffffff + k->val[j] - (curve->order.val[j] & is_even);
-		a.val[j] = tmp & 0x3fffffff;
+		a->val[j] = tmp & 0x3fffffff;
 		tmp >>= 30;
 	}
 	is_non_zero |= k->val[j];
-	a.val[j] = tmp + 0xffff + k->val[j] - (curve->order.val[j] & is_even);
-	assert((a.val[0] & 1) != 0);
+	a->val[j] = tmp + 0xffff + k->val[j] - (curve->order.val[j] & is_even);
+	// replace 2^256 by 2^(CP_WINDOW*CP_DIGITS), bit 240 is bit 0 of a.val[8]
+	a->val[j] += (1 << (CP_WINDOW * CP_DIGITS - 240)) - (1 << 16);
+	assert((a->val[0] & 1) != 0);
+	return is_non_zero;
+}
+
+// jres = k * G in jacobian coordinates, returns 1 if k is zero.
+// k must be a normalized number with 0 <= k < curve->order
+static int scalar_multiply_jacobian(const ecdsa_curve *curve, const bignum256 *k, jacobian_curve_point *jres)
+{
+	assert (bn_is_less(k, &curve->order));
+
+	int i, j, pass, row;
+	CONFIDENTIAL bignum256 a;
+	uint32_t bits, sign = 0, nsign;
+	int started = 0;
+	const bignum256 *prime = &curve->prime;
 
 	// special case 0*G:  just return zero. We don't care about constant time.
-	if (!is_non_zero) {
-		point_set_infinity(res);
-		return;
+	if (!scalar_comb_recode(curve, k, &a)) {
+		return 1;
 	}
 
-	// Now a = k + 2^256 (mod curve->order) and a is odd.
+	// Now a = k + 2^(w*m) (mod curve->order) and a is odd,
+	// with w = CP_WINDOW and m = CP_DIGITS.
 	//
 	// The idea is to bring the new a into the form.
-	// sum_{i=0..64} a[i] 16^i,  where |a[i]| < 16 and a[i] is odd.
+	// sum_{i=0..m} a[i] 2^(w*i),  where |a[i]| < 2^w and a[i] is odd.
 	// a[0] is odd, since a is odd.  If a[i] would be even, we can
-	// add 1 to it and subtract 16 from a[i-1].  Afterwards,
-	// a[64] = 1, which is the 2^256 that we added before.
+	// add 1 to it and subtract 2^w from a[i-1].  Afterwards,
+	// a[m] = 1, which is the 2^(w*m) that we added before.
 	//
-	// Since k = a - 2^256 (mod curve->order), we can compute
-	//   k*G = sum_{i=0..63} a[i] 16^i * G
+	// Since k = a - 2^(w*m) (mod curve->order), we can compute
+	//   k*G = sum_{i=0..m-1} a[i] 2^(w*i) * G
 	//
 	// We have a big table curve->cp that stores all possible
-	// values of |a[i]| 16^i * G.
-	// curve->cp[i][j] = (2*j+1) * 16^i * G
-
-	// now compute  res = sum_{i=0..63} a[i] * 16^i * G step by step.
-	// initial res = |a[0]| * G.  Note that a[0] = a & 0xf if (a&0x10) != 0
-	// and - (16 - (a & 0xf)) otherwise.   We can compute this as
-	//   ((a ^ (((a >> 4) & 1) - 1)) & 0xf) >> 1
-	// since a is odd.
-	lowbits = a.val[0] & ((1 << 5) - 1);
-	lowbits ^= (lowbits >> 4) - 1;
-	lowbits &= 15;
-	curve_to_jacobian(&curve->cp[0][lowbits >> 1], &jres, prime);
-	for (i = 1; i < 64; i ++) {
-		// invariant res = sign(a[i-1]) sum_{j=0..i-1} (a[j] * 16^j * G)
-
-		// shift a by 4 places.
-		for (j = 0; j < 8; j++) {
-			a.val[j] = (a.val[j] >> 4) | ((a.val[j + 1] & 0xf) << 26);
+	// values of |a[i]| 2^(w*i) * G for every CP_SPACING-th i.
+	// curve->cp[r][j] = (2*j+1) * 2^(w*s*r) * G,  s = CP_SPACING
+	// Digit i = r*s + p is added in pass p from row r; passes go from
+	// p = s-1 down to 0 with w doublings in between (comb method).
+	//
+	// a[i] = a>>(w*i) & (2^w-1) if bit w*(i+1) of a is set and
+	// - (2^w - (a>>(w*i) & (2^w-1))) otherwise.  The table index is
+	//   ((a>>(w*i) ^ (((a>>(w*(i+1))) & 1) - 1)) & (2^w-1)) >> 1
+	for (pass = CP_SPACING - 1; pass >= 0; pass--) {
+		if (started) {
+			for (j = 0; j < CP_WINDOW; j++) {
+				point_jacobian_double(jres, curve);
+			}
+		}
+		for (row = 0; row < CP_ROWS; row++) {
+			// the condition only depends on the position and
+			// leaks no private information to a side-channel.
+			i = row * CP_SPACING + pass;
+			if (i >= CP_DIGITS) {
+				continue;
+			}
+			bits = bn_bits(&a, CP_WINDOW * i, CP_WINDOW + 1);
+			nsign = (bits >> CP_WINDOW) - 1;
+			bits ^= nsign;
+			bits &= (1 << CP_WINDOW) - 1;
+			if (!started) {
+				curve_to_jacobian(&curve->cp[row][bits >> 1], jres, prime);
+				started = 1;
+			} else {
+				// invariant jres = (-1)^sign sum of added digits
+				// negate last result to make signs of this round and the
+				// last round equal.
+				conditional_negate(sign ^ nsign, &jres->y, prime);
+				// add odd factor
+				point_jacobian_add(&curve->cp[row][bits >> 1], jres, curve);
+			}
+			sign = nsign;
 		}
-		a.val[j] >>= 4;
-		// a = old(a)>>(4*i)
-		// a is even iff sign(a[i-1]) = -1
-
-		lowbits = a.val[0] & ((1 << 5) - 1);
-		lowbits ^= (lowbits >> 4) - 1;
-		lowbits &= 15;
-		// negate last result to make signs of this round and the
-		// last round equal.
-		conditional_negate((lowbits & 1) - 1, &jres.y, prime);
-
-		// add odd factor
-		point_jacobian_add(&curve->cp[i][lowbits >> 1], &jres, curve);
 	}
-	conditional_negate(((a.val[0] >> 4) & 1) - 1, &jres.y, prime);
-	jacobian_to_curve(&jres, res, prime);
+	conditional_negate(sign, &jres->y, prime);
 	memzero(&a, sizeof(a));
+	return 0;
+}
+
+// res = k * G
+// k must be a normalized number with 0 <= k < curve->order
+void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+{
+	CONFIDENTIAL jacobian_curve_point jres;
+	if (scalar_multiply_jacobian(curve, k, &jres)) {
+		point_set_infinity(res);
+		return;
+	}
+	jacobian_to_curve(&jres, res, &curve->prime);
 	memzero(&jres, sizeof(jres));
 }
 
@@ -639,8 +687,791 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 	point_multiply(curve, k, &curve->G, res);
 }
 
+static int scalar_multiply_jacobian(const ecdsa_curve *curve, const bignum256 *k, jacobian_curve_point *jres)
+{
+	curve_point p;
+	if (bn_is_zero(k)) {
+		return 1;
+	}
+	point_multiply(curve, k, &curve->G, &p);
+	curve_to_jacobian(&p, jres, &curve->prime);
+	memzero(&p, sizeof(p));
+	return 0;
+}
+
+#endif
+
+// number of odd multiples in the tables of point_multiply_double (width-5 NAF)
+#define POINT_TABLE_MAX 8
+
+// converts n jacobian points to affine coordinates with a single inversion
+// (Montgomery's trick). None of the points can be the point at infinity.
+static void jacobian_batch_to_curve(const jacobian_curve_point *jp, curve_point *p, size_t n, const bignum256 *prime)
+{
+	size_t i;
+	bignum256 inv, zinv, zinv2;
+	if (n == 0) {
+		return;
+	}
+	// p[i].x = z[0] * ... * z[i]
+	p[0].x = jp[0].z;
+	for (i = 1; i < n; i++) {
+		p[i].x = jp[i].z;
+		bn_multiply(&p[i - 1].x, &p[i].x, prime);
+	}
+	inv = p[n - 1].x;
+	bn_inverse(&inv, prime);
+	for (i = n; i-- > 0;) {
+		// zinv = 1 / z[i], inv = 1 / (z[0] * ... * z[i-1])
+		zinv = inv;
+		if (i > 0) {
+			bn_multiply(&p[i - 1].x, &zinv, prime);
+			bn_multiply(&jp[i].z, &inv, prime);
+		}
+		zinv2 = zinv;
+		bn_multiply(&zinv2, &zinv2, prime);
+		p[i].x = jp[i].x;
+		bn_multiply(&zinv2, &p[i].x, prime);
+		bn_multiply(&zinv, &zinv2, prime);
+		p[i].y = jp[i].y;
+		bn_multiply(&zinv2, &p[i].y, prime);
+		bn_mod(&p[i].x, prime);
+		bn_mod(&p[i].y, prime);
+	}
+	memzero(&inv, sizeof(inv));
+	memzero(&zinv, sizeof(zinv));
+	memzero(&zinv2, sizeof(zinv2));
+}
+
+// table[i] = (2*i+1) * p for i < n
+static void point_odd_multiples(const ecdsa_curve *curve, const curve_point *p, curve_point *table, size_t n)
+{
+	jacobian_curve_point jp[POINT_TABLE_MAX];
+	curve_point twice;
+	size_t i;
+
+	assert(n <= POINT_TABLE_MAX);
+	twice = *p;
+	point_double(curve, &twice);
+	jp[0].x = p->x;
+	jp[0].y = p->y;
+	bn_one(&jp[0].z);
+	for (i = 1; i < n; i++) {
+		jp[i] = jp[i - 1];
+		point_jacobian_add(&twice, &jp[i], curve);
+	}
+	jacobian_batch_to_curve(jp, table, n, &curve->prime);
+}
+
+#if USE_PRECOMPUTED_CP && CP_SPACING == 1
+
+// acc[i] += q[i] in affine coordinates for i < n with one inversion
+// (Montgomery's trick). Lanes with acc[i].x == q[i].x (doubling or the
+// point at infinity) are flagged in failed[] and skipped from then on.
+// d and prod are scratch arrays of n numbers.
+static void point_add_batch(const ecdsa_curve *curve, curve_point *acc, const curve_point *q, size_t n, uint8_t *failed, bignum256 *d, bignum256 *prod)
+{
+	const bignum256 *prime = &curve->prime;
+	bignum256 inv, lambda, xr, yr;
+	size_t i;
+
+	// d[i] = x2 - x1, prod[i] = d[0] * ... * d[i]
+	for (i = 0; i < n; i++) {
+		bn_one(&d[i]);
+		if (!failed[i]) {
+			bn_subtractmod(&q[i].x, &acc[i].x, &d[i], prime);
+			bn_fast_mod(&d[i], prime);
+			bn_mod(&d[i], prime);
+			if (bn_is_zero(&d[i])) {
+				failed[i] = 1;
+				bn_one(&d[i]);
+			}
+		}
+		prod[i] = d[i];
+		if (i > 0) {
+			bn_multiply(&prod[i - 1], &prod[i], prime);
+		}
+	}
+	inv = prod[n - 1];
+	bn_inverse(&inv, prime);
+	for (i = n; i-- > 0;) {
+		// lambda = 1 / d[i], inv = 1 / (d[0] * ... * d[i-1])
+		lambda = inv;
+		if (i > 0) {
+			bn_multiply(&prod[i - 1], &lambda, prime);
+			bn_multiply(&d[i], &inv, prime);
+		}
+		if (failed[i]) {
+			continue;
+		}
+		// lambda = (y2 - y1) / (x2 - x1)
+		bn_subtractmod(&q[i].y, &acc[i].y, &yr, prime);
+		bn_multiply(&yr, &lambda, prime);
+
+		// xr = lambda^2 - x1 - x2
+		xr = lambda;
+		bn_multiply(&xr, &xr, prime);
+		yr = acc[i].x;
+		bn_addmod(&yr, &q[i].x, prime);
+		bn_subtractmod(&xr, &yr, &xr, prime);
+		bn_fast_mod(&xr, prime);
+		bn_mod(&xr, prime);
+
+		// yr = lambda (x1 - xr) - y1
+		bn_subtractmod(&acc[i].x, &xr, &yr, prime);
+		bn_multiply(&lambda, &yr, prime);
+		bn_subtractmod(&yr, &acc[i].y, &yr, prime);
+		bn_fast_mod(&yr, prime);
+		bn_mod(&yr, prime);
+
+		acc[i].x = xr;
+		acc[i].y = yr;
+	}
+}
+
+// res[i] = p[i * p_step] + k[i] * G for i < n. Variable time, for public
+// scalars like BIP32 tweaks of public derivation: lanes of DERIVE_BATCH_SIZE
+// walk the precomputed comb together in affine coordinates, so every
+// table addition costs a share of one inversion instead of a jacobian
+// addition. Points can not be at infinity, k[i] must be normalized
+// and less than curve->order.
+static void scalar_multiply_add_points(const ecdsa_curve *curve, const curve_point *p, size_t p_step, size_t n, const bignum256 *k, curve_point *res)
+{
+	curve_point q[DERIVE_BATCH_SIZE];
+	bignum256 a[DERIVE_BATCH_SIZE], d[DERIVE_BATCH_SIZE], prod[DERIVE_BATCH_SIZE];
+	uint8_t failed[DERIVE_BATCH_SIZE];
+	const bignum256 *prime = &curve->prime;
+	jacobian_curve_point jp;
+	curve_point *acc, *dst;
+	uint32_t bits, nsign;
+	size_t start, i, m;
+	int row;
+
+	for (start = 0; start < n; start += m) {
+		m = n - start;
+		if (m > DERIVE_BATCH_SIZE) {
+			m = DERIVE_BATCH_SIZE;
+		}
+		acc = res + start;
+		for (i = 0; i < m; i++) {
+			failed[i] = !scalar_comb_recode(curve, &k[start + i], &a[i]);
+		}
+		// signed digits as in scalar_multiply_jacobian
+		for (row = 0; row < CP_ROWS; row++) {
+			for (i = 0; i < m; i++) {
+				bits = bn_bits(&a[i], CP_WINDOW * row, CP_WINDOW + 1);
+				nsign = (bits >> CP_WINDOW) - 1;
+				bits ^= nsign;
+				bits &= (1 << CP_WINDOW) - 1;
+				dst = (row == 0) ? &acc[i] : &q[i];
+				*dst = curve->cp[row][bits >> 1];
+				if (nsign) {
+					bn_subtract(prime, &dst->y, &dst->y);
+				}
+			}
+			if (row > 0) {
+				point_add_batch(curve, acc, q, m, failed, d, prod);
+			}
+		}
+		for (i = 0; i < m; i++) {
+			q[i] = p[(start + i) * p_step];
+		}
+		point_add_batch(curve, acc, q, m, failed, d, prod);
+		// k[i] = 0, p = k[i] * G or an exceptional sum in the comb
+		for (i = 0; i < m; i++) {
+			if (!failed[i]) {
+				continue;
+			}
+			if (scalar_multiply_jacobian(curve, &k[start + i], &jp)) {
+				acc[i] = p[(start + i) * p_step];
+				continue;
+			}
+			point_jacobian_add(&p[(start + i) * p_step], &jp, curve);
+			d[0] = jp.z;
+			bn_mod(&d[0], prime);
+			if (bn_is_zero(&d[0])) {
+				point_set_infinity(&acc[i]);
+			} else {
+				jacobian_to_curve(&jp, &acc[i], prime);
+			}
+		}
+	}
+}
+
+#else
+
+// res[i] = p[i * p_step] + k[i] * G for i < n with one field inversion
+// per DERIVE_BATCH_SIZE points. Points can not be at infinity,
+// k[i] must be normalized and less than curve->order.
+static void scalar_multiply_add_points(const ecdsa_curve *curve, const curve_point *p, size_t p_step, size_t n, const bignum256 *k, curve_point *res)
+{
+	jacobian_curve_point jp[DERIVE_BATCH_SIZE];
+	uint8_t infinity[DERIVE_BATCH_SIZE];
+	const bignum256 *prime = &curve->prime;
+	bignum256 z;
+	size_t start, i, m;
+
+	for (start = 0; start < n; start += m) {
+		m = n - start;
+		if (m > DERIVE_BATCH_SIZE) {
+			m = DERIVE_BATCH_SIZE;
+		}
+		for (i = 0; i < m; i++) {
+			infinity[i] = 0;
+			if (scalar_multiply_jacobian(curve, &k[start + i], &jp[i])) {
+				curve_to_jacobian(&p[(start + i) * p_step], &jp[i], prime);
+				continue;
+			}
+			point_jacobian_add(&p[(start + i) * p_step], &jp[i], curve);
+			// p = -k[i] * G, the batch inversion needs a non-zero z
+			z = jp[i].z;
+			bn_mod(&z, prime);
+			if (bn_is_zero(&z)) {
+				infinity[i] = 1;
+				bn_one(&jp[i].z);
+			}
+		}
+		jacobian_batch_to_curve(jp, res + start, m, prime);
+		for (i = 0; i < m; i++) {
+			if (infinity[i]) {
+				point_set_infinity(&res[start + i]);
+			}
+		}
+	}
+	memzero(jp, sizeof(jp));
+}
+
 #endif
 
+void scalar_multiply_add_batch(const ecdsa_curve *curve, const curve_point *p, size_t n, const bignum256 *k, curve_point *res)
+{
+	scalar_multiply_add_points(curve, p, 0, n, k, res);
+}
+
+void scalar_multiply_add_multi(const ecdsa_curve *curve, size_t n, const curve_point *p, const bignum256 *k, curve_point *res)
+{
+	scalar_multiply_add_points(curve, p, 1, n, k, res);
+}
+
+// c = round(k * g / 2^384)
+static void glv_mul_shift(const bignum256 *k, const bignum256 *g, bignum256 *c)
+{
+	uint32_t res[18];
+	int j;
+	bn_multiply_long(k, g, res);
+	// bit 384 is bit 24 of res[12], k * g < 2^512 so c < 2^128
+	for (j = 0; j < 5; j++) {
+		c->val[j] = ((res[12 + j] >> 24) | (res[13 + j] << 6)) & 0x3FFFFFFF;
+	}
+	for (; j < 9; j++) {
+		c->val[j] = 0;
+	}
+	bn_addi(c, (res[12] >> 23) & 1);
+	memzero(res, sizeof(res));
+}
+
+// k = r1 + r2 * lambda (mod order), r1 and r2 are reduced and
+// either them or their negations are below 2^128. Constant time.
+static void glv_split(const ecdsa_curve *curve, const bignum256 *k, bignum256 *r1, bignum256 *r2)
+{
+	const ecdsa_glv *glv = curve->glv;
+	const bignum256 *order = &curve->order;
+	bignum256 c1, c2;
+
+	glv_mul_shift(k, &glv->g1, &c1);
+	glv_mul_shift(k, &glv->g2, &c2);
+	// r2 = -(c1 * b1 + c2 * b2)
+	bn_multiply(&glv->minus_b1, &c1, order);
+	bn_multiply(&glv->minus_b2, &c2, order);
+	*r2 = c1;
+	bn_addmod(r2, &c2, order);
+	bn_mod(r2, order);
+	// r1 = k - r2 * lambda
+	c1 = *r2;
+	bn_multiply(&glv->lambda, &c1, order);
+	bn_subtractmod(k, &c1, r1, order);
+	bn_fast_mod(r1, order);
+	bn_mod(r1, order);
+	memzero(&c1, sizeof(c1));
+	memzero(&c2, sizeof(c2));
+}
+
+// replaces r by order - r if r > order / 2.
+// Returns 0xffffffff if r was negated, 0 otherwise. Constant time.
+static uint32_t glv_abs(const ecdsa_curve *curve, bignum256 *r)
+{
+	bignum256 neg;
+	int is_neg = bn_is_less(&curve->order_half, r);
+	bn_subtract(&curve->order, r, &neg);
+	bn_cmov(r, is_neg, &neg, r);
+	memzero(&neg, sizeof(neg));
+	return -(uint32_t)is_neg;
+}
+
+// lambda * p for every point of the table
+static void glv_table(const ecdsa_curve *curve, const curve_point *table, curve_point *res, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; i++) {
+		res[i].x = table[i].x;
+		bn_multiply(&curve->glv->beta, &res[i].x, &curve->prime);
+		bn_mod(&res[i].x, &curve->prime);
+		res[i].y = table[i].y;
+	}
+}
+
+// res = table[index], reads every entry so the access pattern
+// does not depend on the index
+static void point_table_select(const curve_point *table, uint32_t index, curve_point *res)
+{
+	uint32_t i;
+	for (i = 0; i < POINT_TABLE_MAX; i++) {
+		int cond = (((i ^ index) - 1) >> 31) & 1;
+		bn_cmov(&res->x, cond, &table[i].x, &res->x);
+		bn_cmov(&res->y, cond, &table[i].y, &res->y);
+	}
+}
+
+// res = k * p on curves with an endomorphism: k = k1 + k2 * lambda, then
+// k1 * p + k2 * (lambda * p) with a joint ladder of 33 signed 4-bit digits
+// (the same recoding as point_multiply) taking half the doublings.
+// Constant time: the operations and table accesses don't depend on k.
+static void point_multiply_glv(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	CONFIDENTIAL bignum256 a[2];
+	CONFIDENTIAL jacobian_curve_point jres, jtmp;
+	CONFIDENTIAL curve_point q;
+	curve_point pmult[2][POINT_TABLE_MAX];
+	const bignum256 *prime = &curve->prime;
+	uint32_t neg[2], skew[2], bits, nsign;
+	int i, j, t;
+
+	// special case 0*p:  just return zero. We don't care about constant time.
+	if (bn_is_zero(k)) {
+		point_set_infinity(res);
+		return;
+	}
+
+	glv_split(curve, k, &a[0], &a[1]);
+	for (t = 0; t < 2; t++) {
+		// a[t] < 2^128 after taking the absolute value, the sign goes to the table
+		neg[t] = glv_abs(curve, &a[t]);
+		// make a[t] odd, the extra p is subtracted at the end
+		skew[t] = 1 - (a[t].val[0] & 1);
+		a[t].val[0] |= 1;
+		// add 2^132 so the top digit is positive
+		a[t].val[4] |= 1 << 12;
+	}
+
+	// pmult[0][i] = (2*i+1) * p, pmult[1][i] = (2*i+1) * lambda * p with signs of a
+	point_odd_multiples(curve, p, pmult[0], POINT_TABLE_MAX);
+	glv_table(curve, pmult[0], pmult[1], POINT_TABLE_MAX);
+	for (t = 0; t < 2; t++) {
+		for (j = 0; j < POINT_TABLE_MAX; j++) {
+			conditional_negate(neg[t], &pmult[t][j].y, prime);
+		}
+	}
+
+	// the top digits are 1 (see point_multiply)
+	curve_to_jacobian(&pmult[0][0], &jres, prime);
+	point_jacobian_add(&pmult[1][0], &jres, curve);
+	for (i = 31; i >= 0; i--) {
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+		for (t = 0; t < 2; t++) {
+			bits = bn_bits(&a[t], 4 * i, 5);
+			nsign = (bits >> 4) - 1;
+			bits ^= nsign;
+			bits &= 15;
+			point_table_select(pmult[t], bits >> 1, &q);
+			conditional_negate(nsign, &q.y, prime);
+			point_jacobian_add(&q, &jres, curve);
+		}
+	}
+
+	// undo the skew: subtract p and lambda * p if a was even
+	for (t = 0; t < 2; t++) {
+		q = pmult[t][0];
+		conditional_negate(0xffffffff, &q.y, prime);
+		jtmp = jres;
+		point_jacobian_add(&q, &jtmp, curve);
+		bn_cmov(&jres.x, skew[t], &jtmp.x, &jres.x);
+		bn_cmov(&jres.y, skew[t], &jtmp.y, &jres.y);
+		bn_cmov(&jres.z, skew[t], &jtmp.z, &jres.z);
+	}
+	jacobian_to_curve(&jres, res, prime);
+	memzero(a, sizeof(a));
+	memzero(&jres, sizeof(jres));
+	memzero(&jtmp, sizeof(jtmp));
+	memzero(&q, sizeof(q));
+}
+
+// width-w non-adjacent form of k: k = sum naf[i] 2^i with every non-zero
+// digit odd and |naf[i]| < 2^(w-1), at most one in w digits is non-zero.
+// returns the number of digits (at most 257)
+static int bn_wnaf(const bignum256 *k, int w, int8_t naf[257])
+{
+	int bit = 0, carry = 0, len = 0;
+	memset(naf, 0, 257);
+	while (bit < 256) {
+		if (((k->val[bit / 30] >> (bit % 30)) & 1) == (uint32_t)carry) {
+			bit++;
+			continue;
+		}
+		int now = (256 - bit < w) ? 256 - bit : w;
+		int word = carry;
+		for (int j = 0; j < now; j++) {
+			word += ((k->val[(bit + j) / 30] >> ((bit + j) % 30)) & 1) << j;
+		}
+		carry = (word >> (w - 1)) & 1;
+		word -= carry << w;
+		naf[bit] = word;
+		len = bit + 1;
+		bit += now;
+	}
+	if (carry) {
+		naf[256] = 1;
+		len = 257;
+	}
+	return len;
+}
+
+// adds p (or -p) to the jacobian accumulator, tracks the point at infinity
+static void jacobian_accumulate(const ecdsa_curve *curve, jacobian_curve_point *acc, int *is_infinity, const curve_point *p, int negate)
+{
+	curve_point q = *p;
+	bignum256 z;
+	if (negate) {
+		bn_subtract(&curve->prime, &p->y, &q.y);
+	}
+	if (*is_infinity) {
+		acc->x = q.x;
+		acc->y = q.y;
+		bn_one(&acc->z);
+		*is_infinity = 0;
+		return;
+	}
+	point_jacobian_add(&q, acc, curve);
+	// acc + p = infinity gives z = 0
+	z = acc->z;
+	bn_mod(&z, &curve->prime);
+	*is_infinity = bn_is_zero(&z);
+}
+
+// odd multiples of G for point_multiply_double, buf is used
+// if the curve has no precomputed points
+static const curve_point *generator_odd_multiples(const ecdsa_curve *curve, curve_point buf[POINT_TABLE_MAX])
+{
+#if USE_PRECOMPUTED_CP && CP_COLS >= POINT_TABLE_MAX
+	(void)buf;
+	return curve->cp[0];
+#else
+	point_odd_multiples(curve, &curve->G, buf, POINT_TABLE_MAX);
+	return buf;
+#endif
+}
+
+// res = k1 * G + k2 * p in jacobian coordinates, gtable and ptable are
+// the odd multiples of G and p. On curves with an endomorphism both scalars
+// are split in halves, so four scalars of 128 bits share the doublings.
+// Returns 1 if the result is the point at infinity.
+static int point_multiply_double_jacobian(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *gtable, const curve_point *ptable, jacobian_curve_point *res)
+{
+	int8_t naf[4][257];
+	const curve_point *tables[4];
+	curve_point lambda_tables[2][POINT_TABLE_MAX];
+	bignum256 k[4];
+	int negate[4], len[4];
+	int is_infinity = 1;
+	int terms = 2, maxlen = 0, i, t;
+
+	k[0] = *k1;
+	k[1] = *k2;
+	tables[0] = gtable;
+	tables[1] = ptable;
+	negate[0] = negate[1] = 0;
+	if (curve->glv) {
+		for (t = 0; t < 2; t++) {
+			glv_split(curve, &k[t], &k[t], &k[t + 2]);
+			negate[t] = glv_abs(curve, &k[t]) & 1;
+			negate[t + 2] = glv_abs(curve, &k[t + 2]) & 1;
+			if (!bn_is_zero(&k[t + 2])) {
+				glv_table(curve, tables[t], lambda_tables[t], POINT_TABLE_MAX);
+			}
+			tables[t + 2] = lambda_tables[t];
+		}
+		terms = 4;
+	}
+	for (t = 0; t < terms; t++) {
+		len[t] = bn_wnaf(&k[t], 5, naf[t]);
+		if (len[t] > maxlen) {
+			maxlen = len[t];
+		}
+	}
+	for (i = maxlen - 1; i >= 0; i--) {
+		if (!is_infinity) {
+			point_jacobian_double(res, curve);
+		}
+		for (t = 0; t < terms; t++) {
+			int d = naf[t][i];
+			if (d != 0) {
+				jacobian_accumulate(curve, res, &is_infinity, &tables[t][(d < 0 ? -d : d) >> 1], (d < 0) ^ negate[t]);
+			}
+		}
+	}
+	return is_infinity;
+}
+
+// res = k1 * G + k2 * p, not constant time: only for public scalars (verification).
+// Both multiplications share one doubling chain (Strauss-Shamir) with
+// scalars in width-5 NAF. Odd multiples of G are taken from curve->cp.
+// k1 and k2 must be normalized and reduced modulo curve->order.
+void point_multiply_double(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *p, curve_point *res)
+{
+	curve_point ptable[POINT_TABLE_MAX];
+	curve_point gbuf[POINT_TABLE_MAX];
+	const curve_point *gtable;
+	jacobian_curve_point acc;
+
+	gtable = generator_odd_multiples(curve, gbuf);
+	if (!bn_is_zero(k2)) {
+		point_odd_multiples(curve, p, ptable, POINT_TABLE_MAX);
+	}
+	if (point_multiply_double_jacobian(curve, k1, k2, gtable, ptable, &acc)) {
+		point_set_infinity(res);
+	} else {
+		jacobian_to_curve(&acc, res, &curve->prime);
+	}
+}
+
+// acc += p in jacobian coordinates, p is not the point at infinity.
+// Not constant time, handles doubling and p = -acc.
+static void jacobian_add(const ecdsa_curve *curve, const jacobian_curve_point *p, jacobian_curve_point *acc, int *is_infinity)
+{
+	const bignum256 *prime = &curve->prime;
+	bignum256 z1z1, z2z2, u1, u2, s1, s2, h, r, hh, hhh, v;
+
+	if (*is_infinity) {
+		*acc = *p;
+		*is_infinity = 0;
+		return;
+	}
+	z1z1 = acc->z;
+	bn_multiply(&z1z1, &z1z1, prime);
+	z2z2 = p->z;
+	bn_multiply(&z2z2, &z2z2, prime);
+	u1 = acc->x;
+	bn_multiply(&z2z2, &u1, prime);  // u1 = x1 * z2^2
+	u2 = p->x;
+	bn_multiply(&z1z1, &u2, prime);  // u2 = x2 * z1^2
+	s1 = acc->y;
+	bn_multiply(&p->z, &s1, prime);
+	bn_multiply(&z2z2, &s1, prime);  // s1 = y1 * z2^3
+	s2 = p->y;
+	bn_multiply(&acc->z, &s2, prime);
+	bn_multiply(&z1z1, &s2, prime);  // s2 = y2 * z1^3
+
+	bn_subtractmod(&u2, &u1, &h, prime);
+	bn_fast_mod(&h, prime);
+	bn_mod(&h, prime);
+	bn_subtractmod(&s2, &s1, &r, prime);
+	bn_fast_mod(&r, prime);
+	bn_mod(&r, prime);
+	if (bn_is_zero(&h)) {
+		if (bn_is_zero(&r)) {
+			point_jacobian_double(acc, curve);
+		} else {
+			*is_infinity = 1;
+		}
+		return;
+	}
+	hh = h;
+	bn_multiply(&hh, &hh, prime);
+	hhh = h;
+	bn_multiply(&hh, &hhh, prime);
+	v = u1;
+	bn_multiply(&hh, &v, prime);     // v = u1 * h^2
+
+	// x3 = r^2 - h^3 - 2v
+	acc->x = r;
+	bn_multiply(&acc->x, &acc->x, prime);
+	bn_subtractmod(&acc->x, &hhh, &acc->x, prime);
+	bn_fast_mod(&acc->x, prime);
+	bn_subtractmod(&acc->x, &v, &acc->x, prime);
+	bn_fast_mod(&acc->x, prime);
+	bn_subtractmod(&acc->x, &v, &acc->x, prime);
+	bn_fast_mod(&acc->x, prime);
+	// y3 = r * (v - x3) - s1 * h^3
+	bn_subtractmod(&v, &acc->x, &acc->y, prime);
+	bn_fast_mod(&acc->y, prime);
+	bn_multiply(&r, &acc->y, prime);
+	bn_multiply(&hhh, &s1, prime);
+	bn_subtractmod(&acc->y, &s1, &acc->y, prime);
+	bn_fast_mod(&acc->y, prime);
+	// z3 = z1 * z2 * h
+	bn_multiply(&p->z, &acc->z, prime);
+	bn_multiply(&h, &acc->z, prime);
+}
+
+// acc += sum k[i] * p[i] for n <= MULTI_STRAUSS_MAX points (Strauss):
+// all scalars in width-5 NAF share one doubling chain and are split
+// in halves on curves with an endomorphism. Odd multiples of all points
+// are converted to affine coordinates with one shared inversion.
+static void point_multiply_strauss(const ecdsa_curve *curve, size_t n, const bignum256 *k, const curve_point *p, jacobian_curve_point *acc, int *acc_inf)
+{
+	int8_t naf[2 * MULTI_STRAUSS_MAX][257];
+	curve_point table[MULTI_STRAUSS_MAX * POINT_TABLE_MAX];
+	jacobian_curve_point jp[MULTI_STRAUSS_MAX * POINT_TABLE_MAX];
+	int negate[2 * MULTI_STRAUSS_MAX];
+	const bignum256 *prime = &curve->prime;
+	bignum256 half[2];
+	jacobian_curve_point res;
+	curve_point q;
+	int terms = curve->glv ? 2 : 1;
+	int res_inf = 1, maxlen = 0, len, i, t;
+	size_t j;
+
+	assert(n <= MULTI_STRAUSS_MAX);
+	// 2 * p[j] for all points, then (2 * i + 1) * p[j]
+	for (j = 0; j < n; j++) {
+		curve_to_jacobian(&p[j], &jp[j], prime);
+		point_jacobian_double(&jp[j], curve);
+	}
+	jacobian_batch_to_curve(jp, table, n, prime);
+	for (j = n; j-- > 0;) {
+		q = table[j];
+		curve_to_jacobian(&p[j], &jp[j * POINT_TABLE_MAX], prime);
+		for (i = 1; i < POINT_TABLE_MAX; i++) {
+			jp[j * POINT_TABLE_MAX + i] = jp[j * POINT_TABLE_MAX + i - 1];
+			point_jacobian_add(&q, &jp[j * POINT_TABLE_MAX + i], curve);
+		}
+	}
+	jacobian_batch_to_curve(jp, table, n * POINT_TABLE_MAX, prime);
+
+	for (j = 0; j < n; j++) {
+		half[0] = k[j];
+		if (terms == 2) {
+			glv_split(curve, &k[j], &half[0], &half[1]);
+		}
+		for (t = 0; t < terms; t++) {
+			negate[2 * j + t] = curve->glv ? glv_abs(curve, &half[t]) & 1 : 0;
+			len = bn_wnaf(&half[t], 5, naf[2 * j + t]);
+			if (len > maxlen) {
+				maxlen = len;
+			}
+		}
+	}
+	for (i = maxlen - 1; i >= 0; i--) {
+		if (!res_inf) {
+			point_jacobian_double(&res, curve);
+		}
+		for (j = 0; j < n; j++) {
+			for (t = 0; t < terms; t++) {
+				int d = naf[2 * j + t][i];
+				if (d == 0) {
+					continue;
+				}
+				q = table[j * POINT_TABLE_MAX + ((d < 0 ? -d : d) >> 1)];
+				if (t == 1) {
+					// lambda * (x, y) = (beta * x, y)
+					bn_multiply(&curve->glv->beta, &q.x, prime);
+					bn_mod(&q.x, prime);
+				}
+				jacobian_accumulate(curve, &res, &res_inf, &q, (d < 0) ^ negate[2 * j + t]);
+			}
+		}
+	}
+	if (!res_inf) {
+		jacobian_add(curve, &res, acc, acc_inf);
+	}
+}
+
+// acc += sum k[i] * p[i] with Pippenger's bucket method and w-bit windows:
+// in every window points are added to the bucket of their digit,
+// then the buckets are summed with their weights with running sums.
+static void point_multiply_pippenger(const ecdsa_curve *curve, size_t n, const bignum256 *k, const curve_point *p, int w, jacobian_curve_point *acc, int *acc_inf)
+{
+	jacobian_curve_point buckets[(1 << MULTI_WINDOW_MAX) - 1];
+	int empty[(1 << MULTI_WINDOW_MAX) - 1];
+	jacobian_curve_point running, sum;
+	int running_inf, sum_inf;
+	int nbuckets = (1 << w) - 1;
+	int j, b, i;
+	size_t t;
+
+	assert(w >= 1 && w <= MULTI_WINDOW_MAX);
+	for (j = (256 + w - 1) / w - 1; j >= 0; j--) {
+		if (!*acc_inf) {
+			for (i = 0; i < w; i++) {
+				point_jacobian_double(acc, curve);
+			}
+		}
+		for (b = 0; b < nbuckets; b++) {
+			empty[b] = 1;
+		}
+		for (t = 0; t < n; t++) {
+			uint32_t d = bn_bits(&k[t], j * w, w);
+			if (d != 0) {
+				jacobian_accumulate(curve, &buckets[d - 1], &empty[d - 1], &p[t], 0);
+			}
+		}
+		// sum = sum (b + 1) * buckets[b]
+		running_inf = sum_inf = 1;
+		for (b = nbuckets - 1; b >= 0; b--) {
+			if (!empty[b]) {
+				jacobian_add(curve, &buckets[b], &running, &running_inf);
+			}
+			if (!running_inf) {
+				jacobian_add(curve, &running, &sum, &sum_inf);
+			}
+		}
+		if (!sum_inf) {
+			jacobian_add(curve, &sum, acc, acc_inf);
+		}
+	}
+}
+
+// res = sum k[i] * p[i], not constant time: only for public scalars
+// (batch verification). Picks Strauss or Pippenger with the cheapest
+// estimate in point additions: Strauss takes about 52 additions per point
+// and a doubling chain per chunk, Pippenger ceil(256 / w) * (n + 3 * 2^w).
+// k must be reduced modulo curve->order, p must not be the point at infinity.
+// res may be NULL. Returns 1 if the result is the point at infinity.
+int point_multiply_multi(const ecdsa_curve *curve, size_t n, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	jacobian_curve_point acc;
+	int acc_inf = 1;
+	int w, best = 0;
+	size_t i, m, cost, best_cost;
+
+	best_cost = 52 * n + (n + MULTI_STRAUSS_MAX - 1) / MULTI_STRAUSS_MAX * (curve->glv ? 104 : 208);
+	for (w = 1; w <= MULTI_WINDOW_MAX; w++) {
+		cost = (size_t)((256 + w - 1) / w) * (n + ((size_t)3 << w));
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = w;
+		}
+	}
+	if (best) {
+		point_multiply_pippenger(curve, n, k, p, best, &acc, &acc_inf);
+	} else {
+		for (i = 0; i < n; i += m) {
+			m = n - i < MULTI_STRAUSS_MAX ? n - i : MULTI_STRAUSS_MAX;
+			point_multiply_strauss(curve, m, k + i, p + i, &acc, &acc_inf);
+		}
+	}
+	if (res) {
+		if (acc_inf) {
+			point_set_infinity(res);
+		} else {
+			jacobian_to_curve(&acc, res, &curve->prime);
+		}
+	}
+	return acc_inf;
+}
+
 int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *pub_key, uint8_t *session_key)
 {
 	curve_point point;
@@ -723,13 +1554,8 @@ int ecdsa_sign(const ecdsa_curve *curve, HasherType hasher_sign, const uint8_t *
 
 }
 
-// uses secp256k1 curve
-// priv_key is a 32 byte big endian stored number
-// sig is 64 bytes long array for the signature
-// digest is 32 bytes of digest
-// is_canonical is an optional function that checks if the signature
-// conforms to additional coin-specific rules.
-int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
+// signs digest using k from rng (RFC6979) or from random32()
+static int sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, rfc6979_state *rng, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
 {
 	int i;
 	curve_point R;
@@ -737,9 +1563,8 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 	bignum256 *s = &R.y;
 	uint8_t by; // signature recovery byte
 
-#if USE_RFC6979
-	rfc6979_state rng;
-	init_rfc6979(priv_key, digest, &rng);
+#if !USE_RFC6979
+	(void)rng;
 #endif
 
 	bn_read_be(digest, &z);
@@ -748,7 +1573,7 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 
 #if USE_RFC6979
 		// generate K deterministically
-		generate_k_rfc6979(&k, &rng);
+		generate_k_rfc6979(&k, rng);
 		// if k is too big or too small, we don't like it
 		if (bn_is_zero(&k) || !bn_is_less(&k, &curve->order)) {
 			continue;
@@ -806,9 +1631,6 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 
 		memzero(&k, sizeof(k));
 		memzero(&randk, sizeof(randk));
-#if USE_RFC6979
-		memzero(&rng, sizeof(rng));
-#endif
 		return 0;
 	}
 
@@ -816,10 +1638,51 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 	// -> fail with an error
 	memzero(&k, sizeof(k));
 	memzero(&randk, sizeof(randk));
+	return -1;
+}
+
+// uses secp256k1 curve
+// priv_key is a 32 byte big endian stored number
+// sig is 64 bytes long array for the signature
+// digest is 32 bytes of digest
+// is_canonical is an optional function that checks if the signature
+// conforms to additional coin-specific rules.
+int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
+{
+	rfc6979_state rng;
 #if USE_RFC6979
+	init_rfc6979(priv_key, digest, &rng);
+#endif
+	int res = sign_digest(curve, priv_key, digest, &rng, sig, pby, is_canonical);
 	memzero(&rng, sizeof(rng));
+	return res;
+}
+
+// signs n 32-byte digests with the same key, signature i goes to sig + 64*i.
+// The per-key part of RFC6979 is computed once for the whole batch.
+// pby is optional, otherwise receives n recovery bytes.
+// Returns 0 if all digests were signed, -1 otherwise.
+int ecdsa_sign_digest_batch(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digests, size_t n, uint8_t *sigs, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
+{
+	rfc6979_state rng;
+	int res = 0;
+#if USE_RFC6979
+	rfc6979_key key;
+	init_rfc6979_key(priv_key, &key);
 #endif
-	return -1;
+	for (size_t i = 0; i < n; i++) {
+#if USE_RFC6979
+		init_rfc6979_digest(&key, digests + 32 * i, &rng);
+#endif
+		if (sign_digest(curve, priv_key, digests + 32 * i, &rng, sigs + 64 * i, pby ? pby + i : NULL, is_canonical) != 0) {
+			res = -1;
+		}
+	}
+#if USE_RFC6979
+	memzero(&key, sizeof(key));
+#endif
+	memzero(&rng, sizeof(rng));
+	return res;
 }
 
 void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key)
@@ -1028,7 +1891,7 @@ int ecdsa_verify(const ecdsa_curve *curve, HasherType hasher_sign, const uint8_t
 int ecdsa_recover_pub_from_sig (const ecdsa_curve *curve, uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest, int recid)
 {
 	bignum256 r, s, e;
-	curve_point cp, cp2;
+	curve_point cp;
 
 	// read r and s
 	bn_read_be(sig, &r);
@@ -1059,14 +1922,16 @@ int ecdsa_recover_pub_from_sig (const ecdsa_curve *curve, uint8_t *pub_key, cons
 	bn_mod(&e, &curve->order);
 	// r := r^-1
 	bn_inverse(&r, &curve->order);
-	// cp := s * R = s * k *G
-	point_multiply(curve, &s, &cp, &cp);
-	// cp2 := -digest * G
-	scalar_multiply(curve, &e, &cp2);
-	// cp := (s * k - digest) * G = (r*priv) * G = r * Pub
-	point_add(curve, &cp2, &cp);
-	// cp := r^{-1} * r * Pub = Pub
-	point_multiply(curve, &r, &cp, &cp);
+	// e := -digest * r^-1, s := s * r^-1
+	bn_multiply(&r, &e, &curve->order);
+	bn_mod(&e, &curve->order);
+	bn_multiply(&r, &s, &curve->order);
+	bn_mod(&s, &curve->order);
+	// cp := r^-1 * (s * R - digest * G) = r^-1 * (r * priv) * G = Pub
+	point_multiply_double(curve, &e, &s, &cp, &cp);
+	if (point_is_infinity(&cp)) {
+		return 1;
+	}
 	pub_key[0] = 0x04;
 	bn_write_be(&cp.x, pub_key + 1);
 	bn_write_be(&cp.y, pub_key + 33);
@@ -1104,13 +1969,14 @@ int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const
 		// I don't expect this to happen any time soon
 		result = 3;
 	} else {
-		scalar_multiply(curve, &z, &res);
+		// res = z*s^-1 * G + r*s^-1 * pub
+		point_multiply_double(curve, &z, &s, &pub, &res);
+		if (point_is_infinity(&res)) {
+			result = 4;
+		}
 	}
 
 	if (result == 0) {
-		// both pub and res can be infinity, can have y = 0 OR can be equal -> false negative
-		point_multiply(curve, &s, &pub, &pub);
-		point_add(curve, &pub, &res);
 		bn_mod(&(res.x), &curve->order);
 		// signature does not match
 		if (!bn_is_equal(&res.x, &r)) {
@@ -1128,6 +1994,182 @@ int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const
 	return result;
 }
 
+// verifies up to VERIFY_BATCH_SIZE signatures, all inversions are shared:
+// one for s values, two for the tables of odd multiples of public keys
+// and one to convert the results to affine coordinates.
+// Returns the number of invalid signatures.
+static size_t verify_digest_group(const ecdsa_curve *curve, size_t n, const uint8_t *const *pub_keys, const uint8_t *sigs, const uint8_t *digests, int *results)
+{
+	curve_point pub[VERIFY_BATCH_SIZE];
+	curve_point table[VERIFY_BATCH_SIZE * POINT_TABLE_MAX];
+	curve_point gbuf[POINT_TABLE_MAX];
+	jacobian_curve_point jp[VERIFY_BATCH_SIZE * POINT_TABLE_MAX];
+	bignum256 r[VERIFY_BATCH_SIZE], s[VERIFY_BATCH_SIZE], z[VERIFY_BATCH_SIZE], tmp[VERIFY_BATCH_SIZE];
+	size_t idx[VERIFY_BATCH_SIZE];
+	const curve_point *gtable;
+	size_t i, j, m = 0, failed = 0;
+
+	assert(n <= VERIFY_BATCH_SIZE);
+	for (i = 0; i < n; i++) {
+		results[i] = 0;
+		if (!ecdsa_read_pubkey(curve, pub_keys[i], &pub[m])) {
+			results[i] = 1;
+			continue;
+		}
+		bn_read_be(sigs + 64 * i, &r[m]);
+		bn_read_be(sigs + 64 * i + 32, &s[m]);
+		bn_read_be(digests + 32 * i, &z[m]);
+		if (bn_is_zero(&r[m]) || bn_is_zero(&s[m]) ||
+			(!bn_is_less(&r[m], &curve->order)) ||
+			(!bn_is_less(&s[m], &curve->order))) {
+			results[i] = 2;
+			continue;
+		}
+		idx[m++] = i;
+	}
+
+	// s = s^-1, z = z*s^-1, s = r*s^-1
+	bn_inverse_batch(s, tmp, m, &curve->order);
+	for (i = 0, j = 0; i < m; i++) {
+		bn_multiply(&s[i], &z[i], &curve->order);
+		bn_mod(&z[i], &curve->order);
+		bn_multiply(&r[i], &s[i], &curve->order);
+		bn_mod(&s[i], &curve->order);
+		if (bn_is_zero(&z[i])) {
+			// message hashes to zero
+			results[idx[i]] = 3;
+			continue;
+		}
+		idx[j] = idx[i];
+		pub[j] = pub[i];
+		r[j] = r[i];
+		s[j] = s[i];
+		z[j] = z[i];
+		j++;
+	}
+	m = j;
+
+	// odd multiples of public keys: 2*P for every key first,
+	// then (2*k+1)*P = (2*k-1)*P + 2*P
+	for (i = 0; i < m; i++) {
+		jp[i].x = pub[i].x;
+		jp[i].y = pub[i].y;
+		bn_one(&jp[i].z);
+		point_jacobian_double(&jp[i], curve);
+	}
+	jacobian_batch_to_curve(jp, table, m, &curve->prime);
+	for (i = 0; i < m; i++) {
+		const curve_point twice = table[i];
+		jacobian_curve_point *row = jp + i * POINT_TABLE_MAX;
+		row[0].x = pub[i].x;
+		row[0].y = pub[i].y;
+		bn_one(&row[0].z);
+		for (j = 1; j < POINT_TABLE_MAX; j++) {
+			row[j] = row[j - 1];
+			point_jacobian_add(&twice, &row[j], curve);
+		}
+	}
+	jacobian_batch_to_curve(jp, table, m * POINT_TABLE_MAX, &curve->prime);
+
+	// res = z*s^-1 * G + r*s^-1 * pub
+	gtable = generator_odd_multiples(curve, gbuf);
+	for (i = 0, j = 0; i < m; i++) {
+		if (point_multiply_double_jacobian(curve, &z[i], &s[i], gtable, table + i * POINT_TABLE_MAX, &jp[j])) {
+			results[idx[i]] = 4;
+			continue;
+		}
+		idx[j] = idx[i];
+		r[j] = r[i];
+		j++;
+	}
+	m = j;
+	jacobian_batch_to_curve(jp, pub, m, &curve->prime);
+	for (i = 0; i < m; i++) {
+		bn_mod(&pub[i].x, &curve->order);
+		// signature does not match
+		if (!bn_is_equal(&pub[i].x, &r[i])) {
+			results[idx[i]] = 5;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		failed += (results[i] != 0);
+	}
+	return failed;
+}
+
+typedef struct {
+	const ecdsa_curve *curve;
+	size_t n;
+	const uint8_t *const *pub_keys;
+	const uint8_t *sigs;
+	const uint8_t *digests;
+	int *results;
+	size_t failed;
+} verify_batch_job;
+
+static void *verify_batch_run(void *arg)
+{
+	verify_batch_job *job = (verify_batch_job *)arg;
+	size_t i, len;
+	job->failed = 0;
+	for (i = 0; i < job->n; i += len) {
+		len = job->n - i < VERIFY_BATCH_SIZE ? job->n - i : VERIFY_BATCH_SIZE;
+		job->failed += verify_digest_group(job->curve, len, job->pub_keys + i,
+			job->sigs + 64 * i, job->digests + 32 * i, job->results + i);
+	}
+	return NULL;
+}
+
+// verifies n signatures, sigs and digests are packed 64 and 32 bytes each.
+// results[i] is set to the ecdsa_verify_digest result for i-th signature.
+// Returns the number of invalid signatures, 0 if all are valid.
+size_t ecdsa_verify_digest_batch(const ecdsa_curve *curve, size_t n, const uint8_t *const *pub_keys, const uint8_t *sigs, const uint8_t *digests, int *results)
+{
+	verify_batch_job jobs[VERIFY_BATCH_THREADS];
+	size_t i, start = 0, groups, failed = 0;
+	size_t nthreads = VERIFY_BATCH_THREADS;
+#if VERIFY_THREADS
+	pthread_t threads[VERIFY_BATCH_THREADS];
+	int started[VERIFY_BATCH_THREADS] = {0};
+#endif
+
+	groups = (n + VERIFY_BATCH_SIZE - 1) / VERIFY_BATCH_SIZE;
+	if (nthreads > groups) {
+		nthreads = groups > 0 ? groups : 1;
+	}
+	for (i = 0; i < nthreads; i++) {
+		// whole groups for every thread
+		size_t end = (groups * (i + 1) / nthreads) * VERIFY_BATCH_SIZE;
+		if (end > n) {
+			end = n;
+		}
+		jobs[i].curve = curve;
+		jobs[i].n = end - start;
+		jobs[i].pub_keys = pub_keys + start;
+		jobs[i].sigs = sigs + 64 * start;
+		jobs[i].digests = digests + 32 * start;
+		jobs[i].results = results + start;
+		start = end;
+	}
+#if VERIFY_THREADS
+	// the caller runs the first job
+	for (i = 1; i < nthreads; i++) {
+		started[i] = (pthread_create(&threads[i], NULL, verify_batch_run, &jobs[i]) == 0);
+	}
+#endif
+	for (i = 0; i < nthreads; i++) {
+#if VERIFY_THREADS
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		} else
+#endif
+		verify_batch_run(&jobs[i]);
+		failed += jobs[i].failed;
+	}
+	return failed;
+}
+
 int ecdsa_sig_to_der(const uint8_t *sig, uint8_t *der)
 {
 	int i;
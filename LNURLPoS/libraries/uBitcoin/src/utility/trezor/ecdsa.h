@@ -29,11 +29,28 @@
 #include "bignum.h"
 #include "hasher.h"
 
+// precomputed table dimensions, see CP_WINDOW in options.h
+#define CP_DIGITS ((256 + CP_WINDOW - 1) / CP_WINDOW)
+#define CP_ROWS ((CP_DIGITS + CP_SPACING - 1) / CP_SPACING)
+#define CP_COLS (1 << (CP_WINDOW - 1))
+
 // curve point x and y
 typedef struct {
 	bignum256 x, y;
 } curve_point;
 
+// efficiently computable endomorphism lambda * (x, y) = (beta * x, y)
+// and the constants to split a scalar k = k1 + k2 * lambda (mod order)
+// into two halves of about 128 bits each (GLV method)
+typedef struct {
+	bignum256 beta;        // cube root of unity modulo prime
+	bignum256 lambda;      // cube root of unity modulo order
+	bignum256 minus_b1;    // -b1 and -b2 (mod order) of the short lattice
+	bignum256 minus_b2;    //   basis (a1, b1), (a2, b2)
+	bignum256 g1;          // round(2^384 * b2 / order)
+	bignum256 g2;          // round(2^384 * -b1 / order)
+} ecdsa_glv;
+
 typedef struct {
 
 	bignum256 prime;       // prime order of the finite field
@@ -42,9 +59,11 @@ typedef struct {
 	bignum256 order_half;  // order of G divided by 2
 	int       a;           // coefficient 'a' of the elliptic curve
 	bignum256 b;           // coefficient 'b' of the elliptic curve
+	const ecdsa_glv *glv;  // endomorphism constants, NULL if the curve has none
 
 #if USE_PRECOMPUTED_CP
-	const curve_point cp[64][8];
+	// cp[i][j] = (2*j+1) * 2^(CP_WINDOW*CP_SPACING*i) * G
+	const curve_point cp[CP_ROWS][CP_COLS];
 #endif
 
 } ecdsa_curve;
@@ -76,12 +95,18 @@ int point_is_infinity(const curve_point *p);
 int point_is_equal(const curve_point *p, const curve_point *q);
 int point_is_negative_of(const curve_point *p, const curve_point *q);
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res);
+void scalar_multiply_add_batch(const ecdsa_curve *curve, const curve_point *p, size_t n, const bignum256 *k, curve_point *res);
+// res[i] = p[i] + k[i] * G with shared inversions as in scalar_multiply_add_batch, res can not overlap p
+void scalar_multiply_add_multi(const ecdsa_curve *curve, size_t n, const curve_point *p, const bignum256 *k, curve_point *res);
+void point_multiply_double(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *p, curve_point *res);
+int point_multiply_multi(const ecdsa_curve *curve, size_t n, const bignum256 *k, const curve_point *p, curve_point *res);
 int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *pub_key, uint8_t *session_key);
 void uncompress_coords(const ecdsa_curve *curve, uint8_t odd, const bignum256 *x, bignum256 *y);
 int ecdsa_uncompress_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key, uint8_t *uncompressed);
 
 int ecdsa_sign(const ecdsa_curve *curve, HasherType hasher_sign, const uint8_t *priv_key, const uint8_t *msg, uint32_t msg_len, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]));
 int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]));
+int ecdsa_sign_digest_batch(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digests, size_t n, uint8_t *sigs, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]));
 void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key);
 void ecdsa_get_public_key65(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key);
 void ecdsa_get_pubkeyhash(const uint8_t *pub_key, HasherType hasher_pubkey, uint8_t *pubkeyhash);
@@ -96,6 +121,7 @@ int ecdsa_read_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key, curve_po
 int ecdsa_validate_pubkey(const ecdsa_curve *curve, const curve_point *pub);
 int ecdsa_verify(const ecdsa_curve *curve, HasherType hasher_sign, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *msg, uint32_t msg_len);
 int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest);
+size_t ecdsa_verify_digest_batch(const ecdsa_curve *curve, size_t n, const uint8_t *const *pub_keys, const uint8_t *sigs, const uint8_t *digests, int *results);
 int ecdsa_recover_pub_from_sig (const ecdsa_curve *curve, uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest, int recid);
 int ecdsa_sig_to_der(const uint8_t *sig, uint8_t *der);
 
@@ -0,0 +1,486 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "multibuf.h"
+#include "memzero.h"
+#include "ripemd160.h"
+#include "sha2.h"
+
+#if MULTIBUF_LANES > 1
+typedef uint32_t lane32 __attribute__((vector_size(4 * MULTIBUF_LANES)));
+#define LANE(v, l) ((v)[l])
+#else
+typedef uint32_t lane32;
+#define LANE(v, l) (v)
+#endif
+
+// broadcast a constant to all lanes
+#define BCAST(c) ((lane32){0} + (uint32_t)(c))
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define BSWAP(x)                                                    \
+	(((x) << 24) | (((x) & 0xff00) << 8) | (((x) >> 8) & 0xff00) | \
+	 ((x) >> 24))
+
+#define READ_BE32(p)                                              \
+	(((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) |      \
+	 ((uint32_t)(p)[2] << 8) | ((uint32_t)(p)[3]))
+#define READ_LE32(p)                                              \
+	(((uint32_t)(p)[3] << 24) | ((uint32_t)(p)[2] << 16) |      \
+	 ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[0]))
+
+const char *multibuf_backend(void) {
+#if MULTIBUF_LANES == 8
+	return "avx2";
+#elif MULTIBUF_LANES == 4 && defined(__SSE2__)
+	return "sse2";
+#elif MULTIBUF_LANES == 4
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+/*********************************** SHA-256 ***********************************/
+
+static const uint32_t K256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t H256[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                 0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                 0x1f83d9ab, 0x5be0cd19};
+
+// one SHA-256 compression over all lanes, starting from the initial state
+static void sha256_lanes(const lane32 X[16], lane32 out[8]) {
+	lane32 W[64];
+	lane32 a, b, c, d, e, f, g, h, t1, t2;
+	int j;
+
+	for (j = 0; j < 16; j++) {
+		W[j] = X[j];
+	}
+	for (j = 16; j < 64; j++) {
+		lane32 s0 = ROR(W[j - 15], 7) ^ ROR(W[j - 15], 18) ^ (W[j - 15] >> 3);
+		lane32 s1 = ROR(W[j - 2], 17) ^ ROR(W[j - 2], 19) ^ (W[j - 2] >> 10);
+		W[j] = W[j - 16] + s0 + W[j - 7] + s1;
+	}
+
+	a = BCAST(H256[0]); b = BCAST(H256[1]);
+	c = BCAST(H256[2]); d = BCAST(H256[3]);
+	e = BCAST(H256[4]); f = BCAST(H256[5]);
+	g = BCAST(H256[6]); h = BCAST(H256[7]);
+
+	for (j = 0; j < 64; j++) {
+		t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) +
+		     K256[j] + W[j];
+		t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) +
+		     ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	out[0] = a + H256[0]; out[1] = b + H256[1];
+	out[2] = c + H256[2]; out[3] = d + H256[3];
+	out[4] = e + H256[4]; out[5] = f + H256[5];
+	out[6] = g + H256[6]; out[7] = h + H256[7];
+	memzero(W, sizeof(W));
+}
+
+// pads up to MULTIBUF_LANES short messages into one transposed block
+static void sha256_load_lanes(const uint8_t *msgs, size_t msg_len,
+                              size_t stride, size_t count, lane32 X[16]) {
+	uint8_t block[64];
+	size_t l;
+	int j;
+	for (l = 0; l < MULTIBUF_LANES; l++) {
+		memset(block, 0, sizeof(block));
+		// lanes past the end hash an empty message, result is discarded
+		if (l < count) {
+			memcpy(block, msgs + l * stride, msg_len);
+			block[msg_len] = 0x80;
+			block[62] = (uint8_t)((msg_len * 8) >> 8);
+			block[63] = (uint8_t)(msg_len * 8);
+		} else {
+			block[0] = 0x80;
+		}
+		for (j = 0; j < 16; j++) {
+			LANE(X[j], l) = READ_BE32(block + 4 * j);
+		}
+	}
+	memzero(block, sizeof(block));
+}
+
+void multibuf_sha256(const uint8_t *msgs, size_t msg_len, size_t stride,
+                     size_t n, uint8_t *digests) {
+	lane32 X[16], H[8];
+	size_t i, l, count;
+	int j;
+	if (msg_len > MULTIBUF_SHA256_MAX_LENGTH) {
+		// doesn't fit into one block, hash one message at a time
+		for (i = 0; i < n; i++) {
+			sha256_Raw(msgs + i * stride, msg_len, digests + i * 32);
+		}
+		return;
+	}
+	for (i = 0; i < n; i += MULTIBUF_LANES) {
+		count = (n - i < MULTIBUF_LANES) ? (n - i) : MULTIBUF_LANES;
+		sha256_load_lanes(msgs + i * stride, msg_len, stride, count, X);
+		sha256_lanes(X, H);
+		for (l = 0; l < count; l++) {
+			uint8_t *out = digests + (i + l) * 32;
+			for (j = 0; j < 8; j++) {
+				uint32_t w = LANE(H[j], l);
+				out[4 * j] = (uint8_t)(w >> 24);
+				out[4 * j + 1] = (uint8_t)(w >> 16);
+				out[4 * j + 2] = (uint8_t)(w >> 8);
+				out[4 * j + 3] = (uint8_t)w;
+			}
+		}
+	}
+	memzero(X, sizeof(X));
+	memzero(H, sizeof(H));
+}
+
+/********************************* RIPEMD-160 *********************************/
+
+// message word selection and rotation amounts for the left and right lines
+static const uint8_t RL[80] = {
+	0, 1, 2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+	7, 4, 13, 1,  10, 6,  15, 3,  12, 0,  9,  5,  2,  14, 11, 8,
+	3, 10, 14, 4, 9,  15, 8,  1,  2,  7,  0,  6,  13, 11, 5,  12,
+	1, 9, 11, 10, 0,  8,  12, 4,  13, 3,  7,  15, 14, 5,  6,  2,
+	4, 0, 5,  9,  7,  12, 2,  10, 14, 1,  3,  8,  11, 6,  15, 13};
+static const uint8_t RR[80] = {
+	5,  14, 7,  0, 9, 2,  11, 4,  13, 6,  15, 8,  1,  10, 3,  12,
+	6,  11, 3,  7, 0, 13, 5,  10, 14, 15, 8,  12, 4,  9,  1,  2,
+	15, 5,  1,  3, 7, 14, 6,  9,  11, 8,  12, 2,  10, 0,  4,  13,
+	8,  6,  4,  1, 3, 11, 15, 0,  5,  12, 2,  13, 9,  7,  10, 14,
+	12, 15, 10, 4, 1, 5,  8,  7,  6,  2,  13, 14, 0,  3,  9,  11};
+static const uint8_t SL[80] = {
+	11, 14, 15, 12, 5,  8,  7,  9,  11, 13, 14, 15, 6,  7,  9,  8,
+	7,  6,  8,  13, 11, 9,  7,  15, 7,  12, 15, 9,  11, 7,  13, 12,
+	11, 13, 6,  7,  14, 9,  13, 15, 14, 8,  13, 6,  5,  12, 7,  5,
+	11, 12, 14, 15, 14, 15, 9,  8,  9,  14, 5,  6,  8,  6,  5,  12,
+	9,  15, 5,  11, 6,  8,  13, 12, 5,  12, 13, 14, 11, 8,  5,  6};
+static const uint8_t SR[80] = {
+	8,  9,  9,  11, 13, 15, 15, 5,  7,  7,  8,  11, 14, 14, 12, 6,
+	9,  13, 15, 7,  12, 8,  9,  11, 7,  7,  12, 7,  6,  15, 13, 11,
+	9,  7,  15, 11, 8,  6,  6,  14, 12, 13, 5,  14, 13, 13, 7,  5,
+	15, 5,  8,  11, 14, 14, 6,  14, 6,  9,  12, 9,  12, 5,  15, 8,
+	8,  5,  12, 9,  12, 5,  14, 6,  8,  13, 6,  5,  15, 13, 11, 11};
+static const uint32_t KL[5] = {0x00000000, 0x5A827999, 0x6ED9EBA1,
+                               0x8F1BBCDC, 0xA953FD4E};
+static const uint32_t KR[5] = {0x50A28BE6, 0x5C4DD124, 0x6D703EF3,
+                               0x7A6D76E9, 0x00000000};
+
+static inline lane32 rmd_f(int j, lane32 x, lane32 y, lane32 z) {
+	switch (j >> 4) {
+		case 0:
+			return x ^ y ^ z;
+		case 1:
+			return (x & y) | (~x & z);
+		case 2:
+			return (x | ~y) ^ z;
+		case 3:
+			return (x & z) | (y & ~z);
+		default:
+			return x ^ (y | ~z);
+	}
+}
+
+// one RIPEMD-160 compression over all lanes, starting from the initial state
+static void ripemd160_lanes(const lane32 X[16], lane32 out[5]) {
+	const uint32_t h0 = 0x67452301, h1 = 0xEFCDAB89, h2 = 0x98BADCFE,
+	               h3 = 0x10325476, h4 = 0xC3D2E1F0;
+	lane32 al = BCAST(h0), bl = BCAST(h1), cl = BCAST(h2), dl = BCAST(h3),
+	       el = BCAST(h4);
+	lane32 ar = al, br = bl, cr = cl, dr = dl, er = el, t;
+	int j;
+
+	for (j = 0; j < 80; j++) {
+		t = al + rmd_f(j, bl, cl, dl) + X[RL[j]] + KL[j >> 4];
+		t = ROL(t, SL[j]) + el;
+		al = el; el = dl; dl = ROL(cl, 10); cl = bl; bl = t;
+
+		t = ar + rmd_f(79 - j, br, cr, dr) + X[RR[j]] + KR[j >> 4];
+		t = ROL(t, SR[j]) + er;
+		ar = er; er = dr; dr = ROL(cr, 10); cr = br; br = t;
+	}
+
+	out[0] = cl + dr + h1;
+	out[1] = dl + er + h2;
+	out[2] = el + ar + h3;
+	out[3] = al + br + h4;
+	out[4] = bl + cr + h0;
+}
+
+// padding of a 32-byte message in words 8..15 (little endian)
+static void ripemd160_pad_32(lane32 X[16]) {
+	int j;
+	X[8] = BCAST(0x80);
+	for (j = 9; j < 16; j++) {
+		X[j] = BCAST(0);
+	}
+	X[14] = BCAST(256);
+}
+
+static void ripemd160_store_lanes(const lane32 H[5], size_t count,
+                                  uint8_t *digests) {
+	size_t l;
+	int j;
+	for (l = 0; l < count; l++) {
+		uint8_t *out = digests + l * 20;
+		for (j = 0; j < 5; j++) {
+			uint32_t w = LANE(H[j], l);
+			out[4 * j] = (uint8_t)w;
+			out[4 * j + 1] = (uint8_t)(w >> 8);
+			out[4 * j + 2] = (uint8_t)(w >> 16);
+			out[4 * j + 3] = (uint8_t)(w >> 24);
+		}
+	}
+}
+
+void multibuf_ripemd160_32(const uint8_t *msgs, size_t stride, size_t n,
+                           uint8_t *digests) {
+	lane32 X[16], H[5];
+	size_t i, l, count;
+	int j;
+	for (i = 0; i < n; i += MULTIBUF_LANES) {
+		count = (n - i < MULTIBUF_LANES) ? (n - i) : MULTIBUF_LANES;
+		for (l = 0; l < MULTIBUF_LANES; l++) {
+			// unused lanes reuse the last message
+			const uint8_t *m = msgs + (i + (l < count ? l : count - 1)) * stride;
+			for (j = 0; j < 8; j++) {
+				LANE(X[j], l) = READ_LE32(m + 4 * j);
+			}
+		}
+		ripemd160_pad_32(X);
+		ripemd160_lanes(X, H);
+		ripemd160_store_lanes(H, count, digests + i * 20);
+	}
+}
+
+/********************************** Hash-160 **********************************/
+
+void multibuf_hash160(const uint8_t *msgs, size_t msg_len, size_t stride,
+                      size_t n, uint8_t *digests) {
+	lane32 X[16], H[8], R[5];
+	size_t i, count;
+	int j;
+	if (msg_len > MULTIBUF_SHA256_MAX_LENGTH) {
+		// doesn't fit into one block, hash one message at a time
+		uint8_t h[32];
+		for (i = 0; i < n; i++) {
+			sha256_Raw(msgs + i * stride, msg_len, h);
+			ripemd160(h, 32, digests + i * 20);
+		}
+		memzero(h, sizeof(h));
+		return;
+	}
+	for (i = 0; i < n; i += MULTIBUF_LANES) {
+		count = (n - i < MULTIBUF_LANES) ? (n - i) : MULTIBUF_LANES;
+		sha256_load_lanes(msgs + i * stride, msg_len, stride, count, X);
+		sha256_lanes(X, H);
+		// sha256 words are big endian, ripemd160 reads little endian words
+		for (j = 0; j < 8; j++) {
+			X[j] = BSWAP(H[j]);
+		}
+		ripemd160_pad_32(X);
+		ripemd160_lanes(X, R);
+		ripemd160_store_lanes(R, count, digests + i * 20);
+	}
+	memzero(X, sizeof(X));
+	memzero(H, sizeof(H));
+}
+
+/********************************* SHA-512 ************************************/
+
+#if MULTIBUF_LANES64 > 1
+typedef uint64_t lane64 __attribute__((vector_size(8 * MULTIBUF_LANES64)));
+#define LANE64(v, l) ((v)[l])
+#else
+typedef uint64_t lane64;
+#define LANE64(v, l) (v)
+#endif
+
+#define BCAST64(c) ((lane64){0} + (uint64_t)(c))
+#define ROR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static const uint64_t K512[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+	0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+	0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+	0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+	0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+	0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+	0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+	0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+	0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+	0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+	0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+	0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+	0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+	0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+	0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+	0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+	0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+	0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+	0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+	0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+	0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL};
+
+// one SHA-512 compression over all lanes, starting from the same state
+static void sha512_lanes(const uint64_t state[8], const lane64 X[16], lane64 out[8]) {
+	lane64 W[80];
+	lane64 a, b, c, d, e, f, g, h, t1, t2;
+	int j;
+
+	for (j = 0; j < 16; j++) {
+		W[j] = X[j];
+	}
+	for (j = 16; j < 80; j++) {
+		lane64 s0 = ROR64(W[j - 15], 1) ^ ROR64(W[j - 15], 8) ^ (W[j - 15] >> 7);
+		lane64 s1 = ROR64(W[j - 2], 19) ^ ROR64(W[j - 2], 61) ^ (W[j - 2] >> 6);
+		W[j] = W[j - 16] + s0 + W[j - 7] + s1;
+	}
+
+	a = BCAST64(state[0]); b = BCAST64(state[1]);
+	c = BCAST64(state[2]); d = BCAST64(state[3]);
+	e = BCAST64(state[4]); f = BCAST64(state[5]);
+	g = BCAST64(state[6]); h = BCAST64(state[7]);
+
+	for (j = 0; j < 80; j++) {
+		t1 = h + (ROR64(e, 14) ^ ROR64(e, 18) ^ ROR64(e, 41)) +
+		     ((e & f) ^ (~e & g)) + K512[j] + W[j];
+		t2 = (ROR64(a, 28) ^ ROR64(a, 34) ^ ROR64(a, 39)) +
+		     ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	out[0] = a + state[0]; out[1] = b + state[1];
+	out[2] = c + state[2]; out[3] = d + state[3];
+	out[4] = e + state[4]; out[5] = f + state[5];
+	out[6] = g + state[6]; out[7] = h + state[7];
+	memzero(W, sizeof(W));
+}
+
+// HMAC-SHA512 of messages that don't fit into one block:
+// both hashes continue from the prepared pad digests with the scalar code
+static void hmac_sha512_one_by_one(const uint64_t *opad_digest,
+                                   const uint64_t *ipad_digest,
+                                   const uint8_t *msgs, size_t msg_len,
+                                   size_t stride, size_t n, uint8_t *hmacs) {
+	SHA512_CTX ctx;
+	uint8_t inner[64];
+	size_t i;
+	for (i = 0; i < n; i++) {
+		memzero(&ctx, sizeof(ctx));
+		memcpy(ctx.state, ipad_digest, sizeof(ctx.state));
+		ctx.bitcount[0] = 128 * 8;
+		sha512_Update(&ctx, msgs + i * stride, msg_len);
+		sha512_Final(&ctx, inner);
+		memzero(&ctx, sizeof(ctx));
+		memcpy(ctx.state, opad_digest, sizeof(ctx.state));
+		ctx.bitcount[0] = 128 * 8;
+		sha512_Update(&ctx, inner, sizeof(inner));
+		sha512_Final(&ctx, hmacs + i * 64);
+	}
+	memzero(&ctx, sizeof(ctx));
+	memzero(inner, sizeof(inner));
+}
+
+void multibuf_hmac_sha512(const uint64_t *opad_digest, const uint64_t *ipad_digest,
+                          const uint8_t *msgs, size_t msg_len, size_t stride,
+                          size_t n, uint8_t *hmacs) {
+	lane64 X[16], H[8];
+	uint8_t block[128];
+	size_t i, l, count;
+	int j, k;
+	// both hashes continue after one block of the padded key
+	const uint64_t inner_bits = (128 + msg_len) * 8;
+	const uint64_t outer_bits = (128 + 64) * 8;
+	if (msg_len > MULTIBUF_SHA512_MAX_LENGTH) {
+		hmac_sha512_one_by_one(opad_digest, ipad_digest, msgs, msg_len, stride, n, hmacs);
+		return;
+	}
+	for (i = 0; i < n; i += MULTIBUF_LANES64) {
+		count = (n - i < MULTIBUF_LANES64) ? (n - i) : MULTIBUF_LANES64;
+		for (l = 0; l < MULTIBUF_LANES64; l++) {
+			// unused lanes reuse the last message
+			memset(block, 0, sizeof(block));
+			memcpy(block, msgs + (i + (l < count ? l : count - 1)) * stride, msg_len);
+			block[msg_len] = 0x80;
+			block[126] = (uint8_t)(inner_bits >> 8);
+			block[127] = (uint8_t)inner_bits;
+			for (j = 0; j < 16; j++) {
+				uint64_t w = 0;
+				for (k = 0; k < 8; k++) {
+					w = (w << 8) | block[8 * j + k];
+				}
+				LANE64(X[j], l) = w;
+			}
+		}
+		sha512_lanes(ipad_digest, X, H);
+		// inner digest is the whole outer message
+		for (j = 0; j < 8; j++) {
+			X[j] = H[j];
+		}
+		X[8] = BCAST64(0x8000000000000000ULL);
+		for (j = 9; j < 15; j++) {
+			X[j] = BCAST64(0);
+		}
+		X[15] = BCAST64(outer_bits);
+		sha512_lanes(opad_digest, X, H);
+		for (l = 0; l < count; l++) {
+			uint8_t *out = hmacs + (i + l) * 64;
+			for (j = 0; j < 8; j++) {
+				uint64_t w = LANE64(H[j], l);
+				for (k = 0; k < 8; k++) {
+					out[8 * j + k] = (uint8_t)(w >> (56 - 8 * k));
+				}
+			}
+		}
+	}
+	memzero(block, sizeof(block));
+	memzero(X, sizeof(X));
+	memzero(H, sizeof(H));
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) uBitcoin contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __MULTIBUF_H__
+#define __MULTIBUF_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Multi-buffer hashing: the same compression function runs over several
+// independent messages at once, one message per SIMD lane.
+// GCC/clang vector extensions map the lanes to AVX2 (8 lanes),
+// SSE2 or NEON (4 lanes); everything else falls back to one lane.
+#if defined(__GNUC__) && defined(__AVX2__)
+#define MULTIBUF_LANES 8
+#elif defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#define MULTIBUF_LANES 4
+#else
+#define MULTIBUF_LANES 1
+#endif
+
+// SHA-512 works on 64-bit words, half as many of them fit into a register
+#if MULTIBUF_LANES > 1
+#define MULTIBUF_LANES64 (MULTIBUF_LANES / 2)
+#else
+#define MULTIBUF_LANES64 1
+#endif
+
+// messages up to this length fit into a single padded SHA-256 block,
+// longer ones are hashed one at a time with the scalar code
+#define MULTIBUF_SHA256_MAX_LENGTH 55
+// messages up to this length fit into a single padded SHA-512 block,
+// longer ones are hashed one at a time with the scalar code
+#define MULTIBUF_SHA512_MAX_LENGTH 111
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// name of the active lane backend ("avx2", "sse2", "neon" or "scalar")
+const char *multibuf_backend(void);
+
+// sha256 of n messages of msg_len bytes each, in parallel only
+// if msg_len <= MULTIBUF_SHA256_MAX_LENGTH,
+// message i starts at msgs + i*stride, digest i goes to digests + i*32
+void multibuf_sha256(const uint8_t *msgs, size_t msg_len, size_t stride,
+                     size_t n, uint8_t *digests);
+
+// ripemd160 of n messages of exactly 32 bytes (sha256 digests),
+// message i starts at msgs + i*stride, digest i goes to digests + i*20
+void multibuf_ripemd160_32(const uint8_t *msgs, size_t stride, size_t n,
+                           uint8_t *digests);
+
+// ripemd160(sha256(m)) of n messages of msg_len bytes each, in parallel
+// only if msg_len <= MULTIBUF_SHA256_MAX_LENGTH,
+// intermediate sha256 digests never leave the vector registers
+void multibuf_hash160(const uint8_t *msgs, size_t msg_len, size_t stride,
+                      size_t n, uint8_t *digests);
+
+// HMAC-SHA512 of n messages of msg_len bytes with the same key, in parallel
+// only if msg_len <= MULTIBUF_SHA512_MAX_LENGTH,
+// opad_digest and ipad_digest are from ubtc_hmac_sha512_prepare.
+// Message i starts at msgs + i*stride, hmac i goes to hmacs + i*64
+void multibuf_hmac_sha512(const uint64_t *opad_digest, const uint64_t *ipad_digest,
+                          const uint8_t *msgs, size_t msg_len, size_t stride,
+                          size_t n, uint8_t *hmacs);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif
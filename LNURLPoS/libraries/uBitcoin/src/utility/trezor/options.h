@@ -28,27 +28,148 @@
 #define USE_PRECOMPUTED_CP 1
 #endif
 
+// layout of the precomputed table: scalar_multiply splits the scalar into
+// signed digits of CP_WINDOW bits, every CP_SPACING-th digit has a table row
+// and the digits in between cost CP_WINDOW doublings each pass.
+// Table size is 72 * ceil(ceil(256 / CP_WINDOW) / CP_SPACING) * 2^(CP_WINDOW-1) bytes:
+//   CP_WINDOW 4, CP_SPACING 1 - 36 kB, 64 additions
+//   CP_WINDOW 5, CP_SPACING 4 - 15 kB, 52 additions, 15 doublings
+//   CP_WINDOW 8, CP_SPACING 1 - 295 kB, 32 additions
+//   CP_WINDOW 10, CP_SPACING 1 - 958 kB, 26 additions
+// Tables other than these two shipped ones are generated with `make table` in tests.
+#ifndef CP_WINDOW
+#if defined(ESP_PLATFORM) || defined(ARDUINO_ARCH_ESP32)
+#define CP_WINDOW 5
+#define CP_SPACING 4
+#else
+#define CP_WINDOW 4
+#endif
+#endif
+#ifndef CP_SPACING
+#define CP_SPACING 1
+#endif
+
 // use fast inverse method
 #ifndef USE_INVERSE_FAST
 #define USE_INVERSE_FAST 1
 #endif
 
+// use 4x64-bit limb arithmetic for secp256k1 field and order
+// on platforms with a 128-bit integer type (64-bit hosts)
+#ifndef USE_BN_64
+#if defined(__SIZEOF_INT128__)
+#define USE_BN_64 1
+#else
+#define USE_BN_64 0
+#endif
+#endif
+
+// constant time bn_inverse with safegcd divsteps,
+// overrides USE_INVERSE_FAST
+#ifndef USE_INVERSE_SAFEGCD
+#define USE_INVERSE_SAFEGCD 1
+#endif
+
+// ecdsa_verify_digest_batch verifies signatures in groups of this size,
+// a group takes about 1.5 kB of stack per signature
+#ifndef VERIFY_BATCH_SIZE
+#if defined(__SIZEOF_POINTER__) && __SIZEOF_POINTER__ >= 8
+#define VERIFY_BATCH_SIZE 16
+#else
+#define VERIFY_BATCH_SIZE 2
+#endif
+#endif
+
+// number of threads ecdsa_verify_digest_batch uses on unix-like hosts
+#ifndef VERIFY_BATCH_THREADS
+#define VERIFY_BATCH_THREADS 1
+#endif
+
+// widest window of point_multiply_multi, it keeps 2^w - 1 jacobian
+// points (108 bytes each) on the stack
+#ifndef MULTI_WINDOW_MAX
+#if defined(__SIZEOF_POINTER__) && __SIZEOF_POINTER__ >= 8
+#define MULTI_WINDOW_MAX 8
+#else
+#define MULTI_WINDOW_MAX 4
+#endif
+#endif
+
+// point_multiply_multi takes points in chunks of this size when it uses
+// interleaved wNAF (Strauss), about 2 kB of stack per point
+#ifndef MULTI_STRAUSS_MAX
+#if defined(__SIZEOF_POINTER__) && __SIZEOF_POINTER__ >= 8
+#define MULTI_STRAUSS_MAX 16
+#else
+#define MULTI_STRAUSS_MAX 2
+#endif
+#endif
+
+// bip340_verify_batch checks signatures in groups of this size,
+// a group takes about 220 bytes of stack per signature
+#ifndef SCHNORR_BATCH_SIZE
+#if defined(__SIZEOF_POINTER__) && __SIZEOF_POINTER__ >= 8
+#define SCHNORR_BATCH_SIZE 256
+#else
+#define SCHNORR_BATCH_SIZE 8
+#endif
+#endif
+
 // support for printing bignum256 structures via printf
 #ifndef USE_BN_PRINT
 #define USE_BN_PRINT 0
 #endif
 
+// use ChaCha20 DRBG for random_buffer() and random32(), seeded from
+// esp_random() on ESP32, getrandom() or /dev/urandom on unix-like hosts
+#ifndef USE_CHACHA_DRBG
+#define USE_CHACHA_DRBG 1
+#endif
+
+// reseed the DRBG from the entropy source after this many bytes
+#ifndef RANDOM_RESEED_INTERVAL
+#define RANDOM_RESEED_INTERVAL (1024 * 1024)
+#endif
+
 // use deterministic signatures
 #ifndef USE_RFC6979
 #define USE_RFC6979 1
 #endif
 
-// implement BIP32 caching
+// HDPublicKey::deriveRange computes child keys in groups of this size
+// sharing field inversions within a group, about 200 bytes of stack per key
+#ifndef DERIVE_BATCH_SIZE
+#if defined(__SIZEOF_POINTER__) && __SIZEOF_POINTER__ >= 8
+#define DERIVE_BATCH_SIZE 64
+#else
+#define DERIVE_BATCH_SIZE 8
+#endif
+#endif
+
+// number of threads HDPublicKey::deriveRange uses on unix-like hosts
+#ifndef DERIVE_THREADS
+#define DERIVE_THREADS 1
+#endif
+
+// implement BIP32 caching: HDPublicKey::derive keeps up to
+// BIP32_CACHE_SIZE intermediate keys, paths longer than
+// BIP32_CACHE_MAXDEPTH are not cached
 #ifndef USE_BIP32_CACHE
 #define USE_BIP32_CACHE 1
+#endif
+#ifndef BIP32_CACHE_SIZE
 #define BIP32_CACHE_SIZE 10
+#endif
+#ifndef BIP32_CACHE_MAXDEPTH
 #define BIP32_CACHE_MAXDEPTH 8
 #endif
+// cache intermediate keys of HDPrivateKey::derive too (about 350 bytes
+// per key), off by default: secrets stay in RAM until
+// clearDerivationCache() is called
+#if !defined(USE_BIP32_PRIVATE_CACHE) || !USE_BIP32_CACHE
+#undef USE_BIP32_PRIVATE_CACHE
+#define USE_BIP32_PRIVATE_CACHE 0
+#endif
 
 // support constructing BIP32 nodes from ed25519 and curve25519 curves.
 #ifndef USE_BIP32_25519_CURVES
@@ -23,8 +23,33 @@
 
 #include "rand.h"
 #include "sha2.h"
+#include "options.h"
 #include <string.h>
 
+#if USE_CHACHA_DRBG
+#include "chacha_drbg.h"
+#include "memzero.h"
+
+#if defined(ESP_PLATFORM) || defined(ARDUINO_ARCH_ESP32)
+// hardware RNG, true random while WiFi or BT are running
+uint32_t esp_random(void);
+#define RAND_ESP32 1
+#elif defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/random.h>)
+#include <sys/random.h>
+#define RAND_GETRANDOM 1
+#endif
+#endif
+#define RAND_POSIX 1
+#endif
+
+#endif // USE_CHACHA_DRBG
+
 // #ifndef RAND_PLATFORM_INDEPENDENT
 
 static uint32_t seed = 0;
@@ -37,6 +62,9 @@ static uint8_t hash[32];
  * This is a junky-code that may be not perfect
  * but works much better than normal non-cryptographic PRNGs
  * 
+ * With USE_CHACHA_DRBG it is only used as a last resort entropy
+ * on platforms without esp_random(), getrandom() or /dev/urandom.
+ * 
  * Replace the random32() function with your own secure code.
  * There is also a possibility to replace the random_buffer() function 
  * as it is defined as a weak symbol.
@@ -53,6 +81,199 @@ static void init_ram_seed(){
 	seed++;
 }
 
+#if USE_CHACHA_DRBG
+
+static random_entropy_source entropy_source = NULL;
+
+#if RAND_POSIX
+// every thread gets its own generator, so no locking is needed
+#define RAND_TLS __thread
+#else
+// one generator shared by all tasks, used under rand_lock()
+#define RAND_TLS
+#endif
+
+#if RAND_ESP32
+#include <sys/lock.h>
+// newlib lock of ESP-IDF, initialized on first use
+static _lock_t rand_mutex;
+static inline void rand_lock(void) { _lock_acquire(&rand_mutex); }
+static inline void rand_unlock(void) { _lock_release(&rand_mutex); }
+#else
+// thread-local state on POSIX, single-threaded targets otherwise
+static inline void rand_lock(void) {}
+static inline void rand_unlock(void) {}
+#endif
+
+static RAND_TLS CHACHA_DRBG_CTX drbg;
+// reseed_epoch at the time drbg was seeded, 0 if not seeded yet
+static RAND_TLS uint32_t drbg_generation = 0;
+// incremented in the child after fork() and when the entropy source
+// changes, so every generator reseeds before its next output
+static uint32_t reseed_epoch = 1;
+
+static inline uint32_t rand_epoch(void) {
+	return __atomic_load_n(&reseed_epoch, __ATOMIC_ACQUIRE);
+}
+
+static inline void rand_new_epoch(void) {
+	__atomic_add_fetch(&reseed_epoch, 1, __ATOMIC_ACQ_REL);
+}
+
+#if RAND_POSIX
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+static void rand_atfork_child(void) {
+	rand_new_epoch();
+}
+
+static void rand_register_atfork(void) {
+	pthread_atfork(NULL, NULL, rand_atfork_child);
+}
+#endif
+
+static int system_entropy(uint8_t *buf, size_t len) {
+#if RAND_ESP32
+	while (len > 0) {
+		uint32_t r = esp_random();
+		size_t n = len < sizeof(r) ? len : sizeof(r);
+		memcpy(buf, &r, n);
+		buf += n;
+		len -= n;
+	}
+	return 0;
+#elif RAND_POSIX
+#if RAND_GETRANDOM
+	while (len > 0) {
+		ssize_t r = getrandom(buf, len, 0);
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		buf += r;
+		len -= r;
+	}
+	if (len == 0) {
+		return 0;
+	}
+#endif
+	int fd = open("/dev/urandom", O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	while (len > 0) {
+		ssize_t r = read(fd, buf, len);
+		if (r <= 0) {
+			if (r < 0 && errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		buf += r;
+		len -= r;
+	}
+	close(fd);
+	return len == 0 ? 0 : -1;
+#else
+	(void)buf;
+	(void)len;
+	return -1;
+#endif
+}
+
+// seeds or reseeds drbg for the given reseed_epoch, call under rand_lock()
+static void drbg_seed(uint32_t epoch) {
+	uint8_t entropy[32 + sizeof(seed)];
+	int res = -1;
+#if RAND_POSIX
+	pthread_once(&atfork_once, rand_register_atfork);
+#endif
+	random_entropy_source source = __atomic_load_n(&entropy_source, __ATOMIC_ACQUIRE);
+	if (source != NULL) {
+		res = source(entropy, 32);
+	}
+	if (res != 0) {
+		res = system_entropy(entropy, 32);
+	}
+	if (res != 0) {
+		init_ram_seed();
+		memcpy(entropy, hash, 32);
+	}
+	// value passed to random_reseed()
+	uint32_t value = __atomic_load_n(&seed, __ATOMIC_RELAXED);
+	memcpy(entropy + 32, &value, sizeof(value));
+	if (drbg_generation == 0) {
+		chacha_drbg_init(&drbg, entropy, sizeof(entropy));
+	} else {
+		chacha_drbg_reseed(&drbg, entropy, sizeof(entropy));
+	}
+	drbg_generation = epoch;
+	memzero(entropy, sizeof(entropy));
+}
+
+void random_set_entropy_source(random_entropy_source source) {
+	__atomic_store_n(&entropy_source, source, __ATOMIC_RELEASE);
+	// generators of all threads reseed from the new source
+	rand_new_epoch();
+}
+
+// call under rand_lock()
+static void drbg_add_entropy(const uint8_t *buf, size_t len) {
+	uint32_t epoch = rand_epoch();
+	if (drbg_generation != epoch) {
+		drbg_seed(epoch);
+	}
+	chacha_drbg_reseed(&drbg, buf, len);
+}
+
+void random_add_entropy(const uint8_t *buf, size_t len) {
+	rand_lock();
+	drbg_add_entropy(buf, len);
+	rand_unlock();
+}
+
+void random_reseed(const uint32_t value)
+{
+	rand_lock();
+	__atomic_store_n(&seed, value, __ATOMIC_RELAXED);
+	drbg_add_entropy((const uint8_t *)&value, sizeof(value));
+	rand_unlock();
+}
+
+uint32_t __attribute__((weak)) random32(void){
+	uint32_t r;
+	random_buffer((uint8_t *)&r, sizeof(r));
+	return r;
+}
+
+void __attribute__((weak)) random_buffer(uint8_t *buf, size_t len)
+{
+	rand_lock();
+	uint32_t epoch = rand_epoch();
+	if (drbg_generation != epoch ||
+	    drbg.generated >= RANDOM_RESEED_INTERVAL) {
+		drbg_seed(epoch);
+	}
+	chacha_drbg_generate(&drbg, buf, len);
+	rand_unlock();
+}
+
+#else // USE_CHACHA_DRBG
+
+void random_set_entropy_source(random_entropy_source source) {
+	(void)source;
+}
+
+void random_add_entropy(const uint8_t *buf, size_t len) {
+	SHA256_CTX	context;
+	sha256_Init(&context);
+	sha256_Update(&context, hash, 32);
+	sha256_Update(&context, buf, len);
+	sha256_Final(&context, hash);
+}
+
 void random_reseed(const uint32_t value)
 {
 	seed = value;
@@ -89,6 +310,8 @@ void __attribute__((weak)) random_buffer(uint8_t *buf, size_t len)
 	}
 }
 
+#endif // USE_CHACHA_DRBG
+
 uint32_t random_uniform(uint32_t n)
 {
 	uint32_t x, max = 0xFFFFFFFF - (0xFFFFFFFF % n);
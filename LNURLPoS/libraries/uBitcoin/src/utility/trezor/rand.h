@@ -32,6 +32,15 @@ extern "C"
 {
 #endif
 
+// entropy source callback, fills buf with len bytes, returns 0 on success
+typedef int (*random_entropy_source)(uint8_t *buf, size_t len);
+
+// replaces platform entropy (esp_random, getrandom, /dev/urandom)
+// used to seed and periodically reseed the generator
+void random_set_entropy_source(random_entropy_source source);
+// mixes additional entropy into the generator
+void random_add_entropy(const uint8_t *buf, size_t len);
+
 void random_reseed(const uint32_t value);
 uint32_t random32(void);
 void random_buffer(uint8_t *buf, size_t len);
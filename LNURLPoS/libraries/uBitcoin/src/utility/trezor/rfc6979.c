@@ -27,44 +27,128 @@
 #include "hmac.h"
 #include "memzero.h"
 
-void init_rfc6979(const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *state) {
-	uint8_t bx[2*32];
-	uint8_t buf[32 + 1 + 2*32];
+// HMAC-SHA256 keys are kept as the midstates of H(K ^ ipad) and H(K ^ opad),
+// so every HMAC of a short message costs two compressions instead of four.
 
-	memcpy(bx, priv_key, 32);
-	memcpy(bx+32, hash, 32);
+// continues the inner hash of HMAC from the ipad midstate
+static void hmac_inner_init(SHA256_CTX *ctx, const uint32_t ipad[8])
+{
+	memcpy(ctx->state, ipad, sizeof(ctx->state));
+	ctx->bitcount = SHA256_BLOCK_LENGTH * 8;
+}
+
+// out = H(K ^ opad || inner), ctx holds the unfinished inner hash
+static void hmac_final(SHA256_CTX *ctx, const uint32_t opad[8], uint8_t out[32])
+{
+	uint8_t inner[32];
+	sha256_Final(ctx, inner);
+	memcpy(ctx->state, opad, sizeof(ctx->state));
+	ctx->bitcount = SHA256_BLOCK_LENGTH * 8;
+	sha256_Update(ctx, inner, sizeof(inner));
+	sha256_Final(ctx, out);
+	memzero(inner, sizeof(inner));
+}
+
+static void set_k(rfc6979_state *state, const uint8_t k[32])
+{
+	ubtc_hmac_sha256_prepare(k, 32, state->k_opad, state->k_ipad);
+}
+
+// V = HMAC(K, V)
+static void update_v(rfc6979_state *state)
+{
+	SHA256_CTX ctx;
+	hmac_inner_init(&ctx, state->k_ipad);
+	sha256_Update(&ctx, state->v, sizeof(state->v));
+	hmac_final(&ctx, state->k_opad, state->v);
+}
+
+// K = HMAC(K, V || sep || priv_key || hash), priv_key and hash are optional
+static void update_k(rfc6979_state *state, uint8_t sep, const uint8_t *priv_key, const uint8_t *hash)
+{
+	SHA256_CTX ctx;
+	uint8_t k[32];
+	hmac_inner_init(&ctx, state->k_ipad);
+	sha256_Update(&ctx, state->v, sizeof(state->v));
+	sha256_Update(&ctx, &sep, 1);
+	if (priv_key != NULL) {
+		sha256_Update(&ctx, priv_key, 32);
+		sha256_Update(&ctx, hash, 32);
+	}
+	hmac_final(&ctx, state->k_opad, k);
+	set_k(state, k);
+	memzero(k, sizeof(k));
+}
+
+void init_rfc6979_key(const uint8_t *priv_key, rfc6979_key *key)
+{
+	uint8_t buf[32 + 1];
+	uint32_t ipad[8];
+
+	// first K is all zeros, first V is all ones
+	memset(buf, 0, 32);
+	ubtc_hmac_sha256_prepare(buf, 32, key->k0_opad, ipad);
+	memset(buf, 1, 32);
+	buf[32] = 0x00;
+	// everything up to the hash depends only on the private key
+	hmac_inner_init(&key->prefix, ipad);
+	sha256_Update(&key->prefix, buf, sizeof(buf));
+	sha256_Update(&key->prefix, priv_key, 32);
+	memcpy(key->priv_key, priv_key, 32);
+
+	memzero(ipad, sizeof(ipad));
+}
+
+void init_rfc6979_digest(const rfc6979_key *key, const uint8_t *hash, rfc6979_state *state)
+{
+	SHA256_CTX ctx;
+	uint8_t k[32];
 
+	// K = HMAC(0, 1...1 || 0x00 || priv_key || hash)
+	memcpy(&ctx, &key->prefix, sizeof(ctx));
+	sha256_Update(&ctx, hash, 32);
+	hmac_final(&ctx, key->k0_opad, k);
+	set_k(state, k);
 	memset(state->v, 1, sizeof(state->v));
-	memset(state->k, 0, sizeof(state->k));
+	update_v(state);
+	// K = HMAC(K, V || 0x01 || priv_key || hash)
+	update_k(state, 0x01, key->priv_key, hash);
+	update_v(state);
+	state->pending = 0;
 
-	memcpy(buf, state->v, sizeof(state->v));
-	buf[sizeof(state->v)] = 0x00;
-	memcpy(buf + sizeof(state->v) + 1, bx, 64);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), buf, sizeof(buf), state->k);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), state->v, sizeof(state->v), state->v);
+	memzero(k, sizeof(k));
+}
 
-	memcpy(buf, state->v, sizeof(state->v));
-	buf[sizeof(state->v)] = 0x01;
-	memcpy(buf + sizeof(state->v) + 1, bx, 64);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), buf, sizeof(buf), state->k);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), state->v, sizeof(state->v), state->v);
+void init_rfc6979(const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *state)
+{
+	rfc6979_key key;
+	init_rfc6979_key(priv_key, &key);
+	init_rfc6979_digest(&key, hash, state);
+	memzero(&key, sizeof(key));
+}
 
-	memzero(bx, sizeof(bx));
-	memzero(buf, sizeof(buf));
+void init_rfc6979_batch(const uint8_t *priv_key, const uint8_t *hashes, size_t n, rfc6979_state *states)
+{
+	rfc6979_key key;
+	init_rfc6979_key(priv_key, &key);
+	for (size_t i = 0; i < n; i++) {
+		init_rfc6979_digest(&key, hashes + 32 * i, states + i);
+	}
+	memzero(&key, sizeof(key));
 }
 
 // generate next number from deterministic random number generator
 void generate_rfc6979(uint8_t rnd[32], rfc6979_state *state)
 {
-	uint8_t buf[32 + 1];
-
-	ubtc_hmac_sha256(state->k, sizeof(state->k), state->v, sizeof(state->v), state->v);
-	memcpy(buf, state->v, sizeof(state->v));
-	buf[sizeof(state->v)] = 0x00;
-	ubtc_hmac_sha256(state->k, sizeof(state->k), buf, sizeof(state->v) + 1, state->k);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), state->v, sizeof(state->v), state->v);
-	memcpy(rnd, buf, 32);
-	memzero(buf, sizeof(buf));
+	// K = HMAC(K, V || 0x00), V = HMAC(K, V) only happens if the
+	// previous number was rejected, most signatures never need it
+	if (state->pending) {
+		update_k(state, 0x00, NULL, NULL);
+		update_v(state);
+	}
+	update_v(state);
+	memcpy(rnd, state->v, sizeof(state->v));
+	state->pending = 1;
 }
 
 // generate K in a deterministic way, according to RFC6979
@@ -26,19 +26,35 @@
 #define __RFC6979_H__
 
 #include <stdint.h>
+#include <stddef.h>
 #include "bignum.h"
+#include "sha2.h"
 
-// rfc6979 pseudo random number generator state
+// rfc6979 pseudo random number generator state,
+// K is stored as precomputed HMAC inner and outer midstates
 typedef struct {
-	uint8_t v[32], k[32];
+	uint32_t k_ipad[8], k_opad[8];
+	uint8_t v[32];
+	int pending; // K and V are updated before the next number
 } rfc6979_state;
 
+// per private key part of the generator, shared by all digests signed with it
+typedef struct {
+	SHA256_CTX prefix; // HMAC inner hash over 1...1 || 0x00 || priv_key
+	uint32_t k0_opad[8];
+	uint8_t priv_key[32];
+} rfc6979_key;
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
 void init_rfc6979(const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *rng);
+void init_rfc6979_key(const uint8_t *priv_key, rfc6979_key *key);
+void init_rfc6979_digest(const rfc6979_key *key, const uint8_t *hash, rfc6979_state *rng);
+// initializes n generators for n 32-byte hashes signed with the same key
+void init_rfc6979_batch(const uint8_t *priv_key, const uint8_t *hashes, size_t n, rfc6979_state *rngs);
 void generate_rfc6979(uint8_t rnd[32], rfc6979_state *rng);
 void generate_k_rfc6979(bignum256 *k, rfc6979_state *rng);
 
@@ -23,6 +23,39 @@
 
 #include "secp256k1.h"
 
+#if USE_PRECOMPUTED_CP && !defined(CP_TABLE_FILE)
+#if CP_WINDOW == 4 && CP_SPACING == 1
+#define CP_TABLE_FILE "secp256k1.table"
+#else
+// secp256k1_w<CP_WINDOW>_s<CP_SPACING>.table
+#define CP_TABLE_STR(name) #name
+#define CP_TABLE_NAME(w, s) CP_TABLE_STR(secp256k1_w ## w ## _s ## s.table)
+#define CP_TABLE_XNAME(w, s) CP_TABLE_NAME(w, s)
+#define CP_TABLE_FILE CP_TABLE_XNAME(CP_WINDOW, CP_SPACING)
+#endif
+#endif
+
+static const ecdsa_glv secp256k1_glv = {
+	/* .beta */ {
+		/*.val =*/ {0x319501ee, 0x4e5b0a1, 0x2f58995c, 0x3c125d44, 0x3434e99c, 0x111e7ab0, 0x7106e6, 0x1a8ad95f, 0x7ae9}
+	},
+	/* .lambda */ {
+		/*.val =*/ {0x1b23bd72, 0x3c0a59f0, 0x816678d, 0xb88ba88, 0x12645a12, 0x18700a20, 0x30e0a52, 0x2b533017, 0x5363}
+	},
+	/* .minus_b1 */ {
+		/*.val =*/ {0xabfe4c3, 0x3d51fea4, 0x10e88286, 0x10dfb580, 0xe4}
+	},
+	/* .minus_b2 */ {
+		/*.val =*/ {0x3db1562c, 0x1d9736a0, 0x374346dd, 0xa02b141, 0x3ffffe8a, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0xffff}
+	},
+	/* .g1 */ {
+		/*.val =*/ {0x5dbb031, 0x224c8269, 0x1e8ca7fe, 0x2aa2851c, 0x4eb153d, 0x3243924a, 0x6bcde86, 0x348869f5, 0x3086}
+	},
+	/* .g2 */ {
+		/*.val =*/ {0xac47f71, 0x15c6d2ba, 0x1f506c61, 0x4822b27, 0x3fe4c422, 0x11fea42a, 0x288286f5, 0x1fb58043, 0xe443}
+	}
+};
+
 const ecdsa_curve secp256k1 = {
 	/* .prime */ {
 		/*.val =*/ {0x3ffffc2f, 0x3ffffffb, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0xffff}
@@ -45,12 +78,14 @@ const ecdsa_curve secp256k1 = {
 
 	/* b */ {
 		/*.val =*/{7}
-	}
+	},
+
+	/* glv */ &secp256k1_glv
 
 #if USE_PRECOMPUTED_CP
 	,
 	/* cp */ {
-#include "secp256k1.table"
+#include CP_TABLE_FILE
 	}
 #endif
 };
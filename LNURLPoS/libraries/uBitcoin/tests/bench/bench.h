@@ -0,0 +1,221 @@
+// Minimal benchmark harness shared by all tests/bench/*.cpp programs.
+//
+// Every benchmark binary accepts:
+//   --json             print results as JSON (one result per line)
+//   --baseline FILE    compare against JSON saved from a previous run
+//   --threshold PCT    allowed slowdown vs baseline before failing (default 10)
+//   --min-time SEC     minimum measuring time per case (default 0.1)
+//   --filter STR       only run cases whose name contains STR
+//
+// Save a baseline with `make bench BENCH_ARGS=--json > baseline.json`
+// and compare later with `make bench BENCH_ARGS="--baseline baseline.json"`.
+// With --json the comparison is added to every result and the exit
+// code is non-zero on a regression, same as for the text output.
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <map>
+#include "utility/trezor/multibuf.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/** \brief CPU cycle counter (TSC on x86, virtual counter on aarch64), 0 if unavailable */
+static inline uint64_t bench_cycles(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return 0;
+#endif
+}
+
+static inline double bench_seconds(){
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** \brief keeps the compiler from optimising benchmarked results away */
+static inline void bench_use(const void * p){
+    asm volatile("" : : "r"(p) : "memory");
+}
+
+class Bench{
+public:
+    Bench(const char * suite, int argc, char ** argv):
+        suite(suite), json(false), minTime(0.1), threshold(10), filter(""), failed(0){
+        const char * baselineFile = NULL;
+        for(int i=1; i<argc; i++){
+            if(strcmp(argv[i], "--json") == 0){
+                json = true;
+            }else if(strcmp(argv[i], "--baseline") == 0 && i+1 < argc){
+                baselineFile = argv[++i];
+            }else if(strcmp(argv[i], "--threshold") == 0 && i+1 < argc){
+                threshold = atof(argv[++i]);
+            }else if(strcmp(argv[i], "--min-time") == 0 && i+1 < argc){
+                minTime = atof(argv[++i]);
+            }else if(strcmp(argv[i], "--filter") == 0 && i+1 < argc){
+                filter = argv[++i];
+            }
+        }
+        if(baselineFile != NULL){
+            loadBaseline(baselineFile);
+        }
+        if(json){
+            printf("{\"suite\":\"%s\",\"backend\":\"%s\",\"lanes\":%d,\"compiler\":\"%s\",\"optimized\":%s,\"results\":[\n",
+                suite, backend(), MULTIBUF_LANES, __VERSION__, optimized() ? "true" : "false");
+        }else{
+            printf("%s: backend %s (%d lanes), %s build\n", suite, backend(), MULTIBUF_LANES,
+                optimized() ? "optimized" : "unoptimized");
+            if(bench_cycles() == 0){
+                printf("  no cycle counter on this platform, cycles are not reported\n");
+            }
+        }
+    }
+    /** \brief active hashing backend */
+    static const char * backend(){ return multibuf_backend(); }
+    static bool optimized(){
+#ifdef __OPTIMIZE__
+        return true;
+#else
+        return false;
+#endif
+    }
+    /** \brief runs fn() repeatedly for at least minTime seconds.
+     *         bytes is the amount of data processed by one call (0 if not applicable) */
+    template<typename F>
+    void run(const std::string &name, size_t bytes, F fn){
+        last = 0;
+        if(name.find(filter) == std::string::npos){
+            return;
+        }
+        fn(); // warm up
+        uint64_t ops = 0;
+        uint64_t batch = 1;
+        double start = bench_seconds();
+        uint64_t c0 = bench_cycles();
+        double elapsed = 0;
+        while(elapsed < minTime){
+            for(uint64_t i=0; i<batch; i++){
+                fn();
+            }
+            ops += batch;
+            batch *= 2;
+            elapsed = bench_seconds() - start;
+        }
+        uint64_t cycles = bench_cycles() - c0;
+        double opsPerSec = ops / elapsed;
+        double cyclesPerOp = (double)cycles / ops;
+        last = opsPerSec;
+        report(name, bytes, opsPerSec, cyclesPerOp);
+    }
+    /** \brief ops/s of the last run() case, 0 if it was filtered out */
+    double lastOpsPerSec() const{ return last; }
+    /** \brief true if results are printed as JSON, extra output would break it */
+    bool jsonOutput() const{ return json; }
+    /** \brief finishes the report, returns process exit code */
+    int finish(){
+        if(json){
+            printf("]}\n");
+        }
+        if(!baseline.empty()){
+            // stderr in JSON mode to keep stdout parseable
+            fprintf(json ? stderr : stdout, "%s: %d case(s) slower than baseline by more than %.0f%%\n", suite, failed, threshold);
+        }
+        return failed > 0 ? 1 : 0;
+    }
+private:
+    const char * suite;
+    bool json;
+    double minTime;
+    double threshold;
+    std::string filter;
+    int failed;
+    size_t count = 0;
+    double last = 0;
+    std::map<std::string, double> baseline;
+
+    void report(const std::string &name, size_t bytes, double opsPerSec, double cyclesPerOp){
+        double cpb = bytes > 0 ? cyclesPerOp / bytes : cyclesPerOp;
+        // baseline check is the same for both output formats
+        bool hasBaseline = false;
+        bool regression = false;
+        double change = 0;
+        std::map<std::string, double>::iterator it = baseline.find(std::string(suite) + "/" + name);
+        if(it != baseline.end() && it->second > 0){
+            hasBaseline = true;
+            change = 100.0 * (opsPerSec / it->second - 1);
+            if(change < -threshold){
+                regression = true;
+                failed++;
+            }
+        }
+        if(json){
+            printf("%s{\"suite\":\"%s\",\"name\":\"%s\",\"bytes\":%zu,\"ops_per_sec\":%.3f,\"cycles_per_op\":%.1f,\"cycles_per_byte\":%.3f",
+                count > 0 ? "," : "", suite, name.c_str(), bytes, opsPerSec, cyclesPerOp, bytes > 0 ? cpb : 0.0);
+            if(hasBaseline){
+                printf(",\"baseline_change\":%.1f,\"regression\":%s", change, regression ? "true" : "false");
+            }
+            printf("}\n");
+        }else{
+            printf("  %-36s %14.1f ops/s", name.c_str(), opsPerSec);
+            if(bench_cycles() != 0){
+                if(bytes > 0){
+                    printf(" %10.2f cycles/byte", cpb);
+                }else{
+                    printf(" %10.0f cycles/op  ", cyclesPerOp);
+                }
+            }
+            if(hasBaseline){
+                printf("  %+6.1f%% vs baseline", change);
+                if(regression){
+                    printf(" REGRESSION");
+                }
+            }
+            printf("\n");
+        }
+        count++;
+    }
+    // reads "suite", "name" and "ops_per_sec" fields from our own JSON output
+    static bool field(const char * line, const char * key, char * out, size_t outLen){
+        char pattern[32];
+        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+        const char * p = strstr(line, pattern);
+        if(p == NULL){ return false; }
+        p += strlen(pattern);
+        if(*p == '"'){ p++; }
+        size_t len = strcspn(p, "\",}");
+        if(len >= outLen){ return false; }
+        memcpy(out, p, len);
+        out[len] = 0;
+        return true;
+    }
+    void loadBaseline(const char * filename){
+        FILE * f = fopen(filename, "r");
+        if(f == NULL){
+            printf("can't open baseline %s\n", filename);
+            exit(2);
+        }
+        char line[512];
+        char s[64], n[128], ops[64];
+        while(fgets(line, sizeof(line), f) != NULL){
+            if(field(line, "name", n, sizeof(n)) && field(line, "suite", s, sizeof(s)) &&
+               field(line, "ops_per_sec", ops, sizeof(ops))){
+                baseline[std::string(s) + "/" + n] = atof(ops);
+            }
+        }
+        fclose(f);
+    }
+};
+
+#endif // __BENCH_H__
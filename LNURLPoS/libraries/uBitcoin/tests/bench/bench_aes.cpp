@@ -0,0 +1,35 @@
+// Payload cipher throughput: AES-CTR on every available backend and ChaCha20.
+#include "bench.h"
+#include "utility/trezor/aes_ctr.h"
+#include "utility/trezor/chacha_drbg.h"
+
+#define MAX_SIZE 16384
+
+int main(int argc, char ** argv){
+  Bench b("aes", argc, argv);
+  static uint8_t data[MAX_SIZE];
+  uint8_t key[32] = { 1 };
+  uint8_t iv[16] = { 0 };
+  uint8_t nonce[12] = { 0 };
+  const size_t sizes[] = { 64, 1024, MAX_SIZE };
+  const int backends[] = { AES_BACKEND_PORTABLE, AES_BACKEND_AESNI, AES_BACKEND_ESP32 };
+
+  for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++){
+    size_t len = sizes[i];
+    std::string sz = "/" + std::to_string(len);
+    for(size_t j=0; j<sizeof(backends)/sizeof(backends[0]); j++){
+      AES_CTX ctx;
+      if(aes_init_backend(&ctx, key, sizeof(key), backends[j]) != 0){
+        continue;
+      }
+      b.run(std::string("aes256_ctr/") + aes_backend_name(backends[j]) + sz, len, [&]{
+        aes_ctr_xor(&ctx, iv, data, len);
+        bench_use(data);
+      });
+    }
+    b.run("chacha20" + sz, len, [&]{ chacha20_xor(key, nonce, 0, data, len); bench_use(data); });
+  }
+  AES_CTX ctx;
+  b.run("aes256_init/best", 0, [&]{ aes_init(&ctx, key, sizeof(key)); bench_use(&ctx); });
+  return b.finish();
+}
@@ -0,0 +1,90 @@
+// Field and scalar arithmetic on secp256k1 and the point operations built on it.
+#include "bench.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+
+static void random_bn(bignum256 * x, const bignum256 * prime){
+  uint8_t buf[32];
+  for(size_t i=0; i<sizeof(buf); i++){
+    buf[i] = rand();
+  }
+  bn_read_be(buf, x);
+  bn_fast_mod(x, prime);
+  bn_mod(x, prime);
+}
+
+int main(int argc, char ** argv){
+  Bench b("bignum", argc, argv);
+  const bignum256 * p = &secp256k1.prime;
+  const bignum256 * n = &secp256k1.order;
+  bignum256 x, y;
+
+  random_bn(&x, p);
+  random_bn(&y, p);
+  b.run("bn_multiply/p", 0, [&]{
+    bn_multiply(&y, &x, p);
+    bench_use(&x);
+  });
+  random_bn(&x, n);
+  random_bn(&y, n);
+  b.run("bn_multiply/n", 0, [&]{
+    bn_multiply(&y, &x, n);
+    bench_use(&x);
+  });
+  random_bn(&x, p);
+  b.run("bn_inverse/p", 0, [&]{
+    bn_inverse(&x, p);
+    bench_use(&x);
+  });
+  random_bn(&x, n);
+  b.run("bn_inverse/n", 0, [&]{
+    bn_inverse(&x, n);
+    bench_use(&x);
+  });
+  random_bn(&x, p);
+  b.run("bn_sqrt/p", 0, [&]{
+    bn_sqrt(&x, p);
+    bench_use(&x);
+  });
+
+  uint8_t priv[32], digest[32], pub[65], sig[64];
+  for(int i=0; i<32; i++){
+    priv[i] = rand();
+    digest[i] = rand();
+  }
+  priv[0] &= 0x7F;
+  ecdsa_get_public_key65(&secp256k1, priv, pub);
+  ecdsa_sign_digest(&secp256k1, priv, digest, sig, NULL, NULL);
+  b.run("ecdsa_get_public_key33", 0, [&]{
+    ecdsa_get_public_key33(&secp256k1, priv, pub);
+    bench_use(pub);
+  });
+  ecdsa_get_public_key65(&secp256k1, priv, pub);
+  b.run("ecdsa_sign_digest", 0, [&]{
+    ecdsa_sign_digest(&secp256k1, priv, digest, sig, NULL, NULL);
+    bench_use(sig);
+  });
+  curve_point pt;
+  bignum256 k;
+  ecdsa_read_pubkey(&secp256k1, pub, &pt);
+  random_bn(&k, n);
+  b.run("point_multiply", 0, [&]{
+    curve_point r;
+    point_multiply(&secp256k1, &k, &pt, &r);
+    bench_use(&r);
+  });
+  // generic path of curves without an endomorphism
+  ecdsa_curve nog = secp256k1;
+  nog.glv = NULL;
+  b.run("point_multiply/no-glv", 0, [&]{
+    curve_point r;
+    point_multiply(&nog, &k, &pt, &r);
+    bench_use(&r);
+  });
+  b.run("ecdsa_verify_digest", 0, [&]{
+    int res = ecdsa_verify_digest(&secp256k1, pub, sig, digest);
+    bench_use(&res);
+  });
+  return b.finish();
+}
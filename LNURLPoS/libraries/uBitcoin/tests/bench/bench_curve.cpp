@@ -0,0 +1,52 @@
+// ECScalar / ECPoint operator chains from BitcoinCurve.h,
+// compare with the bignum256 / curve_point cases in bench_bignum.
+#include "bench.h"
+#include "BitcoinCurve.h"
+
+static ECScalar random_scalar(){
+  uint8_t buf[32];
+  for(size_t i=0; i<sizeof(buf); i++){
+    buf[i] = rand();
+  }
+  buf[0] &= 0x7F;
+  return ECScalar(buf, 32);
+}
+
+int main(int argc, char ** argv){
+  Bench b("curve", argc, argv);
+  ECScalar a = random_scalar();
+  ECScalar c = random_scalar();
+  ECScalar d = random_scalar();
+  ECPoint p = random_scalar() * GeneratorPoint;
+  ECPoint q = random_scalar() * GeneratorPoint;
+
+  b.run("a*b+c", 0, [&]{
+    ECScalar r = a*d + c;
+    bench_use(&r);
+  });
+  b.run("(a*b+c)*(a-c)/b", 0, [&]{
+    ECScalar r = (a*d + c) * (a - c) / d;
+    bench_use(&r);
+  });
+  b.run("(a*b+c)*G", 0, [&]{
+    ECPoint r = (a*d + c) * GeneratorPoint;
+    bench_use(&r);
+  });
+  b.run("P+Q", 0, [&]{
+    ECPoint r = p + q;
+    bench_use(&r);
+  });
+  b.run("P-Q", 0, [&]{
+    ECPoint r = p - q;
+    bench_use(&r);
+  });
+  b.run("a*P+c*Q", 0, [&]{
+    ECPoint r = a*p + c*q;
+    bench_use(&r);
+  });
+  b.run("P.isValid", 0, [&]{
+    bool r = p.isValid();
+    bench_use(&r);
+  });
+  return b.finish();
+}
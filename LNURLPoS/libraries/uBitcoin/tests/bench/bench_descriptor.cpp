@@ -0,0 +1,51 @@
+// Output descriptors: parsing the text for every expansion against
+// expanding the compiled template (one child derivation per key) and
+// expanding recently used indexes that are still in the key caches.
+#include "bench.h"
+#include "Bitcoin.h"
+#include "Descriptor.h"
+
+int main(int argc, char ** argv){
+  Bench b("descriptor", argc, argv);
+  uint8_t seed[64];
+  for(size_t i=0; i<sizeof(seed); i++){
+    seed[i] = rand();
+  }
+  HDPrivateKey root;
+  root.fromSeed(seed, sizeof(seed));
+  std::string fp = root.fingerprint();
+  std::string k1 = "[" + fp + "/84h/0h/0h]" + root.derive("m/84h/0h/0h").xpub().xpub() + "/0/*";
+  std::string k2 = "[" + fp + "/86h/0h/0h]" + root.derive("m/86h/0h/0h").xpub().xpub() + "/0/*";
+  std::string m1 = "[" + fp + "/48h/0h/0h/2h]" + root.derive("m/48h/0h/0h/2h").xpub().xpub() + "/0/*";
+  std::string m2 = "[" + fp + "/48h/0h/1h/2h]" + root.derive("m/48h/0h/1h/2h").xpub().xpub() + "/0/*";
+  std::string m3 = "[" + fp + "/48h/0h/2h/2h]" + root.derive("m/48h/0h/2h/2h").xpub().xpub() + "/0/*";
+  const std::string descriptors[][2] = {
+    { "wpkh", "wpkh(" + k1 + ")" },
+    { "tr", "tr(" + k2 + ")" },
+    { "wsh(sortedmulti(2,3))", "wsh(sortedmulti(2," + m1 + "," + m2 + "," + m3 + "))" },
+  };
+  uint8_t script[40];
+  for(size_t i=0; i<sizeof(descriptors)/sizeof(descriptors[0]); i++){
+    const std::string & name = descriptors[i][0];
+    const std::string & text = descriptors[i][1];
+    uint32_t index = 0;
+    b.run("parse+expand/" + name, 0, [&]{
+      Descriptor desc(text.c_str());
+      size_t len = desc.scriptPubkey(index++, script, sizeof(script));
+      bench_use(&len);
+      bench_use(script);
+    });
+    Descriptor desc(text.c_str());
+    b.run("expand/" + name, 0, [&]{
+      size_t len = desc.scriptPubkey(index++, script, sizeof(script));
+      bench_use(&len);
+      bench_use(script);
+    });
+    b.run("expand cached/" + name, 0, [&]{
+      size_t len = desc.scriptPubkey(index++ % 4, script, sizeof(script));
+      bench_use(&len);
+      bench_use(script);
+    });
+  }
+  return b.finish();
+}
@@ -0,0 +1,67 @@
+// Hashing throughput for one-shot functions and streaming classes.
+#include "bench.h"
+#include "Hash.h"
+#include "utility/trezor/pbkdf2.h"
+
+#define MAX_SIZE (1 << 20)
+// streaming classes get the message in chunks of this size
+#define CHUNK_SIZE 1000
+
+static const size_t sizes[] = { 0, 32, 64, 256, 1024, 4096, 65536, MAX_SIZE };
+
+static void stream(HashAlgorithm &h, const uint8_t * data, size_t len){
+  for(size_t i=0; i<len; i+=CHUNK_SIZE){
+    h.write(data+i, (len-i < CHUNK_SIZE) ? (len-i) : CHUNK_SIZE);
+  }
+}
+
+int main(int argc, char ** argv){
+  Bench b("hash", argc, argv);
+  uint8_t * data = (uint8_t *)malloc(MAX_SIZE);
+  for(size_t i=0; i<MAX_SIZE; i++){
+    data[i] = (uint8_t)(i*13);
+  }
+  uint8_t key[32];
+  memset(key, 0x42, sizeof(key));
+  uint8_t out[64];
+
+  for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++){
+    size_t len = sizes[i];
+    std::string sz = "/" + std::to_string(len);
+
+    b.run("sha256/oneshot"+sz, len, [&]{ sha256(data, len, out); bench_use(out); });
+    b.run("sha256/stream"+sz, len, [&]{ SHA256 h; stream(h, data, len); h.end(out); bench_use(out); });
+    b.run("doubleSha/oneshot"+sz, len, [&]{ doubleSha(data, len, out); bench_use(out); });
+    b.run("doubleSha/stream"+sz, len, [&]{ DoubleSha h; h.begin(); stream(h, data, len); h.end(out); bench_use(out); });
+    b.run("hash160/oneshot"+sz, len, [&]{ hash160(data, len, out); bench_use(out); });
+    b.run("hash160/stream"+sz, len, [&]{ Hash160 h; h.begin(); stream(h, data, len); h.end(out); bench_use(out); });
+    b.run("sha512/oneshot"+sz, len, [&]{ sha512(data, len, out); bench_use(out); });
+    b.run("sha512/stream"+sz, len, [&]{ SHA512 h; stream(h, data, len); h.end(out); bench_use(out); });
+    b.run("rmd160/oneshot"+sz, len, [&]{ rmd160(data, len, out); bench_use(out); });
+    b.run("rmd160/stream"+sz, len, [&]{ RMD160 h; h.begin(); stream(h, data, len); h.end(out); bench_use(out); });
+    b.run("hmac_sha256/oneshot"+sz, len, [&]{ sha256Hmac(key, sizeof(key), data, len, out); bench_use(out); });
+    b.run("hmac_sha256/stream"+sz, len, [&]{ SHA256 h; h.beginHMAC(key, sizeof(key)); stream(h, data, len); h.endHMAC(out); bench_use(out); });
+    b.run("hmac_sha512/oneshot"+sz, len, [&]{ sha512Hmac(key, sizeof(key), data, len, out); bench_use(out); });
+    b.run("hmac_sha512/stream"+sz, len, [&]{ SHA512 h; h.beginHMAC(key, sizeof(key)); stream(h, data, len); h.endHMAC(out); bench_use(out); });
+  }
+
+  // BIP39 seed derivation: 2048 rounds over a 12-word mnemonic
+  const char * mnemonic = "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about";
+  const char * salt = "mnemonic";
+  b.run("pbkdf2_hmac_sha512/oneshot/2048", 0, [&]{
+    pbkdf2_hmac_sha512((const uint8_t *)mnemonic, strlen(mnemonic), (const uint8_t *)salt, strlen(salt), 2048, out, 64);
+    bench_use(out);
+  });
+  b.run("pbkdf2_hmac_sha512/stream/2048", 0, [&]{
+    PBKDF2_HMAC_SHA512_CTX ctx;
+    pbkdf2_hmac_sha512_Init(&ctx, (const uint8_t *)mnemonic, strlen(mnemonic), (const uint8_t *)salt, strlen(salt), 1);
+    for(int i=0; i<8; i++){
+      pbkdf2_hmac_sha512_Update(&ctx, 256);
+    }
+    pbkdf2_hmac_sha512_Final(&ctx, out);
+    bench_use(out);
+  });
+
+  free(data);
+  return b.finish();
+}
@@ -0,0 +1,53 @@
+// Address generation throughput: hash160 of compressed public keys
+// one by one vs. hash160_multi.
+#include "bench.h"
+#include "Hash.h"
+
+#define PUBKEYS 1024
+
+int main(int argc, char ** argv){
+  Bench b("hash160", argc, argv);
+  uint8_t pubkeys[PUBKEYS*33];
+  uint8_t hashes[PUBKEYS*20];
+  uint8_t hashes_multi[PUBKEYS*20];
+  for(size_t i=0; i<sizeof(pubkeys); i++){
+    pubkeys[i] = rand();
+  }
+  for(size_t i=0; i<PUBKEYS; i++){
+    pubkeys[i*33] = 0x02 + (pubkeys[i*33] & 1);
+  }
+
+  for(size_t i=0; i<PUBKEYS; i++){
+    hash160(pubkeys+i*33, 33, hashes+i*20);
+  }
+  hash160_multi(pubkeys, 33, PUBKEYS, hashes_multi);
+  if(memcmp(hashes, hashes_multi, sizeof(hashes)) != 0){
+    printf("hash160_multi result mismatch\n");
+    return 1;
+  }
+
+  // one operation hashes all PUBKEYS keys
+  b.run("hash160/1024_pubkeys", sizeof(pubkeys), [&]{
+    for(size_t i=0; i<PUBKEYS; i++){
+      hash160(pubkeys+i*33, 33, hashes+i*20);
+    }
+    bench_use(hashes);
+  });
+  double single = b.lastOpsPerSec() * PUBKEYS;
+  if(!b.jsonOutput() && single > 0){
+    printf("  %-36s %14.1f pubkeys/s\n", "", single);
+  }
+  b.run("hash160_multi/1024_pubkeys", sizeof(pubkeys), [&]{
+    hash160_multi(pubkeys, 33, PUBKEYS, hashes_multi);
+    bench_use(hashes_multi);
+  });
+  double multi = b.lastOpsPerSec() * PUBKEYS;
+  if(!b.jsonOutput() && multi > 0){
+    if(single > 0){
+      printf("  %-36s %14.1f pubkeys/s (x%.2f)\n", "", multi, multi/single);
+    }else{
+      printf("  %-36s %14.1f pubkeys/s\n", "", multi);
+    }
+  }
+  return b.finish();
+}
@@ -0,0 +1,125 @@
+// BIP32 derivation of receiving keys m/84'/0'/0'/0/i and signing with them,
+// public keys are computed only when derivation or the caller needs them,
+// intermediate keys of the path come from the derivation cache,
+// receiving scripts and addresses in bulk with deriveRange,
+// taproot output keys one by one and in batches,
+// ownership checks with OwnershipIndex.
+#include "bench.h"
+#include "Bitcoin.h"
+#include "PSBT.h"
+
+int main(int argc, char ** argv){
+  Bench b("hd", argc, argv);
+  uint8_t seed[64];
+  for(size_t i=0; i<sizeof(seed); i++){
+    seed[i] = rand();
+  }
+  HDPrivateKey root;
+  root.fromSeed(seed, sizeof(seed));
+  HDPrivateKey account = root.derive("m/84h/0h/0h/");
+  uint8_t hash[32];
+  for(size_t i=0; i<sizeof(hash); i++){
+    hash[i] = rand();
+  }
+  uint32_t index = 0;
+
+  b.run("derive/m/84h/0h/0h/0/i", 0, [&]{
+    uint32_t path[] = { HARDENED_INDEX+84, HARDENED_INDEX, HARDENED_INDEX, 0, index++ };
+    HDPrivateKey pk = root.derive(path, 5);
+    bench_use(&pk);
+  });
+  b.run("derive(\"m/84h/0h/0h/0/i\")", 0, [&]{
+    char path[40];
+    snprintf(path, sizeof(path), "m/84h/0h/0h/0/%u", (unsigned)index++);
+    HDPrivateKey pk = root.derive(path);
+    bench_use(&pk);
+  });
+  // parsed at compile time with C++14
+  DERIVATION_CONSTEXPR DerivationPath receive("m/84h/0h/0h/0");
+  b.run("derive(DerivationPath/i)", 0, [&]{
+    HDPrivateKey pk = root.derive(receive.child(index++));
+    bench_use(&pk);
+  });
+  char path[] = "m/84h/0h/0h/0/17";
+  bench_use(path);
+  b.run("DerivationPath(path)", 0, [&]{
+    DerivationPath p(path);
+    bench_use(&p);
+  });
+  HDPublicKey xpub = account.xpub();
+  b.run("xpub.derive/0/i", 0, [&]{
+    uint32_t path[] = { 0, index++ };
+    HDPublicKey pub = xpub.derive(path, 2);
+    bench_use(&pub);
+  });
+  // gap limit check: 20 receiving addresses at a time
+  b.run("xpub.derive/0/i.address/20", 0, [&]{
+    char addr[80];
+    for(int i=0; i<20; i++){
+      uint32_t path[] = { 0, index++ };
+      xpub.derive(path, 2).address(addr, sizeof(addr));
+    }
+    bench_use(addr);
+  });
+  b.run("xpub.deriveRange/0/i.address/20", 0, [&]{
+    char addr[20][80];
+    xpub.deriveRange(0, index, 20, addr[0], sizeof(addr[0]));
+    index += 20;
+    bench_use(addr);
+  });
+  b.run("xpub.deriveRange/0/i.script/1000", 0, [&]{
+    static Script scripts[1000];
+    xpub.deriveRange(0, index, 1000, scripts);
+    index += 1000;
+    bench_use(scripts);
+  });
+  HDPublicKey trXpub = root.derive("m/86h/0h/0h/").xpub();
+  b.run("xpub.deriveRange/0/i.script/1000 (taproot)", 0, [&]{
+    static Script scripts[1000];
+    trXpub.deriveRange(0, index, 1000, scripts);
+    index += 1000;
+    bench_use(scripts);
+  });
+  static PublicKey internal[1000], output[1000];
+  for(size_t i=0; i<1000; i++){
+    internal[i] = trXpub.child(0).child(i);
+  }
+  size_t k = 0;
+  b.run("taprootTweak", 0, [&]{
+    output[k] = taprootTweak(internal[k]);
+    k = (k+1) % 1000;
+    bench_use(output);
+  });
+  b.run("taprootTweak/1000 keys", 0, [&]{
+    size_t n = taprootTweak(internal, 1000, NULL, output);
+    bench_use(&n);
+    bench_use(output);
+  });
+  // ownership check of a change output: derivation vs. precomputed index
+  Script change(xpub.child(1).child(17), P2WPKH);
+  b.run("xpub.derive/1/17==script", 0, [&]{
+    uint32_t path[] = { 1, 17 };
+    bool mine = (Script(xpub.derive(path, 2), P2WPKH) == change);
+    bench_use(&mine);
+  });
+  OwnershipIndex owned(100);
+  owned.add(xpub);
+  b.run("OwnershipIndex.find", 0, [&]{
+    bool mine = owned.find(change);
+    bench_use(&mine);
+  });
+  b.run("derive+sign/m/84h/0h/0h/0/i", 0, [&]{
+    uint32_t path[] = { HARDENED_INDEX+84, HARDENED_INDEX, HARDENED_INDEX, 0, index++ };
+    Signature sig = root.derive(path, 5).sign(hash);
+    bench_use(&sig);
+  });
+  b.run("account.child(0).child(i).sign", 0, [&]{
+    Signature sig = account.child(0).child(index++).sign(hash);
+    bench_use(&sig);
+  });
+  b.run("account.child(0).child(i).publicKey", 0, [&]{
+    PublicKey pub = account.child(0).child(index++).publicKey();
+    bench_use(&pub);
+  });
+  return b.finish();
+}
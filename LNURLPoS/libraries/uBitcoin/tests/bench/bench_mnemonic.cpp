@@ -0,0 +1,79 @@
+// BIP39 word lookup: perfect hash vs. the linear wordlist scan it replaced,
+// mnemonic checks and prefix completion as used while typing.
+#include "bench.h"
+#include "Bitcoin.h"
+#include "utility/trezor/bip39.h"
+
+// word index with a strcmp scan over the wordlist
+static int word_index_reference(const char * word){
+  const char * const * wordlist = mnemonic_wordlist();
+  for(int k=0; wordlist[k]; k++){
+    if(strcmp(word, wordlist[k]) == 0){
+      return k;
+    }
+  }
+  return -1;
+}
+
+int main(int argc, char ** argv){
+  Bench b("mnemonic", argc, argv);
+  uint8_t entropy[32];
+  for(size_t i=0; i<sizeof(entropy); i++){
+    entropy[i] = rand();
+  }
+  char mnemonic[24*10];
+  strcpy(mnemonic, mnemonicFromEntropy(entropy, sizeof(entropy)));
+  const char * words[24];
+  char buf[24*10];
+  strcpy(buf, mnemonic);
+  size_t n = 0;
+  for(char * w = strtok(buf, " "); w != NULL; w = strtok(NULL, " ")){
+    words[n++] = w;
+  }
+  for(size_t i=0; i<n; i++){
+    if(word_index_reference(words[i]) != mnemonicWordIndex(words[i], strlen(words[i]))){
+      printf("word index mismatch\n");
+      return 1;
+    }
+  }
+
+  b.run("word_index_reference/24", 0, [&]{
+    int sum = 0;
+    for(size_t i=0; i<n; i++){
+      sum += word_index_reference(words[i]);
+    }
+    bench_use(&sum);
+  });
+  b.run("mnemonicWordIndex/24", 0, [&]{
+    int sum = 0;
+    for(size_t i=0; i<n; i++){
+      sum += mnemonicWordIndex(words[i], strlen(words[i]));
+    }
+    bench_use(&sum);
+  });
+  b.run("checkMnemonic/24", 0, [&]{
+    bool ok = checkMnemonic(mnemonic);
+    bench_use(&ok);
+  });
+  uint16_t indexes[24];
+  for(size_t i=0; i<n; i++){
+    indexes[i] = mnemonicWordIndex(words[i], strlen(words[i]));
+  }
+  b.run("checkMnemonic(indexes)/24", 0, [&]{
+    bool ok = checkMnemonic(indexes, n);
+    bench_use(&ok);
+  });
+  b.run("mnemonicComplete/3", 0, [&]{
+    uint16_t first;
+    size_t num = mnemonicComplete(words[0], 3, &first);
+    bench_use(&num);
+    bench_use(&first);
+  });
+  b.run("mnemonicComplete/4", 0, [&]{
+    uint16_t first;
+    size_t num = mnemonicComplete(words[1], 4, &first);
+    bench_use(&num);
+    bench_use(&first);
+  });
+  return b.finish();
+}
@@ -0,0 +1,67 @@
+// Signing a consolidation PSBT: 500 P2WPKH inputs from receive and change
+// addresses of one account (m/84'/0'/0'/{0,1}/i), one op is the whole PSBT.
+#include "bench.h"
+#include "Bitcoin.h"
+#include "PSBT.h"
+
+// sse2 build on x86-64: 500 inputs 190-220M cycles per PSBT. Rebuilt with
+// OPT="-O2 -DINPUTS=200" for the tree before batched derivation (which
+// can't index more than 255 inputs): 200 inputs ~170M -> ~92M cycles.
+#ifndef INPUTS
+#define INPUTS 500
+#endif
+
+// built in memory: Tx serialization limits the number of inputs to 252
+static void consolidation(PSBT & psbt, const HDPrivateKey & root, size_t n){
+  uint8_t fingerprint[4];
+  root.fingerprint(fingerprint);
+  HDPublicKey account = root.derive("m/84h/0h/0h").xpub();
+  for(size_t i=0; i<n; i++){
+    uint8_t prev[32];
+    for(size_t j=0; j<sizeof(prev); j++){
+      prev[j] = rand();
+    }
+    psbt.tx.addInput(TxIn(prev, i % 3));
+  }
+  psbt.tx.addOutput(TxOut(n*10000, Script(account.child(1).child(n), P2WPKH)));
+  psbt.txInsMeta = new PSBTInputMetadata[n];
+  psbt.txOutsMeta = new PSBTOutputMetadata[1];
+  psbt.txOutsMeta[0].derivationsLen = 0;
+  for(size_t i=0; i<n; i++){
+    PSBTInputMetadata & meta = psbt.txInsMeta[i];
+    HDPublicKey pub = account.child(i % 2).child(i / 2);
+    const uint32_t path[] = { HARDENED_INDEX+84, HARDENED_INDEX, HARDENED_INDEX, (uint32_t)(i % 2), (uint32_t)(i / 2) };
+    meta.txOut = TxOut(10000 + i, Script(pub, P2WPKH));
+    meta.signaturesLen = 0;
+    meta.derivationsLen = 1;
+    meta.derivations = new PSBTDerivation[1];
+    meta.derivations[0].pubkey = pub;
+    memcpy(meta.derivations[0].fingerprint, fingerprint, 4);
+    meta.derivations[0].derivationLen = 5;
+    meta.derivations[0].derivation = (uint32_t *)malloc(sizeof(path));
+    memcpy(meta.derivations[0].derivation, path, sizeof(path));
+  }
+}
+
+int main(int argc, char ** argv){
+  Bench b("psbt", argc, argv);
+  uint8_t seed[64];
+  for(size_t i=0; i<sizeof(seed); i++){
+    seed[i] = rand();
+  }
+  HDPrivateKey root;
+  root.fromSeed(seed, sizeof(seed));
+  PSBT unsigned_psbt;
+  consolidation(unsigned_psbt, root, INPUTS);
+  PSBT check = unsigned_psbt;
+  if(check.sign(root) != INPUTS){
+    printf("not all inputs are signed\n");
+    return 1;
+  }
+  b.run("sign/" + std::to_string(INPUTS) + " inputs", 0, [&]{
+    PSBT psbt = unsigned_psbt;
+    size_t signed_inputs = psbt.sign(root);
+    bench_use(&signed_inputs);
+  });
+  return b.finish();
+}
@@ -0,0 +1,14 @@
+// random_buffer() throughput for typical nonce and key sizes.
+#include "bench.h"
+#include "utility/trezor/rand.h"
+
+int main(int argc, char ** argv){
+  Bench b("rand", argc, argv);
+  uint8_t buf[4096];
+  const size_t sizes[] = { 4, 8, 32, 512, 4096 };
+  for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++){
+    size_t len = sizes[i];
+    b.run("random_buffer/" + std::to_string(len), len, [&]{ random_buffer(buf, len); bench_use(buf); });
+  }
+  return b.finish();
+}
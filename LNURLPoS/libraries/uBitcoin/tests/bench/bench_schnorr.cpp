@@ -0,0 +1,53 @@
+// BIP340 Schnorr signing and verification, one signature at a time
+// vs. batches checked with a single multi-scalar multiplication.
+#include "bench.h"
+#include "utility/trezor/bip340.h"
+#include "utility/trezor/secp256k1.h"
+
+#define MAX_BATCH 10000
+
+static uint8_t pubs[MAX_BATCH*32];
+static uint8_t sigs[MAX_BATCH*64];
+static uint8_t msgs[MAX_BATCH*32];
+
+int main(int argc, char ** argv){
+  Bench b("schnorr", argc, argv);
+  uint8_t priv[32];
+  for(size_t i=0; i<MAX_BATCH; i++){
+    for(size_t j=0; j<sizeof(priv); j++){
+      priv[j] = rand();
+    }
+    priv[0] &= 0x7F;
+    for(size_t j=0; j<32; j++){
+      msgs[32*i+j] = rand();
+    }
+    bip340_get_public_key(&secp256k1, priv, pubs+32*i);
+    bip340_sign(&secp256k1, priv, msgs+32*i, NULL, sigs+64*i);
+  }
+
+  uint8_t sig[64];
+  b.run("bip340_sign", 0, [&]{
+    bip340_sign(&secp256k1, priv, msgs, NULL, sig);
+    bench_use(sig);
+  });
+  b.run("bip340_verify", 0, [&]{
+    int res = bip340_verify(&secp256k1, pubs, msgs, sigs);
+    bench_use(&res);
+  });
+  const size_t sizes[] = {1, 10, 100, 1000, 10000};
+  for(size_t k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++){
+    size_t n = sizes[k];
+    char name[64];
+    snprintf(name, sizeof(name), "bip340_verify_batch/%zu", n);
+    b.run(name, 0, [&]{
+      if(bip340_verify_batch(&secp256k1, n, pubs, msgs, sigs) != 0){
+        printf("batch verification failed\n");
+        exit(1);
+      }
+    });
+    if(!b.jsonOutput() && b.lastOpsPerSec() > 0){
+      printf("  %-36s %14.1f verifications/s\n", "", b.lastOpsPerSec() * n);
+    }
+  }
+  return b.finish();
+}
@@ -0,0 +1,84 @@
+// RFC6979 nonce generation and ECDSA signing, one digest at a time
+// vs. a batch of digests signed with the same key.
+#include "bench.h"
+#include "Hash.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+#include "utility/trezor/rfc6979.h"
+#include "utility/trezor/hmac.h"
+
+#define BATCH 16
+
+// RFC6979 with full HMAC computations for every step, for comparison
+static void rfc6979_reference(const uint8_t * priv, const uint8_t * hash, uint8_t k_out[32]){
+  uint8_t v[32], k[32], buf[32+1+64];
+  memset(v, 1, 32);
+  memset(k, 0, 32);
+  for(uint8_t sep=0; sep<2; sep++){
+    memcpy(buf, v, 32);
+    buf[32] = sep;
+    memcpy(buf+33, priv, 32);
+    memcpy(buf+65, hash, 32);
+    ubtc_hmac_sha256(k, 32, buf, sizeof(buf), k);
+    ubtc_hmac_sha256(k, 32, v, 32, v);
+  }
+  ubtc_hmac_sha256(k, 32, v, 32, v);
+  memcpy(k_out, v, 32);
+}
+
+int main(int argc, char ** argv){
+  Bench b("sign", argc, argv);
+  uint8_t priv[32];
+  uint8_t hashes[BATCH*32];
+  uint8_t sigs[BATCH*64];
+  uint8_t k[32];
+  for(size_t i=0; i<sizeof(priv); i++){
+    priv[i] = rand();
+  }
+  for(size_t i=0; i<sizeof(hashes); i++){
+    hashes[i] = rand();
+  }
+
+  rfc6979_state rng;
+  init_rfc6979(priv, hashes, &rng);
+  generate_rfc6979(k, &rng);
+  uint8_t k_ref[32];
+  rfc6979_reference(priv, hashes, k_ref);
+  if(memcmp(k, k_ref, 32) != 0){
+    printf("rfc6979 result mismatch\n");
+    return 1;
+  }
+
+  b.run("rfc6979_reference/16", 0, [&]{
+    for(int i=0; i<BATCH; i++){
+      rfc6979_reference(priv, hashes+32*i, k);
+    }
+    bench_use(k);
+  });
+  b.run("rfc6979/16", 0, [&]{
+    for(int i=0; i<BATCH; i++){
+      init_rfc6979(priv, hashes+32*i, &rng);
+      generate_rfc6979(k, &rng);
+    }
+    bench_use(k);
+  });
+  b.run("rfc6979_batch/16", 0, [&]{
+    rfc6979_state rngs[BATCH];
+    init_rfc6979_batch(priv, hashes, BATCH, rngs);
+    for(int i=0; i<BATCH; i++){
+      generate_rfc6979(k, rngs+i);
+    }
+    bench_use(k);
+  });
+  b.run("ecdsa_sign_digest/16", 0, [&]{
+    for(int i=0; i<BATCH; i++){
+      ecdsa_sign_digest(&secp256k1, priv, hashes+32*i, sigs+64*i, NULL, NULL);
+    }
+    bench_use(sigs);
+  });
+  b.run("ecdsa_sign_digest_batch/16", 0, [&]{
+    ecdsa_sign_digest_batch(&secp256k1, priv, hashes, BATCH, sigs, NULL, NULL);
+    bench_use(sigs);
+  });
+  return b.finish();
+}
@@ -0,0 +1,62 @@
+// ECDSA verification one signature at a time vs. batches
+// sharing the modular inversions (ecdsa_verify_digest_batch).
+#include "bench.h"
+#include "Hash.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+
+#define MAX_BATCH 4096
+
+static uint8_t pubs[MAX_BATCH][33];
+static const uint8_t * pub_keys[MAX_BATCH];
+static uint8_t sigs[MAX_BATCH*64];
+static uint8_t digests[MAX_BATCH*32];
+static int results[MAX_BATCH];
+
+int main(int argc, char ** argv){
+  Bench b("verify", argc, argv);
+  uint8_t priv[32];
+  for(size_t i=0; i<MAX_BATCH; i++){
+    for(size_t j=0; j<sizeof(priv); j++){
+      priv[j] = rand();
+    }
+    priv[0] &= 0x7F;
+    for(size_t j=0; j<32; j++){
+      digests[32*i+j] = rand();
+    }
+    ecdsa_get_public_key33(&secp256k1, priv, pubs[i]);
+    ecdsa_sign_digest(&secp256k1, priv, digests+32*i, sigs+64*i, NULL, NULL);
+    pub_keys[i] = pubs[i];
+  }
+
+  const size_t sizes[] = {1, 16, 256, 4096};
+  for(size_t k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++){
+    size_t n = sizes[k];
+    char name[64];
+    if(n <= 16){
+      snprintf(name, sizeof(name), "ecdsa_verify_digest/%zu", n);
+      b.run(name, 0, [&]{
+        for(size_t i=0; i<n; i++){
+          results[i] = ecdsa_verify_digest(&secp256k1, pub_keys[i], sigs+64*i, digests+32*i);
+        }
+        bench_use(results);
+      });
+      if(!b.jsonOutput() && b.lastOpsPerSec() > 0){
+        printf("  %-36s %14.1f verifications/s\n", "", b.lastOpsPerSec() * n);
+      }
+    }
+    snprintf(name, sizeof(name), "ecdsa_verify_digest_batch/%zu", n);
+    b.run(name, 0, [&]{
+      size_t failed = ecdsa_verify_digest_batch(&secp256k1, n, pub_keys, sigs, digests, results);
+      if(failed != 0){
+        printf("batch verification failed\n");
+        exit(1);
+      }
+      bench_use(results);
+    });
+    if(!b.jsonOutput() && b.lastOpsPerSec() > 0){
+      printf("  %-36s %14.1f verifications/s\n", "", b.lastOpsPerSec() * n);
+    }
+  }
+  return b.finish();
+}
@@ -0,0 +1,148 @@
+// Watch-only scanning: transactions parsed from raw bytes and matched
+// against 100, 1000 and 10000 xpubs in one OwnershipIndex, one
+// transaction per op (ops/s is transactions per second). Indexes are
+// saved next to the binary and memory-mapped on the next run, deriving
+// 10000 xpubs takes a while.
+#include "bench.h"
+#include "Bitcoin.h"
+#include "Hash.h"
+#include "PSBT.h"
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define BENCH_USE_MMAP 1
+#endif
+
+#define GAP 20
+#define TXS 1000
+
+static HDPublicKey watched(uint32_t i){
+  static HDPublicKey account;
+  if(!account){
+    uint8_t seed[64];
+    sha512("watch-only", seed);
+    HDPrivateKey root;
+    root.fromSeed(seed, sizeof(seed));
+    account = root.derive("m/84h/0h/0h").xpub();
+  }
+  return account.child(i);
+}
+
+// snapshot saved by a previous run, NULL if there is none
+static const uint8_t * mapSnapshot(const std::string & filename, size_t * len){
+#if BENCH_USE_MMAP
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0){
+    return NULL;
+  }
+  struct stat st;
+  void * p = MAP_FAILED;
+  if(fstat(fd, &st) == 0 && st.st_size > 0){
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if(p == MAP_FAILED){
+    return NULL;
+  }
+  *len = st.st_size;
+  return (const uint8_t *)p;
+#else
+  return NULL;
+#endif
+}
+
+static void saveSnapshot(const std::string & filename, const OwnershipIndex & index){
+  std::vector<uint8_t> buf(index.snapshotLength());
+  index.snapshot(buf.data(), buf.size());
+  FILE * f = fopen(filename.c_str(), "wb");
+  if(f != NULL){
+    fwrite(buf.data(), 1, buf.size(), f);
+    fclose(f);
+  }
+}
+
+int main(int argc, char ** argv){
+  Bench b("watch", argc, argv);
+  const uint32_t sizes[] = { 100, 1000, 10000 };
+  for(size_t k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++){
+    uint32_t n = sizes[k];
+    std::string filename = std::string(argv[0]) + "." + std::to_string(n) + ".snapshot";
+    OwnershipIndex index(GAP);
+    size_t len = 0;
+    const uint8_t * mapped = mapSnapshot(filename, &len);
+    if(mapped == NULL || !index.load(mapped, len) || index.xpubs() != n){
+      index.clear();
+      for(uint32_t i=0; i<n; i++){
+        index.add(watched(i));
+      }
+      saveSnapshot(filename, index);
+      mapped = mapSnapshot(filename, &len);
+    }
+    if(mapped != NULL){
+      b.run("load/" + std::to_string(n) + " xpubs", 0, [&]{
+        OwnershipIndex restored;
+        bool ok = restored.load(mapped, len);
+        bench_use(&ok);
+      });
+    }
+
+    // two inputs and two outputs, every fifth transaction pays to one of the xpubs
+    std::vector<std::vector<uint8_t> > raw(TXS);
+    for(size_t t=0; t<TXS; t++){
+      Tx tx;
+      uint8_t prev[32];
+      for(uint32_t i=0; i<2; i++){
+        for(size_t j=0; j<sizeof(prev); j++){
+          prev[j] = rand();
+        }
+        tx.addInput(TxIn(prev, i));
+      }
+      uint8_t hash[20];
+      for(size_t j=0; j<sizeof(hash); j++){
+        hash[j] = rand();
+      }
+      uint8_t program[22] = { 0x00, 0x14 };
+      memcpy(program+2, hash, 20);
+      tx.addOutput(TxOut(rand(), Script(program, sizeof(program))));
+      if(t % 5 == 0){
+        HDPublicKey pub = watched(rand() % n).child(rand() % 2).child(rand() % GAP);
+        tx.addOutput(TxOut(rand(), Script(pub, P2WPKH)));
+      }else{
+        hash[0] ^= 1;
+        memcpy(program+2, hash, 20);
+        tx.addOutput(TxOut(rand(), Script(program, sizeof(program))));
+      }
+      raw[t].resize(tx.length());
+      tx.serialize(raw[t].data(), raw[t].size());
+    }
+    // extend windows hit by the transactions before measuring
+    size_t matched = 0;
+    for(size_t t=0; t<TXS; t++){
+      Tx tx;
+      tx.parse(raw[t].data(), raw[t].size());
+      matched += index.scan(tx);
+    }
+    if(matched != TXS/5){
+      printf("%zu transactions matched instead of %d\n", matched, TXS/5);
+      return 1;
+    }
+    size_t t = 0;
+    b.run("parse+scan/" + std::to_string(n) + " xpubs", 0, [&]{
+      Tx tx;
+      tx.parse(raw[t].data(), raw[t].size());
+      size_t num = index.scan(tx);
+      bench_use(&num);
+      t = (t+1) % TXS;
+    });
+    index.clear();
+#if BENCH_USE_MMAP
+    if(mapped != NULL){
+      munmap((void *)mapped, len);
+    }
+#endif
+  }
+  return b.finish();
+}
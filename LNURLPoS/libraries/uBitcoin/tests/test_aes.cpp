@@ -0,0 +1,84 @@
+#include "minunit.h"
+#include "Conversion.h"
+#include "utility/trezor/aes_ctr.h"
+
+using namespace std;
+
+static const int backends[] = { AES_BACKEND_PORTABLE, AES_BACKEND_AESNI, AES_BACKEND_ESP32 };
+
+MU_TEST(test_aes_block) {
+  // FIPS-197, appendix C
+  uint8_t key[32];
+  for(int i=0; i<32; i++){
+    key[i] = i;
+  }
+  uint8_t pt[16], ct[16];
+  fromHex("00112233445566778899aabbccddeeff", pt, sizeof(pt));
+  for(size_t b=0; b<sizeof(backends)/sizeof(backends[0]); b++){
+    AES_CTX ctx;
+    if(aes_init_backend(&ctx, key, 16, backends[b]) != 0){
+      continue; // not available on this platform
+    }
+    aes_encrypt_block(&ctx, pt, ct);
+    mu_assert(toHex(ct, 16) == "69c4e0d86a7b0430d8cdb78070b4c55a", "AES-128 is wrong");
+    aes_init_backend(&ctx, key, 32, backends[b]);
+    aes_encrypt_block(&ctx, pt, ct);
+    mu_assert(toHex(ct, 16) == "8ea2b7ca516745bfeafc49904b496089", "AES-256 is wrong");
+    aes_clear(&ctx);
+  }
+}
+
+MU_TEST(test_aes_ctr) {
+  // NIST SP 800-38A, F.5.5 CTR-AES256.Encrypt
+  uint8_t key[32], iv[16], data[64];
+  fromHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", key, sizeof(key));
+  fromHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", iv, sizeof(iv));
+  const char * plaintext = "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                           "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+  const char * ciphertext = "601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cacaf5c5"
+                            "2b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd08457941a6";
+  for(size_t b=0; b<sizeof(backends)/sizeof(backends[0]); b++){
+    AES_CTX ctx;
+    if(aes_init_backend(&ctx, key, sizeof(key), backends[b]) != 0){
+      continue;
+    }
+    fromHex(plaintext, data, sizeof(data));
+    aes_ctr_xor(&ctx, iv, data, sizeof(data));
+    mu_assert(toHex(data, sizeof(data)) == ciphertext, "AES-256-CTR encryption is wrong");
+    // odd length and decryption
+    aes_ctr_xor(&ctx, iv, data, 37);
+    aes_ctr_xor(&ctx, iv, data+37, 0);
+    mu_assert(toHex(data, 37) == string(plaintext).substr(0, 74), "AES-256-CTR decryption is wrong");
+  }
+}
+
+MU_TEST(test_aes_backends_agree) {
+  uint8_t key[32], iv[16];
+  for(int i=0; i<32; i++){
+    key[i] = i*29+1;
+  }
+  memset(iv, 0xff, sizeof(iv)); // counter wraps around
+  uint8_t a[1000], b[1000];
+  for(size_t i=0; i<sizeof(a); i++){
+    a[i] = i;
+  }
+  memcpy(b, a, sizeof(a));
+  AES_CTX portable, best;
+  aes_init_backend(&portable, key, sizeof(key), AES_BACKEND_PORTABLE);
+  aes_init(&best, key, sizeof(key));
+  aes_ctr_xor(&portable, iv, a, sizeof(a));
+  aes_ctr_xor(&best, iv, b, sizeof(b));
+  mu_assert(memcmp(a, b, sizeof(a)) == 0, "AES backends disagree");
+}
+
+MU_TEST_SUITE(test_aes) {
+  MU_RUN_TEST(test_aes_block);
+  MU_RUN_TEST(test_aes_ctr);
+  MU_RUN_TEST(test_aes_backends_agree);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_aes);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
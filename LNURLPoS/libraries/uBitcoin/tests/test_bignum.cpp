@@ -0,0 +1,191 @@
+#include "minunit.h"
+#include "Conversion.h"
+#include "Hash.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/secp256k1.h"
+
+using namespace std;
+
+// reads up to 270 bits from 68 hex characters
+static void bn_from_hex(const char * hex, bignum256 * x){
+  uint8_t buf[34];
+  fromHex(hex, buf, sizeof(buf));
+  bn_read_be(buf+2, x);
+  x->val[8] |= ((uint32_t)buf[0] << 8 | buf[1]) << 16;
+}
+
+static string bn_to_hex(bignum256 * x){
+  uint8_t buf[32];
+  bn_write_be(x, buf);
+  return toHex(buf, 32);
+}
+
+MU_TEST(test_multiply) {
+  // a, b, a * b mod prime, inputs are normalized and below 180 * prime
+  const char * vectors[][4] = {
+    {"p", "007fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "007fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "00000000000000000000000000000000000000000000400001e87f03a4246f01"},
+    {"p", "0000fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2e", "0000fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2e", "0000000000000000000000000000000000000000000000000000000000000001"},
+    {"p", "0001fffffffffffffffffffffffffffffffffffffffffffffffffffffffdfffff85d", "00000000000000000000000000000000000000000000000000000000000000000003", "fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2c"},
+    {"p", "00000b13a023af11bab1240f16a76490fd4ac393fd0e1cc62be5783646bf0324aac3", "000023bc4710c1f194dbb6258a843b5766388903a9c81cc919f6f344bafb23813fa9", "690d29fa29c51ade8522a7bdf050130ba2bd8cd54c093e505ae2970c3c4248ec"},
+    {"p", "0000ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "22483b2de7de22f6cf670f849d97a983c108087a442cbd9b945efb51a50925bc1604", "c1face4c5c7b5682d31c933e4eca32cd0fbf7ef1dc77716f8934b9ceaa146aaf"},
+    {"n", "007fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "007fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "c7356071a6f179a5fd7916f341f1cdc04a1b796786158f1c5259541983c3aa68"},
+    {"n", "0000fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140", "0000fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140", "0000000000000000000000000000000000000000000000000000000000000001"},
+    {"n", "0001fffffffffffffffffffffffffffffffd755db9cd5e9140777fa4bd19a06c8281", "00000000000000000000000000000000000000000000000000000000000000000003", "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413e"},
+    {"n", "000017d625f897d42fdfff106140347639e0699e317f86ac7bc5729fce14bb7cd907", "000032d0bdb3576eb8e4672774f3e33e474af096dbb7c52ef7610536bc6c1e3ef5da", "0db9e47da1f60c540c884e4c2f4e40c7ddb83a6e3ae6a4edb0b169a4448f091b"},
+    {"n", "0000ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "2e5535d856023f1ec635f482468898cb994f5d69bd8964562841548f285534b7ad53", "5011080504746391570411939bb533bed737e13a5de04bd7cf6111c965d80844"},
+  };
+  for(size_t i=0; i<sizeof(vectors)/sizeof(vectors[0]); i++){
+    const bignum256 * prime = (vectors[i][0][0] == 'p') ? &secp256k1.prime : &secp256k1.order;
+    bignum256 a, b;
+    bn_from_hex(vectors[i][1], &a);
+    bn_from_hex(vectors[i][2], &b);
+    bn_multiply(&a, &b, prime);
+    bignum256 twice = *prime;
+    bn_lshift(&twice);
+    mu_assert(bn_is_less(&b, &twice), "result is not partly reduced");
+    bn_mod(&b, prime);
+    mu_assert(bn_to_hex(&b) == vectors[i][3], "wrong product");
+  }
+}
+
+MU_TEST(test_multiply_large_c) {
+  // prime 2^256 - c with c = 2^160 - 127: too large a c for the 64-bit
+  // folding, products near 2^512 must still come out right
+  bignum256 prime;
+  bn_from_hex("0000ffffffffffffffffffffffff000000000000000000000000000000000000007f", &prime);
+  const char * vectors[][3] = {
+    {"0000ffffffffffffffffdeb3d15ccf8293a2b25026f0a6f62499be87691ba7aeba38", "0000ffffffffffffffffffffffffffffffffffffffffffffffffffd41c333431e34a", "85afab6493d9542211b8845cba1a7e946286a508262300aa03115745e22846a3"},
+    {"0000ffffffffffffffffa3b56bf82fc50e4dcff083f15cd6f1884394d7c9ffe58e87", "0000fffffffffffffffffffff8575df71c28e071d6cfafcd058035a7e55743e47427", "5555497e11c890cbeb388af31e57d0c4de8dac2f837787c6cd17d4f03a113a7f"},
+    {"0000ffffffffffffffff68058d9a9a92da754bf68e9bce75c119736a0c0557d1f3ce", "0000ffffffffffffffffffffffffffffffffffffffffffe6f0b3ebd78453ce4e7130", "394ea79a807a926f1c31e3eac49b20904e69ee36995537cf0fe5984b8ffba644"},
+  };
+  for(size_t i=0; i<sizeof(vectors)/sizeof(vectors[0]); i++){
+    bignum256 a, b;
+    bn_from_hex(vectors[i][0], &a);
+    bn_from_hex(vectors[i][1], &b);
+    bn_multiply(&a, &b, &prime);
+    bn_mod(&b, &prime);
+    mu_assert(bn_to_hex(&b) == vectors[i][2], "wrong product for a large c");
+  }
+}
+
+MU_TEST(test_sqrt_inverse) {
+  bignum256 x;
+  bn_from_hex("00000894b1d17eb884573f687c4623ef78f82934d085772c491a8858449743fccfb8", &x);
+  bn_sqrt(&x, &secp256k1.prime);
+  mu_assert(bn_to_hex(&x) == "0d3343b8f428817a0f5fa1a48c213116a9a8430f95bc11766a951cad378876e6", "wrong square root");
+  bn_inverse(&x, &secp256k1.prime);
+  mu_assert(bn_to_hex(&x) == "dfa099666c94668b5bec44eebab21b08924f7a51670c5ae75f9e5f5fd8c263de", "wrong inverse");
+}
+
+// x^(prime-2), reference for the inverse
+static void bn_inverse_fermat(bignum256 * x, const bignum256 * prime){
+  bignum256 e = *prime, res;
+  e.val[0] -= 2; // fine for secp256k1 p and n
+  bn_one(&res);
+  for(int i=255; i>=0; i--){
+    bn_multiply(&res, &res, prime);
+    if(bn_testbit(&e, i)){
+      bn_multiply(x, &res, prime);
+    }
+  }
+  bn_mod(&res, prime);
+  *x = res;
+}
+
+// binary extended Euclid, second reference that does not depend
+// on USE_INVERSE_SAFEGCD (bn_inverse is bn_inverse_safegcd by default)
+static void bn_inverse_eea(bignum256 * x, const bignum256 * prime){
+  bignum256 u = *x, v = *prime, x1, x2, one;
+  bn_mod(&u, prime);
+  if(bn_is_zero(&u)){
+    *x = u;
+    return;
+  }
+  bn_one(&x1);
+  bn_zero(&x2);
+  bn_one(&one);
+  // invariants: u = x1 * x, v = x2 * x mod prime
+  while(!bn_is_equal(&u, &one) && !bn_is_equal(&v, &one)){
+    while(bn_is_even(&u)){
+      bn_rshift(&u);
+      bn_mult_half(&x1, prime);
+    }
+    while(bn_is_even(&v)){
+      bn_rshift(&v);
+      bn_mult_half(&x2, prime);
+    }
+    if(!bn_is_less(&u, &v)){
+      bn_subtract(&u, &v, &u);
+      if(bn_is_less(&x1, &x2)){
+        bn_add(&x1, prime);
+      }
+      bn_subtract(&x1, &x2, &x1);
+    }else{
+      bn_subtract(&v, &u, &v);
+      if(bn_is_less(&x2, &x1)){
+        bn_add(&x2, prime);
+      }
+      bn_subtract(&x2, &x1, &x2);
+    }
+  }
+  *x = bn_is_equal(&u, &one) ? x1 : x2;
+}
+
+MU_TEST(test_inverse_safegcd) {
+  // random values and edge cases mod p and n, against x^(prime-2) and binary EEA
+  const bignum256 * primes[] = { &secp256k1.prime, &secp256k1.order };
+  uint8_t buf[32] = {0};
+  for(int j=0; j<2; j++){
+    const bignum256 * prime = primes[j];
+    for(uint8_t i=0; i<64; i++){
+      bignum256 x, inv, ref, fast;
+      if(i == 0){
+        bn_one(&x);
+      }else if(i == 1){
+        bn_read_uint32(2, &x);
+      }else if(i == 2){
+        x = *prime;
+        x.val[0] -= 1;
+      }else if(i == 3){
+        // not reduced
+        x = *prime;
+        bn_addi(&x, 5);
+      }else{
+        sha256(buf, 32, buf);
+        bn_read_be(buf, &x);
+        bn_fast_mod(&x, prime);
+        bn_mod(&x, prime);
+      }
+      inv = x;
+      bn_inverse_safegcd(&inv, prime);
+      mu_assert(bn_is_less(&inv, prime), "inverse is not reduced");
+      ref = x;
+      bn_inverse_fermat(&ref, prime);
+      mu_assert(bn_is_equal(&inv, &ref), "safegcd and fermat inverses differ");
+      fast = x;
+      bn_inverse_eea(&fast, prime);
+      mu_assert(bn_is_equal(&inv, &fast), "safegcd and binary EEA inverses differ");
+      bn_multiply(&x, &inv, prime);
+      bn_mod(&inv, prime);
+      bn_one(&x);
+      mu_assert(bn_is_equal(&inv, &x), "x * x^-1 is not 1");
+    }
+    bignum256 zero;
+    bn_zero(&zero);
+    bn_inverse_safegcd(&zero, prime);
+    mu_assert(bn_is_zero(&zero), "inverse of zero is not zero");
+  }
+}
+
+MU_TEST_SUITE(test_bignum) {
+  MU_RUN_TEST(test_multiply);
+  MU_RUN_TEST(test_multiply_large_c);
+  MU_RUN_TEST(test_sqrt_inverse);
+  MU_RUN_TEST(test_inverse_safegcd);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_bignum);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
@@ -0,0 +1,74 @@
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "Hash.h"
+
+using namespace std;
+
+static ECScalar scalar(uint8_t i){
+  uint8_t buf[32];
+  sha256(&i, 1, buf);
+  return ECScalar(buf, 32);
+}
+
+MU_TEST(test_scalar) {
+  ECScalar a = scalar(1);
+  ECScalar b = scalar(2);
+  ECScalar c = scalar(3);
+  mu_assert((a*b + c) - c == a*b, "a*b + c - c != a*b");
+  mu_assert(ECScalar(1u) * a == a, "1 * a != a");
+  mu_assert(a / b * b == a, "a / b * b != a");
+  mu_assert(a - a == ECScalar(0u), "a - a != 0");
+  mu_assert(-ECScalar(0u) == ECScalar(0u), "-0 != 0");
+  mu_assert(a + b == b + a, "a + b != b + a");
+  ECScalar d = a;
+  d *= b;
+  d += c;
+  d -= 5;
+  mu_assert(d == a*b + c - 5, "compound operators are wrong");
+  // limbs and bytes stay in sync
+  uint8_t buf[32], expected[32];
+  d.getSecret(buf);
+  bn_write_be(d.limbs(), expected);
+  mu_assert(memcmp(buf, expected, 32) == 0, "limbs and bytes differ");
+}
+
+MU_TEST(test_point) {
+  ECScalar a = scalar(4);
+  ECScalar b = scalar(5);
+  ECPoint p = a * GeneratorPoint;
+  ECPoint q = b * GeneratorPoint;
+  mu_assert(p.isValid() && q.isValid(), "points are invalid");
+  mu_assert(p + q == (a + b) * GeneratorPoint, "a*G + b*G != (a+b)*G");
+  mu_assert(p - q == (a - b) * GeneratorPoint, "a*G - b*G != (a-b)*G");
+  mu_assert(-p == (-a) * GeneratorPoint, "-(a*G) != (-a)*G");
+  mu_assert(p - p == InfinityPoint, "P - P is not infinity");
+  mu_assert(p + p == (a + a) * GeneratorPoint, "P + P != 2P");
+  mu_assert(b * p == (a * b) * GeneratorPoint, "b*(a*G) != (a*b)*G");
+  mu_assert(p / b * b == p, "P / b * b != P");
+  ECPoint r = p;
+  r.point[63] ^= 1;
+  mu_assert(!r.isValid(), "point not on curve is valid");
+}
+
+MU_TEST(test_private_key) {
+  // arithmetic on a private key updates its public key
+  uint8_t secret[32];
+  scalar(6).getSecret(secret);
+  PrivateKey pk(secret);
+  PublicKey pub = pk.publicKey();
+  ECScalar t = scalar(7);
+  pk += t;
+  mu_assert(pk.publicKey() == pub + t * GeneratorPoint, "public key is not updated");
+}
+
+MU_TEST_SUITE(test_curve) {
+  MU_RUN_TEST(test_scalar);
+  MU_RUN_TEST(test_point);
+  MU_RUN_TEST(test_private_key);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_curve);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
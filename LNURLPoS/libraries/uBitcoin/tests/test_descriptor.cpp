@@ -0,0 +1,187 @@
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "Descriptor.h"
+#include "PSBT.h"
+#include "Conversion.h"
+#include "OpCodes.h"
+
+using namespace std;
+
+#define MNEMONIC "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about"
+
+// "[fingerprint/path]xpub" of the account of the root
+static string account(const HDPrivateKey & root, const char * path){
+  return "[" + root.fingerprint() + "/" + string(path) + "]" + root.derive(path).xpub().xpub();
+}
+
+static string scriptHex(Descriptor & desc, uint32_t index){
+  uint8_t buf[40];
+  size_t len = desc.scriptPubkey(index, buf, sizeof(buf));
+  return toHex(buf, len);
+}
+
+MU_TEST(test_single_key) {
+  // BIP84, BIP49 and BIP86 vectors, first receive address
+  HDPrivateKey root(MNEMONIC, "");
+  Descriptor wpkh(("wpkh(" + account(root, "84h/0h/0h") + "/0/*)").c_str());
+  mu_assert(wpkh.isValid() && wpkh.isRanged() && wpkh.keysNumber() == 1, "wpkh parsing failed");
+  mu_assert(scriptHex(wpkh, 0) == "0014c0cebcd6c3d3ca8c75dc5ec62ebe55330ef910e2", "wrong wpkh script");
+  mu_assert(wpkh.scriptPubkey(0).address() == "bc1qcr8te4kr609gcawutmrza0j4xv80jy8z306fyu", "wrong wpkh address");
+
+  Descriptor nested(("sh(wpkh(" + account(root, "49h/0h/0h") + "/0/*))").c_str());
+  mu_assert(nested.scriptPubkey(0).address() == "37VucYSaXLCAsxYyAPfbSi9eh4iEcbShgf", "wrong sh(wpkh) address");
+
+  Descriptor tr(("tr(" + account(root, "86h/0h/0h") + "/0/*)").c_str());
+  mu_assert(tr.scriptLength() == 34, "wrong tr script length");
+  mu_assert(scriptHex(tr, 0) == "5120a60869f0dbcf1dc659c9cecbaf8050135ea9e8cdc487053f1dc6880949dc684c", "wrong tr script");
+  mu_assert(tr.publicKey(0, 0) == root.derive("m/86h/0h/0h/0/0").publicKey(), "wrong tr internal key");
+
+  // BIP341 wallet vector, key path only
+  Descriptor trKey("tr(d6889cb081036e0faefa3a35157ad71086b123b2b144b649798b494c300a961d)");
+  mu_assert(trKey.isValid() && !trKey.isRanged(), "tr with x-only key parsing failed");
+  mu_assert(scriptHex(trKey, 7) == "512053a1f6e454df1aa2776a2814a721372d6258050de330b3c6d10ee8f4e0dda343", "wrong tweaked key");
+
+  // expansion matches derivation past the size of the cache
+  HDPublicKey xpub = root.derive("m/84h/0h/0h").xpub();
+  for(uint32_t i=0; i<3*DESCRIPTOR_CACHE_SIZE; i++){
+    uint32_t index = (i * 5) % (2*DESCRIPTOR_CACHE_SIZE);
+    mu_assert(wpkh.scriptPubkey(index) == Script(xpub.child(0).child(index), P2WPKH), "wrong expanded script");
+  }
+  uint8_t fingerprint[4];
+  DerivationPath path = wpkh.derivation(0, 5, fingerprint);
+  mu_assert(path.valid && path.depth == 5 && path.index[0] == HARDENED_INDEX + 84 && path.index[4] == 5, "wrong derivation path");
+  mu_assert(toHex(fingerprint, 4) == root.fingerprint(), "wrong fingerprint");
+  mu_assert(wpkh.publicKey(0, 5) == root.derive(path.index, path.depth).publicKey(), "wrong public key");
+}
+
+MU_TEST(test_multisig) {
+  HDPrivateKey root(MNEMONIC, "");
+  string a = account(root, "48h/0h/0h/2h");
+  string b = account(root, "48h/0h/1h/2h");
+  HDPublicKey xa = root.derive("m/48h/0h/0h/2h/1").xpub();
+  HDPublicKey xb = root.derive("m/48h/0h/1h/2h/1").xpub();
+  Descriptor multi(("wsh(multi(1," + a + "/1/*," + b + "/1/*))").c_str());
+  Descriptor sorted(("wsh(sortedmulti(1," + a + "/1/*," + b + "/1/*))").c_str());
+  Descriptor nested(("sh(wsh(sortedmulti(1," + a + "/1/*," + b + "/1/*)))").c_str());
+  mu_assert(multi.isValid() && sorted.isValid() && nested.isValid(), "multisig parsing failed");
+  mu_assert(multi.keysNumber() == 2, "wrong number of keys");
+  bool differ = false;
+  for(uint32_t i=0; i<10; i++){
+    uint8_t ka[33], kb[33];
+    xa.child(i).sec(ka, sizeof(ka));
+    xb.child(i).sec(kb, sizeof(kb));
+    uint8_t ms[71] = { OP_1, 33 };
+    memcpy(ms+2, ka, 33);
+    ms[35] = 33;
+    memcpy(ms+36, kb, 33);
+    ms[69] = OP_2;
+    ms[70] = OP_CHECKMULTISIG;
+    Script unsorted = Script(Script(ms, sizeof(ms)), P2WSH);
+    mu_assert(multi.scriptPubkey(i) == unsorted, "wrong multi script");
+    if(memcmp(ka, kb, 33) > 0){
+      memcpy(ms+2, kb, 33);
+      memcpy(ms+36, ka, 33);
+      differ = true;
+    }
+    Script witnessScript(ms, sizeof(ms));
+    mu_assert(sorted.scriptPubkey(i) == Script(witnessScript, P2WSH), "wrong sortedmulti script");
+    mu_assert(nested.scriptPubkey(i) == Script(Script(witnessScript, P2WSH), P2SH), "wrong sh(wsh) script");
+  }
+  mu_assert(differ, "keys are never reordered");
+}
+
+MU_TEST(test_large_multisig) {
+  // thresholds and numbers of keys above 16 are pushed as 2 bytes
+  HDPrivateKey root(MNEMONIC, "");
+  const size_t sizes[][2] = { { 17, 17 }, { 20, 20 }, { 3, 20 } };
+  for(size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++){
+    size_t threshold = sizes[s][0], num = sizes[s][1];
+    string desc = "multi(" + to_string(threshold);
+    uint8_t ms[3 + 34*DESCRIPTOR_MAX_KEYS + 2];
+    size_t l = 0;
+    if(threshold > 16){
+      ms[l++] = 1;
+      ms[l++] = threshold;
+    }else{
+      ms[l++] = OP_1 + threshold - 1;
+    }
+    for(size_t i=0; i<num; i++){
+      string path = "48h/0h/" + to_string(i) + "h/2h";
+      desc += "," + account(root, path.c_str()) + "/0/*";
+      ms[l++] = 33;
+      root.derive(("m/" + path + "/0/3").c_str()).publicKey().sec(ms+l, 33);
+      l += 33;
+    }
+    desc += ")";
+    if(num > 16){
+      ms[l++] = 1;
+      ms[l++] = num;
+    }else{
+      ms[l++] = OP_1 + num - 1;
+    }
+    ms[l++] = OP_CHECKMULTISIG;
+    Script witnessScript(ms, l);
+    Descriptor wsh(("wsh(" + desc + ")").c_str());
+    Descriptor nested(("sh(wsh(" + desc + "))").c_str());
+    mu_assert(wsh.isValid() && nested.isValid(), "large multisig rejected");
+    mu_assert(wsh.scriptPubkey(3) == Script(witnessScript, P2WSH), "wrong large wsh(multi) script");
+    mu_assert(nested.scriptPubkey(3) == Script(Script(witnessScript, P2WSH), P2SH), "wrong large sh(wsh(multi)) script");
+  }
+}
+
+MU_TEST(test_parsing) {
+  HDPrivateKey root(MNEMONIC, "");
+  string desc = "wpkh(" + account(root, "84h/0h/0h") + "/0/*)";
+  char checksum[10];
+  descriptorChecksum(desc.c_str(), desc.length(), checksum, sizeof(checksum));
+  string withChecksum = desc + "#" + checksum;
+  mu_assert(Descriptor(withChecksum.c_str()).isValid(), "valid checksum rejected");
+  withChecksum[withChecksum.length()-1] ^= 1;
+  mu_assert(!Descriptor(withChecksum.c_str()).isValid(), "invalid checksum accepted");
+
+  string xpub = root.derive("m/84h/0h/0h").xpub().xpub();
+  Descriptor fixed(("wpkh(" + xpub + "/0/3)").c_str());
+  mu_assert(fixed.isValid() && !fixed.isRanged(), "xpub with a fixed path rejected");
+  mu_assert(fixed.scriptPubkey(100) == Script(root.derive("m/84h/0h/0h/0/3").publicKey(), P2WPKH), "wrong fixed script");
+  const char * pub = "02c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5";
+  Descriptor pkh((string("pkh(") + pub + ")").c_str());
+  mu_assert(pkh.scriptPubkey(0) == Script(PublicKey(pub), P2PKH), "wrong pkh script");
+
+  const string invalid[] = {
+    "wpkh(" + xpub + "/0h/*)",        // hardened derivation from xpub
+    "wpkh(" + xpub + "/0/*h)",
+    "wpkh(" + xpub + "/0/*",          // missing bracket
+    "wpkh(" + xpub + "//0/*)",
+    "wsh(wpkh(" + xpub + "))",
+    "sh(pkh(" + xpub + "))",
+    "wsh(multi(3," + xpub + "," + xpub + "))",
+    "wsh(multi(0," + xpub + "))",
+    "multi(1," + xpub + ")",
+    "tr(" + string(pub) + ")",        // tr needs x-only keys
+    "wpkh(" + string(pub+2) + ")",
+    "wpkh([d34db33f]" + string(pub) + "/0)",
+    "wpkh([d34db33f/]" + string(pub) + ")",
+    "wpkh(" + xpub + "," + xpub + ")",
+    "tr(" + xpub + "/0/*,{pk(" + string(pub+2) + ")})", // script trees are not supported
+  };
+  for(size_t i=0; i<sizeof(invalid)/sizeof(invalid[0]); i++){
+    mu_assert(!Descriptor(invalid[i].c_str()).isValid(), "invalid descriptor accepted");
+  }
+  Descriptor origin((string("wpkh([d34db33f/49'/0'/0']") + pub + ")").c_str());
+  uint8_t fingerprint[4];
+  DerivationPath path = origin.derivation(0, 0, fingerprint);
+  mu_assert(origin.isValid() && toHex(fingerprint, 4) == "d34db33f" && path.depth == 3, "wrong key origin");
+}
+
+MU_TEST_SUITE(test_descriptor) {
+  MU_RUN_TEST(test_single_key);
+  MU_RUN_TEST(test_multisig);
+  MU_RUN_TEST(test_large_multisig);
+  MU_RUN_TEST(test_parsing);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_descriptor);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
@@ -0,0 +1,241 @@
+#include "minunit.h"
+#include "Conversion.h"
+#include "Hash.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+#include "utility/trezor/rfc6979.h"
+
+using namespace std;
+
+MU_TEST(test_rfc6979) {
+  // private key 1, message "Satoshi Nakamoto"
+  uint8_t priv[32] = {0};
+  priv[31] = 1;
+  uint8_t hash[32];
+  sha256("Satoshi Nakamoto", hash);
+  rfc6979_state rng;
+  init_rfc6979(priv, hash, &rng);
+  uint8_t k[32];
+  generate_rfc6979(k, &rng);
+  mu_assert(strcmp(toHex(k, 32).c_str(), "8f8a276c19f4149656b280621e358cce24f5f52542772691ee69063b74f15d15") == 0,
+    "first k is wrong");
+  // next numbers, used only if k is rejected
+  generate_rfc6979(k, &rng);
+  mu_assert(strcmp(toHex(k, 32).c_str(), "f15fb763a6bcbbacbde0a6a9ae2a02482bd92f3e75a50b357bd551ddd771045e") == 0,
+    "second k is wrong");
+  generate_rfc6979(k, &rng);
+  mu_assert(strcmp(toHex(k, 32).c_str(), "872b0d837884b32fafbcc50e31a1d92ff5ec12c2db539d36b0a7e69c24ef9999") == 0,
+    "third k is wrong");
+
+  uint8_t sig[64];
+  mu_assert(ecdsa_sign_digest(&secp256k1, priv, hash, sig, NULL, NULL) == 0, "signing failed");
+  mu_assert(strcmp(toHex(sig, 64).c_str(),
+    "934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+    "2442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e5") == 0,
+    "signature is wrong");
+}
+
+MU_TEST(test_sign_batch) {
+  uint8_t priv[32];
+  fromHex("c9afa9d845ba75166b5c215767b1d6934e50c3db36e89b127b8a622b120f6721", priv, 32);
+  const char * expected[] = {
+    "063f5362486d369c61e17d8e9829deb949c8b78c5c2d5d3b4a170c3b70e66988"
+    "4e3c0f5ec88d20009d80486053961955c5aa3203ba5530c0fd3961fd032bbc97",
+    "88b29ae4d2c2a7beec7a6924f7ddc26b31b928af6d4fce7f825ea6609a8f51c8"
+    "0519010619bb8183c1b3787b566568d989053c572a5a26496893adf8d0257898",
+    "ec4e0e2af2f98f45ec5d47a342c375757799c0a3c45df4918a49e9ade93326f0"
+    "5ec94202d5214b5032b0c7a88746d2fe2aca700132e42fcbe7844feed2eb59a3",
+  };
+  uint8_t hashes[3*32];
+  for(uint8_t i=0; i<3; i++){
+    sha256(&i, 1, hashes + 32*i);
+  }
+  uint8_t sigs[3*64];
+  uint8_t by[3];
+  mu_assert(ecdsa_sign_digest_batch(&secp256k1, priv, hashes, 3, sigs, by, NULL) == 0, "batch signing failed");
+  for(int i=0; i<3; i++){
+    mu_assert(strcmp(toHex(sigs + 64*i, 64).c_str(), expected[i]) == 0, "batch signature is wrong");
+    uint8_t sig[64];
+    uint8_t by1;
+    ecdsa_sign_digest(&secp256k1, priv, hashes + 32*i, sig, &by1, NULL);
+    mu_assert(memcmp(sig, sigs + 64*i, 64) == 0 && by1 == by[i], "batch and single signatures differ");
+  }
+}
+
+MU_TEST(test_verify_recover) {
+  uint8_t priv[32], pub[65], digest[32], sig[64], recovered[65];
+  uint8_t by;
+  for(uint8_t i=0; i<8; i++){
+    sha256(&i, 1, priv);
+    sha256(priv, 32, digest);
+    ecdsa_get_public_key65(&secp256k1, priv, pub);
+    ecdsa_sign_digest(&secp256k1, priv, digest, sig, &by, NULL);
+    mu_assert(ecdsa_verify_digest(&secp256k1, pub, sig, digest) == 0, "valid signature rejected");
+    mu_assert(ecdsa_recover_pub_from_sig(&secp256k1, recovered, sig, digest, by) == 0, "recovery failed");
+    mu_assert(memcmp(pub, recovered, 65) == 0, "wrong pubkey recovered");
+    digest[0] ^= 1;
+    mu_assert(ecdsa_verify_digest(&secp256k1, pub, sig, digest) != 0, "invalid signature accepted");
+  }
+}
+
+MU_TEST(test_point_multiply_double) {
+  // k1 * G + k2 * P against separate multiplications
+  uint8_t buf[32];
+  bignum256 k1, k2, k3;
+  curve_point p, a, b;
+  for(uint8_t i=0; i<8; i++){
+    sha256(&i, 1, buf);
+    bn_read_be(buf, &k1);
+    sha256(buf, 32, buf);
+    bn_read_be(buf, &k2);
+    sha256(buf, 32, buf);
+    bn_read_be(buf, &k3);
+    bn_mod(&k1, &secp256k1.order);
+    bn_mod(&k2, &secp256k1.order);
+    bn_mod(&k3, &secp256k1.order);
+    if(i == 0){
+      bn_zero(&k1);
+    }
+    if(i == 1){
+      bn_zero(&k2);
+    }
+    scalar_multiply(&secp256k1, &k3, &p);
+    point_multiply_double(&secp256k1, &k1, &k2, &p, &a);
+    scalar_multiply(&secp256k1, &k1, &b);
+    point_multiply(&secp256k1, &k2, &p, &p);
+    point_add(&secp256k1, &p, &b);
+    mu_assert(point_is_equal(&a, &b), "point_multiply_double result is wrong");
+  }
+}
+
+MU_TEST(test_point_multiply) {
+  // k * (m * G) against (k * m) * G from the precomputed table,
+  // including scalars with GLV halves close to 0 and 2^128,
+  // with and without the endomorphism
+  const char * scalars[] = {
+    "0000000000000000000000000000000000000000000000000000000000000001",
+    "0000000000000000000000000000000000000000000000000000000000000002",
+    "00000000000000000000000000000000ffffffffffffffffffffffffffffffff",
+    "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140", // n-1
+    "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72", // lambda
+    "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd73", // lambda+1
+    "ac9c52b33fa3cf1f5ad9e3fd77ed9ba4a880b9fc8ec739c2e0cfc810b51283ce", // lambda^2
+  };
+  uint8_t buf[32];
+  bignum256 k, m, km;
+  curve_point p, a, b;
+  // generic code path of curves without an endomorphism
+  ecdsa_curve nog = secp256k1;
+  nog.glv = NULL;
+  for(uint8_t i=0; i<16; i++){
+    if(i < sizeof(scalars)/sizeof(scalars[0])){
+      fromHex(scalars[i], buf, 32);
+    }else{
+      sha256(&i, 1, buf);
+    }
+    bn_read_be(buf, &k);
+    bn_mod(&k, &secp256k1.order);
+    sha256(buf, 32, buf);
+    bn_read_be(buf, &m);
+    bn_mod(&m, &secp256k1.order);
+
+    point_multiply(&secp256k1, &k, &secp256k1.G, &a);
+    scalar_multiply(&secp256k1, &k, &b);
+    mu_assert(point_is_equal(&a, &b), "k * G is wrong");
+
+    scalar_multiply(&secp256k1, &m, &p);
+    point_multiply(&secp256k1, &k, &p, &a);
+    km = k;
+    bn_multiply(&m, &km, &secp256k1.order);
+    bn_mod(&km, &secp256k1.order);
+    scalar_multiply(&secp256k1, &km, &b);
+    mu_assert(point_is_equal(&a, &b), "k * P is wrong");
+    point_multiply(&nog, &k, &p, &a);
+    mu_assert(point_is_equal(&a, &b), "k * P without endomorphism is wrong");
+  }
+}
+
+MU_TEST(test_scalar_multiply_add_batch) {
+  // p + k[i] * G against scalar_multiply and point_add,
+  // including k = 0, p = k * G (doubling) and p = -k * G (infinity)
+  const size_t n = DERIVE_BATCH_SIZE + 5;
+  uint8_t buf[32];
+  bignum256 m, k[n];
+  curve_point p, res[n], expected;
+  sha256("parent", buf);
+  bn_read_be(buf, &m);
+  bn_mod(&m, &secp256k1.order);
+  scalar_multiply(&secp256k1, &m, &p);
+  for(uint8_t i=0; i<n; i++){
+    sha256(&i, 1, buf);
+    bn_read_be(buf, &k[i]);
+    bn_mod(&k[i], &secp256k1.order);
+  }
+  bn_zero(&k[1]);
+  k[2] = m;
+  bn_subtract(&secp256k1.order, &m, &k[n-1]);
+  scalar_multiply_add_batch(&secp256k1, &p, n, k, res);
+  for(size_t i=0; i<n; i++){
+    scalar_multiply(&secp256k1, &k[i], &expected);
+    point_add(&secp256k1, &p, &expected);
+    mu_assert(point_is_equal(&res[i], &expected), "p + k * G is wrong");
+  }
+  mu_assert(point_is_infinity(&res[n-1]), "p - p should be infinity");
+}
+
+MU_TEST(test_verify_batch) {
+  // mix of valid and invalid signatures over several groups,
+  // results should match ecdsa_verify_digest one by one
+  const size_t n = 40;
+  uint8_t priv[32], pubs[n][65], sigs[n*64], digests[n*32];
+  const uint8_t * pub_keys[n];
+  int results[n];
+  for(uint8_t i=0; i<n; i++){
+    sha256(&i, 1, priv);
+    sha256(priv, 32, digests + 32*i);
+    if(i % 2){
+      ecdsa_get_public_key33(&secp256k1, priv, pubs[i]);
+    }else{
+      ecdsa_get_public_key65(&secp256k1, priv, pubs[i]);
+    }
+    ecdsa_sign_digest(&secp256k1, priv, digests + 32*i, sigs + 64*i, NULL, NULL);
+    pub_keys[i] = pubs[i];
+    switch(i % 7){
+      case 1: // wrong digest
+        digests[32*i] ^= 1;
+        break;
+      case 3: // invalid public key
+        pubs[i][0] = 0x05;
+        break;
+      case 5: // r = 0
+        memset(sigs + 64*i, 0, 32);
+        break;
+    }
+  }
+  size_t failed = ecdsa_verify_digest_batch(&secp256k1, n, pub_keys, sigs, digests, results);
+  size_t expected_failed = 0;
+  for(size_t i=0; i<n; i++){
+    int res = ecdsa_verify_digest(&secp256k1, pub_keys[i], sigs + 64*i, digests + 32*i);
+    mu_assert(res == results[i], "batch result differs from single verification");
+    mu_assert((res == 0) == (i % 7 != 1 && i % 7 != 3 && i % 7 != 5), "unexpected verification result");
+    expected_failed += (res != 0);
+  }
+  mu_assert(failed == expected_failed, "wrong number of invalid signatures");
+  mu_assert(ecdsa_verify_digest_batch(&secp256k1, 0, pub_keys, sigs, digests, results) == 0, "empty batch failed");
+}
+
+MU_TEST_SUITE(test_ecdsa) {
+  MU_RUN_TEST(test_rfc6979);
+  MU_RUN_TEST(test_sign_batch);
+  MU_RUN_TEST(test_verify_recover);
+  MU_RUN_TEST(test_point_multiply);
+  MU_RUN_TEST(test_point_multiply_double);
+  MU_RUN_TEST(test_scalar_multiply_add_batch);
+  MU_RUN_TEST(test_verify_batch);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_ecdsa);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
@@ -1,6 +1,8 @@
 #include "minunit.h"
 #include "Hash.h"  // all single-line hashing algorithms
 #include "Conversion.h" // to print byte arrays in hex format
+#include "utility/trezor/multibuf.h"
+#include "utility/trezor/hmac.h"
 
 using namespace std;
 
@@ -44,6 +46,25 @@ MU_TEST(test_hash160) {
   mu_assert(strcmp(hexresult.c_str(), "621281c15fb62d5c6013ea29007491e8b174e1b9") == 0, "hash160 is wrong");
 }
 
+MU_TEST(test_hash160_multi) {
+  // 11 messages so both full and partial lane groups are covered
+  const size_t count = 11;
+  uint8_t hashes[count*20];
+  uint8_t expected[20];
+  for(size_t len = 0; len <= 65; len += 13){
+    uint8_t data[count*65];
+    for(size_t i=0; i<sizeof(data); i++){
+      data[i] = (uint8_t)(i*7+len);
+    }
+    int res = hash160_multi(data, len, count, hashes);
+    mu_assert(res == count*20, "hash160_multi returned wrong length");
+    for(size_t i=0; i<count; i++){
+      hash160(data+i*len, len, expected);
+      mu_assert(memcmp(expected, hashes+i*20, 20) == 0, "hash160_multi doesn't match hash160");
+    }
+  }
+}
+
 MU_TEST(test_doublesha256) {
   uint8_t hash[32];
   int hashLen = doubleSha(message, hash);
@@ -58,12 +79,75 @@ MU_TEST(test_sha512) {
   mu_assert(strcmp(hexresult.c_str(), "f6cde2a0f819314cdde55fc227d8d7dae3d28cc556222a0a8ad66d91ccad4aad6094f517a2182360c9aacf6a3dc323162cb6fd8cdffedb0fe038f55e85ffb5b6") == 0, "sha512 is wrong");
 }
 
+MU_TEST(test_sha512_hmac_multi) {
+  // BIP32 child derivation data and longer messages that fall back to one at a time
+  const size_t count = 7;
+  uint8_t key[32];
+  uint8_t hmacs[count*64];
+  uint8_t expected[64];
+  for(size_t i=0; i<sizeof(key); i++){
+    key[i] = (uint8_t)(i*3);
+  }
+  const size_t lengths[] = { 0, 37, 111, 112, 150 };
+  for(size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++){
+    size_t len = lengths[k];
+    uint8_t data[count*150];
+    for(size_t i=0; i<sizeof(data); i++){
+      data[i] = (uint8_t)(i*5+len);
+    }
+    int res = sha512Hmac_multi(key, sizeof(key), data, len, count, hmacs);
+    mu_assert(res == count*64, "sha512Hmac_multi returned wrong length");
+    for(size_t i=0; i<count; i++){
+      sha512Hmac(key, sizeof(key), data+i*len, len, expected);
+      mu_assert(memcmp(expected, hmacs+i*64, 64) == 0, "sha512Hmac_multi doesn't match sha512Hmac");
+    }
+  }
+}
+
+MU_TEST(test_multibuf_lengths) {
+  // messages longer than one block go through the scalar fallback,
+  // stride is larger than the message to catch offset mistakes
+  const size_t count = 5;
+  const size_t stride = 160;
+  uint8_t data[count*stride];
+  for(size_t i=0; i<sizeof(data); i++){
+    data[i] = (uint8_t)(i*11+3);
+  }
+  uint8_t key[] = "Bitcoin seed";
+  uint64_t opad[8], ipad[8];
+  ubtc_hmac_sha512_prepare(key, sizeof(key)-1, opad, ipad);
+  uint8_t digests[count*64];
+  uint8_t expected[64];
+  const size_t lengths[] = { 55, 56, 64, 111, 112, 150 };
+  for(size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++){
+    size_t len = lengths[k];
+    multibuf_sha256(data, len, stride, count, digests);
+    for(size_t i=0; i<count; i++){
+      sha256(data+i*stride, len, expected);
+      mu_assert(memcmp(expected, digests+i*32, 32) == 0, "multibuf_sha256 is wrong");
+    }
+    multibuf_hash160(data, len, stride, count, digests);
+    for(size_t i=0; i<count; i++){
+      hash160(data+i*stride, len, expected);
+      mu_assert(memcmp(expected, digests+i*20, 20) == 0, "multibuf_hash160 is wrong");
+    }
+    multibuf_hmac_sha512(opad, ipad, data, len, stride, count, digests);
+    for(size_t i=0; i<count; i++){
+      sha512Hmac(key, sizeof(key)-1, data+i*stride, len, expected);
+      mu_assert(memcmp(expected, digests+i*64, 64) == 0, "multibuf_hmac_sha512 is wrong");
+    }
+  }
+}
+
 MU_TEST_SUITE(test_hash) {
   MU_RUN_TEST(test_sha256);
   MU_RUN_TEST(test_ripemd160);
   MU_RUN_TEST(test_hash160);
+  MU_RUN_TEST(test_hash160_multi);
   MU_RUN_TEST(test_doublesha256);
   MU_RUN_TEST(test_sha512);
+  MU_RUN_TEST(test_sha512_hmac_multi);
+  MU_RUN_TEST(test_multibuf_lengths);
 }
 
 int main(int argc, char *argv[]) {
@@ -12,8 +12,272 @@ MU_TEST(test_password) {
   mu_assert(strcmp(hd.xprv().c_str(), "xprv9s21ZrQH143K3a5zf698hDA7tWk75bUs2aK5ZUzsSHPxk6MUv2NqUM8NwzFLKqeLeeaH3VGxTcLBgyE9vHYWVnY6JjkuCw9k4HpxHPnodhs") == 0, "Root xprv is invalid");
 }
 
+MU_TEST(test_lazy_pubkey) {
+  // public key is computed on first use, copies keep it,
+  // changing the secret invalidates it
+  HDPrivateKey hd(MNEMONIC, PASSWORD);
+  HDPrivateKey child = hd.derive("m/84h/0h/0h/0/3");
+  HDPrivateKey copy = child;
+  uint8_t secret[32];
+  child.getSecret(secret);
+  PrivateKey pk(secret);
+  mu_assert(child.publicKey() == pk * GeneratorPoint, "wrong child public key");
+  mu_assert(copy.publicKey() == child.publicKey(), "copy has a different public key");
+  mu_assert(child.xpub().xpub() == hd.derive("m/84h/0h/0h/").xpub().derive("m/0/3").xpub(), "private and public derivation differ");
+  secret[31] ^= 1;
+  copy.setSecret(secret);
+  mu_assert(copy.publicKey() == PrivateKey(secret) * GeneratorPoint, "public key is not updated");
+  mu_assert(copy.publicKey() != child.publicKey(), "stale public key");
+  mu_assert(strcmp(pk.wif().c_str(), PrivateKey(pk.wif().c_str()).wif().c_str()) == 0, "wif roundtrip failed");
+}
+
+MU_TEST(test_word_lookup) {
+  // perfect hash lookup and completion against a linear scan of the wordlist
+  for(uint16_t i=0; i<2048; i++){
+    const char * word = mnemonicWord(i);
+    size_t len = strlen(word);
+    mu_assert(mnemonicWordIndex(word, len) == i, "wrong word index");
+    for(size_t l=0; l<=len; l++){
+      uint16_t first = 0xFFFF;
+      size_t expected = 0, expectedFirst = 0;
+      for(uint16_t j=0; j<2048; j++){
+        if(strncmp(mnemonicWord(j), word, l) == 0){
+          if(expected == 0){
+            expectedFirst = j;
+          }
+          expected++;
+        }
+      }
+      mu_assert(mnemonicComplete(word, l, &first) == expected, "wrong number of completions");
+      mu_assert(first == expectedFirst, "wrong first completion");
+    }
+  }
+  const char * invalid[] = { "", "aban", "abandons", "abandox", "Abandon", "zzzz", "actio", "a1" };
+  for(size_t i=0; i<sizeof(invalid)/sizeof(invalid[0]); i++){
+    mu_assert(mnemonicWordIndex(invalid[i], strlen(invalid[i])) == -1, "invalid word found");
+  }
+  mu_assert(mnemonicComplete("zzz", 3) == 0 && mnemonicComplete("abandonx", 8) == 0, "invalid prefix completed");
+  mu_assert(mnemonicComplete("zoo", 3) == 1 && mnemonicComplete("", 0) == 2048, "wrong number of completions");
+  uint8_t parsed[16];
+  const char * known = "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about";
+  mu_assert(mnemonicToEntropy(known, strlen(known), parsed, sizeof(parsed)) == 16, "valid mnemonic rejected");
+  const char * unknown = "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandox about";
+  mu_assert(mnemonicToEntropy(unknown, strlen(unknown), parsed, sizeof(parsed)) == 0, "unknown word accepted");
+  mu_assert(mnemonicWord(2048) == NULL, "word out of range");
+  const char * valid = "flight canvas heart purse potato mixed offer tooth maple blue kitten salute "
+                       "almost staff physical remain coral clump midnight rotate innocent shield inch ski";
+  mu_assert(checkMnemonic(valid), "valid mnemonic rejected");
+  mu_assert(!checkMnemonic("flight canvas heart purse potato mixed offer tooth maple blue kitten salute "
+                           "almost staff physical remain coral clump midnight rotate innocent shield inch skis"), "misspelled mnemonic accepted");
+  mu_assert(!checkMnemonic("flight canvas heart purse potato mixed offer tooth maple blue kitten salute "
+                           "almost staff physical remain coral clump midnight rotate innocent shield inch inch"), "wrong checksum accepted");
+  // word indexes against the string check, every length and every last word
+  uint8_t entropy[32] = { 0 };
+  for(size_t len=16; len<=32; len+=8){
+    entropy[0]++;
+    char mnemonic[24*10];
+    strcpy(mnemonic, mnemonicFromEntropy(entropy, len));
+    uint16_t words[24];
+    size_t n = 0;
+    for(char * w = strtok(mnemonic, " "); w != NULL; w = strtok(NULL, " ")){
+      words[n++] = mnemonicWordIndex(w, strlen(w));
+    }
+    mu_assert(n == len*3/4 && checkMnemonic(words, n), "valid word indexes rejected");
+    size_t accepted = 0;
+    for(uint16_t k=0; k<2048; k++){
+      words[n-1] = k;
+      bool ok = checkMnemonic(words, n);
+      accepted += ok;
+      if(k % 128 == 0 || ok){
+        char buf[24*10] = "";
+        for(size_t i=0; i<n; i++){
+          strcat(buf, mnemonicWord(words[i]));
+          strcat(buf, (i+1 < n) ? " " : "");
+        }
+        mu_assert(ok == checkMnemonic(buf), "word indexes and string checks differ");
+      }
+    }
+    // checksum has len/4 bits
+    mu_assert(accepted == (2048u >> (len/4)), "wrong number of valid last words");
+  }
+  uint16_t words[12] = { 0 };
+  mu_assert(!checkMnemonic(words, 11) && !checkMnemonic(words, 25), "wrong number of words accepted");
+  words[3] = 2048;
+  mu_assert(!checkMnemonic(words, 12), "out of range word index accepted");
+}
+
+#if __cplusplus >= 201402L
+// parsed by the compiler
+constexpr DerivationPath BIP84_ACCOUNT("m/84h/0h/0h");
+static_assert(BIP84_ACCOUNT.valid && BIP84_ACCOUNT.depth == 3, "constexpr path is not parsed");
+static_assert(BIP84_ACCOUNT.index[0] == HARDENED_INDEX + 84 && BIP84_ACCOUNT.index[2] == HARDENED_INDEX, "wrong constexpr path");
+static_assert(!DerivationPath("m/84h/x").valid, "invalid constexpr path accepted");
+static_assert(!DerivationPath("m/4294967296").valid, "overflowing constexpr index accepted");
+#endif
+
+MU_TEST(test_derivation_path) {
+  struct { const char * path; bool valid; uint8_t depth; uint32_t last; } cases[] = {
+    { "", true, 0, 0 },
+    { "m", true, 0, 0 },
+    { "m/", true, 0, 0 },
+    { "m/84h/0'/0H/1/23/", true, 5, 23 },
+    { "84h/0h", true, 2, HARDENED_INDEX },
+    { "m/2147483647", true, 1, 0x7FFFFFFF },
+    { "m/2147483648", false, 0, 0 },
+    { "m/2147483647h", true, 1, 0xFFFFFFFF },
+    { "m/4294967296", false, 0, 0 },
+    { "m/4294967297", false, 0, 0 },
+    { "m/42949672970", false, 0, 0 },
+    { "m/0000000000001", true, 1, 1 },
+    { "m/1/2/3/4/5/6/7/8/9/10", true, 10, 10 },
+    { "m/1/2/3/4/5/6/7/8/9/10/11", false, 0, 0 },
+    { "m//1", false, 0, 0 },
+    { "/1", false, 0, 0 },
+    { "m/h", false, 0, 0 },
+    { "m/1hh", false, 0, 0 },
+    { "m/1h2", false, 0, 0 },
+    { "m/-1", false, 0, 0 },
+    { "mm/1", false, 0, 0 },
+  };
+  for(size_t i=0; i<sizeof(cases)/sizeof(cases[0]); i++){
+    DerivationPath p(cases[i].path);
+    mu_assert(p.valid == cases[i].valid, "wrong path validity");
+    if(p.valid){
+      mu_assert(p.depth == cases[i].depth, "wrong path depth");
+      mu_assert(p.depth == 0 || p.index[p.depth-1] == cases[i].last, "wrong path index");
+    }
+  }
+  HDPrivateKey hd(MNEMONIC, PASSWORD);
+  DerivationPath account("m/84h/0h/0h/");
+  HDPrivateKey expected = hd.child(84, true).child(0, true).child(0, true).child(1).child(7);
+  mu_assert(hd.derive(account.child(1).child(7)).xprv() == expected.xprv(), "derivation with DerivationPath is wrong");
+  mu_assert(hd.derive("m/84'/0'/0'/1/7").xprv() == expected.xprv(), "derivation with a string path is wrong");
+  mu_assert(hd.derive("m").xprv() == hd.xprv(), "empty path should return the key");
+  mu_assert(!hd.derive("m/84h/x"), "invalid path should give invalid key");
+  HDPublicKey xpub = hd.derive(account).xpub();
+  mu_assert(xpub.derive(DerivationPath("m/1/7")).xpub() == expected.xpub().xpub(), "public derivation with DerivationPath is wrong");
+  mu_assert(xpub.derive("1/7").xpub() == expected.xpub().xpub(), "public derivation with a string path is wrong");
+  mu_assert(!xpub.derive("m/1h/7"), "hardened public derivation should fail");
+}
+
+MU_TEST(test_derivation_cache) {
+  // derive() resumes from cached intermediate keys, results should match
+  // step by step derivation with more paths than the cache can keep
+  HDPrivateKey hd(MNEMONIC, PASSWORD);
+  HDPublicKey account = hd.derive("m/84h/0h/0h/").xpub();
+  for(uint32_t i=0; i<3*BIP32_CACHE_SIZE; i++){
+    uint32_t branch = i % 3;
+    uint32_t path[] = { HARDENED_INDEX+84, HARDENED_INDEX, HARDENED_INDEX+branch, i % 2, i };
+    HDPrivateKey expected = hd.child(84, true).child(0, true).child(branch, true).child(i % 2).child(i);
+    mu_assert(hd.derive(path, 5).xprv() == expected.xprv(), "cached private derivation is wrong");
+    mu_assert(account.derive(path+3, 2).xpub() == account.child(i % 2).child(i).xpub(), "cached public derivation is wrong");
+  }
+  // same chain code, different secret
+  uint8_t secret[32];
+  hd.getSecret(secret);
+  secret[0] ^= 1;
+  HDPrivateKey other(secret, hd.chainCode);
+  uint8_t otherSecret[32];
+  other.getSecret(otherSecret);
+  mu_assert(memcmp(otherSecret, secret, 32) == 0, "secret is not set");
+  mu_assert(other.derive("m/84h/0h/0h/0/1").xprv() == other.child(84, true).child(0, true).child(0, true).child(0).child(1).xprv(),
+    "key with the same chain code got cached children");
+  clearDerivationCache();
+  mu_assert(hd.derive("m/84h/0h/0h/1/7").xprv() == hd.child(84, true).child(0, true).child(0, true).child(1).child(7).xprv(),
+    "derivation after clearing the cache is wrong");
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+
+struct CacheWorker{
+  HDPublicKey account;
+  const HDPrivateKey * root; // shared by all workers
+  uint32_t first;
+  bool ok;
+};
+
+static void * cacheWorkerRun(void * arg){
+  CacheWorker * w = (CacheWorker *)arg;
+  w->ok = true;
+  for(uint32_t i=0; i<50; i++){
+    // different branches share the cache and evict each other's entries
+    uint32_t path[] = { (w->first + i) % 7, i };
+    if(w->account.derive(path, 2).xpub() != w->account.child(path[0]).child(i).xpub()){
+      w->ok = false;
+    }
+    uint32_t full[] = { HARDENED_INDEX+84, HARDENED_INDEX, HARDENED_INDEX, path[0], i };
+    if(w->root->derive(full, 5).xpub().xpub() != w->account.child(path[0]).child(i).xpub()){
+      w->ok = false;
+    }
+  }
+  return NULL;
+}
+
+MU_TEST(test_derivation_cache_threads) {
+  // the cache is shared by the process, derive() from several threads,
+  // private keys from one shared root
+  HDPrivateKey hd(MNEMONIC, PASSWORD);
+  HDPublicKey account = hd.derive("m/84h/0h/0h/").xpub();
+  hd.publicKey(); // the key is shared, its public key is cached before starting the threads
+  CacheWorker workers[4];
+  pthread_t threads[4];
+  for(uint32_t i=0; i<4; i++){
+    workers[i].account = account;
+    workers[i].root = &hd;
+    workers[i].first = i;
+    mu_assert(pthread_create(&threads[i], NULL, cacheWorkerRun, &workers[i]) == 0, "can't start a thread");
+  }
+  for(uint32_t i=0; i<4; i++){
+    pthread_join(threads[i], NULL);
+    mu_assert(workers[i].ok, "derivation from a thread is wrong");
+  }
+  clearDerivationCache();
+}
+#endif
+
+MU_TEST(test_derive_range) {
+  // batched children should match child() one by one for every script type,
+  // the range spans more than one group of DERIVE_BATCH_SIZE keys
+  HDPrivateKey hd(MNEMONIC, PASSWORD);
+  HDPublicKey account = hd.derive("m/84h/0h/0h/").xpub();
+  const ScriptType types[] = { P2WPKH, P2SH_P2WPKH, P2PKH, P2TR, UNKNOWN_TYPE };
+  const size_t count = 2*DERIVE_BATCH_SIZE + 3;
+  Script scripts[count];
+  char addresses[count][80];
+  for(size_t t=0; t<sizeof(types)/sizeof(types[0]); t++){
+    account.type = types[t];
+    mu_assert(account.deriveRange(1, 5, count, scripts) == count, "wrong number of scripts");
+    mu_assert(account.deriveRange(1, 5, count, addresses[0], sizeof(addresses[0])) == count, "wrong number of addresses");
+    for(size_t i=0; i<count; i++){
+      HDPublicKey child = account.child(1).child(5+i);
+      Script expected;
+      if(types[t] == P2SH_P2WPKH){
+        expected = Script(Script(child, P2WPKH), P2SH);
+      }else if(types[t] == P2TR){
+        expected = Script(child, P2TR);
+      }else{
+        expected = Script(child, types[t] == P2PKH ? P2PKH : P2WPKH);
+      }
+      mu_assert(scripts[i] == expected, "deriveRange script is wrong");
+      mu_assert(child.address() == addresses[i], "deriveRange address is wrong");
+    }
+  }
+  mu_assert(account.deriveRange(HARDENED_INDEX, 0, 1, scripts) == 0, "hardened branch should fail");
+  mu_assert(account.deriveRange(0, HARDENED_INDEX-1, 2, scripts) == 0, "hardened child should fail");
+  mu_assert(account.deriveRange(0, 0, 0, scripts) == 0, "empty range should be empty");
+}
+
 MU_TEST_SUITE(test_mnemonic) {
   MU_RUN_TEST(test_password);
+  MU_RUN_TEST(test_lazy_pubkey);
+  MU_RUN_TEST(test_word_lookup);
+  MU_RUN_TEST(test_derivation_path);
+  MU_RUN_TEST(test_derivation_cache);
+#if defined(__unix__) || defined(__APPLE__)
+  MU_RUN_TEST(test_derivation_cache_threads);
+#endif
+  MU_RUN_TEST(test_derive_range);
 }
 
 int main(int argc, char *argv[]) {
@@ -0,0 +1,265 @@
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "PSBT.h"
+
+using namespace std;
+
+#define MNEMONIC "flight canvas heart purse potato mixed offer tooth maple blue kitten salute almost staff physical remain coral clump midnight rotate innocent shield inch ski"
+// spends from m/84h/1h/0h/0/0, output 1 goes to change m/84h/1h/0h/1/0
+#define PSBT_B64 "cHNidP8BAHICAAAAAUswu6MJzSuKPVEDD3cxwoPYynvQOnUP1xIga/Qyv+icAAAAAAD9////AqCGAQAAAAAAF6kUxD/8BOj9UucJiNpagTRzluc4gvKHErsNAAAAAAAWABTZJKDg5Ayidmusul21PNw16zUy2PDlFwAAAQEfQEIPAAAAAAAWABRw5Uq2fGtsTutqAZqDMypDuQmxmSIGA3s6OgE8GCKOcHDJe7XY0q/i/XSe6e933ErCDCCKR5WoGARkI4xUAACAAQAAgAAAAIAAAAAAAAAAAAAAIgID07CelU8+BYAL87tK7Ec0+NfjojPZC/11wjTfcCoTK/4YBGQjjFQAAIABAACAAAAAgAEAAAAAAAAAAA=="
+
+MU_TEST(test_ownership_index) {
+  // scripts of several xpubs and types, lookups near the edge extend the window
+  HDPrivateKey hd(MNEMONIC, "");
+  HDPublicKey segwit = hd.derive("m/84h/1h/0h/").xpub();
+  segwit.type = P2WPKH;
+  HDPublicKey nested = hd.derive("m/49h/1h/0h/").xpub();
+  nested.type = P2SH_P2WPKH;
+  HDPublicKey legacy = hd.derive("m/44h/1h/0h/").xpub();
+  legacy.type = P2PKH;
+  OwnershipIndex index(5);
+  mu_assert(index.add(segwit) == 0, "adding xpub failed");
+  mu_assert(index.add(nested) == 1, "adding xpub failed");
+  mu_assert(index.add(legacy) == 2, "adding xpub failed");
+  mu_assert(index.size() == 3*2*5, "wrong number of scripts");
+
+  uint32_t xpub, i;
+  uint8_t branch;
+  Script nestedScript(Script(nested.child(1).child(3), P2WPKH), P2SH);
+  mu_assert(index.find(nestedScript, &xpub, &branch, &i), "nested segwit change not found");
+  mu_assert(xpub == 1 && branch == 1 && i == 3, "wrong nested segwit location");
+  mu_assert(index.size() == 3*2*5 + 4, "window is not extended after a hit");
+  mu_assert(index.find(Script(legacy.child(0).child(4), P2PKH), &xpub, &branch, &i), "legacy receive not found");
+  mu_assert(xpub == 2 && branch == 0 && i == 4, "wrong legacy location");
+  // same key with a different script type is not ours
+  mu_assert(!index.find(Script(legacy.child(0).child(4), P2WPKH)), "wrong script type found");
+  mu_assert(!index.find(Script(segwit.child(0).child(5), P2WPKH)), "script outside of the window found");
+  // walking the gap limit: every hit makes the next addresses visible
+  for(uint32_t j=0; j<40; j++){
+    mu_assert(index.find(Script(segwit.child(0).child(j), P2WPKH), &xpub, &branch, &i), "script after extension not found");
+    mu_assert(xpub == 0 && branch == 0 && i == j, "wrong segwit location");
+  }
+  mu_assert(!index.find(Script(segwit.child(0).child(46), P2WPKH)), "script outside of the window found");
+  index.clear();
+  mu_assert(index.size() == 0 && !index.find(nestedScript), "index is not cleared");
+}
+
+MU_TEST(test_ownership_scan) {
+  // many xpubs in one table, used indexes, snapshot round trips
+  HDPrivateKey hd(MNEMONIC, "");
+  HDPublicKey account = hd.derive("m/84h/1h/0h/").xpub();
+  OwnershipIndex index(3);
+  const uint32_t n = 300;
+  for(uint32_t j=0; j<n; j++){
+    mu_assert(index.add(account.child(j)) == (int)j, "adding xpub failed");
+  }
+  mu_assert(index.xpubs() == n && index.size() == n*2*3, "wrong number of scripts");
+
+  Tx tx;
+  tx.addOutput(TxOut(1000, Script(account.child(299).child(0).child(2), P2WPKH)));
+  tx.addOutput(TxOut(2000, Script(hd.derive("m/84h/1h/1h/0/0").publicKey(), P2WPKH))); // not watched
+  tx.addOutput(TxOut(3000, Script(account.child(7).child(1).child(0), P2WPKH)));
+  OwnershipIndex::Match matches[3];
+  mu_assert(index.scan(tx, matches, 3) == 2, "wrong number of matches");
+  mu_assert(matches[0].output == 0 && matches[0].xpub == 299 && matches[0].branch == 0 &&
+            matches[0].index == 2 && matches[0].amount == 1000, "wrong first match");
+  mu_assert(matches[1].output == 2 && matches[1].xpub == 7 && matches[1].branch == 1 &&
+            matches[1].index == 0 && matches[1].amount == 3000, "wrong second match");
+  mu_assert(index.used(299, 0) == 3 && index.derived(299, 0) == 6, "receive window is not extended");
+  mu_assert(index.used(7, 1) == 1 && index.derived(7, 1) == 4, "change window is not extended");
+  mu_assert(index.used(7, 0) == 0 && index.used(n, 0) == 0, "unused branch is marked");
+  mu_assert(index.scan(tx) == 2, "matches are not counted");
+
+  // aligned snapshot is used in place, unaligned one is copied
+  size_t len = index.snapshotLength();
+  uint8_t * buf = (uint8_t *)malloc(len + 8);
+  mu_assert(index.snapshot(buf, len-1) == 0, "snapshot doesn't fit");
+  mu_assert(index.snapshot(buf, len) == len, "snapshot failed");
+  for(int offset=0; offset<2; offset++){
+    if(offset){
+      memmove(buf+1, buf, len);
+    }
+    OwnershipIndex restored;
+    mu_assert(restored.load(buf+offset, len), "loading snapshot failed");
+    mu_assert(restored.xpubs() == n && restored.size() == index.size(), "wrong restored size");
+    mu_assert(restored.used(299, 0) == 3 && restored.derived(299, 0) == 6, "wrong restored state");
+    uint32_t xpub, i;
+    uint8_t branch;
+    mu_assert(restored.find(Script(account.child(299).child(0).child(5), P2WPKH), &xpub, &branch, &i), "restored script not found");
+    mu_assert(xpub == 299 && branch == 0 && i == 5, "wrong restored location");
+    // the hit extends the restored index without touching the snapshot
+    mu_assert(restored.derived(299, 0) == 9 && restored.find(Script(account.child(299).child(0).child(8), P2WPKH)), "restored index is not extended");
+    mu_assert(restored.find(Script(account.child(0).child(1).child(2), P2WPKH)), "restored script not found");
+  }
+  OwnershipIndex restored;
+  mu_assert(restored.load(buf+1, len), "snapshot was changed");
+  mu_assert(!restored.find(Script(account.child(299).child(0).child(8), P2WPKH)), "snapshot was changed");
+  buf[1+4] ^= 1; // version
+  mu_assert(!restored.load(buf+1, len) && restored.xpubs() == 0, "broken snapshot loaded");
+  mu_assert(!restored.load(buf, 10), "short snapshot loaded");
+  free(buf);
+}
+
+MU_TEST(test_ownership_snapshot_checks) {
+  // corrupted hash tables are rejected instead of being used in place
+  HDPrivateKey hd(MNEMONIC, "");
+  OwnershipIndex index(3);
+  mu_assert(index.add(hd.derive("m/84h/1h/0h/").xpub()) == 0, "adding xpub failed");
+  size_t len = index.snapshotLength();
+  uint8_t * buf = (uint8_t *)malloc(len);
+  uint8_t * copy = (uint8_t *)malloc(len);
+  mu_assert(index.snapshot(buf, len) == len, "snapshot failed");
+  // the table ends the snapshot: 64 slots of 44 bytes, key[32] xpub index keyLen type branch
+  const size_t entrySize = 44;
+  const size_t capacity = 64;
+  uint8_t * table = buf + len - capacity*entrySize;
+  size_t full = capacity, empty = capacity;
+  for(size_t i=0; i<capacity; i++){
+    if(table[i*entrySize+40] != 0){
+      full = i;
+    }else{
+      empty = i;
+    }
+  }
+  mu_assert(full < capacity && empty < capacity, "unexpected snapshot layout");
+  OwnershipIndex restored;
+  mu_assert(restored.load(buf, len) && restored.size() == 6, "valid snapshot is not loaded");
+  struct { size_t slot; size_t offset; uint8_t value; const char * msg; } cases[] = {
+    { full, 42, 2, "entry with a wrong branch loaded" },
+    { full, 32, 1, "entry with a wrong xpub loaded" },
+    { full, 40, 7, "entry with a wrong key length loaded" },
+    { full, 40, 0, "table with a wrong count loaded" },
+    { empty, 40, 20, "table with a wrong count loaded" },
+  };
+  for(size_t i=0; i<sizeof(cases)/sizeof(cases[0]); i++){
+    memcpy(copy, buf, len);
+    copy[len - capacity*entrySize + cases[i].slot*entrySize + cases[i].offset] = cases[i].value;
+    mu_assert(!restored.load(copy, len) && restored.xpubs() == 0, cases[i].msg);
+  }
+  // no empty slot left: slot() would never stop
+  memcpy(copy, buf, len);
+  uint8_t * t = copy + len - capacity*entrySize;
+  for(size_t i=0; i<capacity; i++){
+    memcpy(t + i*entrySize, table + full*entrySize, entrySize);
+  }
+  mu_assert(!restored.load(copy, len), "table without empty slots loaded");
+  free(copy);
+  free(buf);
+}
+
+MU_TEST(test_psbt_is_mine) {
+  HDPrivateKey hd(MNEMONIC, "");
+  PSBT psbt;
+  psbt.parseBase64(PSBT_B64);
+  mu_assert(bool(psbt), "psbt parsing failed");
+  OwnershipIndex index;
+  mu_assert(index.add(hd.derive("m/84h/1h/0h/").xpub()) == 0, "adding xpub failed");
+  mu_assert(!psbt.isMine(0, index), "external output is mine");
+  mu_assert(!psbt.isChange(0, index), "external output is change");
+  mu_assert(psbt.isMine(1, index) == psbt.isMine(1, hd), "index and derivation disagree");
+  mu_assert(psbt.isMine(1, index), "change output is not mine");
+  mu_assert(psbt.isChange(1, index), "change output is not change");
+  mu_assert(!psbt.isMine(2, index), "output out of range");
+}
+
+MU_TEST(test_psbt_is_mine_taproot) {
+  // BIP86 test vectors, account type is taken from the 86h path
+  HDPrivateKey hd("abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about", "");
+  OwnershipIndex index(3);
+  mu_assert(index.add(hd.derive("m/86h/0h/0h/").xpub()) == 0, "adding taproot xpub failed");
+  PSBT psbt;
+  psbt.tx.addOutput(TxOut(1000, Script(hd.derive("m/84h/0h/0h/0/0").publicKey(), P2WPKH)));
+  psbt.tx.addOutput(TxOut(2000, Script("bc1p4qhjn9zdvkux4e44uhx8tc55attvtyu358kutcqkudyccelu0was9fqzwh"))); // 0/1
+  psbt.tx.addOutput(TxOut(3000, Script("bc1p3qkhfews2uk44qtvauqyr2ttdsw7svhkl9nkm9s9c3x4ax5h60wqwruhk7"))); // 1/0
+  psbt.txOutsMeta = new PSBTOutputMetadata[3];
+  for(size_t i=0; i<3; i++){
+    psbt.txOutsMeta[i].derivationsLen = 0;
+  }
+  mu_assert(psbt.tx.txOuts[1].scriptPubkey.type() == P2TR, "taproot address is not parsed");
+  mu_assert(!psbt.isMine(0, index), "external output is mine");
+  mu_assert(psbt.isMine(1, index) && !psbt.isChange(1, index), "taproot receive output is wrong");
+  mu_assert(psbt.isMine(2, index) && psbt.isChange(2, index), "taproot change output is wrong");
+  OwnershipIndex::Match matches[2];
+  mu_assert(index.scan(psbt.tx, matches, 2) == 2, "wrong number of taproot matches");
+  mu_assert(matches[0].output == 1 && matches[0].branch == 0 && matches[0].index == 1, "wrong taproot receive match");
+  mu_assert(matches[1].output == 2 && matches[1].branch == 1 && matches[1].index == 0, "wrong taproot change match");
+  mu_assert(index.find(Script("bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr")), "first taproot address not found"); // 0/0
+}
+
+// fills input metadata of a PSBT built in memory
+static void setInput(PSBTInputMetadata & meta, const TxOut & utxo, const PublicKey & pub, const uint8_t fingerprint[4], const char * path){
+  DerivationPath p(path);
+  meta.txOut = utxo;
+  meta.signaturesLen = 0;
+  meta.derivationsLen = 1;
+  meta.derivations = new PSBTDerivation[1];
+  meta.derivations[0].pubkey = pub;
+  memcpy(meta.derivations[0].fingerprint, fingerprint, 4);
+  meta.derivations[0].derivationLen = p.depth;
+  meta.derivations[0].derivation = (uint32_t *)calloc(p.depth, sizeof(uint32_t));
+  memcpy(meta.derivations[0].derivation, p.index, p.depth*sizeof(uint32_t));
+}
+
+MU_TEST(test_psbt_sign) {
+  // more than 255 inputs from receive and change branches, legacy and hardened leaves,
+  // a foreign fingerprint and a wrong public key
+  const size_t n = 260;
+  HDPrivateKey hd(MNEMONIC, "");
+  uint8_t fingerprint[4];
+  hd.fingerprint(fingerprint);
+  PSBT psbt;
+  for(size_t i=0; i<n; i++){
+    uint8_t prev[32] = { (uint8_t)i, (uint8_t)(i >> 8) };
+    psbt.tx.addInput(TxIn(prev, i % 3));
+  }
+  psbt.tx.addOutput(TxOut(n*1000, Script(hd.derive("m/84h/1h/0h/1/1000").publicKey(), P2WPKH)));
+  psbt.txInsMeta = new PSBTInputMetadata[n];
+  psbt.txOutsMeta = new PSBTOutputMetadata[1];
+  psbt.txOutsMeta[0].derivationsLen = 0;
+  string paths[n];
+  for(size_t i=0; i<n; i++){
+    paths[i] = "m/84h/1h/0h/" + to_string(i % 2) + "/" + to_string(i / 2);
+  }
+  paths[3] = "m/44h/1h/0h/0/3";
+  paths[10] = "m/84h/1h/0h/0/7h";
+  paths[11] = "m/84h/1h/2h";
+  for(size_t i=0; i<n; i++){
+    PublicKey pub = hd.derive(paths[i].c_str()).publicKey();
+    setInput(psbt.txInsMeta[i], TxOut(1000+i, Script(pub, (i == 3) ? P2PKH : P2WPKH)), pub, fingerprint, paths[i].c_str());
+  }
+  psbt.txInsMeta[5].derivations[0].fingerprint[0] ^= 1;
+  psbt.txInsMeta[7].derivations[0].pubkey = hd.derive("m/84h/1h/0h/1/4").publicKey();
+
+  mu_assert(psbt.sign(hd) == n-2, "wrong number of signed inputs");
+  for(size_t i=0; i<n; i++){
+    if(i == 5 || i == 7){
+      mu_assert(psbt.txInsMeta[i].signaturesLen == 0, "signed with a wrong key");
+      continue;
+    }
+    PrivateKey pk = hd.derive(paths[i].c_str());
+    uint8_t h[32];
+    if(i == 3){
+      psbt.tx.sigHash(h, i, psbt.txInsMeta[i].txOut.scriptPubkey);
+    }else{
+      psbt.tx.sigHashSegwit(h, i, pk.publicKey().script(), psbt.txInsMeta[i].txOut.amount);
+    }
+    mu_assert(psbt.txInsMeta[i].signaturesLen == 1, "input is not signed");
+    mu_assert(psbt.txInsMeta[i].signatures[0].pubkey == pk.publicKey(), "wrong public key");
+    mu_assert(psbt.txInsMeta[i].signatures[0].signature == pk.sign(h), "wrong signature");
+  }
+}
+
+MU_TEST_SUITE(test_psbt) {
+  MU_RUN_TEST(test_ownership_index);
+  MU_RUN_TEST(test_ownership_scan);
+  MU_RUN_TEST(test_ownership_snapshot_checks);
+  MU_RUN_TEST(test_psbt_is_mine);
+  MU_RUN_TEST(test_psbt_is_mine_taproot);
+  MU_RUN_TEST(test_psbt_sign);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_psbt);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
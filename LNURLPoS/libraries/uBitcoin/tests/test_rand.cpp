@@ -0,0 +1,150 @@
+#include "minunit.h"
+#include "Conversion.h"
+#include "utility/trezor/rand.h"
+#include "utility/trezor/chacha_drbg.h"
+#include <unistd.h>
+#include <sys/wait.h>
+#include <pthread.h>
+
+using namespace std;
+
+MU_TEST(test_chacha20_block) {
+  // RFC 8439, section 2.3.2
+  uint8_t key[32];
+  for(int i=0; i<32; i++){
+    key[i] = i;
+  }
+  uint8_t nonce[12];
+  fromHex("000000090000004a00000000", nonce, sizeof(nonce));
+  uint8_t out[64];
+  chacha20_block(key, nonce, 1, out);
+  mu_assert(strcmp(toHex(out, sizeof(out)).c_str(),
+    "10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+    "d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e") == 0,
+    "chacha20 block is wrong");
+}
+
+MU_TEST(test_chacha20_xor) {
+  // RFC 8439, section 2.4.2
+  uint8_t key[32];
+  for(int i=0; i<32; i++){
+    key[i] = i;
+  }
+  uint8_t nonce[12];
+  fromHex("000000000000004a00000000", nonce, sizeof(nonce));
+  char text[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+  size_t len = strlen(text);
+  chacha20_xor(key, nonce, 1, (uint8_t *)text, len);
+  mu_assert(strcmp(toHex((uint8_t *)text, len).c_str(),
+    "6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0b"
+    "f91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f530c359f0861d8"
+    "07ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736"
+    "5af90bbf74a35be6b40b8eedf2785e42874d") == 0,
+    "chacha20 encryption is wrong");
+  chacha20_xor(key, nonce, 1, (uint8_t *)text, len);
+  mu_assert(text[len-1] == '.', "chacha20 decryption is wrong");
+}
+
+MU_TEST(test_drbg) {
+  uint8_t seed[32] = { 1 };
+  CHACHA_DRBG_CTX a, b;
+  chacha_drbg_init(&a, seed, sizeof(seed));
+  chacha_drbg_init(&b, seed, sizeof(seed));
+  // same output whether we read it at once or in odd-sized pieces
+  uint8_t x[1500], y[1500];
+  chacha_drbg_generate(&a, x, sizeof(x));
+  for(size_t i=0; i<sizeof(y); i+=7){
+    chacha_drbg_generate(&b, y+i, (sizeof(y)-i < 7) ? sizeof(y)-i : 7);
+  }
+  mu_assert(memcmp(x, y, sizeof(x)) == 0, "drbg output depends on request size");
+  // no repetition across pool refills
+  mu_assert(memcmp(x, x+480, 480) != 0, "drbg repeats itself");
+  chacha_drbg_reseed(&a, seed, sizeof(seed));
+  chacha_drbg_generate(&a, y, 32);
+  mu_assert(memcmp(x+sizeof(x)-32, y, 32) != 0, "reseed doesn't change output");
+}
+
+MU_TEST(test_random_buffer_fork) {
+  uint8_t x[32], y[32];
+  random_buffer(x, sizeof(x));
+  random_buffer(y, sizeof(y));
+  mu_assert(memcmp(x, y, sizeof(x)) != 0, "random_buffer repeats itself");
+  // parent and child must not share the buffered pool after fork()
+  int fds[2];
+  mu_assert(pipe(fds) == 0, "pipe failed");
+  pid_t pid = fork();
+  if(pid == 0){
+    random_buffer(x, sizeof(x));
+    ssize_t res = write(fds[1], x, sizeof(x));
+    _exit(res == sizeof(x) ? 0 : 1);
+  }
+  random_buffer(x, sizeof(x));
+  mu_assert(read(fds[0], y, sizeof(y)) == sizeof(y), "read from child failed");
+  waitpid(pid, NULL, 0);
+  close(fds[0]);
+  close(fds[1]);
+  mu_assert(memcmp(x, y, sizeof(x)) != 0, "parent and child got the same random bytes");
+}
+
+static __thread int sourceCalls = 0;
+
+static int countingSource(uint8_t * buf, size_t len){
+  sourceCalls++;
+  memset(buf, 0x5a, len);
+  return 0;
+}
+
+struct SourceWorker{
+  pthread_barrier_t * barrier;
+  uint8_t out[2][32];
+  int calls;
+};
+
+static void * sourceWorkerRun(void * arg){
+  SourceWorker * w = (SourceWorker *)arg;
+  random_buffer(w->out[0], 32); // seeded before the source changes
+  pthread_barrier_wait(w->barrier);
+  pthread_barrier_wait(w->barrier);
+  random_buffer(w->out[1], 32);
+  w->calls = sourceCalls;
+  return NULL;
+}
+
+MU_TEST(test_entropy_source_threads) {
+  // changing the entropy source reseeds the generators of all threads
+  pthread_barrier_t barrier;
+  pthread_barrier_init(&barrier, NULL, 5);
+  SourceWorker workers[4];
+  pthread_t threads[4];
+  for(int i=0; i<4; i++){
+    workers[i].barrier = &barrier;
+    workers[i].calls = -1;
+    mu_assert(pthread_create(&threads[i], NULL, sourceWorkerRun, &workers[i]) == 0, "can't start a thread");
+  }
+  pthread_barrier_wait(&barrier);
+  random_set_entropy_source(countingSource);
+  pthread_barrier_wait(&barrier);
+  for(int i=0; i<4; i++){
+    pthread_join(threads[i], NULL);
+    mu_assert(workers[i].calls == 1, "thread didn't reseed from the new source");
+    for(int j=0; j<i; j++){
+      mu_assert(memcmp(workers[i].out[1], workers[j].out[1], 32) != 0, "threads got the same random bytes");
+    }
+  }
+  random_set_entropy_source(NULL);
+  pthread_barrier_destroy(&barrier);
+}
+
+MU_TEST_SUITE(test_rand) {
+  MU_RUN_TEST(test_chacha20_block);
+  MU_RUN_TEST(test_chacha20_xor);
+  MU_RUN_TEST(test_drbg);
+  MU_RUN_TEST(test_random_buffer_fork);
+  MU_RUN_TEST(test_entropy_source_threads);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_rand);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
@@ -0,0 +1,281 @@
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "Conversion.h"
+#include "Hash.h"
+#include "utility/trezor/bip340.h"
+#include "utility/trezor/secp256k1.h"
+
+using namespace std;
+
+// test vectors from https://github.com/bitcoin/bips/blob/master/bip-0340/test-vectors.csv
+static const char * sign_vectors[][5] = {
+  // secret key, public key, aux, message, signature
+  {
+    "0000000000000000000000000000000000000000000000000000000000000003",
+    "f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9",
+    "0000000000000000000000000000000000000000000000000000000000000000",
+    "0000000000000000000000000000000000000000000000000000000000000000",
+    "e907831f80848d1069a5371b402410364bdf1c5f8307b0084c55f1ce2dca8215"
+    "25f66a4a85ea8b71e482a74f382d2ce5ebeee8fdb2172f477df4900d310536c0",
+  },
+  {
+    "b7e151628aed2a6abf7158809cf4f3c762e7160f38b4da56a784d9045190cfef",
+    "dff1d77f2a671c5f36183726db2341be58feae1da2deced843240f7b502ba659",
+    "0000000000000000000000000000000000000000000000000000000000000001",
+    "243f6a8885a308d313198a2e03707344a4093822299f31d0082efa98ec4e6c89",
+    "6896bd60eeae296db48a229ff71dfe071bde413e6d43f917dc8dcf8c78de3341"
+    "8906d11ac976abccb20b091292bff4ea897efcb639ea871cfa95f6de339e4b0a",
+  },
+  {
+    "c90fdaa22168c234c4c6628b80dc1cd129024e088a67cc74020bbea63b14e5c9",
+    "dd308afec5777e13121fa72b9cc1b7cc0139715309b086c960e18fd969774eb8",
+    "c87aa53824b4d7ae2eb035a2b5bbbccc080e76cdc6d1692c4b0b62d798e6d906",
+    "7e2d58d8b3bcdf1abadec7829054f90dda9805aab56c77333024b9d0a508b75c",
+    "5831aaeed7b44bb74e5eab94ba9d4294c49bcf2a60728d8b4c200f50dd313c1b"
+    "ab745879a5ad954a72c45a91c3a51d3c7adea98d82f8481e0e1e03674a6f3fb7",
+  },
+  {
+    "0b432b2677937381aef05bb02a66ecd012773062cf3fa2549e44f58ed2401710",
+    "25d1dff95105f5253c4022f628a996ad3a0d95fbf21d468a1b33f8c160d8f517",
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+    "7eb0509757e246f19449885651611cb965ecc1a187dd51b64fda1edc9637d5ec"
+    "97582b9cb13db3933705b32ba982af5af25fd78881ebb32771fc5922efc66ea3",
+  },
+};
+
+static const char * verify_vectors[][4] = {
+  // public key, message, signature, expected result
+  { // R.x with leading zeroes
+    "d69c3509bb99e412e68b0fe8544e72837dfa30746d8be2aa65975f29d22dc7b9",
+    "4df3c3f68fcc83b27e9d42c90431a72499f17875c81a599b566c9889b9696703",
+    "00000000000000000000003b78ce563f89a0ed9414f5aa28ad0d96d6795f9c63"
+    "76afb1548af603b3eb45c9f8207dee1060cb71c04e80f593060b07d28308d7f4",
+    "1",
+  },
+  { // public key is not on the curve
+    "eefdea4cdb677750a420fee807eacf21eb9898ae79b9768766e4faa04a2d4a34",
+    "243f6a8885a308d313198a2e03707344a4093822299f31d0082efa98ec4e6c89",
+    "6cff5c3ba86c69ea4b7376f31a9bcb4f74c1976089b2d9963da2e5543e177769"
+    "69e89b4c5564d00349106b8497785dd7d1d713a8ae82b32fa79d5f7fc407d39b",
+    "0",
+  },
+  { // R has odd y
+    "dff1d77f2a671c5f36183726db2341be58feae1da2deced843240f7b502ba659",
+    "243f6a8885a308d313198a2e03707344a4093822299f31d0082efa98ec4e6c89",
+    "fff97bd5755eeea420453a14355235d382f6472f8568a18b2f057a1460297556"
+    "3cc27944640ac607cd107ae10923d9ef7a73c643e166be5ebeafa34b1ac553e2",
+    "0",
+  },
+  { // s is equal to the curve order
+    "dff1d77f2a671c5f36183726db2341be58feae1da2deced843240f7b502ba659",
+    "243f6a8885a308d313198a2e03707344a4093822299f31d0082efa98ec4e6c89",
+    "6cff5c3ba86c69ea4b7376f31a9bcb4f74c1976089b2d9963da2e5543e177769"
+    "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+    "0",
+  },
+};
+
+MU_TEST(test_vectors) {
+  uint8_t priv[32], pub[32], aux[32], msg[32], sig[64];
+  for(size_t i=0; i<sizeof(sign_vectors)/sizeof(sign_vectors[0]); i++){
+    fromHex(sign_vectors[i][0], priv, 32);
+    fromHex(sign_vectors[i][2], aux, 32);
+    fromHex(sign_vectors[i][3], msg, 32);
+    mu_assert(bip340_get_public_key(&secp256k1, priv, pub) == 0, "public key failed");
+    mu_assert(strcmp(toHex(pub, 32).c_str(), sign_vectors[i][1]) == 0, "public key is wrong");
+    mu_assert(bip340_sign(&secp256k1, priv, msg, aux, sig) == 0, "signing failed");
+    mu_assert(strcmp(toHex(sig, 64).c_str(), sign_vectors[i][4]) == 0, "signature is wrong");
+    mu_assert(bip340_verify(&secp256k1, pub, msg, sig) == 0, "valid signature rejected");
+    msg[0] ^= 1;
+    mu_assert(bip340_verify(&secp256k1, pub, msg, sig) != 0, "invalid signature accepted");
+  }
+  for(size_t i=0; i<sizeof(verify_vectors)/sizeof(verify_vectors[0]); i++){
+    fromHex(verify_vectors[i][0], pub, 32);
+    fromHex(verify_vectors[i][1], msg, 32);
+    fromHex(verify_vectors[i][2], sig, 64);
+    int valid = (verify_vectors[i][3][0] == '1');
+    mu_assert((bip340_verify(&secp256k1, pub, msg, sig) == 0) == valid, "wrong verification result");
+    mu_assert((bip340_verify_batch(&secp256k1, 1, pub, msg, sig) == 0) == valid, "wrong batch result");
+  }
+  mu_assert(bip340_sign(&secp256k1, (const uint8_t *)"\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", msg, NULL, sig) != 0,
+    "zero key accepted");
+}
+
+MU_TEST(test_keys) {
+  // Schnorr API on PrivateKey / PublicKey, odd y keys are negated
+  uint8_t secret[32], hash[32], x[32];
+  for(uint8_t i=0; i<8; i++){
+    sha256(&i, 1, secret);
+    sha256(secret, 32, hash);
+    PrivateKey pk(secret);
+    PublicKey pub = pk.publicKey();
+    SchnorrSignature sig = pk.schnorrSign(hash);
+    uint8_t raw[64];
+    mu_assert(bip340_sign(&secp256k1, secret, hash, NULL, raw) == 0, "signing failed");
+    mu_assert(sig == SchnorrSignature(raw), "C++ and C signatures differ");
+    mu_assert(pub.schnorrVerify(sig, hash), "valid signature rejected");
+    pub.xonly(x);
+    PublicKey even;
+    mu_assert(even.fromXonly(x), "x-only key rejected");
+    mu_assert(memcmp(even.point, pub.point, 32) == 0 && (even.point[63] & 1) == 0, "x-only key is wrong");
+    mu_assert(even.schnorrVerify(sig, hash), "valid signature rejected by x-only key");
+    mu_assert(!pub.schnorrVerify(sig, secret), "signature of other hash accepted");
+    SchnorrSignature parsed(toHex(raw, 64).c_str());
+    mu_assert(parsed == sig, "parsing failed");
+  }
+}
+
+MU_TEST(test_batch) {
+  // valid batches of different sizes, one bad signature anywhere fails the batch
+  const size_t n = 20;
+  PublicKey pubs[n];
+  SchnorrSignature sigs[n];
+  uint8_t hashes[n*32], secret[32];
+  for(uint8_t i=0; i<n; i++){
+    sha256(&i, 1, secret);
+    sha256(secret, 32, hashes + 32*i);
+    PrivateKey pk(secret);
+    pubs[i] = pk.publicKey();
+    sigs[i] = pk.schnorrSign(hashes + 32*i);
+  }
+  for(size_t m=0; m<=n; m++){
+    mu_assert(schnorrVerifyBatch(pubs, hashes, sigs, m), "valid batch rejected");
+  }
+  for(size_t i=0; i<n; i+=3){
+    hashes[32*i] ^= 1;
+    mu_assert(!schnorrVerifyBatch(pubs, hashes, sigs, n), "batch with wrong hash accepted");
+    hashes[32*i] ^= 1;
+  }
+  // signatures of two keys swapped
+  SchnorrSignature tmp = sigs[4];
+  sigs[4] = sigs[7];
+  sigs[7] = tmp;
+  mu_assert(!schnorrVerifyBatch(pubs, hashes, sigs, n), "batch with swapped signatures accepted");
+  sigs[7] = sigs[4];
+  sigs[4] = tmp;
+  // s + n, r + p or R.x not on the curve
+  uint8_t raw[n*64], xs[n*32];
+  for(size_t i=0; i<n; i++){
+    sigs[i].bin(raw + 64*i, 64);
+    pubs[i].xonly(xs + 32*i);
+  }
+  mu_assert(bip340_verify_batch(&secp256k1, n, xs, hashes, raw) == 0, "valid raw batch rejected");
+  memset(raw + 64*5 + 32, 0xff, 32);
+  mu_assert(bip340_verify_batch(&secp256k1, n, xs, hashes, raw) != 0, "s out of range accepted");
+  sigs[5].bin(raw + 64*5, 64);
+  memset(raw + 64*9, 0xff, 32);
+  mu_assert(bip340_verify_batch(&secp256k1, n, xs, hashes, raw) != 0, "r out of range accepted");
+  sigs[9].bin(raw + 64*9, 64);
+  memset(xs + 32*11, 0, 32);
+  mu_assert(bip340_verify_batch(&secp256k1, n, xs, hashes, raw) != 0, "invalid public key accepted");
+}
+
+MU_TEST(test_point_multiply_multi) {
+  // sum k_i * (m_i * G) against (sum k_i * m_i) * G, small sizes take
+  // interleaved wNAF, large ones Pippenger's buckets
+  const size_t sizes[] = {1, 2, 17, 40, 600};
+  static bignum256 k[600];
+  static curve_point p[600];
+  uint8_t buf[32];
+  bignum256 m, sum;
+  curve_point a, b;
+  for(size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++){
+    size_t n = sizes[s];
+    bn_zero(&sum);
+    for(size_t i=0; i<n; i++){
+      uint32_t seed = s*1000 + i;
+      sha256((uint8_t *)&seed, sizeof(seed), buf);
+      bn_read_be(buf, &m);
+      bn_mod(&m, &secp256k1.order);
+      scalar_multiply(&secp256k1, &m, &p[i]);
+      sha256(buf, 32, buf);
+      bn_read_be(buf, &k[i]);
+      bn_mod(&k[i], &secp256k1.order);
+      bn_multiply(&k[i], &m, &secp256k1.order);
+      bn_addmod(&sum, &m, &secp256k1.order);
+      bn_mod(&sum, &secp256k1.order);
+    }
+    scalar_multiply(&secp256k1, &sum, &b);
+    mu_assert(point_multiply_multi(&secp256k1, n, k, p, &a) == 0, "unexpected infinity");
+    mu_assert(point_is_equal(&a, &b), "point_multiply_multi result is wrong");
+  }
+  // k * P + (n - k) * P
+  p[1] = p[0];
+  bn_subtract(&secp256k1.order, &k[0], &k[1]);
+  mu_assert(point_multiply_multi(&secp256k1, 2, k, p, NULL) == 1, "infinity is not detected");
+  for(size_t i=2; i<600; i++){
+    bn_zero(&k[i]);
+  }
+  mu_assert(point_multiply_multi(&secp256k1, 600, k, p, NULL) == 1, "infinity is not detected");
+}
+
+MU_TEST(test_taproot) {
+  // BIP86 and BIP341 wallet vectors, BIP350 addresses
+  HDPrivateKey root("abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about", "");
+  HDPrivateKey first = root.derive("m/86h/0h/0h/0/0");
+  mu_assert(first.type == P2TR, "bip86 path is not taproot");
+  mu_assert(first.address() == "bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr", "wrong bip86 address");
+  mu_assert(root.derive("m/86h/0h/0h/1/0").xpub().address() == "bc1p3qkhfews2uk44qtvauqyr2ttdsw7svhkl9nkm9s9c3x4ax5h60wqwruhk7", "wrong bip86 change address");
+  Script sc = first.publicKey().script(P2TR);
+  mu_assert(sc.type() == P2TR, "wrong script type");
+  mu_assert(sc == Script("bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr"), "address and script differ");
+  uint8_t raw[35];
+  sc.serialize(raw, sizeof(raw));
+  mu_assert(toHex(raw+1, 34) == "5120a60869f0dbcf1dc659c9cecbaf8050135ea9e8cdc487053f1dc6880949dc684c", "wrong output key");
+
+  uint8_t x[32], root32[32];
+  fromHex("187791b6f712a8ea41c8ecdd0ee77fab3e85263b37e1ec18a3651926b3a6cf27", x, 32);
+  fromHex("5b75adecf53548f3ec6ad7d78383bf84cc57b55a3127c72b9a2481752dd88b21", root32, 32);
+  PublicKey internal;
+  mu_assert(internal.fromXonly(x), "internal key rejected");
+  PublicKey output = taprootTweak(internal, root32);
+  output.xonly(x);
+  mu_assert(toHex(x, 32) == "147c9c57132f6e7ecddba9800bb0c4449251c92a1e60371ee77557b6620f3ea3", "wrong tweak with merkle root");
+  mu_assert(Script("bc1pz37fc4cn9ah8anwm4xqqhvxygjf9rjf2resrw8h8w4tmvcs0863sa2e586").address() ==
+    "bc1pz37fc4cn9ah8anwm4xqqhvxygjf9rjf2resrw8h8w4tmvcs0863sa2e586", "address round trip failed");
+  mu_assert(!taprootTweak(PublicKey()).isValid(), "invalid internal key tweaked");
+
+  // v0 must use bech32 and v1 bech32m
+  mu_assert(Script("bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0").type() == P2TR, "valid bech32m address rejected");
+  mu_assert(!Script("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kemeawh"), "v0 address with bech32m checksum accepted");
+  mu_assert(!Script("bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqh2y7hd"), "v1 address with bech32 checksum accepted");
+  mu_assert(Script("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4").type() == P2WPKH, "bech32 address rejected");
+}
+
+MU_TEST(test_taproot_batch) {
+  // batch over more than one group matches one by one tweaking, invalid keys fail alone
+  const size_t n = 2*DERIVE_BATCH_SIZE + 3;
+  PublicKey keys[n], outputs[n];
+  uint8_t roots[n*32];
+  for(size_t i=0; i<n; i++){
+    uint8_t secret[32];
+    uint8_t b = i;
+    sha256(&b, 1, secret);
+    keys[i] = PrivateKey(secret).publicKey();
+    sha256(secret, 32, roots+32*i);
+  }
+  keys[5] = PublicKey();
+  mu_assert(taprootTweak(keys, n, roots, outputs) == n-1, "wrong number of tweaked keys");
+  for(size_t i=0; i<n; i++){
+    mu_assert(outputs[i] == taprootTweak(keys[i], roots+32*i), "batch and single tweak differ");
+  }
+  mu_assert(!outputs[5].isValid(), "invalid key tweaked");
+  mu_assert(taprootTweak(keys+3, 4, NULL, outputs) == 3, "wrong number of keys without merkle roots");
+  mu_assert(outputs[0] == taprootTweak(keys[3]), "batch without merkle roots is wrong");
+}
+
+MU_TEST_SUITE(test_schnorr) {
+  MU_RUN_TEST(test_vectors);
+  MU_RUN_TEST(test_keys);
+  MU_RUN_TEST(test_batch);
+  MU_RUN_TEST(test_point_multiply_multi);
+  MU_RUN_TEST(test_taproot);
+  MU_RUN_TEST(test_taproot_batch);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_schnorr);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
@@ -0,0 +1,80 @@
+// Generates the BIP39 perfect hash tables (see bip39_hash.h): buckets are
+// placed from the largest one, each gets the first displacement that moves
+// all its words to free slots. bip39_index maps slots to word indexes.
+//
+// Usage: mkbip39hash > bip39_english.table
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utility/trezor/bip39_hash.h"
+#include "utility/trezor/bip39_english.h"
+
+int main(void)
+{
+	static uint16_t displacement[BIP39_HASH_BUCKETS];
+	static int slots[BIP39_WORDS];
+	static int size[BIP39_HASH_BUCKETS];
+	static int members[BIP39_HASH_BUCKETS][BIP39_WORDS];
+	int order[BIP39_HASH_BUCKETS];
+	int i, j, k, b;
+	uint32_t d;
+
+	for (i = 0; i < BIP39_WORDS; i++) {
+		uint32_t key = bip39_prefix_key(wordlist[i], strlen(wordlist[i]));
+		b = bip39_bucket(key);
+		members[b][size[b]++] = i;
+	}
+	for (i = 0; i < BIP39_WORDS; i++) {
+		slots[i] = -1;
+	}
+	for (i = 0; i < BIP39_HASH_BUCKETS; i++) {
+		order[i] = i;
+	}
+	// largest buckets first
+	for (i = 0; i < BIP39_HASH_BUCKETS; i++) {
+		for (j = i + 1; j < BIP39_HASH_BUCKETS; j++) {
+			if (size[order[j]] > size[order[i]]) {
+				int t = order[i];
+				order[i] = order[j];
+				order[j] = t;
+			}
+		}
+	}
+	for (i = 0; i < BIP39_HASH_BUCKETS; i++) {
+		b = order[i];
+		for (d = 0; d <= 0xffff; d++) {
+			for (k = 0; k < size[b]; k++) {
+				int w = members[b][k];
+				uint32_t s = bip39_slot(bip39_prefix_key(wordlist[w], strlen(wordlist[w])), d);
+				if (slots[s] >= 0) {
+					break;
+				}
+				slots[s] = w;
+			}
+			if (k == size[b]) {
+				break;
+			}
+			// release slots of this attempt
+			while (k-- > 0) {
+				int w = members[b][k];
+				slots[bip39_slot(bip39_prefix_key(wordlist[w], strlen(wordlist[w])), d)] = -1;
+			}
+		}
+		if (d > 0xffff) {
+			fprintf(stderr, "no displacement for bucket %d of %d words\n", b, size[b]);
+			return 1;
+		}
+		displacement[b] = d;
+	}
+	printf("// generated by tests/tools/mkbip39hash.c\n\n");
+	printf("static const uint16_t bip39_displacement[BIP39_HASH_BUCKETS] = {\n");
+	for (i = 0; i < BIP39_HASH_BUCKETS; i++) {
+		printf("%s%5u,%s", i % 16 ? " " : "\t", displacement[i], i % 16 == 15 ? "\n" : "");
+	}
+	printf("};\n\nstatic const uint16_t bip39_index[BIP39_WORDS] = {\n");
+	for (i = 0; i < BIP39_WORDS; i++) {
+		printf("%s%4d,%s", i % 16 ? " " : "\t", slots[i], i % 16 == 15 ? "\n" : "");
+	}
+	printf("};\n");
+	return 0;
+}
@@ -0,0 +1,66 @@
+// Generates the precomputed table for scalar_multiply:
+//   cp[i][j] = (2*j+1) * 2^(window*spacing*i) * G
+// Must be linked with the library built with USE_PRECOMPUTED_CP=0,
+// see `make table` in the tests Makefile.
+//
+// Usage: mktable WINDOW SPACING > secp256k1_wWINDOW_sSPACING.table
+#include <stdio.h>
+#include <stdlib.h>
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+
+static void print_bn(const bignum256 *a)
+{
+	int i;
+	printf("{{");
+	for (i = 0; i < 8; i++) {
+		printf("0x%08x, ", a->val[i]);
+	}
+	printf("0x%04x}}", a->val[8]);
+}
+
+int main(int argc, char **argv)
+{
+	int window, spacing, digits, rows, cols, width, i, j;
+	unsigned long long base;
+	curve_point row, point, twice;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s WINDOW SPACING\n", argv[0]);
+		return 1;
+	}
+	window = atoi(argv[1]);
+	spacing = atoi(argv[2]);
+	if (window < 1 || window > 12 || spacing < 1 || window * spacing > 63) {
+		fprintf(stderr, "window must be 1..12, window * spacing below 64\n");
+		return 1;
+	}
+	digits = (256 + window - 1) / window;
+	rows = (digits + spacing - 1) / spacing;
+	cols = 1 << (window - 1);
+	base = 1ULL << (window * spacing);
+	width = snprintf(NULL, 0, "%d", 2 * cols - 1);
+
+	row = secp256k1.G;
+	for (i = 0; i < rows; i++) {
+		printf("\t{\n");
+		point = row;
+		twice = row;
+		point_double(&secp256k1, &twice);
+		for (j = 0; j < cols; j++) {
+			if (j > 0) {
+				point_add(&secp256k1, &twice, &point);
+			}
+			printf("\t\t/* %*d*%llu^%d*G: */\n\t\t{", width, 2 * j + 1, base, i);
+			print_bn(&point.x);
+			printf(",\n\t\t ");
+			print_bn(&point.y);
+			printf("}%s\n", j + 1 < cols ? "," : "");
+		}
+		printf("\t},\n");
+		for (j = 0; j < window * spacing; j++) {
+			point_double(&secp256k1, &row);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,657 @@
+// BIP39 recovery: finds a mnemonic with missing or mistyped words and/or
+// a forgotten passphrase by checking every candidate against a known
+// address or root fingerprint.
+//
+// Candidates are numbered mnemonic * passphrases + passphrase, words of
+// each mnemonic are enumerated as a mixed radix number. If one word is
+// missing at an unknown position (11, 17 or 23 words given), the position
+// of the missing word is the most significant digit. Every worker owns
+// a range of candidate numbers and steals half of the largest other range
+// when its own is done. Mnemonics with a wrong checksum are skipped with
+// all their passphrases before running PBKDF2. Remaining ranges are saved
+// to the checkpoint file, so an interrupted search continues from there.
+//
+// Usage: recover [options] "word word ? wrod~ ab* ..."
+//   ?                 any word
+//   pre*              any word starting with pre
+//   word~             a mistyped word, every word within --distance edits.
+//                     Words not in the wordlist are treated the same way.
+// Give 11, 17 or 23 words if one word is missing and its position is unknown.
+// Only one word can be missing at an unknown position, use ? for the others.
+// Options:
+//   --address ADDR    address at --path: P2PKH, P2SH-P2WPKH or P2WPKH
+//   --path PATH       default m/84h/0h/0h/0/0
+//   --fingerprint HEX root key fingerprint to look for instead of an address
+//   --passphrase STR  passphrase to use, default empty
+//   --passphrases FILE  dictionary, one passphrase per line
+//   --distance N      edit distance for mistyped words, default 2
+//   --threads N       default: number of CPUs
+//   --checkpoint FILE progress is saved there and resumed from it
+//   --interval SEC    progress report and checkpoint interval, default 10
+//   --all             don't stop at the first match
+//
+// Passphrases are used as is, without NFKD normalization.
+// Build: make recover, known-answer tests: make recover-test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Bitcoin.h"
+#include "Hash.h"
+#include "utility/trezor/bip39.h"
+#include "utility/trezor/pbkdf2.h"
+#include "utility/trezor/memzero.h"
+
+struct Range{
+  uint64_t lo, hi;
+};
+
+struct Rules{
+  size_t numWords;
+  size_t numSlots;                      // numWords, or numWords-1 if a word is missing anywhere
+  std::vector<uint16_t> slots[24];      // candidate word indexes for every given word
+  uint64_t perPosition;                 // mnemonics for one position of the missing word
+  std::vector<std::string> passphrases;
+  uint64_t mnemonics;                   // product of the slot sizes
+  uint64_t total;                       // mnemonics * passphrases
+  bool useAddress;
+  Script target;
+  ScriptType type;
+  DerivationPath path;
+  uint8_t fingerprint[4];
+  uint8_t id[32];                       // hash of all of the above, for checkpoints
+};
+
+struct Worker{
+  pthread_mutex_t lock;
+  uint64_t pos, end;  // candidates left
+  bool busy;          // candidate pos-1 is being checked
+  pthread_t thread;
+  struct Pool * pool;
+};
+
+struct Pool{
+  const Rules * rules;
+  std::vector<Worker> workers;
+  pthread_mutex_t lock;     // pending ranges, stealing, checkpoints and output
+  std::vector<Range> pending;
+  bool all;
+  std::atomic<bool> stop;
+  std::atomic<size_t> running;
+  std::atomic<uint64_t> checked, pruned, found;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int){
+  interrupted = 1;
+}
+
+static size_t editDistance(const char * a, const char * b){
+  size_t la = strlen(a), lb = strlen(b);
+  size_t row[16];
+  if(lb >= sizeof(row)/sizeof(row[0])){
+    return lb;
+  }
+  for(size_t j=0; j<=lb; j++){
+    row[j] = j;
+  }
+  for(size_t i=1; i<=la; i++){
+    size_t diag = row[0];
+    row[0] = i;
+    for(size_t j=1; j<=lb; j++){
+      size_t up = row[j];
+      size_t best = diag + (a[i-1] != b[j-1]);
+      best = std::min(best, up + 1);
+      best = std::min(best, row[j-1] + 1);
+      row[j] = best;
+      diag = up;
+    }
+  }
+  return row[lb];
+}
+
+// candidate words for one position of the mnemonic, closest ones first
+static bool parseWord(std::string token, size_t distance, std::vector<uint16_t> * slot){
+  slot->clear();
+  if(token == "?"){
+    for(uint16_t k=0; k<2048; k++){
+      slot->push_back(k);
+    }
+    return true;
+  }
+  if(token.size() > 1 && token.back() == '*'){
+    uint16_t first = 0;
+    size_t n = mnemonicComplete(token.c_str(), token.size()-1, &first);
+    for(size_t k=0; k<n; k++){
+      slot->push_back(first + k);
+    }
+    return n > 0;
+  }
+  bool typo = (token.size() > 1 && token.back() == '~');
+  if(typo){
+    token.pop_back();
+  }
+  int k = mnemonicWordIndex(token.c_str(), token.size());
+  if(k >= 0 && !typo){
+    slot->push_back(k);
+    return true;
+  }
+  std::vector<std::pair<size_t, uint16_t> > close;
+  for(uint16_t w=0; w<2048; w++){
+    size_t d = editDistance(token.c_str(), mnemonicWord(w));
+    // words are unique by their first 4 letters, so those are a match too
+    if(d > distance && token.size() >= 4 && strncmp(token.c_str(), mnemonicWord(w), 4) == 0){
+      d = distance;
+    }
+    if(d <= distance){
+      close.push_back(std::make_pair(d, w));
+    }
+  }
+  std::stable_sort(close.begin(), close.end());
+  for(size_t i=0; i<close.size(); i++){
+    slot->push_back(close[i].second);
+  }
+  return !close.empty();
+}
+
+// words and passphrase of the candidate, false if the same words are
+// also the candidate with the missing word one position earlier
+static bool candidate(const Rules * r, uint64_t index, uint16_t * words, size_t * passphrase){
+  uint64_t m = index / r->passphrases.size();
+  size_t gap = r->numWords; // position of the missing word, none
+  if(r->numSlots < r->numWords){
+    gap = m / r->perPosition;
+    m %= r->perPosition;
+  }
+  size_t slot = r->numSlots;
+  for(size_t i=r->numWords; i-- > 0; ){
+    if(i == gap){
+      words[i] = m % 2048;
+      m /= 2048;
+    }else{
+      slot--;
+      words[i] = r->slots[slot][m % r->slots[slot].size()];
+      m /= r->slots[slot].size();
+    }
+  }
+  *passphrase = index % r->passphrases.size();
+  return gap == 0 || gap == r->numWords || words[gap-1] != words[gap];
+}
+
+static std::string mnemonicString(const Rules * r, const uint16_t * words){
+  std::string s;
+  for(size_t i=0; i<r->numWords; i++){
+    if(i > 0){
+      s += ' ';
+    }
+    s += mnemonicWord(words[i]);
+  }
+  return s;
+}
+
+// mnemonic_to_seed and derive() use static state, workers call PBKDF2
+// and child() directly: HMAC and PBKDF2 keep their pads on the stack
+static bool checkCandidate(const Rules * r, const std::string & mnemonic, const std::string & passphrase){
+  std::string salt = "mnemonic" + passphrase;
+  uint8_t seed[64];
+  pbkdf2_hmac_sha512((const uint8_t *)mnemonic.c_str(), mnemonic.size(),
+                     (const uint8_t *)salt.c_str(), salt.size(), BIP39_PBKDF2_ROUNDS, seed, sizeof(seed));
+  HDPrivateKey key;
+  key.fromSeed(seed, sizeof(seed));
+  memzero(seed, sizeof(seed));
+  if(!r->useAddress){
+    uint8_t fingerprint[4];
+    key.fingerprint(fingerprint);
+    return memcmp(fingerprint, r->fingerprint, 4) == 0;
+  }
+  for(size_t i=0; i<r->path.depth; i++){
+    key = key.child(r->path.index[i]);
+  }
+  return key.publicKey().script(r->type) == r->target;
+}
+
+// moves a range to the worker: a pending one or half of the largest range
+// of other workers. Holds the pool lock so checkpoints see every range.
+static bool refill(Pool * pool, Worker * w){
+  Range range = { 0, 0 };
+  pthread_mutex_lock(&pool->lock);
+  if(!pool->pending.empty()){
+    range = pool->pending.back();
+    pool->pending.pop_back();
+  }else{
+    Worker * victim = NULL;
+    uint64_t largest = 1; // the last candidate is left to its owner
+    for(size_t i=0; i<pool->workers.size(); i++){
+      Worker * v = &pool->workers[i];
+      pthread_mutex_lock(&v->lock);
+      if(v != w && v->end - v->pos > largest){
+        largest = v->end - v->pos;
+        victim = v;
+      }
+      pthread_mutex_unlock(&v->lock);
+    }
+    if(victim != NULL){
+      pthread_mutex_lock(&victim->lock);
+      uint64_t left = victim->end - victim->pos;
+      if(left > 1){
+        range.hi = victim->end;
+        range.lo = victim->end - left / 2;
+        victim->end = range.lo;
+      }
+      pthread_mutex_unlock(&victim->lock);
+    }
+  }
+  pthread_mutex_lock(&w->lock);
+  w->pos = range.lo;
+  w->end = range.hi;
+  pthread_mutex_unlock(&w->lock);
+  pthread_mutex_unlock(&pool->lock);
+  return range.hi > range.lo;
+}
+
+static bool takeCandidate(Pool * pool, Worker * w, uint64_t * index){
+  while(!pool->stop){
+    pthread_mutex_lock(&w->lock);
+    w->busy = (w->pos < w->end);
+    if(w->busy){
+      *index = w->pos++;
+    }
+    pthread_mutex_unlock(&w->lock);
+    if(w->busy){
+      return true;
+    }
+    if(!refill(pool, w)){
+      return false;
+    }
+  }
+  return false;
+}
+
+// marks candidates of the worker up to next as done, returns their number
+static uint64_t skipTo(Worker * w, uint64_t next){
+  uint64_t skipped = 0;
+  pthread_mutex_lock(&w->lock);
+  next = std::min(next, w->end);
+  if(next > w->pos){
+    skipped = next - w->pos;
+    w->pos = next;
+  }
+  pthread_mutex_unlock(&w->lock);
+  return skipped;
+}
+
+static void * workerRun(void * arg){
+  Worker * w = (Worker *)arg;
+  Pool * pool = w->pool;
+  const Rules * r = pool->rules;
+  const uint64_t P = r->passphrases.size();
+  uint16_t words[24];
+  uint64_t index = 0;
+  uint64_t last = UINT64_MAX;  // mnemonic checked last
+  bool valid = false;
+  std::string mnemonic;
+  while(takeCandidate(pool, w, &index)){
+    size_t p = 0;
+    bool unique = candidate(r, index, words, &p);
+    uint64_t m = index / P;
+    if(m != last){
+      last = m;
+      valid = unique && checkMnemonic(words, r->numWords);
+      if(valid){
+        mnemonic = mnemonicString(r, words);
+      }
+    }
+    if(!valid){
+      pool->pruned += 1 + skipTo(w, (m+1)*P);
+      continue;
+    }
+    if(checkCandidate(r, mnemonic, r->passphrases[p])){
+      pthread_mutex_lock(&pool->lock);
+      printf("found: %s\npassphrase: \"%s\"\n", mnemonic.c_str(), r->passphrases[p].c_str());
+      fflush(stdout);
+      pthread_mutex_unlock(&pool->lock);
+      pool->found++;
+      if(!pool->all){
+        pool->stop = true;
+      }
+    }
+    pool->checked++;
+  }
+  pthread_mutex_lock(&w->lock);
+  w->busy = false;
+  pthread_mutex_unlock(&w->lock);
+  pool->running--;
+  return NULL;
+}
+
+// ranges nobody has finished yet, candidates being checked included
+static std::vector<Range> remaining(Pool * pool){
+  std::vector<Range> ranges;
+  pthread_mutex_lock(&pool->lock);
+  ranges = pool->pending;
+  for(size_t i=0; i<pool->workers.size(); i++){
+    Worker * w = &pool->workers[i];
+    pthread_mutex_lock(&w->lock);
+    Range range = { w->busy ? w->pos - 1 : w->pos, w->end };
+    pthread_mutex_unlock(&w->lock);
+    if(range.hi > range.lo){
+      ranges.push_back(range);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  std::sort(ranges.begin(), ranges.end(), [](const Range & a, const Range & b){ return a.lo < b.lo; });
+  return ranges;
+}
+
+static bool saveCheckpoint(const char * filename, const Rules * r, const std::vector<Range> & ranges){
+  std::string tmp = std::string(filename) + ".tmp";
+  FILE * f = fopen(tmp.c_str(), "w");
+  if(f == NULL){
+    return false;
+  }
+  fprintf(f, "# uBitcoin recover checkpoint\nrules %s\ntotal %llu\n",
+          toHex(r->id, sizeof(r->id)).c_str(), (unsigned long long)r->total);
+  for(size_t i=0; i<ranges.size(); i++){
+    fprintf(f, "range %llu %llu\n", (unsigned long long)ranges[i].lo, (unsigned long long)ranges[i].hi);
+  }
+  bool ok = (fflush(f) == 0);
+  ok = (fclose(f) == 0) && ok;
+  return ok && rename(tmp.c_str(), filename) == 0;
+}
+
+// 1 if loaded, 0 if there is no checkpoint, -1 if it doesn't match the rules
+static int loadCheckpoint(const char * filename, const Rules * r, std::vector<Range> * ranges){
+  FILE * f = fopen(filename, "r");
+  if(f == NULL){
+    return 0;
+  }
+  char line[200], id[65];
+  unsigned long long a, b;
+  bool matches = false;
+  ranges->clear();
+  while(fgets(line, sizeof(line), f) != NULL){
+    if(sscanf(line, "rules %64s", id) == 1){
+      matches = (toHex(r->id, sizeof(r->id)) == id);
+    }else if(sscanf(line, "total %llu", &a) == 1){
+      matches = matches && (a == r->total);
+    }else if(sscanf(line, "range %llu %llu", &a, &b) == 2 && a < b && b <= r->total){
+      Range range = { a, b };
+      ranges->push_back(range);
+    }
+  }
+  fclose(f);
+  return matches ? 1 : -1;
+}
+
+static void computeId(Rules * r){
+  std::string s;
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%zu/%zu", r->numSlots, r->numWords);
+  s += buf;
+  for(size_t i=0; i<r->numSlots; i++){
+    snprintf(buf, sizeof(buf), "|%zu:", r->slots[i].size());
+    s += buf;
+    s.append((const char *)r->slots[i].data(), r->slots[i].size()*sizeof(uint16_t));
+  }
+  for(size_t i=0; i<r->passphrases.size(); i++){
+    snprintf(buf, sizeof(buf), "|%zu:", r->passphrases[i].size());
+    s += buf + r->passphrases[i];
+  }
+  if(r->useAddress){
+    uint8_t script[100];
+    size_t len = r->target.serialize(script, sizeof(script));
+    s.append((const char *)script, len);
+    s.append((const char *)r->path.index, r->path.depth*sizeof(uint32_t));
+  }else{
+    s.append((const char *)r->fingerprint, 4);
+  }
+  sha256(s, r->id);
+}
+
+static bool readPassphrases(const char * filename, std::vector<std::string> * passphrases){
+  FILE * f = fopen(filename, "r");
+  if(f == NULL){
+    return false;
+  }
+  char line[1024];
+  while(fgets(line, sizeof(line), f) != NULL){
+    size_t len = strcspn(line, "\r\n");
+    line[len] = 0;
+    passphrases->push_back(line);
+  }
+  fclose(f);
+  return true;
+}
+
+static void usage(){
+  fprintf(stderr, "usage: recover [--address ADDR [--path PATH] | --fingerprint HEX]\n"
+                  "               [--passphrase STR | --passphrases FILE] [--distance N]\n"
+                  "               [--threads N] [--checkpoint FILE] [--interval SEC] [--all]\n"
+                  "               \"word ? wrod~ ab* ...\"\n"
+                  "11, 17 or 23 words: one more word is missing at an unknown position\n");
+}
+
+static double seconds(std::chrono::steady_clock::time_point start){
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char ** argv){
+  Rules rules;
+  rules.useAddress = false;
+  const char * address = NULL;
+  const char * fingerprint = NULL;
+  const char * path = "m/84h/0h/0h/0/0";
+  const char * checkpoint = NULL;
+  const char * mnemonic = NULL;
+  size_t distance = 2;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  double interval = 10;
+  bool all = false;
+  for(int i=1; i<argc; i++){
+    std::string arg = argv[i];
+    bool hasValue = (i+1 < argc);
+    if(arg == "--address" && hasValue){
+      address = argv[++i];
+    }else if(arg == "--path" && hasValue){
+      path = argv[++i];
+    }else if(arg == "--fingerprint" && hasValue){
+      fingerprint = argv[++i];
+    }else if(arg == "--passphrase" && hasValue){
+      rules.passphrases.push_back(argv[++i]);
+    }else if(arg == "--passphrases" && hasValue){
+      if(!readPassphrases(argv[++i], &rules.passphrases)){
+        fprintf(stderr, "can't read %s\n", argv[i]);
+        return 1;
+      }
+    }else if(arg == "--distance" && hasValue){
+      distance = atoi(argv[++i]);
+    }else if(arg == "--threads" && hasValue){
+      threads = atol(argv[++i]);
+    }else if(arg == "--checkpoint" && hasValue){
+      checkpoint = argv[++i];
+    }else if(arg == "--interval" && hasValue){
+      interval = atof(argv[++i]);
+    }else if(arg == "--all"){
+      all = true;
+    }else if(arg[0] != '-' && mnemonic == NULL){
+      mnemonic = argv[i];
+    }else{
+      usage();
+      return 1;
+    }
+  }
+  if(mnemonic == NULL || (address == NULL) == (fingerprint == NULL)){
+    usage();
+    return 1;
+  }
+  if(threads < 1){
+    threads = 1;
+  }
+  if(rules.passphrases.empty()){
+    rules.passphrases.push_back("");
+  }
+
+  // search space
+  std::vector<std::string> tokens;
+  std::string s = mnemonic;
+  for(char * w = strtok(&s[0], " "); w != NULL; w = strtok(NULL, " ")){
+    tokens.push_back(w);
+  }
+  rules.numSlots = tokens.size();
+  rules.numWords = tokens.size();
+  if(tokens.size() % 6 == 5){
+    // one word missing, try it at every position
+    rules.numWords++;
+  }
+  if(rules.numWords != 12 && rules.numWords != 18 && rules.numWords != 24){
+    fprintf(stderr, "mnemonic should have 12, 18 or 24 words (one less if a word is missing), got %zu\n", tokens.size());
+    return 1;
+  }
+  rules.mnemonics = 1;
+  for(size_t i=0; i<rules.numSlots; i++){
+    if(!parseWord(tokens[i], distance, &rules.slots[i])){
+      fprintf(stderr, "no candidates for word %zu \"%s\"\n", i+1, tokens[i].c_str());
+      return 1;
+    }
+    if(rules.mnemonics > UINT64_MAX / rules.slots[i].size() / rules.passphrases.size()){
+      fprintf(stderr, "search space is too large\n");
+      return 1;
+    }
+    rules.mnemonics *= rules.slots[i].size();
+  }
+  if(rules.numSlots < rules.numWords){
+    rules.perPosition = rules.mnemonics * 2048;
+    if(rules.perPosition / 2048 != rules.mnemonics ||
+       rules.perPosition > UINT64_MAX / rules.numWords / rules.passphrases.size()){
+      fprintf(stderr, "search space is too large\n");
+      return 1;
+    }
+    rules.mnemonics = rules.perPosition * rules.numWords;
+  }
+  rules.total = rules.mnemonics * rules.passphrases.size();
+
+  // target
+  if(address != NULL){
+    rules.useAddress = true;
+    rules.target = Script(address);
+    rules.path = DerivationPath(path);
+    switch(rules.target.type()){
+      case P2PKH:  rules.type = P2PKH; break;
+      case P2SH:   rules.type = P2SH_P2WPKH; break;
+      case P2WPKH: rules.type = P2WPKH; break;
+      default:
+        fprintf(stderr, "unsupported address %s\n", address);
+        return 1;
+    }
+    if(!rules.path){
+      fprintf(stderr, "invalid derivation path %s\n", path);
+      return 1;
+    }
+  }else if(strlen(fingerprint) != 8 || fromHex(fingerprint, rules.fingerprint, 4) != 4){
+    fprintf(stderr, "fingerprint should be 4 bytes in hex\n");
+    return 1;
+  }
+  computeId(&rules);
+
+  Pool pool;
+  pool.rules = &rules;
+  pool.all = all;
+  pool.stop = false;
+  pool.checked = 0;
+  pool.pruned = 0;
+  pool.found = 0;
+  pthread_mutex_init(&pool.lock, NULL);
+  int loaded = checkpoint ? loadCheckpoint(checkpoint, &rules, &pool.pending) : 0;
+  if(loaded < 0){
+    fprintf(stderr, "checkpoint %s was saved for a different search\n", checkpoint);
+    return 1;
+  }
+  if(loaded == 0){
+    Range range = { 0, rules.total };
+    pool.pending.push_back(range);
+  }
+  uint64_t todo = 0;
+  for(size_t i=0; i<pool.pending.size(); i++){
+    todo += pool.pending[i].hi - pool.pending[i].lo;
+  }
+  fprintf(stderr, "%llu candidates (%llu mnemonics, %zu passphrases), %llu left, %ld threads\n",
+          (unsigned long long)rules.total, (unsigned long long)rules.mnemonics,
+          rules.passphrases.size(), (unsigned long long)todo, threads);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  pool.workers.resize(threads);
+  pool.running = threads;
+  for(long i=0; i<threads; i++){
+    Worker * w = &pool.workers[i];
+    pthread_mutex_init(&w->lock, NULL);
+    w->pos = w->end = 0;
+    w->busy = false;
+    w->pool = &pool;
+  }
+  // pthread_create failures leave the work to the other threads
+  size_t started = 0;
+  for(long i=0; i<threads; i++){
+    if(pthread_create(&pool.workers[i].thread, NULL, workerRun, &pool.workers[i]) != 0){
+      pool.workers[i].thread = pthread_self();
+      pool.running--;
+    }else{
+      started++;
+    }
+  }
+  if(started == 0){
+    pool.running++;
+    workerRun(&pool.workers[0]);
+  }
+
+  double lastReport = 0;
+  while(pool.running > 0){
+    usleep(100000);
+    if(interrupted){
+      pool.stop = true;
+    }
+    double t = seconds(start);
+    if(t - lastReport >= interval){
+      lastReport = t;
+      uint64_t done = pool.checked + pool.pruned;
+      double rate = done / t;
+      fprintf(stderr, "%5.1f%%  %llu done, %llu pruned by checksum, %.1f candidates/s, %.1f seeds/s, eta %.0fs\n",
+              todo ? 100.0 * done / todo : 100.0, (unsigned long long)done, (unsigned long long)pool.pruned,
+              rate, pool.checked / t, rate > 0 ? (todo - done) / rate : 0.0);
+      if(checkpoint && !saveCheckpoint(checkpoint, &rules, remaining(&pool))){
+        fprintf(stderr, "can't save checkpoint %s\n", checkpoint);
+      }
+    }
+  }
+  for(long i=0; i<threads; i++){
+    if(!pthread_equal(pool.workers[i].thread, pthread_self())){
+      pthread_join(pool.workers[i].thread, NULL);
+    }
+  }
+  std::vector<Range> left = remaining(&pool);
+  if(checkpoint && !saveCheckpoint(checkpoint, &rules, left)){
+    fprintf(stderr, "can't save checkpoint %s\n", checkpoint);
+  }
+  double t = seconds(start);
+  uint64_t done = pool.checked + pool.pruned;
+  fprintf(stderr, "%llu candidates in %.1fs: %llu pruned by checksum, %llu seeds checked, %.1f candidates/s, %.1f seeds/s\n",
+          (unsigned long long)done, t, (unsigned long long)pool.pruned, (unsigned long long)pool.checked,
+          done / t, pool.checked / t);
+  if(!left.empty()){
+    fprintf(stderr, "stopped with %zu ranges left%s\n", left.size(), checkpoint ? ", saved to the checkpoint" : "");
+  }
+  if(pool.found == 0){
+    fprintf(stderr, left.empty() ? "nothing found\n" : "nothing found yet\n");
+    return 2;
+  }
+  return 0;
+}
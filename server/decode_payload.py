@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""
+Reference decoder for the LNURLPoS `p=` payload.
+
+    <variant><len|nonce><len|encrypted payload><8-byte hmac>
+
+variant 1 - payload xored with HMAC(key, "Round secret:" + nonce)
+variant 2 - payload encrypted with AES-256-CTR, key HMAC(key, "AES key:" + nonce),
+            counter starting at zero
+
+Both variants authenticate everything before the hmac with
+HMAC(key, "Data:" + data)[:8]. The payload is <pin><amount><currency byte>
+with pin and amount as compact ints; variant 2 may carry extra bytes after them.
+
+Usage: decode_payload.py KEY PAYLOAD
+"""
+import base64
+import hashlib
+import hmac
+import sys
+
+
+def _xtime(x):
+    return ((x << 1) ^ (0x1B if x & 0x80 else 0)) & 0xFF
+
+
+def _gf_mul(a, b):
+    r = 0
+    while b:
+        if b & 1:
+            r ^= a
+        a = _xtime(a)
+        b >>= 1
+    return r
+
+
+def _make_sbox():
+    sbox = []
+    for x in range(256):
+        inv = 0
+        if x:
+            inv = 1
+            for _ in range(254):
+                inv = _gf_mul(inv, x)
+        s = inv
+        for i in range(1, 5):
+            s ^= ((inv << i) | (inv >> (8 - i))) & 0xFF
+        sbox.append(s ^ 0x63)
+    return sbox
+
+
+SBOX = _make_sbox()
+
+
+def _expand_key(key):
+    nk = len(key) // 4
+    rounds = nk + 6
+    w = [list(key[4 * i:4 * i + 4]) for i in range(nk)]
+    rcon = 1
+    for i in range(nk, 4 * (rounds + 1)):
+        t = list(w[i - 1])
+        if i % nk == 0:
+            t = [SBOX[b] for b in t[1:] + t[:1]]
+            t[0] ^= rcon
+            rcon = _xtime(rcon)
+        elif nk > 6 and i % nk == 4:
+            t = [SBOX[b] for b in t]
+        w.append([a ^ b for a, b in zip(w[i - nk], t)])
+    return [sum(w[4 * r:4 * r + 4], []) for r in range(rounds + 1)]
+
+
+def aes_encrypt_block(round_keys, block):
+    s = [a ^ b for a, b in zip(block, round_keys[0])]
+    for r in range(1, len(round_keys)):
+        s = [SBOX[b] for b in s]
+        s = [s[(4 * (c + i) + i) % 16] for c in range(4) for i in range(4)]
+        if r != len(round_keys) - 1:
+            m = []
+            for c in range(4):
+                a = s[4 * c:4 * c + 4]
+                t = a[0] ^ a[1] ^ a[2] ^ a[3]
+                m += [a[i] ^ t ^ _xtime(a[i] ^ a[(i + 1) % 4]) for i in range(4)]
+            s = m
+        s = [a ^ b for a, b in zip(s, round_keys[r])]
+    return bytes(s)
+
+
+def aes_ctr_xor(key, data, iv=bytes(16)):
+    round_keys = _expand_key(key)
+    counter = int.from_bytes(iv, "big")
+    out = bytearray()
+    for i in range(0, len(data), 16):
+        block = aes_encrypt_block(round_keys, counter.to_bytes(16, "big"))
+        out += bytes(a ^ b for a, b in zip(data[i:i + 16], block))
+        counter = (counter + 1) % (1 << 128)
+    return bytes(out)
+
+
+def read_varint(data, pos):
+    """Bitcoin compact int"""
+    v = data[pos]
+    if v < 0xFD:
+        return v, pos + 1
+    size = {0xFD: 2, 0xFE: 4, 0xFF: 8}[v]
+    return int.from_bytes(data[pos + 1:pos + 1 + size], "little"), pos + 1 + size
+
+
+def decode(key, payload):
+    """
+    Returns dict with pin, amount, currency and extra fields.
+    key is the PoS key string, payload is the base64url `p` parameter or raw bytes.
+    Raises ValueError if the payload is malformed or not authentic.
+    """
+    if isinstance(key, str):
+        key = key.encode()
+    if isinstance(payload, str):
+        payload = base64.urlsafe_b64decode(payload + "=" * (-len(payload) % 4))
+    try:
+        variant = payload[0]
+        nonce_len = payload[1]
+        nonce = payload[2:2 + nonce_len]
+        pos = 2 + nonce_len
+        payload_len = payload[pos]
+        encrypted = payload[pos + 1:pos + 1 + payload_len]
+        end = pos + 1 + payload_len
+    except IndexError:
+        raise ValueError("payload is too short")
+    if len(encrypted) != payload_len or len(payload) != end + 8:
+        raise ValueError("invalid payload length")
+    expected = hmac.new(key, b"Data:" + payload[:end], hashlib.sha256).digest()[:8]
+    if not hmac.compare_digest(expected, payload[end:]):
+        raise ValueError("invalid hmac")
+    if variant == 1:
+        secret = hmac.new(key, b"Round secret:" + nonce, hashlib.sha256).digest()
+        if payload_len > len(secret):
+            raise ValueError("xor payload is too long")
+        data = bytes(a ^ b for a, b in zip(encrypted, secret))
+    elif variant == 2:
+        aes_key = hmac.new(key, b"AES key:" + nonce, hashlib.sha256).digest()
+        data = aes_ctr_xor(aes_key, encrypted)
+    else:
+        raise ValueError("unknown variant %d" % variant)
+    try:
+        pin, pos = read_varint(data, 0)
+        amount, pos = read_varint(data, pos)
+        currency = data[pos:pos + 1]
+    except (IndexError, KeyError):
+        raise ValueError("invalid payload")
+    if len(currency) != 1:
+        raise ValueError("invalid payload")
+    return {
+        "variant": variant,
+        "pin": pin,
+        "amount": amount,
+        # variant 1 devices leave the currency byte unset
+        "currency": chr(currency[0]) if variant != 1 else None,
+        "extra": data[pos + 1:],
+    }
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print(__doc__.strip().splitlines()[-1])
+        sys.exit(1)
+    print(decode(sys.argv[1], sys.argv[2]))